@@ -0,0 +1,157 @@
+#include "autotune.hpp"
+
+#include <cmath>
+
+bool StepTuner::add(const TelemetrySample& s)
+{
+    if (n_ >= MAX_POINTS) return false;
+    pts_[n_++] = { (float)s.t_ms / 1000.0f, s.dispensed, s.servo };
+    return true;
+}
+
+// Solve the symmetric 3x3 system a x = b; false when singular
+static bool solve3(const float a[3][3], const float b[3], float x[3])
+{
+    float m[3][4];
+    for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) m[r][c] = a[r][c];
+        m[r][3] = b[r];
+    }
+    for (int c = 0; c < 3; c++) {
+        int p = c;
+        for (int r = c + 1; r < 3; r++) {
+            if (std::fabs(m[r][c]) > std::fabs(m[p][c])) p = r;
+        }
+        if (std::fabs(m[p][c]) < 1e-9f) return false;
+        if (p != c) {
+            for (int k = 0; k < 4; k++) { float t = m[c][k]; m[c][k] = m[p][k]; m[p][k] = t; }
+        }
+        for (int r = c + 1; r < 3; r++) {
+            float f = m[r][c] / m[c][c];
+            for (int k = c; k < 4; k++) m[r][k] -= f * m[c][k];
+        }
+    }
+    for (int r = 2; r >= 0; r--) {
+        float s = m[r][3];
+        for (int k = r + 1; k < 3; k++) s -= m[r][k] * x[k];
+        x[r] = s / m[r][r];
+    }
+    return true;
+}
+
+// Grams the model's flow change has added by t_s after the step (unit flow
+// change): the integral of 1 - exp(-(t - dead) / tau) from dead on
+static float ramp(float t_s, float dead, float tau)
+{
+    float x = t_s - dead;
+    if (x <= 0.0f) return 0.0f;
+    return x - tau * (1.0f - std::exp(-x / tau));
+}
+
+float StepTuner::sse(int from, float t_step, float dead, float tau, float* coef) const
+{
+    // Model: grams = a + b (t - t_step) + c ramp(t - t_step), relative to
+    // the first fitted sample (keeps the float sums small)
+    const float y0 = pts_[from].dispensed;
+    float ata[3][3] = {}, aty[3] = {};
+    for (int i = from; i < n_; i++) {
+        float t = pts_[i].t_s - t_step;
+        float row[3] = { 1.0f, t, ramp(t, dead, tau) };
+        float y = pts_[i].dispensed - y0;
+        for (int r = 0; r < 3; r++) {
+            for (int k = 0; k < 3; k++) ata[r][k] += row[r] * row[k];
+            aty[r] += row[r] * y;
+        }
+    }
+    float x[3];
+    if (!solve3(ata, aty, x)) return INFINITY;
+
+    float sum = 0.0f;
+    for (int i = from; i < n_; i++) {
+        float t = pts_[i].t_s - t_step;
+        float e = pts_[i].dispensed - y0 - (x[0] + x[1] * t + x[2] * ramp(t, dead, tau));
+        sum += e * e;
+    }
+    if (coef) { coef[0] = x[0]; coef[1] = x[1]; coef[2] = x[2]; }
+    return sum;
+}
+
+bool StepTuner::fit(StepModel& out) const
+{
+    if (n_ < 2) return false;
+
+    // The step: first sample logged with the gate MIN_STEP_DEG above where
+    // the run started. Its servo value is the command issued after that
+    // sample was captured, so the step time is the sample's own time.
+    const float lo = pts_[0].servo;
+    int j = 1;
+    while (j < n_ && pts_[j].servo - lo < MIN_STEP_DEG) j++;
+    if (j >= n_) return false;
+    float hi = 0.0f;
+    for (int i = j; i < n_; i++) hi += pts_[i].servo;
+    hi /= (float)(n_ - j);
+    const float t_step = pts_[j].t_s;
+
+    int from = 0;
+    while (from < j && pts_[from].t_s < t_step - PRE_STEP_S) from++;
+    if (j - from < 5 || n_ - j < 10) return false;   // too little on one side
+
+    // Coarse grid, then one refinement around the best cell. tau is spaced
+    // geometrically: 20 ms and 40 ms differ as much as 1.5 s and 3 s.
+    constexpr int G = 16;
+    const float tau_min = 0.02f;
+    const float tau_ratio = std::pow(MAX_TAU_S / tau_min, 1.0f / (float)(G - 1));
+    float best = INFINITY, best_dead = 0.0f, best_tau = tau_min;
+    for (int a = 0; a < G; a++) {
+        float dead = MAX_DEAD_S * (float)a / (float)(G - 1);
+        float tau = tau_min;
+        for (int b = 0; b < G; b++, tau *= tau_ratio) {
+            float e = sse(from, t_step, dead, tau, nullptr);
+            if (e < best) { best = e; best_dead = dead; best_tau = tau; }
+        }
+    }
+    const float dead_step = MAX_DEAD_S / (float)(G - 1);
+    const float d0 = best_dead, t0 = best_tau;
+    for (int a = -4; a <= 4; a++) {
+        float dead = d0 + dead_step * (float)a / 4.0f;
+        if (dead < 0.0f) continue;
+        for (int b = -4; b <= 4; b++) {
+            float tau = t0 * std::pow(tau_ratio, (float)b / 4.0f);
+            float e = sse(from, t_step, dead, tau, nullptr);
+            if (e < best) { best = e; best_dead = dead; best_tau = tau; }
+        }
+    }
+    if (!std::isfinite(best)) return false;
+
+    float x[3] = {};
+    sse(from, t_step, best_dead, best_tau, x);
+    const float c = x[2];
+    const float du = hi - lo;
+    if (c <= 0.0f || du < MIN_STEP_DEG) return false;   // the gate opened, flow didn't rise
+    // A flow change lost in the noise (empty hopper) fits too, as a tiny k
+    // that would propose huge gains
+    const float rms = std::sqrt(best / (float)(n_ - from));
+    if (c * ramp(pts_[n_ - 1].t_s - t_step, best_dead, best_tau) < MIN_RISE_RMS * rms) return false;
+
+    out.k        = c / du;
+    out.dead_s   = best_dead;
+    out.tau_s    = best_tau;
+    out.base_gps = x[1];
+    out.du_deg   = du;
+    out.rms_g    = rms;
+    return true;
+}
+
+PidProposal StepTuner::propose(const StepModel& m, float tc_s)
+{
+    // tc below the dead time asks for more than the loop can deliver (SIMC's
+    // own recommendation is tc = dead for tight control)
+    float tc = tc_s > m.dead_s ? tc_s : m.dead_s;
+    float lag = tc + m.dead_s;
+    if (lag < 0.05f) lag = 0.05f;
+    float kc = 1.0f / (m.k * lag);
+    float ti = 4.0f * lag;
+    float td = m.tau_s;
+    // Series -> parallel: Kc (1 + Td/Ti), Kc / Ti, Kc Td
+    return { kc * (1.0f + td / ti), kc / ti, kc * td };
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include "telem_codec.hpp"   // TelemetrySample
+
+// PID autotune from a step test.
+//
+// The experiment (app/control.cpp, WebCommand::Autotune) holds the gate at a
+// low opening until the flow is steady, then steps it to a high one, open
+// loop, while the run's telemetry is logged as usual. From those samples
+// StepTuner fits a first-order-plus-dead-time model of flow versus gate angle:
+//
+//     flow(t) = base + k * du * (1 - exp(-(t - dead) / tau))    for t > dead
+//
+// and since the PID's input is the dispensed grams - the integral of the
+// flow - the fit is done on the grams themselves (no differentiated noise).
+// For a given dead time and time constant the model is linear in its three
+// remaining unknowns (grams at the step, base flow, flow change), so a grid
+// over (dead, tau), refined once around the best cell, with a 3x3 least
+// squares solve per cell finds it.
+//
+// propose() turns the model into gains with the SIMC rules for an integrating
+// process with lag (Skogestad 2003): angle -> grams is k e^-(dead s) /
+// (s (tau s + 1)), so with closed-loop time constant tc
+//     Kc = 1 / (k (tc + dead)),  Ti = 4 (tc + dead),  Td = tau   (series PID)
+// converted to the parallel form the PID class uses. tc is the one knob:
+// larger is gentler (less overshoot at the end of a run).
+//
+// No Pico SDK dependencies: the fit runs on core 0 after the run, or on a
+// host against a recorded or synthetic run.
+
+struct StepModel {
+    float k;         // g/s of flow per degree of gate opening
+    float dead_s;    // dead time (filter, servo travel, grain leaving the gate)
+    float tau_s;     // flow time constant
+    float base_gps;  // flow before the step (at the low opening)
+    float du_deg;    // step size
+    float rms_g;     // fit residual
+};
+
+struct PidProposal {
+    float kp, ki, kd;   // user units, as /api/pid takes them
+};
+
+class StepTuner {
+public:
+    static constexpr int   MAX_POINTS  = 512;     // ~12 s at the 40 Hz filter rate
+    static constexpr float PRE_STEP_S  = 1.5f;    // fit window before the step
+    static constexpr float MIN_STEP_DEG = 5.0f;
+    static constexpr float MAX_DEAD_S  = 1.5f;
+    static constexpr float MAX_TAU_S   = 3.0f;
+    static constexpr float MIN_RISE_RMS = 10.0f;  // grams the step added, in fit residuals
+
+    void reset() { n_ = 0; }
+    // One logged sample, in order; false when full (the rest is ignored)
+    bool add(const TelemetrySample& s);
+    int  count() const { return n_; }
+
+    // False when the samples hold no usable step (none found, no flow change
+    // above the noise, or the fit is degenerate)
+    bool fit(StepModel& out) const;
+
+    static PidProposal propose(const StepModel& m, float tc_s);
+
+private:
+    struct Point { float t_s, dispensed, servo; };
+
+    // Least squares for one (dead, tau): sum of squared residuals, and the
+    // fitted {grams at the first sample, base flow, flow change} when wanted
+    float sse(int from, float t_step, float dead, float tau, float* coef) const;
+
+    Point pts_[MAX_POINTS];
+    int   n_ = 0;
+};
@@ -0,0 +1,101 @@
+#include "bag_level.hpp"
+
+#include <cmath>
+#include <cstring>
+
+int BagTracker::count() const
+{
+    int n = 0;
+    while (n < BAG_DAYS && log_.days[n].day != 0) n++;
+    return n;
+}
+
+BagDay* BagTracker::today()
+{
+    if (day_ <= 0 || day_ > 0xFFFF) return nullptr;
+    int n = count();
+    // A clock set back (another phone) keeps counting on the newest day:
+    // the log stays in order
+    if (n > 0 && log_.days[n - 1].day >= (uint16_t)day_) return &log_.days[n - 1];
+    if (n == BAG_DAYS) {
+        std::memmove(&log_.days[0], &log_.days[1], sizeof(BagDay) * (BAG_DAYS - 1));
+        n--;
+    }
+    log_.days[n] = BagDay{};
+    log_.days[n].day = (uint16_t)day_;
+    dirty_ = true;
+    return &log_.days[n];
+}
+
+void BagTracker::set_day(int32_t day)
+{
+    if (day == day_) return;
+    day_ = day;
+    for (int i = 0; i < 3; i++) {
+        if (pending_[i] <= 0.0f) continue;
+        float g = pending_[i];
+        pending_[i] = 0.0f;
+        used(i, g);
+    }
+}
+
+void BagTracker::used(int scale, float grams)
+{
+    if (scale < 0 || scale > 2 || !(grams > 0.0f)) return;
+    BagDay* d = today();
+    if (!d) {
+        pending_[scale] += grams;
+        return;
+    }
+    part_[scale] += grams;
+    int tens = (int)(part_[scale] / 10.0f);
+    if (tens <= 0) return;
+    part_[scale] -= (float)tens * 10.0f;
+    uint32_t v = (uint32_t)d->g10[scale] + (uint32_t)tens;
+    d->g10[scale] = (uint16_t)(v > 0xFFFF ? 0xFFFF : v);
+    dirty_ = true;
+}
+
+void BagTracker::set_reserve(int scale, float gross)
+{
+    if (scale < 0 || scale > 2) return;
+    uint16_t r = 0;   // default
+    if (gross >= 0.0f) {
+        float g = gross > MAX_RESERVE_G ? MAX_RESERVE_G : gross;
+        r = (uint16_t)(g + 0.5f);
+        if (r == 0) r = 1;   // 0 is "default": an empty sack of ~nothing
+    }
+    if (log_.reserve_g[scale] == r) return;
+    log_.reserve_g[scale] = r;
+    dirty_ = true;
+}
+
+float BagTracker::reserve(int scale) const
+{
+    uint16_t r = log_.reserve_g[scale];
+    return r ? (float)r : DEFAULT_RESERVE_G;
+}
+
+BagStatus BagTracker::status(int scale, float gross, float target) const
+{
+    BagStatus b;
+    b.reserve_g = reserve(scale);
+    b.avail_g = gross - b.reserve_g;
+    if (b.avail_g < 0.0f) b.avail_g = 0.0f;
+    if (target >= 1.0f) {
+        float usable = b.avail_g - BAG_MARGIN_G;
+        b.runs_left = usable >= target ? (int)(usable / target) : 0;
+    }
+
+    // Calendar days from the first logged one to today, idle days included
+    int n = count();
+    if (n > 0) {
+        uint32_t sum = 0;
+        for (int k = 0; k < n; k++) sum += log_.days[k].g10[scale];
+        int32_t last = day_ > (int32_t)log_.days[n - 1].day ? day_ : (int32_t)log_.days[n - 1].day;
+        int32_t span = last - (int32_t)log_.days[0].day + 1;
+        b.rate_gpd = (float)sum * 10.0f / (float)span;
+        if (b.rate_gpd > 0.0f) b.days_left = b.avail_g / b.rate_gpd;
+    }
+    return b;
+}
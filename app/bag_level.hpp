@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include "dispenser_state.h"   // BagLog, BagStatus
+
+// Bag level and consumption, per scale.
+//
+// The gross weight (vs the calibrated zero, unaffected by tare) is the bag
+// itself, so the grain left to dispense is
+//
+//     available = gross - reserve
+//
+// where the reserve is the gross weight at which the bag stops flowing: the
+// empty sack plus the grain that never leaves it. It starts at
+// DEFAULT_RESERVE_G and is learned from the first run that stops on an empty
+// bag (core 1's no-flow stop, app/control.cpp), or set from /api/bag.
+//
+// Every run's grams are added to the day's entry of a small log (BAG_DAYS
+// calendar days, oldest dropped), kept in flash (BagConfig); the average over
+// it gives grams per day and so the days the bag lasts. The firmware has no
+// clock of its own: the web page sets the calendar day (set_day). Runs before
+// that are held and counted on the first day it learns.
+//
+// No Pico SDK dependencies: main.cpp feeds the runs and the clock, reads the
+// status and persists log() when dirty().
+
+class BagTracker {
+public:
+    static constexpr float DEFAULT_RESERVE_G = 150.0f;
+    static constexpr float MAX_RESERVE_G     = 20000.0f;
+
+    // Boot: the log from flash
+    void restore(const BagLog& l) { log_ = l; }
+    const BagLog& log() const { return log_; }
+    bool dirty() const { return dirty_; }
+    void saved() { dirty_ = false; }
+
+    // Local calendar day (days since 1970); < 0 = not known yet
+    void set_day(int32_t day);
+
+    // A run on the scale dispensed grams
+    void used(int scale, float grams);
+
+    // The flow stopped with the gate wide open at this gross weight
+    void empty_at(int scale, float gross) { set_reserve(scale, gross); }
+    // < 0: back to DEFAULT_RESERVE_G
+    void set_reserve(int scale, float gross);
+    float reserve(int scale) const;
+
+    // For a run of target grams, at this gross weight
+    BagStatus status(int scale, float gross, float target) const;
+
+private:
+    int  count() const;   // days in use
+    BagDay* today();      // the current day's entry, appended when new
+
+    BagLog  log_;
+    int32_t day_ = -1;
+    float   pending_[3] = {0, 0, 0};   // before the day is known
+    float   part_[3] = {0, 0, 0};      // grams not yet a whole 10 g in the log
+    bool    dirty_ = false;
+};
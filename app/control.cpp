@@ -0,0 +1,691 @@
+#include "control.hpp"
+
+#include <cstdio>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/flash.h"
+
+#include "spsc_queue.h"
+#include "Servo.hpp"
+#include "Vibrator.hpp"
+#include "PID.hpp"
+#include "telemetry.hpp"
+#include "flow_model.hpp"
+
+// ---------------------------------------------------------------- queues ----
+
+static SpscQueue<WebCmd, 16>        s_cmds;     // core 0 -> core 1
+static SpscQueue<ControlStatus, 4>  s_status;   // core 1 -> core 0
+
+// =================================================================== core 1 ==
+
+static hx711**    s_scales    = nullptr;
+static Servo**    s_servos    = nullptr;
+static Vibrator** s_vibrators = nullptr;
+
+// Core 1's copy of the servo zeros (SetServoZero), read through the
+// servo_min_open / servo_close helpers in dispenser_state.h
+static float s_servo_zero[3] = {-1.0f, -1.0f, -1.0f};
+
+static ControlStatus s_st;   // built here, published by value every period
+
+// Tare/calibration requested by core 0, per scale (id 0 = none)
+static uint16_t s_link_op[3]  = {0, 0, 0};
+static bool     s_link_cal[3] = {false, false, false};
+
+// Servo release: close first, cut the PWM once the arm got there
+static constexpr uint32_t SERVO_RELEASE_US = 300000;
+static absolute_time_t s_release_at[3];
+static bool            s_release_pending[3] = {false, false, false};
+
+// --- Dispense runs (moved here from DispenseScreen) ---
+// One controller per scale, so all three gates can run at once (a mix of
+// wheat, spelt and rye in one go): each has its own PID state, slew limiter,
+// done confirmation, feedforward and telemetry stream, and its own tuned
+// gains (each gate and grain is autotuned on its own). The schedule below is
+// shared.
+struct Tuning { double kp = 1.5, ki = 0.08, kd = 0.8; };
+static Tuning s_tuning[3];
+
+struct Run {
+    // The PID object holds pointers to these - static storage (s_run)
+    double pid_input = 0.0, pid_output = 0.0, pid_setpoint = 0.0;
+    PID*   pid = nullptr;
+
+    bool     running = false;
+    bool     have_run = false;     // a run happened: keep tracking the scale
+    int      target_g = 0;
+    // NOTE: Weight DECREASES as corn is dispensed from the hanging bag
+    float    start_weight = 0.0f;
+    uint32_t start_us = 0;         // telemetry time base (HX711 capture clock)
+
+    // Start-of-run tare runs alongside the first PID ticks. dispensed =
+    // start - current is anchored to the reading taken at start, so when the
+    // new zero lands both terms shift together: start is re-based by the
+    // offset change.
+    bool     taring = false;
+    int32_t  tare_offset0 = 0;
+
+    uint32_t sample_ms = 100;      // PID sample time: the scale's filtered output period
+    int      done_confirm_samples = 3;
+    int      done_streak = 0;
+    float    servo_cmd = 0.0f;     // slew-limited gate angle
+
+    FlowFeedforward ff;
+    bool     ff_on = false;
+    bool     settling = false;     // closed: in-flight grams landing
+
+    // Empty-bag watch: reset whenever the gate is below wide open or grain
+    // came since
+    uint32_t flow_check_us = 0;
+    float    flow_check_g = 0.0f;
+
+    bool     tune = false;         // autotune step test instead of a dispense
+    float    tune_open = 0.0f;     // step opening above the flow start
+    uint32_t tune_sample_us = 0;   // capture time of the last sample used
+};
+static Run s_run[3];
+
+// Done-confirmation: the tail readings wobble +-1.5 g (vibrator shakes the
+// scale), so a single sample >= target is usually an upward noise spike -
+// closing on it left the SETTLED weight 2-3 g under target. The reading
+// must hold at/above target for this long, counted in fresh samples.
+static constexpr uint32_t DONE_CONFIRM_MS = 300;
+
+// Servo slew limit: a full 9 kg bag swings like a pendulum when the gate
+// slams (CSV: readings bouncing +-35 g while the servo jumped 108<->180
+// between samples, each exciting the other). The gate glides at most this fast.
+static constexpr float SERVO_SLEW_DEG_PER_S = 100.0f;
+
+// Gain schedule by grams remaining, as multiples of the tuned (web) gains:
+// push harder while far away, soften P and I for the last grams where the
+// falling column overshoots. Interpolated in between, end points hold.
+struct GainScale { float remaining_g, kp, ki, kd; };
+static constexpr GainScale GAIN_SCHEDULE[] = {
+    {  10.0f, 0.6f, 0.5f, 1.0f },
+    {  40.0f, 1.0f, 1.0f, 1.0f },
+    { 200.0f, 1.5f, 1.0f, 0.8f },
+};
+// Back-calculation tracking time: the integrator follows the slew-limited
+// servo instead of winding up while the arm glides. About sqrt(Ti * Td) for
+// the default tuning (Ti = Kp/Ki ~19 s, Td = Kd/Kp ~0.5 s); much faster
+// tracking soaks the D kick and the falling P term into the integrator while
+// the arm slews, and it comes back as opening at the end of the run
+// (tests/pid_sim_bench: +19 g on a 50 g dispense at 0.5 per sample).
+static constexpr double PID_TRACKING_S = 3.0;
+
+// Vibrator: assist the tail of the run; starts early because the motor takes
+// a moment to spin up
+static constexpr float VIB_ASSIST_REMAINING_G = 80.0f;
+static constexpr float VIB_ASSIST_INTENSITY   = 0.6f;
+
+// Feedforward (app/flow_model.hpp): each scale learns its gate's flow curve
+// from its runs. Once learned, the gate goes to the model's opening for the
+// flow the remaining grams need and the PID only trims around it (+-15 deg);
+// until then the PID drives the angle alone, as before. The gate also closes
+// early by the grams predicted to land after the close (learned in-flight
+// mass plus the flow over the learned close lag), on every run once a first
+// close has been measured; every close, early or confirmed, refines them.
+static constexpr float FF_TRIM_DEG = 15.0f;
+static FlowModel       s_flow[3];
+
+// Empty bag: with the gate wide open (within 1 deg of the PID ceiling) for
+// NO_FLOW_MS and less than NO_FLOW_G coming out, the run ends instead of
+// holding the gate open forever. RunStatus::no_flow tells core 0, which
+// takes the bag's gross weight there as its empty level (app/bag_level.hpp).
+static constexpr uint32_t NO_FLOW_MS = 3000;
+static constexpr float    NO_FLOW_G  = 2.0f;
+
+// Autotune step test (app/autotune.hpp): open loop, PID off. The gate holds
+// at half the step opening until the flow is steady, then steps to the full
+// opening; the run ends TUNE_STEP_MS later or at the gram cap (the run's
+// target), whichever comes first. Telemetry is logged as in any run - the
+// fit on core 0 reads it back from there.
+static constexpr uint32_t TUNE_HOLD_MS = 3000;
+static constexpr uint32_t TUNE_STEP_MS = 4000;
+
+static uint32_t run_ms(const Run& r)
+{
+    return (time_us_32() - r.start_us) / 1000;
+}
+
+// Scale i's gains into its PID. Not while its run is going: new gains wait
+// in s_tuning for the next start_run.
+static void apply_gains(int i)
+{
+    Run& r = s_run[i];
+    if (r.running) return;
+    const Tuning& t = s_tuning[i];
+    PID::GainPoint pts[count_of(GAIN_SCHEDULE)];
+    for (unsigned k = 0; k < count_of(GAIN_SCHEDULE); k++) {
+        const GainScale& g = GAIN_SCHEDULE[k];
+        pts[k] = { g.remaining_g, t.kp * g.kp, t.ki * g.ki, t.kd * g.kd };
+    }
+    r.pid->SetTunings(t.kp, t.ki, t.kd);
+    r.pid->SetGainSchedule(pts, (int)count_of(GAIN_SCHEDULE));
+}
+
+static void finish_link_op(int i, bool ok)
+{
+    s_st.scale[i].op_id = s_link_op[i];
+    s_st.scale[i].op_ok = ok ? 1 : 0;
+    s_link_op[i] = 0;
+}
+
+static void close_and_release(int i)
+{
+    s_servos[i]->writeDegrees(servo_close(s_servo_zero[i]));
+    s_vibrators[i]->off();
+    s_release_at[i] = make_timeout_time_us(SERVO_RELEASE_US);
+    s_release_pending[i] = true;
+}
+
+static void end_run(int i, bool done, float dispensed)
+{
+    Run& r = s_run[i];
+    RunStatus& rs = s_st.run[i];
+    close_and_release(i);
+    r.pid->SetMode(MANUAL);
+    if (r.taring) s_scales[i]->cancel_op();
+    r.taring = false;
+    r.running = false;
+    rs.dispensing = false;
+    rs.done = done;
+    rs.final_dispensed = dispensed;
+    rs.servo_angle = servo_close(s_servo_zero[i]);
+    rs.vib = 0.0f;
+    rs.seq++;
+    rs.in_flight = r.ff.on_close(run_ms(r), dispensed);
+    r.settling = true;
+    rs.settling = true;
+}
+
+// The in-flight grams landed: what the scale shows now is the run's result
+static void end_settle(int i, float dispensed)
+{
+    RunStatus& rs = s_st.run[i];
+    s_run[i].settling = false;
+    rs.settling = false;
+    rs.settled = dispensed;
+    rs.settled_seq++;
+}
+
+// tune_open > 0: an autotune step test to that opening instead of a dispense
+static void start_run(int scale, int target_g, float tune_open = 0.0f)
+{
+    // Still settling: the last close's landing is its result and a lesson
+    // for the in-flight model (core 0 waits for it too)
+    if (scale < 0 || scale > 2 || s_run[scale].running || s_run[scale].settling) return;
+    Run& r = s_run[scale];
+    hx711* sc = s_scales[scale];
+
+    // Anything still zeroing/calibrating this scale is dropped
+    if (s_link_op[scale]) {
+        sc->cancel_op();
+        finish_link_op(scale, false);
+    }
+    s_release_pending[scale] = false;
+
+    // Anchor on the current (filtered) reading and zero in the background:
+    // one 10 SPS conversion or eight at 80 SPS, no settling discard
+    r.target_g = target_g;
+    r.start_weight = sc->read_weight();
+    r.tare_offset0 = sc->get_offset();
+    r.taring = sc->begin_tare(1, 0);
+
+    apply_gains(scale);   // any SetPID that came in during the last run
+    r.pid_setpoint = (double)target_g;
+    r.pid_input = 0.0;
+    r.ff.begin(&s_flow[scale]);
+    r.ff_on = s_flow[scale].learned();
+    r.settling = false;
+    // Working range of THIS scale's servo: calibrated zero up to zero + 80 deg
+    // (mechanical end stop ~75 deg past zero), or the 85-170 default. With the
+    // feedforward on, the PID output is a trim added to the model's angle.
+    if (r.ff_on) r.pid->SetOutputLimits(-FF_TRIM_DEG, FF_TRIM_DEG);
+    else r.pid->SetOutputLimits(servo_min_open(s_servo_zero[scale]), servo_max_open(s_servo_zero[scale]));
+    // One PID compute per filtered value, so every compute sees a genuinely
+    // new sample (Arduino PID rescales Ki/Kd with it)
+    uint32_t period_us = sc->output_period_us();
+    if (period_us < 10000) period_us = 10000;
+    r.sample_ms = period_us / 1000;
+    r.pid->SetSampleTimeUs(period_us);
+    r.pid->SetDerivativeFilter(2.0 * period_us / 1000.0);   // ~2 samples
+    r.pid->SetAntiWindup(AW_BACK_CALC, period_us / 1e6 / PID_TRACKING_S);   // Kt per sample
+    r.done_confirm_samples = (int)((DONE_CONFIRM_MS + r.sample_ms - 1) / r.sample_ms);
+    // Seed the output at the floor before enabling: SetMode's bumpless
+    // transfer latches the CURRENT output into the integrator, and with a tiny
+    // Ki a stale value from the last run never bleeds off - the gate then rides
+    // ~50 deg above the floor for the whole run (CSV runs 2-4: i_term 150-175).
+    // Seeded at the floor, the end-phase tapers to just above the flow-start
+    // point: angle = zero + Kp * grams_remaining.
+    r.pid_output = r.ff_on ? 0.0 : (double)servo_min_open(s_servo_zero[scale]);
+    r.tune = tune_open > 0.0f;
+    r.tune_open = tune_open;
+    r.tune_sample_us = sc->last_sample_us();
+    if (!r.tune) r.pid->SetMode(AUTOMATIC);
+
+    r.start_us = time_us_32();
+    r.flow_check_us = r.start_us;
+    r.flow_check_g = 0.0f;
+    r.done_streak = 0;
+    r.servo_cmd = servo_min_open(s_servo_zero[scale]);
+    r.running = true;
+    r.have_run = true;
+    s_st.run[scale].dispensing = true;
+    s_st.run[scale].dispensed = 0.0f;
+    s_st.run[scale].no_flow = false;
+}
+
+// One control period of a step test. The gate only moves on a fresh sample,
+// so each logged servo value is exactly the command issued right after that
+// sample was captured (the fit takes the step time from it).
+static void step_tune(int i, float dispensed, float current_grams, float current_gross)
+{
+    Run& r = s_run[i];
+    uint32_t sample_us = s_scales[i]->last_sample_us();
+    if (sample_us == r.tune_sample_us) return;
+    r.tune_sample_us = sample_us;
+
+    int32_t age_us = (int32_t)(sample_us - r.start_us);
+    uint32_t t_ms = age_us > 0 ? (uint32_t)age_us / 1000 : 0;
+
+    const float zero = servo_min_open(s_servo_zero[i]);
+    const float top  = servo_max_open(s_servo_zero[i]);
+    r.ff.update(t_ms, dispensed, r.servo_cmd - zero);   // two openings: flow model points too
+    float want = zero + (t_ms < TUNE_HOLD_MS ? 0.5f * r.tune_open : r.tune_open);
+    r.servo_cmd = want > top ? top : want;
+    s_servos[i]->writeDegrees(r.servo_cmd);
+    s_st.run[i].servo_angle = r.servo_cmd;
+
+    TelemetrySample ts;
+    ts.t_ms      = t_ms;
+    ts.setpoint  = (float)r.target_g;   // the gram cap
+    ts.dispensed = dispensed;
+    ts.weight    = current_grams;
+    ts.gross     = current_gross;
+    ts.servo     = r.servo_cmd;
+    ts.p = ts.i = ts.d = 0.0f;
+    ts.vib       = 0.0f;
+    telem_append((uint8_t)i, ts);
+
+    // Complete (done) only when the step response was recorded in full
+    if (dispensed >= (float)r.target_g) end_run(i, false, dispensed);
+    else if (t_ms >= TUNE_HOLD_MS + TUNE_STEP_MS) end_run(i, true, dispensed);
+}
+
+static void step_run(int i, float current_grams, float current_gross)
+{
+    Run& r = s_run[i];
+    RunStatus& rs = s_st.run[i];
+    hx711* sc = s_scales[i];
+    if (r.taring) {
+        HxOpStatus st = sc->poll_op();
+        if (st != HxOpStatus::Busy) {
+            r.taring = false;
+            if (st == HxOpStatus::Done) {
+                float shift = (float)(sc->get_offset() - r.tare_offset0) / sc->get_scale();
+                r.start_weight -= shift;
+                current_grams  -= shift;   // same sample, new zero
+            }
+        }
+    }
+    float dispensed = r.start_weight - current_grams;
+    rs.dispensed = dispensed;
+    if (!r.running) {
+        // Keep tracking after the close until the in-flight grams landed
+        if (r.settling && r.ff.settle(run_ms(r), dispensed)) end_settle(i, dispensed);
+        return;
+    }
+    if (r.tune) {
+        step_tune(i, dispensed, current_grams, current_gross);
+        return;
+    }
+
+    // PID control - input is dispensed amount, setpoint is target; the
+    // output is the servo angle directly (like Arduino), or the trim on top
+    // of the feedforward angle
+    r.pid_input = (double)dispensed;
+    bool pid_computed = r.pid->Compute();
+    float remaining = (float)r.target_g - dispensed;
+
+    // Sample capture time since the run started (telemetry time base)
+    int32_t age_us = (int32_t)(sc->last_sample_us() - r.start_us);
+    uint32_t t_ms = age_us > 0 ? (uint32_t)age_us / 1000 : 0;
+
+    // Slew-limit the commanded angle: glide, don't slam
+    if (pid_computed) {
+        const float zero = servo_min_open(s_servo_zero[i]);
+        r.ff.update(t_ms, dispensed, r.servo_cmd - zero);   // angle held since the last sample
+        const float base = r.ff_on ? zero + r.ff.opening_for(remaining) : 0.0f;
+        float want = base + (float)r.pid_output;
+        if (r.ff_on) {
+            const float top = servo_max_open(s_servo_zero[i]);
+            if (want < zero) want = zero;
+            if (want > top)  want = top;
+        }
+        const float max_step = SERVO_SLEW_DEG_PER_S * (float)r.sample_ms / 1000.0f;
+        float step = want - r.servo_cmd;
+        if (step >  max_step) step =  max_step;
+        if (step < -max_step) step = -max_step;
+        r.servo_cmd += step;
+        // What the PID's output actually became, for back-calculation
+        r.pid->TrackOutput((double)(r.servo_cmd - base));
+    }
+
+    bool vib_on = remaining <= VIB_ASSIST_REMAINING_G;
+    if (vib_on) s_vibrators[i]->setIntensity(VIB_ASSIST_INTENSITY);
+    else        s_vibrators[i]->off();
+
+    s_servos[i]->writeDegrees(r.servo_cmd);
+    rs.servo_angle = r.servo_cmd;
+    rs.vib = vib_on ? VIB_ASSIST_INTENSITY : 0.0f;
+
+    // Log a telemetry sample per actual PID computation, stamped with the
+    // sample's capture time (not "now")
+    if (pid_computed) {
+        TelemetrySample ts;
+        ts.t_ms      = t_ms;
+        ts.setpoint  = (float)r.pid_setpoint;
+        ts.dispensed = dispensed;
+        ts.weight    = current_grams;
+        ts.gross     = current_gross;
+        ts.servo     = r.servo_cmd;
+        ts.p         = (float)r.pid->GetLastP();
+        ts.i         = (float)r.pid->GetLastI();
+        ts.d         = (float)r.pid->GetLastD();
+        ts.vib       = rs.vib;
+        telem_append((uint8_t)i, ts);
+    }
+
+    // Empty bag: wide open, nothing coming
+    if (pid_computed) {
+        if (r.servo_cmd < servo_max_open(s_servo_zero[i]) - 1.0f || dispensed - r.flow_check_g >= NO_FLOW_G) {
+            r.flow_check_us = time_us_32();
+            r.flow_check_g = dispensed;
+        } else if (time_us_32() - r.flow_check_us >= NO_FLOW_MS * 1000) {
+            rs.no_flow = true;
+            end_run(i, false, dispensed);
+            return;
+        }
+    }
+
+    // In-flight compensation: what is still falling covers the rest
+    if (pid_computed && r.ff.should_close(remaining)) {
+        end_run(i, true, dispensed);
+        return;
+    }
+
+    // Done: target must hold for DONE_CONFIRM_MS worth of consecutive fresh
+    // samples (counted on pid_computed - counting ticks would confirm on the
+    // same noisy reading). While confirming the PID rides the floor, so the
+    // gate trickles ~0.1-0.5 g more, biasing the settled result to target.
+    if (pid_computed) {
+        if (dispensed >= (float)r.target_g) r.done_streak++;
+        else r.done_streak = 0;
+    }
+    if (r.done_streak >= r.done_confirm_samples) end_run(i, true, dispensed);
+}
+
+static void handle_cmd(const WebCmd& c)
+{
+    int i = c.i0;
+    switch (c.cmd) {
+    case WebCommand::StartDispense:
+        start_run(i, (int)c.f0);
+        break;
+
+    case WebCommand::Autotune:
+        if (c.f0 > 0.0f) start_run(i, (int)c.f1, c.f0);
+        break;
+
+    case WebCommand::StopDispense:
+        // i0 < 0: every run
+        for (int k = 0; k < 3; k++) {
+            if ((i < 0 || i == k) && s_run[k].running) end_run(k, false, s_st.run[k].dispensed);
+        }
+        break;
+
+    case WebCommand::EStop:
+        // Works from ANY state: end every run, close + release everything
+        for (int k = 0; k < 3; k++) {
+            if (s_run[k].running) end_run(k, false, s_st.run[k].dispensed);
+            close_and_release(k);
+        }
+        break;
+
+    case WebCommand::SetPID:
+        if (i >= 0 && i <= 2) {
+            s_tuning[i] = Tuning{ c.f0, c.f1, c.f2 };
+            apply_gains(i);
+        }
+        break;
+
+    case WebCommand::SetServoZero:
+        if (i >= 0 && i <= 2) {
+            s_servo_zero[i] = c.f0;
+            s_flow[i].reset();   // the curve is relative to the old zero
+        }
+        break;
+
+    case WebCommand::Tare:
+    case WebCommand::Calibrate: {
+        if (i < 0 || i > 2) break;
+        if (s_link_op[i]) {            // superseded
+            s_scales[i]->cancel_op();
+            finish_link_op(i, false);
+        }
+        // A run counts its grams from its own zero: a new zero or scale
+        // factor mid-run would restart the PID on a filling bag
+        if (s_run[i].running) {
+            s_link_op[i] = c.id;
+            finish_link_op(i, false);
+            break;
+        }
+        // A new zero mid-landing: the run ends on what has landed so far
+        if (s_run[i].settling) {
+            s_run[i].ff.drop_settle();
+            end_settle(i, s_st.run[i].dispensed);
+        }
+        s_link_op[i]  = c.id;
+        s_link_cal[i] = (c.cmd == WebCommand::Calibrate);
+        bool ok = s_link_cal[i]
+            ? s_scales[i]->begin_calibrate(c.f0, (int)c.f1, (int)c.f2)
+            : s_scales[i]->begin_tare((int)c.f0, (int)c.f1);
+        if (!ok) finish_link_op(i, false);   // busy (run tare) or bad input
+        break;
+    }
+
+    case WebCommand::CancelOp:
+        if (i >= 0 && i <= 2 && s_link_op[i] && s_link_op[i] == c.id) {
+            s_scales[i]->cancel_op();
+            finish_link_op(i, false);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void core1_main()
+{
+    // Lets core 0's flash writes park this core (it executes from XIP flash)
+    flash_safe_execute_core_init();
+
+    for (int i = 0; i < 3; i++) {
+        Run& r = s_run[i];
+        const Tuning& t = s_tuning[i];
+        r.pid = new PID(&r.pid_input, &r.pid_output, &r.pid_setpoint,
+                        t.kp, t.ki, t.kd, DIRECT);
+        apply_gains(i);
+    }
+
+    absolute_time_t next = get_absolute_time();
+    while (true) {
+        WebCmd c;
+        while (s_cmds.pop(c)) handle_cmd(c);
+
+        // Every scale, every period: keeps the rings drained, the filters
+        // current and any tare/calibration advancing
+        for (int i = 0; i < 3; i++) {
+            hx711* sc = s_scales[i];
+            float w = sc->read_weight();
+            float g = sc->last_gross();
+
+            if (s_run[i].have_run) step_run(i, w, g);
+
+            if (s_link_op[i]) {
+                HxOpStatus st = sc->poll_op();
+                if (st != HxOpStatus::Busy) {
+                    // The tare done before calibration IS the calibrated zero
+                    if (st == HxOpStatus::Done && s_link_cal[i]) sc->set_cal_offset(sc->get_offset());
+                    finish_link_op(i, st == HxOpStatus::Done);
+                }
+            }
+
+            ScaleStatus& ss = s_st.scale[i];
+            ss.weight      = sc->read_weight(); // after a tare landed this tick
+            ss.gross       = sc->last_gross();
+            ss.offset      = sc->get_offset();
+            ss.cal_offset  = sc->get_cal_offset();
+            ss.cpg         = sc->get_scale();
+            ss.sample_ms   = (uint16_t)(sc->output_period_us() / 1000);
+            ss.op_busy     = s_link_op[i] != 0;
+            ss.op_progress = (uint8_t)(ss.op_busy ? sc->op_progress() : 0);
+
+            if (s_release_pending[i] && time_reached(s_release_at[i])) {
+                s_servos[i]->off();   // no holding torque once closed
+                s_release_pending[i] = false;
+            }
+        }
+
+        s_status.push(s_st);   // full = core 0 lagging; it gets the next one
+
+        // Hard period: sleep to the next slot; a late period is counted and
+        // the schedule restarts from now instead of bursting to catch up
+        next = delayed_by_us(next, CONTROL_PERIOD_US);
+        if (time_reached(next)) {
+            s_st.tick_overruns++;
+            next = get_absolute_time();
+        } else {
+            sleep_until(next);
+        }
+    }
+}
+
+void control_start(hx711** scales, Servo** servos, Vibrator** vibrators)
+{
+    s_scales = scales;
+    s_servos = servos;
+    s_vibrators = vibrators;
+    for (int i = 0; i < 3; i++) {
+        s_st.scale[i].offset = scales[i]->get_offset();
+        s_st.scale[i].cal_offset = scales[i]->get_cal_offset();
+        s_st.scale[i].cpg = scales[i]->get_scale();
+    }
+    multicore_launch_core1(core1_main);
+}
+
+// =================================================================== core 0 ==
+
+static ControlStatus s_latest;   // newest snapshot seen by core 0
+static uint16_t s_next_id = 0;
+
+bool control_send(const WebCmd& c)
+{
+    return s_cmds.push(c);
+}
+
+const ControlStatus& control_poll()
+{
+    ControlStatus st;
+    while (s_status.pop(st)) s_latest = st;
+    return s_latest;
+}
+
+static uint16_t next_request_id()
+{
+    if (++s_next_id == 0) s_next_id = 1;   // 0 = none
+    return s_next_id;
+}
+
+float ScaleLink::read_weight()
+{
+    return control_poll().scale[idx_].weight;
+}
+
+float ScaleLink::last_gross() const
+{
+    return s_latest.scale[idx_].gross;
+}
+
+int32_t ScaleLink::get_offset() const
+{
+    return s_latest.scale[idx_].offset;
+}
+
+float ScaleLink::get_scale() const
+{
+    return s_latest.scale[idx_].cpg;
+}
+
+uint32_t ScaleLink::output_period_us() const
+{
+    return (uint32_t)s_latest.scale[idx_].sample_ms * 1000;
+}
+
+bool ScaleLink::begin_tare(int samples, int discard)
+{
+    if (pending_id_) return false;
+    WebCmd c;
+    c.cmd = WebCommand::Tare;
+    c.i0 = idx_;
+    c.f0 = (float)samples;
+    c.f1 = (float)discard;
+    c.id = next_request_id();
+    if (!control_send(c)) return false;
+    pending_id_ = c.id;
+    return true;
+}
+
+bool ScaleLink::begin_calibrate(float known_grams, int samples, int discard)
+{
+    if (pending_id_ || known_grams <= 0.0f) return false;
+    WebCmd c;
+    c.cmd = WebCommand::Calibrate;
+    c.i0 = idx_;
+    c.f0 = known_grams;
+    c.f1 = (float)samples;
+    c.f2 = (float)discard;
+    c.id = next_request_id();
+    if (!control_send(c)) return false;
+    pending_id_ = c.id;
+    return true;
+}
+
+HxOpStatus ScaleLink::poll_op()
+{
+    if (!pending_id_) return HxOpStatus::Idle;
+    const ScaleStatus& s = control_poll().scale[idx_];
+    if (s.op_id != pending_id_) return HxOpStatus::Busy;
+    pending_id_ = 0;
+    return s.op_ok ? HxOpStatus::Done : HxOpStatus::Failed;
+}
+
+int ScaleLink::op_progress() const
+{
+    const ScaleStatus& s = s_latest.scale[idx_];
+    return s.op_busy ? s.op_progress : 0;
+}
+
+void ScaleLink::cancel_op()
+{
+    if (!pending_id_) return;
+    WebCmd c;
+    c.cmd = WebCommand::CancelOp;
+    c.i0 = idx_;
+    c.id = pending_id_;
+    control_send(c);
+    pending_id_ = 0;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include "dispenser_state.h"
+#include "hx711.hpp"
+
+class Servo;
+class Vibrator;
+
+// Dispense control on core 1.
+//
+// Core 1 runs a hard-periodic task (CONTROL_PERIOD_US): it is the only reader
+// of the three HX711 rings (filter, tare/calibration ops included), and during
+// a run it owns the PID, servo slew, vibrator assist, done detection, the
+// empty-bag stop and the delayed servo release - one run per scale, the three
+// side by side. Core 0 keeps the LCD, WS2812s, buzzer, lwIP and flash - none
+// of which can stretch a control period any more.
+//
+// The cores talk through two lock-free SPSC queues (include/spsc_queue.h):
+//   core 0 -> core 1: WebCmd (StartDispense, Autotune, StopDispense, EStop,
+//                     SetPID, SetServoZero, Tare, Calibrate, CancelOp)
+//   core 1 -> core 0: ControlStatus snapshots, one per period
+// Telemetry samples are appended on core 1; telem_begin_run/end_run stay on
+// core 0 under the lwIP lock (see telemetry.hpp).
+
+inline constexpr uint32_t CONTROL_PERIOD_US = 5000;   // 200 Hz, 2.5x the 80 SPS rate
+
+// Launch core 1. Call once, after the HX711s are configured (capture, rate,
+// filter, calibration) - core 0 must not touch them afterwards. Sends no
+// config: follow with SetPID and SetServoZero commands, one per scale.
+void control_start(hx711** scales, Servo** servos, Vibrator** vibrators);
+
+// Core 0: queue a command for core 1. False when the queue is full.
+bool control_send(const WebCmd& c);
+
+// Core 0: drain pending snapshots and return the newest
+const ControlStatus& control_poll();
+
+// Core-0 stand-in for one hx711, with the subset of its API the screens use.
+// Reads come from the newest ControlStatus; tare/calibration become commands
+// whose completion is matched by request id (snapshots may be dropped).
+class ScaleLink {
+public:
+    explicit ScaleLink(int index) : idx_(index) {}
+
+    float    read_weight();
+    float    last_gross() const;
+    int32_t  get_offset() const;
+    float    get_scale() const;
+    uint32_t output_period_us() const;
+
+    bool       begin_tare(int samples = 10, int discard = 6);
+    bool       begin_calibrate(float known_grams, int samples = 10, int discard = 6);
+    // Same contract as hx711::poll_op: Busy, then Done/Failed exactly once.
+    // A completed calibration has already set the calibrated zero to the
+    // current tare on core 1.
+    HxOpStatus poll_op();
+    int        op_progress() const;
+    void       cancel_op();
+
+private:
+    int      idx_;
+    uint16_t pending_id_ = 0;   // request in flight, 0 = none
+};
@@ -0,0 +1,212 @@
+#include "flow_model.hpp"
+
+#include <cmath>
+
+static float clampf(float v, float lo, float hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+// ---------------------------------------------------------------- FlowModel --
+
+void FlowModel::reset()
+{
+    *this = FlowModel();
+}
+
+void FlowModel::curve(float* c) const
+{
+    // A node counts once it has seen a meaningful share of one observation
+    auto known = [&](int k) { return conf_[k] > 0.05f; };
+    for (int k = 0; k < FLOW_NODES; k++) {
+        if (known(k)) { c[k] = gps_[k]; continue; }
+        int lo = k - 1, hi = k + 1;
+        while (lo >= 0 && !known(lo)) lo--;
+        while (hi < FLOW_NODES && !known(hi)) hi++;
+        if (lo >= 0 && hi < FLOW_NODES) {
+            c[k] = gps_[lo] + (gps_[hi] - gps_[lo]) * (float)(k - lo) / (float)(hi - lo);
+        } else if (lo >= 0) {
+            c[k] = gps_[lo];                          // flat past the widest seen
+        } else if (hi < FLOW_NODES) {
+            c[k] = gps_[hi] * (float)k / (float)hi;   // from 0 at the flow start
+        } else {
+            c[k] = 0.0f;
+        }
+    }
+    // A wider gate never flows less: noise must not fold the inverse
+    if (c[0] < 0.0f) c[0] = 0.0f;
+    for (int k = 1; k < FLOW_NODES; k++) {
+        if (c[k] < c[k - 1]) c[k] = c[k - 1];
+    }
+}
+
+float FlowModel::flow_at(float open_deg) const
+{
+    float c[FLOW_NODES];
+    curve(c);
+    float x = clampf(open_deg / NODE_DEG, 0.0f, (float)(FLOW_NODES - 1));
+    int i = (int)x;
+    if (i >= FLOW_NODES - 1) return c[FLOW_NODES - 1];
+    return c[i] + (c[i + 1] - c[i]) * (x - (float)i);
+}
+
+float FlowModel::max_flow() const
+{
+    float c[FLOW_NODES];
+    curve(c);
+    return c[FLOW_NODES - 1];
+}
+
+float FlowModel::opening_for(float gps) const
+{
+    float c[FLOW_NODES];
+    curve(c);
+    if (gps <= c[0]) return 0.0f;
+    for (int k = 0; k < FLOW_NODES - 1; k++) {
+        if (gps <= c[k + 1]) {   // c[k] < gps here, so the segment rises
+            return ((float)k + (gps - c[k]) / (c[k + 1] - c[k])) * NODE_DEG;
+        }
+    }
+    return (float)(FLOW_NODES - 1) * NODE_DEG;
+}
+
+void FlowModel::observe(float open_deg, float gps)
+{
+    if (open_deg < 0.0f || gps < 0.0f) return;
+    float x = clampf(open_deg / NODE_DEG, 0.0f, (float)(FLOW_NODES - 1));
+    int i = (int)x;
+    if (i >= FLOW_NODES - 1) i = FLOW_NODES - 2;
+    float frac = x - (float)i;
+
+    // Split the observation between the two nodes around it. A node averages
+    // its first observations, then settles into an EMA that keeps tracking
+    // the bag (flow drops as it empties, grain changes)
+    const int   node[2] = {i, i + 1};
+    const float w[2]    = {1.0f - frac, frac};
+    for (int j = 0; j < 2; j++) {
+        if (w[j] <= 0.0f) continue;
+        int k = node[j];
+        conf_[k] += w[j];
+        float a = w[j] / conf_[k];
+        if (a < LEARN_RATE * w[j]) a = LEARN_RATE * w[j];
+        gps_[k] += a * (gps - gps_[k]);
+    }
+    obs_++;
+}
+
+float FlowModel::in_flight_at(float gps) const
+{
+    if (gps < 0.0f) gps = 0.0f;
+    return in_flight_g_ + gps * close_lag_s_;
+}
+
+void FlowModel::observe_in_flight(float landed_g, float gps_at_close)
+{
+    // Recursive least squares on landed = [1, gps] . [in_flight_g, close_lag_s]
+    // with forgetting. Runs that all close at the same flow only inform one
+    // direction, so the spread is capped at the prior's: it can't wind up
+    // along the other one and make the next differing run swing the fit.
+    float f = clampf(gps_at_close, 0.0f, 200.0f);
+    float pg = cov_[0], pgs = cov_[1], ps = cov_[2];
+    float kg = pg + pgs * f;        // P x
+    float ks = pgs + ps * f;
+    float den = NOISE_G2 + kg + ks * f;
+    kg /= den;
+    ks /= den;
+    float err = landed_g - in_flight_at(f);
+    in_flight_g_ = clampf(in_flight_g_ + kg * err, 0.0f, 50.0f);
+    close_lag_s_ = clampf(close_lag_s_ + ks * err, 0.0f, 2.0f);
+
+    // P = (P - k x' P) / forget
+    float a = 1.0f - kg, b = -kg * f;   // I - k x'
+    float c = -ks, d = 1.0f - ks * f;
+    cov_[0] = (a * pg + b * pgs) / IN_FLIGHT_FORGET;
+    cov_[1] = (c * pg + d * pgs) / IN_FLIGHT_FORGET;
+    cov_[2] = (c * pgs + d * ps) / IN_FLIGHT_FORGET;
+    if (cov_[0] > P0_G) cov_[0] = P0_G;
+    if (cov_[2] > P0_S) cov_[2] = P0_S;
+    float lim = cov_[0] * cov_[2];   // stays positive definite
+    if (cov_[1] * cov_[1] > 0.99f * lim) cov_[1] = (cov_[1] < 0.0f ? -0.99f : 0.99f) * std::sqrt(lim);
+    in_flight_n_++;
+}
+
+// ---------------------------------------------------------- FlowFeedforward --
+
+void FlowFeedforward::begin(FlowModel* model)
+{
+    model_ = model;
+    head_ = count_ = 0;
+    flow_ = 0.0f;
+    closed_ = false;
+}
+
+void FlowFeedforward::update(uint32_t t_ms, float dispensed, float open_deg)
+{
+    hist_[head_] = {t_ms, dispensed, open_deg};
+    head_ = (head_ + 1) % HIST;
+    if (count_ < HIST) count_++;
+
+    // Newest point at least a window old
+    const Point* old = nullptr;
+    for (int n = 1; n < count_; n++) {
+        const Point& p = hist_[(head_ - 1 - n + HIST) % HIST];
+        if (t_ms - p.t_ms >= FLOW_WINDOW_MS) { old = &p; break; }
+    }
+    if (!old) return;
+
+    float dt = (float)(t_ms - old->t_ms) / 1000.0f;
+    float f = (dispensed - old->dispensed) / dt;
+    flow_ = f > 0.0f ? f : 0.0f;
+
+    // Learn only from a steady gate: across a swing the window mixes flows
+    float swing = open_deg - old->open_deg;
+    if (swing < -5.0f || swing > 5.0f) return;
+    model_->observe(old->open_deg, flow_);
+}
+
+float FlowFeedforward::opening_for(float remaining_g) const
+{
+    if (remaining_g <= 0.0f) return 0.0f;
+    float want = remaining_g / TAPER_S;
+    float top = model_->max_flow();
+    if (want > top) want = top;
+    return model_->opening_for(want);
+}
+
+float FlowFeedforward::in_flight() const
+{
+    return model_->in_flight_learned() ? model_->in_flight_at(flow_) : 0.0f;
+}
+
+bool FlowFeedforward::should_close(float remaining_g) const
+{
+    // No flow measured yet: the start of the run, nothing to predict from
+    if (!model_->in_flight_learned() || flow_ <= 0.0f) return false;
+    return remaining_g <= in_flight();
+}
+
+float FlowFeedforward::on_close(uint32_t t_ms, float dispensed)
+{
+    closed_ = true;
+    close_ms_ = t_ms;
+    close_g_ = dispensed;
+    close_flow_ = flow_;
+    return in_flight();
+}
+
+bool FlowFeedforward::settle(uint32_t t_ms, float dispensed)
+{
+    if (!closed_) return true;
+    if (t_ms - close_ms_ < SETTLE_MS) return false;
+    model_->observe_in_flight(dispensed - close_g_, close_flow_);
+    closed_ = false;
+    return true;
+}
+
+void FlowFeedforward::replay(const TelemetrySample* s, int n, float servo_zero, float final_g)
+{
+    if (!model_ || n <= 0) return;
+    begin(model_);
+    for (int k = 0; k < n; k++) update(s[k].t_ms, s[k].dispensed, s[k].servo - servo_zero);
+    if (final_g >= 0.0f) {
+        on_close(s[n - 1].t_ms, s[n - 1].dispensed);
+        settle(s[n - 1].t_ms + SETTLE_MS, final_g);
+    }
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <cstdint>
+#include "telem_codec.hpp"   // TelemetrySample
+
+// Learned gate flow model and the dispense feedforward built on it.
+//
+// FlowModel (one per scale) maps the gate opening - servo degrees above the
+// flow-start point (servo_min_open) - to grams per second. It is a curve
+// through FLOW_NODES points 10 deg apart, each adapted by an EMA from
+// measured flow during runs; nodes not visited yet are interpolated from
+// their neighbours, and the curve is read as non-decreasing. It also learns
+// what keeps landing after the gate closes:
+//
+//     in-flight grams = in_flight_g + flow at the close x close_lag_s
+//
+// in_flight_g is the grain that drops off the gate and the vibrated chute
+// whatever the flow; close_lag_s is how long the full flow goes on after the
+// close decision - the servo's travel to closed, the fall into the container
+// and the flow measurement's own lag. Both are fitted by recursive least
+// squares over the runs' (flow, landed) pairs, forgetting old runs so the
+// fit follows the bag; a trickle close (no flow) pins in_flight_g, a close at
+// speed close_lag_s.
+//
+// FlowFeedforward runs one dispense on top of a FlowModel:
+//  - update() measures the flow over the last FLOW_WINDOW_MS and feeds the
+//    model, paired with the opening at the window's start (the material
+//    landing now left the gate that long ago).
+//  - opening_for() is the feedforward: the opening whose learned flow brings
+//    the remaining grams in over TAPER_S, capped at full flow. From the first
+//    sample of a run the gate goes where the flow it needs is, instead of
+//    waiting for the PID to wind up from the floor.
+//  - should_close() is the in-flight compensation: once the grams predicted
+//    to land after a close cover what is missing, the gate closes - without
+//    the done confirmation, whose samples would all be overshoot.
+//  - on_close() / settle() measure what landed after the close and teach
+//    the in-flight model.
+//
+// No Pico SDK dependencies; replay() drives the learning from a recorded
+// TelemetrySample run (e.g. decoded /api/log.bin) on a host.
+
+inline constexpr int FLOW_NODES = 9;   // 0..80 deg above the flow-start point
+
+class FlowModel {
+public:
+    static constexpr float NODE_DEG   = 10.0f;
+    static constexpr int   MIN_OBS    = 40;     // observations before learned()
+    static constexpr float LEARN_RATE = 0.1f;   // EMA weight of one observation
+    static constexpr float IN_FLIGHT_FORGET = 0.8f;   // weight of the previous runs
+
+    void reset();
+
+    // Enough flow measured to drive the gate from the model
+    bool learned() const { return obs_ >= MIN_OBS; }
+    bool in_flight_learned() const { return in_flight_n_ > 0; }
+
+    float flow_at(float open_deg) const;   // g/s
+    float max_flow() const;                // g/s at full opening
+    float opening_for(float gps) const;    // smallest opening giving gps (deg)
+    float in_flight_g() const { return in_flight_g_; }
+    float close_lag_s() const { return close_lag_s_; }
+    float in_flight_at(float gps) const;   // grams landing after a close at gps
+
+    void observe(float open_deg, float gps);
+    void observe_in_flight(float landed_g, float gps_at_close);
+
+private:
+    static constexpr float P0_G = 25.0f;    // prior spread of in_flight_g (g^2)
+    static constexpr float P0_S = 0.25f;    // and of close_lag_s (s^2)
+    static constexpr float NOISE_G2 = 1.0f; // settled reading noise (g^2)
+
+    void curve(float* c) const;   // node values, gaps filled, non-decreasing
+
+    float    gps_[FLOW_NODES] = {};
+    float    conf_[FLOW_NODES] = {};   // observation weight seen per node
+    uint32_t obs_ = 0;
+    // In-flight fit: parameters and their covariance (symmetric 2x2: g*g,
+    // g*s, s*s), starting from the prior's spread
+    float    in_flight_g_ = 0.0f;
+    float    close_lag_s_ = 0.0f;
+    float    cov_[3] = {P0_G, 0.0f, P0_S};
+    uint32_t in_flight_n_ = 0;
+};
+
+class FlowFeedforward {
+public:
+    static constexpr uint32_t FLOW_WINDOW_MS = 500;   // flow measurement span
+    static constexpr float    TAPER_S        = 2.0f;  // remaining grams over this time
+    static constexpr uint32_t SETTLE_MS      = 1500;  // after close: in-flight landed
+
+    void begin(FlowModel* model);
+
+    // One fresh sample (PID rate): t since run start, grams dispensed, gate
+    // opening above the flow-start point actually commanded
+    void update(uint32_t t_ms, float dispensed, float open_deg);
+
+    float flow() const { return flow_; }   // measured g/s (0 until a window is full)
+    // Grams expected to land after a close now (0 = nothing learned yet)
+    float in_flight() const;
+    float opening_for(float remaining_g) const;
+    bool  should_close(float remaining_g) const;
+
+    // The gate closed; returns in_flight() at that moment
+    float on_close(uint32_t t_ms, float dispensed);
+    // Post-close tracking; true once settled (the in-flight model learned)
+    bool settle(uint32_t t_ms, float dispensed);
+    // The reading can't be trusted to the end (the zero moved): no lesson
+    void drop_settle() { closed_ = false; }
+
+    // Learn from a recorded run: its samples, flow-start angle and settled
+    // final grams (< 0: unknown, flow curve only)
+    void replay(const TelemetrySample* s, int n, float servo_zero, float final_g);
+
+private:
+    static constexpr int HIST = 64;   // >= FLOW_WINDOW_MS at the 10 ms PID floor
+    struct Point { uint32_t t_ms; float dispensed; float open_deg; };
+
+    FlowModel* model_ = nullptr;
+    Point    hist_[HIST] = {};
+    int      head_ = 0, count_ = 0;
+    float    flow_ = 0.0f;
+    bool     closed_ = false;
+    uint32_t close_ms_ = 0;
+    float    close_g_ = 0.0f;
+    float    close_flow_ = 0.0f;
+};
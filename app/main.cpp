@@ -13,8 +13,13 @@
 #include "Servo.hpp"
 #include "Vibrator.hpp"
 #include "SharedSlice.hpp"
-#include "PID.hpp"
 #include "screens.hpp"
+#include "control.hpp"
+#include "scheduler.hpp"
+#include "telemetry.hpp"
+#include "recipe.hpp"
+#include "order_queue.hpp"
+#include "bag_level.hpp"
 
 #include "wifi_config.h"
 #include "dispenser_state.h"
@@ -35,8 +40,22 @@ hx711 scale1(20, 21);  // HX711_1: GP20=SCK, GP21=DT
 hx711 scale2(18, 19);  // HX711_2: GP18=SCK, GP19=DT
 hx711 scale3(16, 17);  // HX711_3: GP16=SCK, GP17=DT
 
-// Array for easy access by index
+// HX711 RATE line, shared by all three modules (lifted off the boards' GND
+// strap and wired to GP10). High = 80 SPS: a fresh filtered value every 25 ms
+// instead of a raw one every 100 ms - that lag was most of the end-of-run
+// overshoot.
+constexpr uint HX711_RATE_PIN  = 10;
+constexpr bool HX711_HIGH_RATE = true;
+
+// 80 SPS chain: median-3 (vibrator knocks) -> 4-tap boxcar -> every 2nd value
+// = 40 Hz out, ~37 ms behind the newest conversion (see weight_filter.hpp)
+constexpr WeightFilterConfig HX711_FILTER = {3, FilterStage::Fir, 4, 0.5f, 2};
+
+// Array for easy access by index. Core 1 owns these once control_start() ran;
+// core 0 goes through the ScaleLink views.
 hx711* scales[3] = {&scale1, &scale2, &scale3};
+ScaleLink link1(0), link2(1), link3(2);
+ScaleLink* scale_links[3] = {&link1, &link2, &link3};
 
 // Dispenser actuators - one per scale
 Servo servo1(7);      // Scale 1 servo - GPIO 7
@@ -69,17 +88,37 @@ static bool net_stack_up = false;
 static inline void net_lock()   { if (net_stack_up) cyw43_arch_lwip_begin(); }
 static inline void net_unlock() { if (net_stack_up) cyw43_arch_lwip_end(); }
 
-// PID tuning parameters (mutable for web-based tuning)
-static double Kp = 1.5, Ki = 0.08, Kd = 0.8;
-static PID* dispense_pid = nullptr;
+// PID tuning parameters per scale (mutable for web-based tuning)
+static PidEntry pid_gains[3] = {
+    { 1.5f, 0.08f, 0.8f }, { 1.5f, 0.08f, 0.8f }, { 1.5f, 0.08f, 0.8f },
+};
 static bool pid_save_pending = false;  // Deferred flash save (never write mid-dispense)
 
 static void save_pid_gains() {
-    PidConfig pc;
-    pc.kp = (float)Kp;
-    pc.ki = (float)Ki;
-    pc.kd = (float)Kd;
-    save_pid_config(pc);  // stalls IRQs ~100 ms - only call while not dispensing
+    PidScaleConfig pc;
+    for (int i = 0; i < 3; i++) pc.entries[i] = pid_gains[i];
+    save_pid_scale_config(pc);  // parks core 1 (~1 ms, ~50 ms on a log GC) - only call while not dispensing
+}
+
+// New gains for scale i from the web form or an autotune proposal: retuned
+// on the control core (once its run, if any, has ended - the other scales
+// keep theirs), and persisted if asked - never mid-dispense (IRQ stall)
+static void apply_pid_gains(int i, float kp, float ki, float kd, bool save) {
+    if (i < 0 || i > 2) return;
+    pid_gains[i] = PidEntry{ kp, ki, kd };
+    WebCmd c;
+    c.cmd = WebCommand::SetPID;
+    c.i0 = i;
+    c.f0 = kp;
+    c.f1 = ki;
+    c.f2 = kd;
+    control_send(c);
+    if (!save) return;
+    if (!g_state.dispensing) {
+        save_pid_gains();
+    } else {
+        pid_save_pending = true;
+    }
 }
 
 // Scale content names ("Wheat", "Spelt", ...) - mirrored in g_state.names for
@@ -107,6 +146,18 @@ static void save_servo_zeros() {
     save_servo_config(svc);
 }
 
+// Recipe book - mirrored in g_state.recipes for the web UI and persisted to
+// flash, with the same deferred-save rule.
+static bool recipe_save_pending = false;
+
+static void save_recipes() {
+    RecipeConfig rc;
+    for (int i = 0; i < RECIPE_SLOTS; i++) {
+        rc.recipes[i] = g_state.recipes[i];
+    }
+    save_recipe_config(rc);
+}
+
 // --- Access-point fallback ---------------------------------------------------
 // When the router is unreachable, the Pico broadcasts its own network so a phone
 // can join it directly and use the web app at http://192.168.4.1.
@@ -155,17 +206,789 @@ static bool start_ap_mode() {
     return true;
 }
 
+// --- Core-0 main loop ---------------------------------------------------------
+// Everything after boot runs as scheduler tasks (app/scheduler.hpp): the loop
+// in main() sleeps until the next deadline. The control loop itself is on
+// core 1 (app/control.hpp); nothing here can delay it.
+
+// Higher runs first when several tasks are due
+enum : uint8_t { PRIO_LCD = 0, PRIO_UI = 1, PRIO_WEB = 2, PRIO_SYNC = 3 };
+
+constexpr uint32_t SYNC_PERIOD_US   = 10000;    // g_state <- core-1 snapshot, SSE push
+constexpr uint32_t WEB_PERIOD_US    = 10000;    // web command queue
+constexpr uint32_t LCD_PERIOD_US    = 20000;    // diffed framebuffer flush (a full one is ~12 ms)
+constexpr uint32_t WEB_UI_PERIOD_US = 100000;   // "Web Control Active" page
+constexpr uint32_t STATS_PERIOD_US  = 10000000;
+constexpr uint32_t SERVO_SETTLE_US  = 300000;   // close -> release
+constexpr uint32_t BATCH_PERIOD_US  = 100000;   // recipe stage starts
+constexpr uint32_t QUEUE_PERIOD_US  = 50000;    // order queue: swap detection, run starts
+constexpr uint32_t BAG_PERIOD_US    = 1000000;  // bag levels -> g_state, log saves
+constexpr uint64_t BAG_SAVE_US      = 300000000;// bag log: at most one flash save per 5 min
+
+static Scheduler sched(time_us_64);
+static int ui_task = -1;
+
+// UI context shared by the screen classes (app/screens.cpp) and the web
+// command dispatcher below
+static UiContext ctx{
+    lcd, enc, bz, scale_links, servos, vibrators, sevenSeg, sc, g_state,
+    pid_gains, &net_lock, &net_unlock
+};
+static ScreenManager mgr;
+
+// Web Tare/Calibrate in flight (-1 = none); finished in task_web
+static int web_op_scale = -1;
+static WebCommand web_op_cmd = WebCommand::None;
+
+// A closed gate's servo is released once it got there (SERVO_SETTLE_US) by a
+// one-shot task, not a sleep. One pending release per servo; a newer close
+// re-arms it, a jog cancels it. Skipped if a run started meanwhile - core 1
+// owns the servos then.
+static int servo_release_task[3] = {-1, -1, -1};
+
+static void release_servo_now(void* p)
+{
+    int i = (int)(intptr_t)p;
+    servo_release_task[i] = -1;
+    if (!g_state.dispensing) servos[i]->off();
+}
+
+static void release_servo_later(int i)
+{
+    sched.cancel(servo_release_task[i]);
+    servo_release_task[i] = sched.after("servo-off", SERVO_SETTLE_US, PRIO_WEB,
+                                        release_servo_now, (void*)(intptr_t)i);
+    if (servo_release_task[i] < 0) {   // task table full: the old way
+        sleep_us(SERVO_SETTLE_US);
+        servos[i]->off();
+    }
+}
+
+// --- Bag level ----------------------------------------------------------------
+// BagTracker (app/bag_level.hpp): grain left per bag and the grams dispensed
+// per calendar day. The day comes from the web page (SetClock) - there is no
+// clock on the board.
+static BagTracker bags;
+static bool     bag_save_now = false;   // a reserve changed: save at the next chance
+static uint64_t bag_saved_us = 0;
+
+static int32_t  clock_day = -1;   // local day at clock_us
+static uint32_t clock_sec = 0;    // seconds into it
+static uint64_t clock_us  = 0;
+
+static int32_t today()
+{
+    if (clock_day < 0) return -1;
+    uint64_t sec = clock_sec + (time_us_64() - clock_us) / 1000000;
+    return clock_day + (int32_t)(sec / 86400);
+}
+
+static void save_bags()
+{
+    BagConfig bc;
+    bc.log = bags.log();
+    if (save_bag_config(bc)) bags.saved();
+    bag_save_now = false;
+    bag_saved_us = time_us_64();
+}
+
+// Why the bag on scale i can't cover a run of target grams; nullptr = it can
+static const char* bag_short(int i, float target)
+{
+    if (bag_covers(g_state, i, target)) return nullptr;
+    static char why[24];
+    std::snprintf(why, sizeof(why), "scale %d bag low", i + 1);
+    return why;
+}
+
+// --- Dispense runs ------------------------------------------------------------
+// Core 1 runs one per scale, side by side. Every run - LCD or web, dispense or
+// step test - is started by start_run() and closed by task_sync() once core 1
+// reports its end, so telemetry begin/end and the per-scale g_state live in
+// one place whichever screen is showing (or none: a run started from the web
+// on another scale).
+//
+// A run ends in two steps: the gate closes (run_active off, the chime), then
+// the grams still in flight land and core 1 reports the settled weight. That
+// is the run's result for the telemetry, batches, the order queue and the bag
+// log; the scale takes no new run until then.
+struct RunTrack {
+    bool     active;     // until settled
+    bool     tune;       // autotune step test: no completion chime
+    bool     closed;     // gate closed, waiting for the settled weight
+    uint16_t seq0;       // RunStatus::seq at the start; bumps at the close
+    uint16_t settled0;   // RunStatus::settled_seq at the start; bumps when settled
+};
+static RunTrack run_track[3];
+
+// c: StartDispense (i0 scale, f0 target) or Autotune (i0 scale, f1 gram cap).
+// Returns the telemetry run id, 0 = not started.
+static uint32_t start_run(const WebCmd& c)
+{
+    int i = c.i0;
+    if (i < 0 || i > 2) return 0;
+    const ControlStatus& cs = control_poll();
+    // A previous run still closing on core 1 must end first: its telemetry
+    // appends would land in the new run's stream, and its settle would be cut
+    if (run_track[i].active || cs.run[i].dispensing || cs.run[i].settling) return 0;
+    bool tune = c.cmd == WebCommand::Autotune;
+    int target = (int)(tune ? c.f1 : c.f0);
+    // A run the bag can't finish would stall half way with the gate open
+    if (!tune && bag_short(i, (float)target)) return 0;
+
+    // Under the lwIP lock so a CSV download in flight can't observe the
+    // run slot being reused
+    net_lock();
+    uint32_t id = tune
+        ? telem_begin_run((uint8_t)i, (uint16_t)target, 0.0f, 0.0f, 0.0f,
+                          g_state.names[i], cs.scale[i].sample_ms)
+        : telem_begin_run((uint8_t)i, (uint16_t)target, pid_gains[i].kp, pid_gains[i].ki, pid_gains[i].kd,
+                          g_state.names[i], cs.scale[i].sample_ms);
+    if (!control_send(c)) {
+        telem_end_run((uint8_t)i, 0.0f);   // never started
+        net_unlock();
+        return 0;
+    }
+    run_track[i] = { true, tune, false, cs.run[i].seq, cs.run[i].settled_seq };
+    set_run_active(g_state, i, true);
+    g_state.run_done[i] = false;
+    g_state.run_grams[i] = 0.0f;
+    g_state.run_target[i] = target;
+    g_state.run_id[i] = id;
+    net_unlock();
+    return id;
+}
+
+// The Autotune screen fits the test when it ends: never navigate away from
+// it meanwhile
+static bool tune_running()
+{
+    for (const RunTrack& t : run_track) {
+        if (t.active && t.tune && !t.closed) return true;
+    }
+    return false;
+}
+
+// --- Recipe batches -----------------------------------------------------------
+// RecipeBatch (app/recipe.hpp) plans the stages and the carry-forward;
+// task_batch starts each stage through start_run() and task_sync feeds the
+// end of every batch run back. One batch at a time.
+static RecipeBatch batch;
+
+// The batch failed or was stopped: its runs still going stop with it
+static void stop_batch_runs()
+{
+    for (int i = 0; i < 3; i++) {
+        if (!batch.owns(i)) continue;
+        WebCmd c;
+        c.cmd = WebCommand::StopDispense;
+        c.i0 = i;
+        control_send(c);
+    }
+}
+
+static void task_batch(void*)
+{
+    if (!batch.running()) return;
+    int scale[RECIPE_ITEMS];
+    float target[RECIPE_ITEMS];
+    int n = batch.next(scale, target);
+    for (int k = 0; k < n; k++) {
+        WebCmd c;
+        c.cmd = WebCommand::StartDispense;
+        c.i0 = scale[k];
+        c.f0 = target[k];
+        if (const char* why = bag_short(scale[k], target[k])) batch.stop(why);
+        if (!batch.running() || !start_run(c)) batch.start_failed(scale[k]);
+    }
+    if (!batch.running()) stop_batch_runs();
+    if (n > 0) {
+        printf("[recipe] stage %d: %d run(s), carry x%.3f\n", batch.status().stage + 1, n,
+               (double)batch.status().factor);
+    }
+}
+
+// --- Order queue --------------------------------------------------------------
+// OrderQueue (app/order_queue.hpp) repeats one dispense for bagging: task_queue
+// feeds it the scale's gross weight between runs (container swap detection)
+// and starts each run through start_run(); task_sync feeds the ends back.
+static OrderQueue orders;
+
+// The queue was stopped: its run going stops with it
+static void stop_queue_run()
+{
+    int i = orders.status().scale;
+    if (i < 0 || !orders.owns(i)) return;
+    WebCmd c;
+    c.cmd = WebCommand::StopDispense;
+    c.i0 = i;
+    control_send(c);
+}
+
+// QueueStart / QueueNext / QueueStop, from the web or the Dispense screen
+static void queue_command(const WebCmd& c)
+{
+    switch (c.cmd) {
+    case WebCommand::QueueStart: {
+        if (orders.running()) break;
+        int i = (c.i0 >= 0 && c.i0 <= 2) ? c.i0 : ctx.selected_scale;
+        float target = c.f0 >= 1.0f ? c.f0 : (float)ctx.target_grams;
+        if (orders.begin(i, target, (int)c.f1)) {
+            printf("[queue] %d x %.0f g on scale %d\n", (int)c.f1, (double)target, i + 1);
+            // Shown on the Dispense screen: LCD + 7-segment progress
+            if (!tune_running()) {
+                ctx.selected_scale = i;
+                if (mgr.currentId() != ScreenId::Dispense) mgr.goTo(ctx, ScreenId::Dispense);
+            }
+        } else {
+            printf("[queue] refused: %s\n", orders.status().error);
+        }
+        break;
+    }
+    case WebCommand::QueueNext:
+        orders.swapped();
+        break;
+    case WebCommand::QueueStop:
+        stop_queue_run();
+        orders.stop("stopped");
+        break;
+    default:
+        break;
+    }
+}
+
+static void task_queue(void*)
+{
+    if (!orders.running()) return;
+    const ControlStatus& cs = control_poll();
+    orders.sample(to_ms_since_boot(get_absolute_time()), cs.scale[orders.status().scale].gross);
+    int scale;
+    float target;
+    if (!orders.next(&scale, &target)) return;
+    if (const char* why = bag_short(scale, target)) {
+        orders.stop(why);
+        return;
+    }
+    WebCmd c;
+    c.cmd = WebCommand::StartDispense;
+    c.i0 = scale;
+    c.f0 = target;
+    if (start_run(c)) {
+        printf("[queue] run %u/%u\n", (unsigned)orders.status().done + 1,
+               (unsigned)orders.status().count);
+    } else {
+        orders.start_failed();
+    }
+}
+
+// Web state sync: update g_state from the control core's newest snapshot,
+// and close the runs it reports over. Guarded so /api/status snapshots taken
+// in the lwIP IRQ context can't tear across fields.
+static void task_sync(void*)
+{
+    const ControlStatus& cs = control_poll();
+    bool chime = false;
+    bool batch_over = false;
+    net_lock();
+    g_state.selected_scale = ctx.selected_scale;
+    g_state.target_grams = ctx.target_grams;
+    for (int i = 0; i < 3; i++) {
+        g_state.weights[i] = cs.scale[i].weight;
+        g_state.gross[i] = cs.scale[i].gross;
+        g_state.scale_calibrated[i] =
+            (cs.scale[i].offset != 0 || cs.scale[i].cpg != 1.0f);
+
+        const RunStatus& rs = cs.run[i];
+        RunTrack& t = run_track[i];
+        if (t.active && !t.closed && rs.seq != t.seq0) {
+            // Gate closed (target reached or stopped)
+            t.closed = true;
+            set_run_active(g_state, i, false);
+            g_state.run_done[i] = rs.done && !t.tune;   // a step test dispenses nothing
+            chime |= g_state.run_done[i];
+        }
+        if (t.active && t.closed && rs.settled_seq != t.settled0) {
+            // Run over: the in-flight grams landed, book what the scale says
+            float grams = rs.settled;
+            telem_end_run((uint8_t)i, grams);
+            t.active = false;
+            g_state.run_grams[i] = grams;
+            if (batch.owns(i)) {
+                batch.run_ended(i, rs.done, grams);
+                batch_over |= !batch.running();
+            }
+            if (orders.owns(i)) orders.run_ended(rs.done, grams);
+            if (!t.tune) bags.used(i, grams);
+            if (rs.no_flow && g_state.scale_calibrated[i]) {
+                // Gate wide open, nothing came: this is the empty bag
+                bags.empty_at(i, cs.scale[i].gross);
+                bag_save_now = true;
+                printf("[bag] scale %d: no flow at %.0f g gross\n", i + 1,
+                       (double)cs.scale[i].gross);
+            }
+        } else if (t.active) {
+            // Until core 1 picked the command up, the snapshot still shows
+            // the previous run's numbers
+            g_state.run_grams[i] = (rs.dispensing || t.closed) ? rs.dispensed : 0.0f;
+        }
+        g_state.run_servo[i] = rs.servo_angle;
+        g_state.run_vib[i] = rs.vib;
+    }
+    // The single-run fields follow the selected scale
+    int sel = ctx.selected_scale;
+    g_state.dispense_done = g_state.run_done[sel];
+    g_state.dispensed_grams = g_state.run_grams[sel];
+    g_state.servo_angle = g_state.run_servo[sel];
+    g_state.vib_intensity = g_state.run_vib[sel];
+    for (int i = 0; i < 3; i++) {
+        g_state.pid_kp[i] = pid_gains[i].kp;
+        g_state.pid_ki[i] = pid_gains[i].ki;
+        g_state.pid_kd[i] = pid_gains[i].kd;
+    }
+    g_state.batch = batch.status();
+    g_state.queue = orders.status();
+    web_server_tick();   // /api/events push (self rate-limited)
+    net_unlock();
+    if (batch_over) stop_batch_runs();
+    if (chime) bz.playCloseEncounters();   // Complete!
+}
+
+// Bag levels for the web and the LCD, and the bag log's flash saves: never
+// while dispensing, at most every BAG_SAVE_US (every run changes the log)
+static void task_bag(void*)
+{
+    bags.set_day(today());
+    net_lock();
+    for (int i = 0; i < 3; i++) {
+        float target = g_state.run_target[i] > 0 ? (float)g_state.run_target[i]
+                                                 : (float)ctx.target_grams;
+        if (orders.running() && orders.status().scale == i) target = orders.status().target;
+        g_state.bag[i] = bags.status(i, g_state.gross[i], target);
+        if (!g_state.scale_calibrated[i]) g_state.bag[i].runs_left = -1;
+    }
+    g_state.bag_log = bags.log();
+    net_unlock();
+
+    if (!bags.dirty() || g_state.dispensing) return;
+    if (bag_save_now || time_us_64() - bag_saved_us >= BAG_SAVE_US) save_bags();
+}
+
+// Web command dispatch, web-started tare/calibration and deferred saves.
+static void task_web(void*)
+{
+    // Drain ALL queued commands in order (the queue means nothing gets lost
+    // while a blocking tare/calibrate stalls the loop). Pop under the lwIP
+    // lock, dispatch from the copy.
+    while (true) {
+        WebCmd c;
+        net_lock();
+        bool have = (g_state.cmd_tail != g_state.cmd_head);
+        if (have) {
+            c = g_state.cmd_queue[g_state.cmd_tail];
+            g_state.cmd_tail = (uint8_t)((g_state.cmd_tail + 1) % WEBCMD_QUEUE_LEN);
+        }
+        net_unlock();
+        if (!have) break;
+
+        ctx.web_active = true;  // Web is in control, disable hardware input
+
+        switch (c.cmd) {
+        case WebCommand::Tare:
+            // Never move the zero under the PID with the gate open; the
+            // tare itself completes over the next ~1.6 s (see below)
+            if (g_state.dispensing || web_op_scale >= 0) break;
+            if (scale_links[ctx.selected_scale]->begin_tare()) {
+                web_op_scale = ctx.selected_scale;
+                web_op_cmd = WebCommand::Tare;
+            }
+            break;
+
+        case WebCommand::SetTarget:
+            ctx.target_grams = c.i0;
+            if (ctx.target_grams < 1) ctx.target_grams = 1;
+            if (ctx.target_grams > 9999) ctx.target_grams = 9999;
+            break;
+
+        case WebCommand::SelectScale:
+            if (c.i0 >= 0 && c.i0 <= 2) {
+                ctx.selected_scale = c.i0;
+            }
+            break;
+
+        case WebCommand::StartDispense: {
+            // i0 = scale (-1 = the selected one), f0 = target (0 = the
+            // current one). Runs on other scales keep going. A run on the
+            // selected scale is shown on the Dispense screen.
+            WebCmd s = c;
+            if (s.i0 < 0 || s.i0 > 2) s.i0 = ctx.selected_scale;
+            if (s.f0 < 1.0f) s.f0 = (float)ctx.target_grams;
+            if (s.f0 > 9999.0f) s.f0 = 9999.0f;
+            s.f0 = (float)(int)s.f0;
+            if (start_run(s) && s.i0 == ctx.selected_scale && !tune_running()) {
+                mgr.goTo(ctx, ScreenId::Dispense);
+            }
+            break;
+        }
+
+        case WebCommand::StopDispense:
+            // i0 = scale, -1 = every run. Core 1 closes the gate; task_sync
+            // closes the run when the snapshot reports it over.
+            control_send(c);
+            break;
+
+        case WebCommand::TestServo: {
+            // i0 = explicit servo index (calibration UI); -1 = legacy test
+            // slider, which follows the selected scale
+            int idx = (c.i0 >= 0 && c.i0 <= 2) ? c.i0 : ctx.selected_scale;
+            if (g_state.dispensing) break;  // never fight the PID loop
+            if (c.f0 < 0.0f) {
+                // Close-and-release sentinel
+                servos[idx]->writeDegrees(servo_close(g_state, idx));
+                release_servo_later(idx);
+            } else {
+                sched.cancel(servo_release_task[idx]);   // jogging: keep torque
+                servos[idx]->writeDegrees(c.f0);  // driver clamps 0-180
+            }
+            break;
+        }
+
+        case WebCommand::TestVibrator:
+            if (g_state.dispensing) break;  // core 1 drives the vibrator
+            vibrators[ctx.selected_scale]->setIntensity(c.f0);
+            break;
+
+        case WebCommand::TestStop:
+            // The test sliders' stop. A running gate and its vibrator belong
+            // to core 1 (the web's Stop is StopDispense): left alone
+            for (int i = 0; i < 3; i++) {
+                if (g_state.run_active[i]) continue;
+                servos[i]->writeDegrees(servo_close(g_state, i));
+                vibrators[i]->off();
+                release_servo_later(i);
+            }
+            break;
+
+        case WebCommand::SetPID:
+            apply_pid_gains(c.i0, c.f0, c.f1, c.f2, true);
+            break;
+
+        case WebCommand::Autotune:
+            // Handed to the Autotune screen: it starts the test and fits the
+            // result. Other scales may be dispensing meanwhile.
+            if (!tune_running() &&
+                !g_state.run_active[(c.i0 >= 0 && c.i0 <= 2) ? c.i0 : ctx.selected_scale]) {
+                if (c.i0 >= 0 && c.i0 <= 2) ctx.selected_scale = c.i0;
+                if (c.f0 > 0.0f) ctx.tune_open = c.f0 > SERVO_OPEN_SPAN_DEG ? SERVO_OPEN_SPAN_DEG : c.f0;
+                if (c.f1 > 0.0f) ctx.tune_max_g = c.f1 > 9999.0f ? 9999.0f : c.f1;
+                if (c.f2 > 0.0f) ctx.tune_tc = c.f2;
+                ctx.web_start_autotune = true;
+                mgr.goTo(ctx, ScreenId::Autotune);
+            }
+            break;
+
+        case WebCommand::AutotuneApply:
+            if (c.i0 >= 0 && c.i0 <= 2 && g_state.tune[c.i0].state == TuneState::Done) {
+                const TuneResult& r = g_state.tune[c.i0];
+                apply_pid_gains(c.i0, r.kp, r.ki, r.kd, c.f0 != 0.0f);
+                bz.playMarioCoin();
+            }
+            break;
+
+        case WebCommand::RecipeSave:
+            if (c.i0 >= 0 && c.i0 < RECIPE_SLOTS) {
+                net_lock();
+                g_state.recipes[c.i0] = g_state.recipe_stage[c.i0];
+                net_unlock();
+                if (!g_state.dispensing) {
+                    save_recipes();
+                } else {
+                    recipe_save_pending = true;
+                }
+            }
+            break;
+
+        case WebCommand::RecipeRun:
+            // task_batch starts the first stage on its next tick. A recipe
+            // that can't be planned leaves a Failed batch saying why.
+            if (!batch.running() && c.i0 >= 0 && c.i0 < RECIPE_SLOTS) {
+                if (batch.begin(g_state.recipes[c.i0], c.i0, c.f0)) {
+                    printf("[recipe] batch '%s'\n", g_state.recipes[c.i0].name);
+                } else {
+                    printf("[recipe] '%s' refused: %s\n", g_state.recipes[c.i0].name,
+                           batch.status().error);
+                }
+            }
+            break;
+
+        case WebCommand::RecipeStop:
+            batch.stop("stopped");
+            stop_batch_runs();
+            break;
+
+        case WebCommand::QueueStart:
+        case WebCommand::QueueNext:
+        case WebCommand::QueueStop:
+            queue_command(c);
+            break;
+
+        case WebCommand::BagReserve:
+            // Saved by task_bag, once nothing dispenses
+            if (c.i0 >= 0 && c.i0 <= 2) {
+                bags.set_reserve(c.i0, c.f0);
+                bag_save_now = true;
+            }
+            break;
+
+        case WebCommand::SetClock:
+            if (c.i0 > 0 && c.f0 >= 0.0f && c.f0 < 86400.0f) {
+                clock_day = c.i0;
+                clock_sec = (uint32_t)c.f0;
+                clock_us = time_us_64();
+            }
+            break;
+
+        case WebCommand::SetName:
+            if (c.i0 >= 0 && c.i0 <= 2) {
+                net_lock();
+                std::snprintf(g_state.names[c.i0], sizeof(g_state.names[c.i0]),
+                              "%s", c.s0);
+                net_unlock();
+                if (!g_state.dispensing) {
+                    save_scale_names();
+                } else {
+                    name_save_pending = true;
+                }
+            }
+            break;
+
+        case WebCommand::SetServoZero:
+            if (c.i0 >= 0 && c.i0 <= 2 && c.f0 >= 0.0f && c.f0 <= 180.0f) {
+                net_lock();
+                g_state.servo_zero[c.i0] = c.f0;
+                net_unlock();
+                control_send(c);
+                bz.playMarioCoin();
+                if (!g_state.dispensing) {
+                    save_servo_zeros();
+                    // Park at the new closed position (zero - backoff)
+                    servos[c.i0]->writeDegrees(servo_close(g_state, c.i0));
+                    release_servo_later(c.i0);
+                } else {
+                    servo_save_pending = true;
+                }
+            }
+            break;
+
+        case WebCommand::EStop:
+            // Emergency stop: works from ANY state, never asks questions.
+            printf("[estop] web emergency stop\n");
+            batch.stop("e-stop");
+            orders.stop("e-stop");
+            // Core 1 ends every run (PID to MANUAL), closes every servo,
+            // stops the vibrators and releases the servos 300 ms later.
+            // task_sync sees the runs end in the next snapshot and closes
+            // their telemetry.
+            if (!control_send(c)) {
+                // Queue full: never lose an e-stop - close from here
+                for (int i = 0; i < 3; i++) {
+                    servos[i]->writeDegrees(servo_close(g_state, i));
+                    vibrators[i]->off();
+                }
+            }
+            break;
+
+        case WebCommand::Calibrate:
+            // Writes flash on completion - not while a dispense is running
+            if (g_state.dispensing || web_op_scale >= 0) break;
+            if (c.i0 > 0 &&
+                scale_links[ctx.selected_scale]->begin_calibrate((float)c.i0, 10)) {
+                web_op_scale = ctx.selected_scale;
+                web_op_cmd = WebCommand::Calibrate;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    // Web-started tare/calibration: collected across task runs, so the
+    // LCD, web queue and status polls keep running while it averages
+    if (web_op_scale >= 0) {
+        ScaleLink* s = scale_links[web_op_scale];
+        HxOpStatus st = s->poll_op();
+        if (st != HxOpStatus::Busy) {
+            if (st == HxOpStatus::Done && web_op_cmd == WebCommand::Calibrate &&
+                !g_state.dispensing) {
+                // The tare done before calibration IS the calibrated zero
+                // (applied on core 1); persist what it reported
+                sc.entries[web_op_scale].offset_counts = s->get_offset();
+                sc.entries[web_op_scale].count_per_g = s->get_scale();
+                save_scale_config(sc);
+            }
+            if (st == HxOpStatus::Done) {
+                bz.playMarioCoin();
+                // Publish the new reading immediately so the next status
+                // poll shows it instead of the stale pre-tare weight
+                float wnew = s->read_weight();
+                net_lock();
+                g_state.weights[web_op_scale] = wnew;
+                g_state.gross[web_op_scale] = s->last_gross();
+                net_unlock();
+            }
+            web_op_scale = -1;
+        }
+    }
+
+    // Flush saves that were deferred because a dispense was running
+    if (pid_save_pending && !g_state.dispensing) {
+        pid_save_pending = false;
+        save_pid_gains();
+    }
+    if (name_save_pending && !g_state.dispensing) {
+        name_save_pending = false;
+        save_scale_names();
+    }
+    if (servo_save_pending && !g_state.dispensing) {
+        servo_save_pending = false;
+        save_servo_zeros();
+    }
+    if (recipe_save_pending && !g_state.dispensing) {
+        recipe_save_pending = false;
+        save_recipes();
+    }
+    // The LCD Servo Zero screen requests persistence through this flag
+    if (ctx.servo_zero_save_request && !g_state.dispensing) {
+        ctx.servo_zero_save_request = false;
+        save_servo_zeros();
+    }
+}
+
+// LCD/encoder UI: the current screen at its own period, or the web status
+// page while the phone is in control.
+static void task_ui(void*)
+{
+    // When web is active, show status on LCD but skip all hardware input.
+    // EXCEPTION: the Dispense and Autotune screens keep running - Dispense
+    // shows the selected scale's run, Autotune fits the step test when it
+    // ends.
+    if (ctx.web_active && mgr.currentId() != ScreenId::Dispense &&
+        mgr.currentId() != ScreenId::Autotune) {
+        static bool web_lcd_drawn = false;
+
+        // Encoder press (while idle) hands control back to the local UI.
+        // Close + release all servos first: one may have been left jogged
+        // open from the phone (calibration/test) and must not stay open.
+        if (enc.isPressed() && !g_state.dispensing) {
+            for (int i = 0; i < 3; i++) {
+                servos[i]->writeDegrees(servo_close(g_state, i));
+                release_servo_later(i);
+            }
+            ctx.web_active = false;
+            web_lcd_drawn = false;
+            mgr.goTo(ctx, ScreenId::Menu);
+            sched.set_period(ui_task, mgr.periodMs() * 1000);
+            return;
+        }
+
+        if (!web_lcd_drawn) {
+            lcd.clear();
+            lcd.setCursor(0, 0);
+            lcd.print("  Web Control Active");
+            web_lcd_drawn = true;
+        }
+        // Show live info on LCD
+        char wline[21];
+        float wg = scale_links[ctx.selected_scale]->read_weight();
+        std::snprintf(wline, sizeof(wline), "Scale %d: %d g      ", ctx.selected_scale + 1, (int)(wg + 0.5f));
+        lcd.setCursor(1, 0);
+        lcd.print(wline);
+        std::snprintf(wline, sizeof(wline), "Target: %d g        ", ctx.target_grams);
+        lcd.setCursor(2, 0);
+        lcd.print(wline);
+        const QueueStatus& q = g_state.queue;
+        if (q.state == BatchState::Running) {
+            static const char* const PHASE[] = {"next", "run", "settle", "remove", "place"};
+            std::snprintf(wline, sizeof(wline), "Queue %u/%u %-6s    ",
+                          (unsigned)q.done + (q.phase == QueuePhase::Run ? 1 : 0),
+                          (unsigned)q.count, PHASE[(int)q.phase]);
+        } else if (g_state.run_active[ctx.selected_scale]) {
+            std::snprintf(wline, sizeof(wline), "Dispensing: %d g    ", (int)(g_state.dispensed_grams + 0.5f));
+        } else if (g_state.dispensing) {
+            std::snprintf(wline, sizeof(wline), "Running: %c %c %c       ",
+                          g_state.run_active[0] ? '1' : '-', g_state.run_active[1] ? '2' : '-',
+                          g_state.run_active[2] ? '3' : '-');
+        } else if (g_state.ap_mode) {
+            // RSSI is meaningless as an access point - show where the
+            // app lives instead (\xA5 = centered dot in the HD44780 ROM)
+            std::snprintf(wline, sizeof(wline), "Hotspot\xA5 192.168.4.1");
+        } else {
+            int32_t rssi = -100;
+            cyw43_wifi_get_rssi(&cyw43_state, &rssi);
+            std::snprintf(wline, sizeof(wline), "WiFi: %ld dBm %s", (long)rssi,
+                rssi > -50 ? "Great" : rssi > -65 ? "Good" : rssi > -75 ? "Fair" : "Weak");
+        }
+        lcd.setCursor(3, 0);
+        lcd.print(wline);
+
+        // Update 7-segment with weight (two decimals)
+        sevenSeg->clear();
+        sevenSeg->printFixed2(wg < 0 ? 0.0f : wg, 0, 128, 255);
+        sevenSeg->show();
+
+        sched.set_period(ui_task, WEB_UI_PERIOD_US);
+        return;  // Web owns the UI; skip the screen tick
+    }
+
+    // Run the current screen (see app/screens.cpp)
+    mgr.tick(ctx);
+    sched.set_period(ui_task, mgr.periodMs() * 1000);
+    if (ctx.hold_ms) {
+        sched.defer(ui_task, ctx.hold_ms * 1000);   // keep its message up
+        ctx.hold_ms = 0;
+    }
+}
+
+static void task_lcd(void*)
+{
+    // Screens redraw into the LCD framebuffer; this sends the difference by
+    // DMA (skipped while the previous flush is still on the wire)
+    lcd.flushAsync();
+}
+
+// Overrun report: printed only when a counter moved
+static void task_stats(void*)
+{
+    static uint32_t last_total = 0;
+    Scheduler::Stats st[Scheduler::MAX_TASKS];
+    int n = sched.stats(st, Scheduler::MAX_TASKS);
+    uint32_t total = 0;
+    for (int i = 0; i < n; i++) total += st[i].overruns;
+    if (total == last_total) return;
+    last_total = total;
+    for (int i = 0; i < n; i++) {
+        if (st[i].period_us == 0) continue;
+        printf("[sched] %-6s %6lu us: %lu runs, %lu overruns, late max %lu us, run max %lu us\n",
+               st[i].name, (unsigned long)st[i].period_us, (unsigned long)st[i].runs,
+               (unsigned long)st[i].overruns, (unsigned long)st[i].max_late_us,
+               (unsigned long)st[i].max_run_us);
+    }
+}
+
 int main()
 {
     stdio_init_all();
 
-    // Load persisted PID gains (if ever saved) before the controller is created
+    // Load persisted PID gains (if ever saved) before the controller is
+    // created. A unit last saved with one set for all scales starts every
+    // scale on it.
     {
+        PidScaleConfig ps;
         PidConfig pc;
-        if (load_pid_config(pc)) {
-            Kp = pc.kp;
-            Ki = pc.ki;
-            Kd = pc.kd;
+        if (load_pid_scale_config(ps)) {
+            for (int i = 0; i < 3; i++) pid_gains[i] = ps.entries[i];
+        } else if (load_pid_config(pc)) {
+            for (PidEntry& g : pid_gains) g = PidEntry{ pc.kp, pc.ki, pc.kd };
         }
     }
 
@@ -179,6 +1002,23 @@ int main()
         }
     }
 
+    // Bag reserves and consumption log
+    {
+        BagConfig bc;
+        if (load_bag_config(bc)) bags.restore(bc.log);
+        bag_saved_us = time_us_64();
+    }
+
+    // Load the recipe book
+    {
+        RecipeConfig rc;
+        if (load_recipe_config(rc)) {
+            for (int i = 0; i < RECIPE_SLOTS; i++) {
+                g_state.recipes[i] = rc.recipes[i];
+            }
+        }
+    }
+
     // Load persisted servo zero angles (before the startup close below, which
     // parks each servo relative to its zero)
     {
@@ -208,7 +1048,7 @@ int main()
     sleep_ms(1000);
     printf("Ready.\r\r\n");
 
-    lcd.init(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, 100000);
+    lcd.init(PICO_DEFAULT_I2C_SDA_PIN, PICO_DEFAULT_I2C_SCL_PIN, 400000);
 
     // --- Network mode chooser --------------------------------------------
     // Pick Home WiFi (STA, still falls back to the hotspot if it fails) or
@@ -423,6 +1263,13 @@ int main()
 
     bool isConfigured = false;
 
+    // Timestamped DMA capture (falls back to FIFO polling), 80 SPS + filter
+    for (int i = 0; i < 3; i++) {
+        scales[i]->start_capture();
+        scales[i]->set_rate(HX711_RATE_PIN, HX711_HIGH_RATE);
+        scales[i]->set_filter(HX711_HIGH_RATE ? HX711_FILTER : WeightFilterConfig{});
+    }
+
     if (load_scale_config(sc))
     {
         // Apply config to all 3 scales
@@ -471,334 +1318,45 @@ int main()
         sleep_ms(2500);
     }
 
-    // UI context shared by the screen classes (app/screens.cpp) and the web
-    // command dispatcher below
-    UiContext ctx{
-        lcd, enc, bz, scales, servos, vibrators, sevenSeg, sc, g_state,
-        Kp, Ki, Kd, dispense_pid, &net_lock, &net_unlock
-    };
-    ctx.names = g_state.names;
-
-    ScreenManager mgr;
-    mgr.init(ctx, isConfigured ? ScreenId::Menu : ScreenId::SelectScale);
-
-    // Timestamp for periodic background weight reads
-    absolute_time_t last_bg_weight_time = get_absolute_time();
-    int bg_weight_cycle = 0;  // cycles through non-selected scales
-
-    while (true)
+    // Hand the scales and the dispense actuators to the control core, then
+    // give it the gains and servo zeros loaded above
+    control_start(scales, servos, vibrators);
     {
-        // --- Web state sync: update g_state from local variables ---
-        // Scale reads happen OUTSIDE the lwIP lock (they bit-bang the HX711);
-        // only the g_state assignments are guarded so /api/status snapshots
-        // taken in the lwIP IRQ context can't tear across fields.
-        bool have_weights = false;
-        float w_sel = 0.0f, w_other = 0.0f;
-        float gr_sel = 0.0f, gr_other = 0.0f;
-        int other = (ctx.selected_scale + 1 + bg_weight_cycle) % 3;
-        if (absolute_time_diff_us(last_bg_weight_time, get_absolute_time()) > 250000) {
-            w_sel = scales[ctx.selected_scale]->read_weight();
-            gr_sel = scales[ctx.selected_scale]->last_gross();   // same raw sample
-            if (other != ctx.selected_scale) {
-                w_other = scales[other]->read_weight();
-                gr_other = scales[other]->last_gross();
-            }
-            have_weights = true;
-            bg_weight_cycle = (bg_weight_cycle + 1) % 2;
-            last_bg_weight_time = get_absolute_time();
-        }
-
-        net_lock();
-        g_state.selected_scale = ctx.selected_scale;
-        g_state.target_grams = ctx.target_grams;
-        if (have_weights) {
-            g_state.weights[ctx.selected_scale] = w_sel;
-            g_state.gross[ctx.selected_scale] = gr_sel;
-            if (other != ctx.selected_scale) {
-                g_state.weights[other] = w_other;
-                g_state.gross[other] = gr_other;
-            }
-        }
-        g_state.pid_kp = (float)Kp;
-        g_state.pid_ki = (float)Ki;
-        g_state.pid_kd = (float)Kd;
+        WebCmd c;
+        c.cmd = WebCommand::SetPID;
         for (int i = 0; i < 3; i++) {
-            g_state.scale_calibrated[i] =
-                (scales[i]->get_offset() != 0 || scales[i]->get_scale() != 1.0f);
+            c.i0 = i;
+            c.f0 = pid_gains[i].kp; c.f1 = pid_gains[i].ki; c.f2 = pid_gains[i].kd;
+            control_send(c);
         }
-        net_unlock();
-
-        // --- Web command dispatch ---
-        // Drain ALL queued commands in order (the queue means nothing gets lost
-        // while a blocking tare/calibrate stalls the loop). Pop under the lwIP
-        // lock, dispatch from the copy.
-        while (true) {
-            WebCmd c;
-            net_lock();
-            bool have = (g_state.cmd_tail != g_state.cmd_head);
-            if (have) {
-                c = g_state.cmd_queue[g_state.cmd_tail];
-                g_state.cmd_tail = (uint8_t)((g_state.cmd_tail + 1) % WEBCMD_QUEUE_LEN);
-            }
-            net_unlock();
-            if (!have) break;
-
-            ctx.web_active = true;  // Web is in control, disable hardware input
-
-            switch (c.cmd) {
-            case WebCommand::Tare:
-                // tare blocks ~1.6 s - never stall the PID with the gate open
-                if (g_state.dispensing) break;
-                scales[ctx.selected_scale]->tare();
-                bz.playMarioCoin();
-                // Publish the tared reading immediately so the next status poll
-                // shows ~0 instead of the stale pre-tare weight
-                {
-                    float wnew = scales[ctx.selected_scale]->read_weight();
-                    net_lock();
-                    g_state.weights[ctx.selected_scale] = wnew;
-                    g_state.gross[ctx.selected_scale] = scales[ctx.selected_scale]->last_gross();
-                    net_unlock();
-                }
-                break;
-
-            case WebCommand::SetTarget:
-                ctx.target_grams = c.i0;
-                if (ctx.target_grams < 1) ctx.target_grams = 1;
-                if (ctx.target_grams > 9999) ctx.target_grams = 9999;
-                break;
-
-            case WebCommand::SelectScale:
-                if (c.i0 >= 0 && c.i0 <= 2) {
-                    ctx.selected_scale = c.i0;
-                }
-                break;
-
-            case WebCommand::StartDispense:
-                // Jump to the dispense screen and flag it to auto-start
-                if (!g_state.dispensing) {
-                    ctx.web_start_dispense = true;
-                    g_state.dispense_done = false;
-                    mgr.goTo(ctx, ScreenId::Dispense);
-                }
-                break;
-
-            case WebCommand::StopDispense:
-                // Route through the Dispense screen's Running state so the state
-                // machine, telemetry and web state all stop consistently. (Closing
-                // the servo here alone is not enough - Running would re-open it.)
-                if (g_state.dispensing) {
-                    ctx.web_stop_dispense = true;
-                }
-                break;
-
-            case WebCommand::TestServo: {
-                // i0 = explicit servo index (calibration UI); -1 = legacy test
-                // slider, which follows the selected scale
-                int idx = (c.i0 >= 0 && c.i0 <= 2) ? c.i0 : ctx.selected_scale;
-                if (g_state.dispensing) break;  // never fight the PID loop
-                if (c.f0 < 0.0f) {
-                    // Close-and-release sentinel
-                    servos[idx]->writeDegrees(servo_close(g_state, idx));
-                    sleep_ms(300);
-                    servos[idx]->off();
-                } else {
-                    servos[idx]->writeDegrees(c.f0);  // driver clamps 0-180
-                }
-                break;
-            }
-
-            case WebCommand::TestVibrator:
-                vibrators[ctx.selected_scale]->setIntensity(c.f0);
-                break;
-
-            case WebCommand::TestStop:
-                for (int i = 0; i < 3; i++) {
-                    servos[i]->writeDegrees(servo_close(g_state, i));
-                    vibrators[i]->off();
-                }
-                sleep_ms(300);
-                for (int i = 0; i < 3; i++) {
-                    servos[i]->off();
-                }
-                break;
-
-            case WebCommand::SetPID:
-                Kp = (double)c.f0;
-                Ki = (double)c.f1;
-                Kd = (double)c.f2;
-                if (dispense_pid) {
-                    dispense_pid->SetTunings(Kp, Ki, Kd);
-                }
-                // Persist - but never write flash mid-dispense (IRQ stall)
-                if (!g_state.dispensing) {
-                    save_pid_gains();
-                } else {
-                    pid_save_pending = true;
-                }
-                break;
-
-            case WebCommand::SetName:
-                if (c.i0 >= 0 && c.i0 <= 2) {
-                    net_lock();
-                    std::snprintf(g_state.names[c.i0], sizeof(g_state.names[c.i0]),
-                                  "%s", c.s0);
-                    net_unlock();
-                    if (!g_state.dispensing) {
-                        save_scale_names();
-                    } else {
-                        name_save_pending = true;
-                    }
-                }
-                break;
-
-            case WebCommand::SetServoZero:
-                if (c.i0 >= 0 && c.i0 <= 2 && c.f0 >= 0.0f && c.f0 <= 180.0f) {
-                    net_lock();
-                    g_state.servo_zero[c.i0] = c.f0;
-                    net_unlock();
-                    bz.playMarioCoin();
-                    if (!g_state.dispensing) {
-                        save_servo_zeros();
-                        // Park at the new closed position (zero - backoff)
-                        servos[c.i0]->writeDegrees(servo_close(g_state, c.i0));
-                        sleep_ms(300);
-                        servos[c.i0]->off();
-                    } else {
-                        servo_save_pending = true;
-                    }
-                }
-                break;
-
-            case WebCommand::EStop:
-                // Emergency stop: works from ANY state, never asks questions.
-                printf("[estop] web emergency stop\n");
-                if (g_state.dispensing) {
-                    // Route through the Dispense screen's Running state (same
-                    // tick, drain runs before mgr.tick) - servo closes, PID
-                    // goes MANUAL, telemetry run ends cleanly
-                    ctx.web_stop_dispense = true;
-                } else {
-                    // Idle/test/jog: close and release everything
-                    for (int i = 0; i < 3; i++) {
-                        servos[i]->writeDegrees(servo_close(g_state, i));
-                    }
-                    sleep_ms(300);
-                    for (int i = 0; i < 3; i++) {
-                        servos[i]->off();
-                    }
-                }
-                for (int i = 0; i < 3; i++) {
-                    vibrators[i]->off();
-                }
-                break;
-
-            case WebCommand::Calibrate:
-                // Blocks even longer than tare, and writes flash - not while
-                // a dispense is running
-                if (g_state.dispensing) break;
-                if (c.i0 > 0) {
-                    scales[ctx.selected_scale]->calibrate_scale(
-                        (float)c.i0, 10);
-                    // The tare done before calibration IS the calibrated zero
-                    scales[ctx.selected_scale]->set_cal_offset(
-                        scales[ctx.selected_scale]->get_offset());
-                    sc.entries[ctx.selected_scale].offset_counts =
-                        scales[ctx.selected_scale]->get_offset();
-                    sc.entries[ctx.selected_scale].count_per_g =
-                        scales[ctx.selected_scale]->get_scale();
-                    save_scale_config(sc);
-                    bz.playMarioCoin();
-                }
-                break;
-
-            default:
-                break;
-            }
-        }
-
-        // Flush saves that were deferred because a dispense was running
-        if (pid_save_pending && !g_state.dispensing) {
-            pid_save_pending = false;
-            save_pid_gains();
-        }
-        if (name_save_pending && !g_state.dispensing) {
-            name_save_pending = false;
-            save_scale_names();
-        }
-        if (servo_save_pending && !g_state.dispensing) {
-            servo_save_pending = false;
-            save_servo_zeros();
-        }
-        // The LCD Servo Zero screen requests persistence through this flag
-        if (ctx.servo_zero_save_request && !g_state.dispensing) {
-            ctx.servo_zero_save_request = false;
-            save_servo_zeros();
+        c = WebCmd{};
+        c.cmd = WebCommand::SetServoZero;
+        for (int i = 0; i < 3; i++) {
+            c.i0 = i;
+            c.f0 = g_state.servo_zero[i];
+            control_send(c);
         }
+    }
 
-        // When web is active, show status on LCD but skip all hardware input.
-        // EXCEPTION: the Dispense screen must keep running - it owns the PID
-        // loop, so a web-started dispense would otherwise never actually run.
-        if (ctx.web_active && mgr.currentId() != ScreenId::Dispense) {
-            static bool web_lcd_drawn = false;
-
-            // Encoder press (while idle) hands control back to the local UI.
-            // Close + release all servos first: one may have been left jogged
-            // open from the phone (calibration/test) and must not stay open.
-            if (enc.isPressed() && !g_state.dispensing) {
-                for (int i = 0; i < 3; i++) {
-                    servos[i]->writeDegrees(servo_close(g_state, i));
-                }
-                sleep_ms(300);
-                for (int i = 0; i < 3; i++) {
-                    servos[i]->off();
-                }
-                ctx.web_active = false;
-                web_lcd_drawn = false;
-                mgr.goTo(ctx, ScreenId::Menu);
-                continue;
-            }
-
-            if (!web_lcd_drawn) {
-                lcd.clear();
-                lcd.setCursor(0, 0);
-                lcd.print("  Web Control Active");
-                web_lcd_drawn = true;
-            }
-            // Show live info on LCD
-            char wline[21];
-            float wg = scales[ctx.selected_scale]->read_weight();
-            std::snprintf(wline, sizeof(wline), "Scale %d: %d g      ", ctx.selected_scale + 1, (int)(wg + 0.5f));
-            lcd.setCursor(1, 0);
-            lcd.print(wline);
-            std::snprintf(wline, sizeof(wline), "Target: %d g        ", ctx.target_grams);
-            lcd.setCursor(2, 0);
-            lcd.print(wline);
-            if (g_state.dispensing) {
-                std::snprintf(wline, sizeof(wline), "Dispensing: %d g    ", (int)(g_state.dispensed_grams + 0.5f));
-            } else if (g_state.ap_mode) {
-                // RSSI is meaningless as an access point - show where the
-                // app lives instead (\xA5 = centered dot in the HD44780 ROM)
-                std::snprintf(wline, sizeof(wline), "Hotspot\xA5 192.168.4.1");
-            } else {
-                int32_t rssi = -100;
-                cyw43_wifi_get_rssi(&cyw43_state, &rssi);
-                std::snprintf(wline, sizeof(wline), "WiFi: %ld dBm %s", (long)rssi,
-                    rssi > -50 ? "Great" : rssi > -65 ? "Good" : rssi > -75 ? "Fair" : "Weak");
-            }
-            lcd.setCursor(3, 0);
-            lcd.print(wline);
-
-            // Update 7-segment with weight (two decimals)
-            sevenSeg->clear();
-            sevenSeg->printFixed2(wg < 0 ? 0.0f : wg, 0, 128, 255);
-            sevenSeg->show();
+    ctx.names = g_state.names;
+    ctx.release_servo_later = release_servo_later;
+    ctx.apply_pid = apply_pid_gains;
+    ctx.start_run = start_run;
+    ctx.queue_cmd = queue_command;
+    mgr.init(ctx, isConfigured ? ScreenId::Menu : ScreenId::SelectScale);
 
-            sleep_ms(100);
-            continue;  // Web owns the UI; skip the screen tick
-        }
+    lcd.setAutoFlush(false);   // task_lcd flushes
+    sched.every("sync", SYNC_PERIOD_US, PRIO_SYNC, task_sync, nullptr);
+    sched.every("web", WEB_PERIOD_US, PRIO_WEB, task_web, nullptr);
+    sched.every("batch", BATCH_PERIOD_US, PRIO_WEB, task_batch, nullptr);
+    sched.every("queue", QUEUE_PERIOD_US, PRIO_WEB, task_queue, nullptr);
+    sched.every("bag", BAG_PERIOD_US, PRIO_LCD, task_bag, nullptr);
+    ui_task = sched.every("ui", mgr.periodMs() * 1000, PRIO_UI, task_ui, nullptr);
+    sched.every("lcd", LCD_PERIOD_US, PRIO_LCD, task_lcd, nullptr);
+    sched.every("stats", STATS_PERIOD_US, PRIO_LCD, task_stats, nullptr);
 
-        // Run the current screen (see app/screens.cpp)
-        mgr.tick(ctx);
+    while (true)
+    {
+        sleep_until(from_us_since_boot(sched.run_due()));
     }
 }
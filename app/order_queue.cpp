@@ -0,0 +1,124 @@
+#include "order_queue.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+void OrderQueue::fail(const char* why)
+{
+    st_.state = BatchState::Failed;
+    std::snprintf(st_.error, sizeof(st_.error), "%s", why);
+}
+
+bool OrderQueue::begin(int scale, float target, int count)
+{
+    st_ = QueueStatus{};
+    st_.state = BatchState::Running;
+    st_.phase = QueuePhase::Start;
+    st_.scale = (int8_t)scale;
+    st_.target = std::floor(target + 0.5f);   // StartDispense takes whole grams
+    st_.count = (uint16_t)(count < 0 ? 0 : (count > MAX_COUNT ? MAX_COUNT : count));
+    have_win_ = false;
+    if (scale < 0 || scale > 2) {
+        fail("bad scale");
+        return false;
+    }
+    if (st_.target < MIN_G || st_.target > MAX_G) {
+        fail("bad target");
+        return false;
+    }
+    if (count < 1 || count > MAX_COUNT) {
+        fail("bad count");
+        return false;
+    }
+    return true;
+}
+
+bool OrderQueue::next(int* scale, float* target)
+{
+    if (!running() || st_.phase != QueuePhase::Start) return false;
+    st_.phase = QueuePhase::Run;
+    *scale = st_.scale;
+    *target = st_.target;
+    return true;
+}
+
+void OrderQueue::start_failed()
+{
+    if (!running()) return;
+    char why[24];
+    std::snprintf(why, sizeof(why), "scale %d busy", st_.scale + 1);
+    fail(why);
+}
+
+void OrderQueue::run_ended(bool done, float grams)
+{
+    if (!running() || st_.phase != QueuePhase::Run) return;
+    if (!done) {
+        char why[24];
+        std::snprintf(why, sizeof(why), "run %u stopped", (unsigned)st_.done + 1);
+        fail(why);
+        return;
+    }
+    st_.done++;
+    st_.last = grams;
+    st_.total += grams;
+    if (st_.done >= st_.count) {
+        st_.state = BatchState::Done;
+        return;
+    }
+    st_.phase = QueuePhase::Settle;
+    disturbed_ = false;
+    have_win_ = false;
+}
+
+void OrderQueue::sample(uint32_t now_ms, float gross)
+{
+    if (!running()) return;
+    QueuePhase p = st_.phase;
+    if (p != QueuePhase::Settle && p != QueuePhase::Remove && p != QueuePhase::Place) return;
+
+    // Still window: restarts whenever the readings spread too far
+    float lo = gross < lo_ ? gross : lo_;
+    float hi = gross > hi_ ? gross : hi_;
+    if (!have_win_ || hi - lo > STILL_G) {
+        lo_ = hi_ = gross;
+        win_ms_ = now_ms;
+        have_win_ = true;
+    } else {
+        lo_ = lo;
+        hi_ = hi;
+    }
+    uint32_t still_ms = now_ms - win_ms_;
+    float level = 0.5f * (lo_ + hi_);
+
+    if (p == QueuePhase::Settle) {
+        if (still_ms >= READY_MS) {
+            base_ = level;
+            disturbed_ = false;
+            st_.phase = QueuePhase::Remove;
+        }
+        return;
+    }
+
+    if (std::fabs(gross - base_) > BUMP_G) disturbed_ = true;
+    if (!disturbed_) return;
+    uint32_t need = p == QueuePhase::Remove ? STILL_MS : READY_MS;
+    if (still_ms >= need && std::fabs(level - base_) <= RETURN_G) {
+        disturbed_ = false;
+        st_.phase = p == QueuePhase::Remove ? QueuePhase::Place : QueuePhase::Start;
+    }
+}
+
+void OrderQueue::swapped()
+{
+    if (!running()) return;
+    QueuePhase p = st_.phase;
+    if (p == QueuePhase::Settle || p == QueuePhase::Remove || p == QueuePhase::Place) {
+        st_.phase = QueuePhase::Start;
+    }
+}
+
+void OrderQueue::stop(const char* why)
+{
+    if (running()) fail(why);
+}
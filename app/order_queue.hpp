@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include "dispenser_state.h"   // QueueStatus
+
+// Order queue: the same dispense N times on one scale for bagging. After each
+// run it waits for the filled container to be swapped for an empty one, then
+// starts the next run straight away - no Done screen, no re-tare (core 1 zeroes
+// in the background at the start of every run, see app/control.cpp).
+//
+// The swap is read from the scale's gross weight. The load cell carries the
+// hanging supply bag, not the container under the gate, so the container's
+// own weight never shows; taking a container off the spout and hooking the
+// next one on does knock the hanging bag, though, and that does:
+//
+//   Settle   the run is over: wait until the bag hangs still (in-flight grain
+//            landed, swing died down) and take that as the baseline
+//   Remove   a disturbance (a reading BUMP_G off the baseline) that dies down
+//            again: the full container came off
+//   Place    a second one: the empty container went on. The next run starts
+//            once the bag has hung still READY_MS back at the baseline, so
+//            nothing still leaning on the gate comes off mid-run and counts
+//            as dispensed.
+//
+// A swap too quick or too gentle to show up as two disturbances is confirmed
+// by hand (swapped(): the encoder or /api/queue "next").
+//
+// A run that ends without reaching its target (stopped, e-stop, empty bag)
+// fails the queue.
+//
+// No Pico SDK dependencies: main.cpp starts and closes the runs, feeds their
+// ends and the weight stream here.
+
+class OrderQueue {
+public:
+    static constexpr int      MAX_COUNT = 999;
+    static constexpr float    MIN_G     = 1.0f;
+    static constexpr float    MAX_G     = 9999.0f;
+    static constexpr float    STILL_G   = 2.0f;    // spread of a still reading
+    static constexpr uint32_t STILL_MS  = 500;     // still this long: disturbance over
+    static constexpr uint32_t READY_MS  = 1500;    // still this long: baseline / go
+    static constexpr float    BUMP_G    = 8.0f;    // off the baseline: disturbed
+    static constexpr float    RETURN_G  = 3.0f;    // back at the baseline
+
+    // False (and a Failed status saying why) for a bad scale, target or count
+    bool begin(int scale, float target, int count);
+
+    // A run to start now: true, and marks it running
+    bool next(int* scale, float* target);
+    // The run next() asked for did not start (scale busy)
+    void start_failed();
+    // The queue's run is over: done = reached its target, grams = final weight
+    void run_ended(bool done, float grams);
+
+    // Gross weight of the queue's scale, between runs (any rate, in order)
+    void sample(uint32_t now_ms, float gross);
+    // The operator says the next container is in place
+    void swapped();
+
+    void stop(const char* why);
+
+    bool running() const { return st_.state == BatchState::Running; }
+    // Scale i has the queue's run going
+    bool owns(int scale) const {
+        return running() && st_.phase == QueuePhase::Run && st_.scale == scale;
+    }
+    const QueueStatus& status() const { return st_; }
+
+private:
+    void fail(const char* why);
+
+    QueueStatus st_;
+    float    base_ = 0.0f;        // still level after the run
+    bool     disturbed_ = false;  // current phase saw its disturbance
+    // Still window: readings since win_ms_ spread no more than STILL_G
+    bool     have_win_ = false;
+    float    lo_ = 0.0f, hi_ = 0.0f;
+    uint32_t win_ms_ = 0;
+};
@@ -0,0 +1,157 @@
+#include "recipe.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+void RecipeBatch::fail(const char* why)
+{
+    st_.state = BatchState::Failed;
+    std::snprintf(st_.error, sizeof(st_.error), "%s", why);
+}
+
+bool RecipeBatch::begin(const Recipe& r, int slot, float total_g)
+{
+    st_ = BatchStatus{};
+    st_.state = BatchState::Running;
+    st_.slot = (int8_t)slot;
+    st_.count = r.count;
+    if (r.count == 0 || r.count > RECIPE_ITEMS) {
+        fail("empty recipe");
+        return false;
+    }
+
+    float sum = 0.0f;
+    for (int i = 0; i < r.count; i++) {
+        const RecipeItem& it = r.items[i];
+        st_.items[i].scale = it.scale;
+        st_.items[i].stage = it.stage;
+        if (r.percent & (1u << i)) {
+            if (r.total_g == 0) {
+                fail("% item, no total");
+                return false;
+            }
+            planned_[i] = (float)r.total_g * (float)it.amount / 1000.0f;
+        } else {
+            planned_[i] = (float)it.amount;
+        }
+        sum += planned_[i];
+        for (int j = 0; j < i; j++) {
+            if (r.items[j].scale == it.scale && r.items[j].stage == it.stage) {
+                char why[24];
+                std::snprintf(why, sizeof(why), "scale %d: stage clash", it.scale + 1);
+                fail(why);
+                return false;
+            }
+        }
+    }
+
+    // Another batch weight: every item in proportion
+    if (total_g > 0.0f && sum > 0.0f) {
+        for (int i = 0; i < r.count; i++) planned_[i] *= total_g / sum;
+    }
+    for (int i = 0; i < r.count; i++) {
+        if (planned_[i] < MIN_ITEM_G || planned_[i] > MAX_ITEM_G) {
+            char why[24];
+            std::snprintf(why, sizeof(why), "item %d: %.0f g", i + 1, (double)planned_[i]);
+            fail(why);
+            return false;
+        }
+        st_.items[i].target = planned_[i];
+    }
+    return true;
+}
+
+float RecipeBatch::factor() const
+{
+    float asked = 0.0f, got = 0.0f;
+    for (int i = 0; i < st_.count; i++) {
+        if (st_.items[i].state != ItemState::Done) continue;
+        asked += planned_[i];
+        got += st_.items[i].actual;
+    }
+    return asked > 0.0f ? got / asked : 1.0f;
+}
+
+int RecipeBatch::next(int* scale, float* target)
+{
+    if (st_.state != BatchState::Running) return 0;
+
+    // The current stage first
+    int stage = -1;
+    for (int i = 0; i < st_.count; i++) {
+        const BatchItem& it = st_.items[i];
+        if (it.state == ItemState::Running) return 0;
+        if (it.state == ItemState::Pending && (stage < 0 || it.stage < stage)) stage = it.stage;
+    }
+    if (stage < 0) {
+        st_.state = BatchState::Done;
+        return 0;
+    }
+
+    float k = factor();
+    if (std::fabs(k - 1.0f) > MAX_CARRY) {
+        char why[24];
+        std::snprintf(why, sizeof(why), "off by %+.0f %%", (double)((k - 1.0f) * 100.0f));
+        fail(why);
+        return 0;
+    }
+    st_.factor = k;
+    st_.stage = (uint8_t)stage;
+
+    int n = 0;
+    for (int i = 0; i < st_.count; i++) {
+        BatchItem& it = st_.items[i];
+        if (it.state != ItemState::Pending || it.stage != stage) continue;
+        // Whole grams: StartDispense takes the target as an integer
+        float t = std::floor(planned_[i] * k + 0.5f);
+        if (t < MIN_ITEM_G) t = MIN_ITEM_G;
+        if (t > MAX_ITEM_G) t = MAX_ITEM_G;
+        it.target = t;
+        it.state = ItemState::Running;
+        scale[n] = it.scale;
+        target[n] = t;
+        n++;
+    }
+    return n;
+}
+
+void RecipeBatch::start_failed(int scale)
+{
+    for (int i = 0; i < st_.count; i++) {
+        BatchItem& it = st_.items[i];
+        if (it.state == ItemState::Running && it.scale == scale) it.state = ItemState::Failed;
+    }
+    if (st_.state != BatchState::Running) return;   // keep the first reason
+    char why[24];
+    std::snprintf(why, sizeof(why), "scale %d busy", scale + 1);
+    fail(why);
+}
+
+void RecipeBatch::run_ended(int scale, bool done, float grams)
+{
+    for (int i = 0; i < st_.count; i++) {
+        BatchItem& it = st_.items[i];
+        if (it.state != ItemState::Running || it.scale != scale) continue;
+        it.actual = grams;
+        it.state = done ? ItemState::Done : ItemState::Failed;
+        if (!done && st_.state == BatchState::Running) {
+            char why[24];
+            std::snprintf(why, sizeof(why), "scale %d stopped", scale + 1);
+            fail(why);
+        }
+        return;
+    }
+}
+
+void RecipeBatch::stop(const char* why)
+{
+    if (st_.state == BatchState::Running) fail(why);
+}
+
+bool RecipeBatch::owns(int scale) const
+{
+    for (int i = 0; i < st_.count; i++) {
+        if (st_.items[i].state == ItemState::Running && st_.items[i].scale == scale) return true;
+    }
+    return false;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include "dispenser_state.h"   // Recipe, BatchStatus
+
+// Recipe batch executor: one recipe (dispenser_state.h) dispensed
+// unattended, stage by stage. The items of a stage run side by side, one run
+// per scale; the next stage starts once all of them are over.
+//
+// Carry-forward: a stage's targets are scaled by what the finished items
+// actually delivered against what they were asked for,
+//
+//     factor = sum(actual) / sum(planned)    over every finished item
+//
+// so if the wheat overshoots by 3 % the items after it are asked for 3 % more
+// and the batch keeps its ratio. Items that run side by side can't correct
+// each other - put the item that should absorb the error in a later stage. A
+// factor off by more than MAX_CARRY means something went wrong (a jam, a
+// bag swapped mid-run): the batch fails instead of chasing it.
+//
+// A run that ends without reaching its target (stopped, e-stop, empty bag)
+// fails the batch; the caller stops the batch's other runs.
+//
+// No Pico SDK dependencies: main.cpp starts and closes the runs and feeds
+// their ends back here.
+
+class RecipeBatch {
+public:
+    static constexpr float MAX_CARRY = 0.10f;   // |factor - 1| limit
+    static constexpr float MIN_ITEM_G = 1.0f;
+    static constexpr float MAX_ITEM_G = 9999.0f;
+
+    // Plan recipe `slot`. total_g > 0 rescales the whole recipe to that batch
+    // weight. False (and a Failed status saying why) when the recipe is
+    // empty, has a scale twice in one stage, or plans an item outside
+    // MIN_ITEM_G..MAX_ITEM_G.
+    bool begin(const Recipe& r, int slot, float total_g);
+
+    // Runs to start now: the next stage, once the current one is over.
+    // Fills scale[]/target[] (RECIPE_ITEMS each) and marks those items
+    // running; 0 = nothing to start (waiting, finished or failed).
+    int next(int* scale, float* target);
+
+    // A run next() asked for did not start (scale busy, or the batch failed
+    // on an earlier one of the stage)
+    void start_failed(int scale);
+
+    // One of the batch's runs is over: done = reached its target, grams =
+    // settled final weight
+    void run_ended(int scale, bool done, float grams);
+
+    void stop(const char* why);
+
+    bool running() const { return st_.state == BatchState::Running; }
+    // Scale i has a batch run going
+    bool owns(int scale) const;
+    const BatchStatus& status() const { return st_; }
+
+private:
+    void fail(const char* why);
+    float factor() const;
+
+    BatchStatus st_;
+    float planned_[RECIPE_ITEMS] = {};   // before carry-forward
+};
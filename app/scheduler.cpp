@@ -0,0 +1,127 @@
+#include "scheduler.hpp"
+
+int Scheduler::add(const char* name, uint32_t period_us, uint32_t delay_us, uint8_t prio,
+                   Fn fn, void* arg)
+{
+    if (!fn) return -1;
+    for (int i = 0; i < MAX_TASKS; i++) {
+        Task& t = tasks_[i];
+        if (t.used) continue;
+        uint16_t gen = (uint16_t)((t.gen + 1) & 0x7FFF);   // ids stay positive
+        t = Task{};
+        t.name = name;
+        t.fn = fn;
+        t.arg = arg;
+        t.deadline = clock_() + delay_us;
+        t.period_us = period_us;
+        t.prio = prio;
+        t.used = true;
+        t.gen = gen;
+        return make_id(i, gen);
+    }
+    return -1;
+}
+
+int Scheduler::every(const char* name, uint32_t period_us, uint8_t prio, Fn fn, void* arg)
+{
+    if (period_us == 0) return -1;
+    return add(name, period_us, 0, prio, fn, arg);   // first run right away
+}
+
+int Scheduler::after(const char* name, uint32_t delay_us, uint8_t prio, Fn fn, void* arg)
+{
+    return add(name, 0, delay_us, prio, fn, arg);
+}
+
+Scheduler::Task* Scheduler::find(int id)
+{
+    if (id < 0) return nullptr;
+    int slot = id & 0xFF;
+    if (slot >= MAX_TASKS) return nullptr;
+    Task& t = tasks_[slot];
+    return (t.used && make_id(slot, t.gen) == id) ? &t : nullptr;
+}
+
+void Scheduler::cancel(int id)
+{
+    if (Task* t = find(id)) t->used = false;
+}
+
+void Scheduler::set_period(int id, uint32_t period_us)
+{
+    Task* t = find(id);
+    if (t && t->period_us != 0 && period_us != 0) t->period_us = period_us;
+}
+
+void Scheduler::defer(int id, uint32_t delay_us)
+{
+    Task* t = find(id);
+    if (!t) return;
+    uint64_t at = clock_() + delay_us;
+    if (t->deadline < at) t->deadline = at;
+}
+
+uint64_t Scheduler::run_due()
+{
+    for (;;) {
+        uint64_t now = clock_();
+
+        // Highest priority among the due tasks, then the earliest deadline
+        int pick = -1;
+        for (int i = 0; i < MAX_TASKS; i++) {
+            const Task& t = tasks_[i];
+            if (!t.used || t.deadline > now) continue;
+            if (pick < 0 || t.prio > tasks_[pick].prio ||
+                (t.prio == tasks_[pick].prio && t.deadline < tasks_[pick].deadline))
+                pick = i;
+        }
+
+        if (pick < 0) {
+            uint64_t next = now + MAX_IDLE_US;
+            for (const Task& t : tasks_)
+                if (t.used && t.deadline < next) next = t.deadline;
+            return next;
+        }
+
+        Task& t = tasks_[pick];
+        int id = make_id(pick, t.gen);
+        uint32_t late = (uint32_t)(now - t.deadline);
+
+        // Reschedule (or free) before the call, so the task may cancel,
+        // defer or re-arm itself
+        if (t.period_us != 0) {
+            uint64_t next = t.deadline + t.period_us;
+            if (next <= now) {
+                t.overruns++;
+                next = now + t.period_us;
+            }
+            t.deadline = next;
+        } else {
+            t.used = false;
+        }
+
+        Fn fn = t.fn;
+        void* arg = t.arg;
+        fn(arg);
+        uint32_t run = (uint32_t)(clock_() - now);
+
+        // Stats stay with the slot while it still holds this task (a
+        // finished one-shot's slot is free, but nobody has taken it yet)
+        if (make_id(pick, t.gen) == id) {
+            t.runs++;
+            if (late > t.max_late_us) t.max_late_us = late;
+            if (run > t.max_run_us) t.max_run_us = run;
+        }
+    }
+}
+
+int Scheduler::stats(Stats* out, int max) const
+{
+    int n = 0;
+    for (const Task& t : tasks_) {
+        if (!t.used || n >= max) continue;
+        out[n++] = Stats{t.name, t.period_us, t.prio, t.runs, t.overruns,
+                         t.max_late_us, t.max_run_us};
+    }
+    return n;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+
+// Deadline scheduler for the core-0 main loop (UI, web sync, LCD refresh,
+// one-shot timers such as a servo release after a close).
+//
+// Tasks are function + argument pairs in a fixed table, no heap. every()
+// registers a periodic task, after() a one-shot that frees its slot when it
+// runs. run_due() runs every task whose deadline has passed - highest
+// priority first, earliest deadline among equals - and returns the next
+// deadline, so the loop sleeps exactly until then instead of stacking
+// sleep_ms() calls. Nothing preempts: a long task only delays the others,
+// which shows up in their lateness.
+//
+// A periodic task keeps its phase (next = deadline + period). When it falls
+// a whole period behind it counts an overrun and restarts from now instead
+// of running back to back to catch up.
+//
+// No Pico SDK dependencies: the microsecond clock is passed in.
+
+class Scheduler {
+public:
+    using Fn = void (*)(void* arg);
+
+    static constexpr int      MAX_TASKS   = 16;
+    static constexpr uint32_t MAX_IDLE_US = 100000;   // longest sleep without a deadline
+
+    struct Stats {
+        const char* name;
+        uint32_t period_us;     // 0 = one-shot
+        uint8_t  prio;
+        uint32_t runs;
+        uint32_t overruns;      // deadlines missed by a whole period
+        uint32_t max_late_us;   // worst start past the deadline
+        uint32_t max_run_us;    // longest single run
+    };
+
+    explicit Scheduler(uint64_t (*clock_us)()) : clock_(clock_us) {}
+
+    // Task id, or -1 when the table is full. Ids of finished one-shots are
+    // never reused for another task, so cancel() on a stale id is harmless.
+    int every(const char* name, uint32_t period_us, uint8_t prio, Fn fn, void* arg);
+    int after(const char* name, uint32_t delay_us, uint8_t prio, Fn fn, void* arg);
+
+    void cancel(int id);
+    void set_period(int id, uint32_t period_us);    // takes effect after the next run
+    void defer(int id, uint32_t delay_us);          // next run no earlier than now + delay
+
+    // Run the due tasks; returns the next deadline (clock time, us)
+    uint64_t run_due();
+
+    // Copy out up to max tasks' stats; returns how many
+    int stats(Stats* out, int max) const;
+
+private:
+    struct Task {
+        const char* name;
+        Fn       fn;
+        void*    arg;
+        uint64_t deadline;
+        uint32_t period_us;     // 0 = one-shot
+        uint8_t  prio;
+        bool     used;
+        uint16_t gen;           // bumped on every reuse of the slot
+        uint32_t runs, overruns, max_late_us, max_run_us;
+    };
+
+    int   add(const char* name, uint32_t period_us, uint32_t delay_us, uint8_t prio, Fn fn, void* arg);
+    Task* find(int id);
+    static int make_id(int slot, uint16_t gen) { return (int)(((uint32_t)gen << 8) | (uint32_t)slot); }
+
+    uint64_t (*clock_)();
+    Task tasks_[MAX_TASKS] = {};
+};
@@ -7,13 +7,13 @@
 #include "Lcd1602I2C.hpp"
 #include "Rotary_Button.hpp"
 #include "Buzzer.hpp"
-#include "hx711.hpp"
+#include "control.hpp"
 #include "config_store.hpp"
 #include "Servo.hpp"
 #include "Vibrator.hpp"
 #include "SevenSeg.hpp"
-#include "PID.hpp"
 #include "telemetry.hpp"
+#include "autotune.hpp"
 #include "dispenser_state.h"
 
 // Menu arrow indicator (supports up to 4 rows)
@@ -24,6 +24,13 @@ static void indicatorArrow(Lcd1602I2C& lcd, int lineNumber, int startRow = 0, in
     }
 }
 
+// A running dispense counts its grams from its scale's zero: core 1 refuses
+// a Tare or Calibrate on that scale until the gate closes, and the screens
+// offer them greyed out ("----") meanwhile
+static bool scaleRunning(const UiContext& ctx, int i) {
+    return ctx.g_state.run_active[i];
+}
+
 // ---------------------------------------------------------------- Menu ------
 
 class MenuScreen : public Screen {
@@ -49,6 +56,8 @@ public:
         was_pressed_ = ctx.enc.isPressed();  // ignore carry-over press
     }
 
+    uint32_t periodMs() const override { return 20; }
+
     ScreenId update(UiContext& ctx) override {
         // Delta-driven selection, clamped (no wrap) - starting from the top
         // regardless of the encoder's absolute position
@@ -85,8 +94,6 @@ public:
             }
         }
         was_pressed_ = pressed;
-
-        sleep_ms(20);
         return next;
     }
 };
@@ -122,6 +129,8 @@ public:
         // here before the user could turn the knob)
     }
 
+    uint32_t periodMs() const override { return 20; }
+
     ScreenId update(UiContext& ctx) override {
         int pos = ctx.enc.getPosition();
         int delta = pos - last_encoder_pos_;
@@ -141,11 +150,9 @@ public:
         ScreenId next = ScreenId::SelectScale;
         if (pressed && !was_pressed_) {
             ctx.selected_scale = selected_;  // 0, 1, or 2
-            next = ctx.after_select;         // Calibrate1, Dispense or Weigh
+            next = ctx.after_select;         // Calibrate1, Dispense, Weigh or Autotune
         }
         was_pressed_ = pressed;
-
-        sleep_ms(20);
         return next;
     }
 };
@@ -157,6 +164,8 @@ class Calibrate1Screen : public Screen {
     int  last_option_ = -1;
     int  last_encoder_pos_ = 0;
     bool was_pressed_ = false;
+    bool taring_ = false;    // incremental tare running (ScaleLink::begin_tare)
+    bool busy_ = false;      // the scale is dispensing: Tare greyed out
 public:
     void enter(UiContext& ctx) override {
         ctx.lcd.clear();
@@ -174,22 +183,57 @@ public:
         was_pressed_ = ctx.enc.isPressed();
         option_ = 0;
         last_option_ = -1;
+        taring_ = false;
+        busy_ = false;
     }
 
     ScreenId update(UiContext& ctx) override {
+        if (taring_) {
+            // Zeroing across ticks: encoder ignored, progress on row 3
+            ScaleLink* s = ctx.scales[ctx.selected_scale];
+            HxOpStatus st = s->poll_op();
+            char line[21];
+            if (st == HxOpStatus::Busy) {
+                std::snprintf(line, sizeof(line), "   Zeroing... %3d%% ", s->op_progress());
+                ctx.lcd.setCursor(3, 0);
+                ctx.lcd.print(line);
+                return ScreenId::Calibrate1;
+            }
+            taring_ = false;
+            was_pressed_ = ctx.enc.isPressed();
+            last_encoder_pos_ = ctx.enc.getPosition();
+            if (st == HxOpStatus::Done) {
+                ctx.lcd.setCursor(3, 0);
+                ctx.lcd.print("   Zeroed!          ");
+                ctx.bz.playMarioCoin();  // Bling!
+                ctx.hold_ms = 700;       // message first, then Calibrate2
+                return ScreenId::Calibrate2;
+            }
+            ctx.lcd.setCursor(3, 0);
+            ctx.lcd.print("   No sensor data!  ");
+            ctx.hold_ms = 700;
+            last_option_ = -1;   // repaint the options after the hold
+            return ScreenId::Calibrate1;
+        }
+
+        bool busy = scaleRunning(ctx, ctx.selected_scale);
+        if (busy != busy_) {
+            busy_ = busy;
+            last_option_ = -1;
+        }
         int pos = ctx.enc.getPosition();
         int delta = pos - last_encoder_pos_;
         if (delta != 0) {
             option_ += delta;
-            if (option_ < 0) option_ = 0;
-            if (option_ > 1) option_ = 1;
             last_encoder_pos_ = pos;
         }
+        if (option_ < (busy_ ? 1 : 0)) option_ = busy_ ? 1 : 0;
+        if (option_ > 1) option_ = 1;
 
         if (option_ != last_option_) {
             char opt_line[21];
             std::snprintf(opt_line, sizeof(opt_line), "   %s%s%s%s%s%s",
-                option_ == 0 ? "[" : " ", "Tare", option_ == 0 ? "]" : " ",
+                option_ == 0 ? "[" : " ", busy_ ? "----" : "Tare", option_ == 0 ? "]" : " ",
                 option_ == 1 ? "[" : " ", "Back", option_ == 1 ? "]" : " ");
             ctx.lcd.setCursor(3, 0);
             ctx.lcd.print(opt_line);
@@ -199,24 +243,17 @@ public:
         bool pressed = ctx.enc.isPressed();
         if (pressed && !was_pressed_) {
             if (option_ == 0) {
-                // Tare and continue (visible feedback - tare blocks ~1.6 s)
+                // Tare, then continue to step 2 once it completes (~1.6 s,
+                // collected across ticks - the web stays responsive)
                 ctx.lcd.setCursor(3, 0);
                 ctx.lcd.print("   Zeroing...       ");
-                ctx.scales[ctx.selected_scale]->tare();
-                ctx.lcd.setCursor(3, 0);
-                ctx.lcd.print("   Zeroed!          ");
-                ctx.bz.playMarioCoin();  // Bling!
-                sleep_ms(700);
-                was_pressed_ = pressed;
-                return ScreenId::Calibrate2;
+                taring_ = ctx.scales[ctx.selected_scale]->begin_tare();
             } else {
                 was_pressed_ = pressed;
                 return ScreenId::Menu;
             }
         }
         was_pressed_ = pressed;
-
-        sleep_ms(50);
         return ScreenId::Calibrate1;
     }
 };
@@ -231,6 +268,7 @@ class Calibrate2Screen : public Screen {
     int  last_encoder_pos_ = 0;
     bool was_pressed_ = false;
     bool edit_mode_ = false;
+    bool calibrating_ = false;   // incremental calibration running
 public:
     void enter(UiContext& ctx) override {
         ctx.lcd.clear();
@@ -245,9 +283,38 @@ public:
         was_pressed_ = ctx.enc.isPressed();
         cursor_pos_ = 0;
         edit_mode_ = false;
+        calibrating_ = false;
     }
 
     ScreenId update(UiContext& ctx) override {
+        if (calibrating_) {
+            ScaleLink* s = ctx.scales[ctx.selected_scale];
+            HxOpStatus st = s->poll_op();
+            char line[21];
+            if (st == HxOpStatus::Busy) {
+                std::snprintf(line, sizeof(line), "Measuring... %3d%%   ", s->op_progress());
+                ctx.lcd.setCursor(3, 0);
+                ctx.lcd.print(line);
+                return ScreenId::Calibrate2;
+            }
+            calibrating_ = false;
+            was_pressed_ = ctx.enc.isPressed();
+            last_encoder_pos_ = ctx.enc.getPosition();
+            if (st == HxOpStatus::Done) {
+                // The tare done in step 1 IS the calibrated zero (core 1
+                // already applied it). The snapshot that reported Done
+                // carries the new values; save them (entry index = scale).
+                ctx.sc.entries[ctx.selected_scale].offset_counts = s->get_offset();
+                ctx.sc.entries[ctx.selected_scale].count_per_g = s->get_scale();
+                save_scale_config(ctx.sc);
+                return ScreenId::Menu;
+            }
+            ctx.lcd.setCursor(3, 0);
+            ctx.lcd.print("Failed - check load ");
+            ctx.hold_ms = 700;
+            return ScreenId::Calibrate2;
+        }
+
         bool pressed = ctx.enc.isPressed();
         int pos = ctx.enc.getPosition();
         int delta = pos - last_encoder_pos_;
@@ -273,25 +340,19 @@ public:
             if (pressed && !was_pressed_) {
                 if (cursor_pos_ < 4) {
                     edit_mode_ = true;
+                } else if (cursor_pos_ == 4 && scaleRunning(ctx, ctx.selected_scale)) {
+                    ctx.lcd.setCursor(3, 0);
+                    ctx.lcd.print("Scale is dispensing ");
+                    ctx.hold_ms = 700;
                 } else if (cursor_pos_ == 4) {
                     // OK pressed - calibrate selected scale
                     int known_grams = digits_[0] * 1000 + digits_[1] * 100 +
                                       digits_[2] * 10 + digits_[3];
                     if (known_grams < 1) known_grams = 1;
 
-                    ctx.scales[ctx.selected_scale]->calibrate_scale((float)known_grams, 10);
-                    // The tare done in step 1 IS the calibrated zero
-                    ctx.scales[ctx.selected_scale]->set_cal_offset(
-                        ctx.scales[ctx.selected_scale]->get_offset());
-
-                    // Save to flash (entry index matches scale index)
-                    ctx.sc.entries[ctx.selected_scale].offset_counts =
-                        ctx.scales[ctx.selected_scale]->get_offset();
-                    ctx.sc.entries[ctx.selected_scale].count_per_g =
-                        ctx.scales[ctx.selected_scale]->get_scale();
-                    save_scale_config(ctx.sc);
-
-                    next = ScreenId::Menu;
+                    // Averages across ticks; saved once it completes (above)
+                    calibrating_ = ctx.scales[ctx.selected_scale]->begin_calibrate(
+                        (float)known_grams, 10);
                 } else {
                     // Back pressed - return to menu without saving
                     next = ScreenId::Menu;
@@ -329,8 +390,6 @@ public:
         }
         ctx.lcd.setCursor(3, 0);
         ctx.lcd.print(line2);
-
-        sleep_ms(50);
         return next;
     }
 };
@@ -380,8 +439,6 @@ public:
             return ScreenId::Weigh;
         }
         was_pressed_ = pressed;
-
-        sleep_ms(50);
         return ScreenId::SetTarget;
     }
 };
@@ -485,8 +542,6 @@ public:
         ctx.sevenSeg->clear();
         ctx.sevenSeg->printNumber(preview, 0, 255, 0);  // green
         ctx.sevenSeg->show();
-
-        sleep_ms(50);
         return next;
     }
 };
@@ -498,6 +553,8 @@ class WeighScreen : public Screen {
     int  last_option_ = -1;
     int  last_encoder_pos_ = 0;
     bool was_pressed_ = false;
+    bool taring_ = false;
+    bool busy_ = false;      // the scale is dispensing: Tare greyed out
 public:
     void enter(UiContext& ctx) override {
         ctx.lcd.clear();
@@ -515,9 +572,36 @@ public:
         was_pressed_ = ctx.enc.isPressed();  // ignore carry-over press
         option_ = 0;
         last_option_ = -1;
+        taring_ = false;
+        busy_ = false;
     }
 
+    uint32_t periodMs() const override { return 20; }
+
     ScreenId update(UiContext& ctx) override {
+        if (taring_) {
+            ScaleLink* s = ctx.scales[ctx.selected_scale];
+            HxOpStatus st = s->poll_op();
+            char line[21];
+            if (st == HxOpStatus::Busy) {
+                std::snprintf(line, sizeof(line), "Zeroing... %3d%%     ", s->op_progress());
+                ctx.lcd.setCursor(1, 0);
+                ctx.lcd.print(line);
+                return ScreenId::Weigh;
+            }
+            taring_ = false;
+            was_pressed_ = ctx.enc.isPressed();
+            ctx.lcd.setCursor(1, 0);
+            if (st == HxOpStatus::Done) {
+                ctx.lcd.print("Zeroed!             ");
+                ctx.bz.playMarioCoin();  // Bling!
+            } else {
+                ctx.lcd.print("No sensor data!     ");
+            }
+            ctx.hold_ms = 700;  // message readable; weight repaints next tick
+            return ScreenId::Weigh;
+        }
+
         // Read weight from selected scale
         float grams = ctx.scales[ctx.selected_scale]->read_weight();
         int display_grams = (int)(grams + 0.5f);  // round to nearest gram
@@ -541,19 +625,24 @@ public:
         ctx.lcd.setCursor(2, 0);
         ctx.lcd.print(line);
 
+        bool busy = scaleRunning(ctx, ctx.selected_scale);
+        if (busy != busy_) {
+            busy_ = busy;
+            last_option_ = -1;
+        }
         int pos = ctx.enc.getPosition();
         int delta = pos - last_encoder_pos_;
         if (delta != 0) {
             option_ += delta;
-            if (option_ < 0) option_ = 0;
-            if (option_ > 2) option_ = 2;
             last_encoder_pos_ = pos;
         }
+        if (option_ < (busy_ ? 1 : 0)) option_ = busy_ ? 1 : 0;
+        if (option_ > 2) option_ = 2;
 
         if (option_ != last_option_) {
             char opt_line[21];
             std::snprintf(opt_line, sizeof(opt_line), "%s%s%s%s%s%s%s%s%s",
-                option_ == 0 ? "[" : " ", "Tare", option_ == 0 ? "]" : " ",
+                option_ == 0 ? "[" : " ", busy_ ? "----" : "Tare", option_ == 0 ? "]" : " ",
                 option_ == 1 ? "[" : " ", "Target", option_ == 1 ? "]" : " ",
                 option_ == 2 ? "[" : " ", "Back", option_ == 2 ? "]" : " ");
             ctx.lcd.setCursor(3, 0);
@@ -565,15 +654,11 @@ public:
         ScreenId next = ScreenId::Weigh;
         if (pressed && !was_pressed_) {
             if (option_ == 0) {
-                // Tare - zero the scale, with visible before/after feedback
-                // (tare blocks ~1.6 s; without a message the screen just freezes)
+                // Tare - zero the scale across the next ~1.6 s of ticks,
+                // with progress and a before/after message
                 ctx.lcd.setCursor(1, 0);
                 ctx.lcd.print("Zeroing...          ");
-                ctx.scales[ctx.selected_scale]->tare();
-                ctx.lcd.setCursor(1, 0);
-                ctx.lcd.print("Zeroed!             ");
-                ctx.bz.playMarioCoin();  // Bling!
-                sleep_ms(700);  // message readable; weight repaints next tick
+                taring_ = ctx.scales[ctx.selected_scale]->begin_tare();
             } else if (option_ == 1) {
                 // Target - go to digit entry, come back here
                 ctx.after_target = ScreenId::Weigh;
@@ -584,67 +669,74 @@ public:
         }
         was_pressed_ = pressed;
 
-        sleep_ms(20);  // faster update for weighing
         return next;
     }
 };
 
 // -------------------------------------------------------------- Dispense ----
 
+// Order queue progress on the 7-segment: finished runs on the left three
+// digits, the count on the right three ("  3.  10")
+static void showQueueProgress(SevenSeg* seg, int done, int count) {
+    seg->clear();
+    seg->printNumber(count, 255, 128, 0);
+    for (int d = 2; d >= 0; d--) {
+        seg->setDigit((uint8_t)d, done % 10, 255, 128, 0);
+        done /= 10;
+        if (done == 0) break;
+    }
+    seg->setDot(2, true, 255, 128, 0);
+    seg->show();
+}
+
 class DispenseScreen : public Screen {
-    enum class DispenseState { Idle, Running, Done };
+    enum class DispenseState { Idle, Running, Done, Queue };
 
-    // Servo working range comes from the per-servo zero calibration
-    // (servo_min_open / servo_close in dispenser_state.h)
+    // The run itself - PID, servo slew, vibrator assist, done detection,
+    // start-of-run tare - lives on core 1 (app/control.cpp), and main.cpp
+    // starts and closes it (ctx.start_run). This screen shows one scale's
+    // run; Back while it runs leaves it going, so another scale can be
+    // started alongside from the menu.
 
     DispenseState state_ = DispenseState::Idle;
-    int  option_ = 1;        // 0=Target, 1=Start, 2=Back (Idle) / 0=Back, 1=Retry (Done)
+    int  scale_ = 0;         // the scale shown (selected on entry)
+    int  option_ = 1;        // 0=Target, 1=Start, 2=Back (Idle) / 0=Stop, 1=Back (Running)
+                             // / 0=Back, 1=Retry (Done) / 0=Stop, 1=Next, 2=Back (Queue)
     int  last_option_ = -1;
     int  last_encoder_pos_ = 0;
     bool was_pressed_ = false;
 
-    // PID variables - the PID object holds pointers to these, so this screen
-    // must live in static storage (it does: singleton below)
-    double pid_input_ = 0.0;
-    double pid_output_ = 0.0;
-    double pid_setpoint_ = 0.0;
-
-    // NOTE: Weight DECREASES as corn is dispensed from the hanging bag
-    float start_weight_ = 0.0f;      // Weight when dispense started
-    float final_dispensed_ = 0.0f;   // Final amount dispensed (for Done display)
-    uint32_t dispense_start_ms_ = 0; // For telemetry timestamps
-
-    // Done-confirmation: the tail readings wobble +-1.5 g (vibrator shakes the
-    // scale), so a single sample >= target is usually an upward noise spike -
-    // closing on it left the SETTLED weight 2-3 g under target. The reading
-    // must hold at/above target for this many consecutive fresh samples.
-    static constexpr int DONE_CONFIRM_SAMPLES = 3;
-    int done_streak_ = 0;
-
-    // Servo slew limit: a full 9 kg bag swings like a pendulum when the gate
-    // slams (CSV: readings bouncing +-35 g while the servo jumped 108<->180
-    // between samples, each exciting the other). The gate now glides at most
-    // this many degrees per 100 ms sample (~100 deg/s).
-    static constexpr float SERVO_SLEW_DEG_PER_SAMPLE = 10.0f;
-    float servo_cmd_ = 0.0f;   // last commanded (slew-limited) angle
-
-    // Last values painted on the LCD. Repainting only on change matters: even
-    // with fast I2C a 16-char line costs ~9 ms, and unconditional repaints
-    // every loop tick were the main reason the PID ran at ~200 ms instead of
-    // its 100 ms sample time.
-    int lcd_target_ = -1;
-    int lcd_value_  = -1;
-    void resetLcdCache() { lcd_target_ = -1; lcd_value_ = -1; }
+    bool stop_sent_ = false;
+
+    void enterRunning() {
+        state_ = DispenseState::Running;
+        option_ = 0;
+        last_option_ = -1;
+        stop_sent_ = false;
+    }
+
+    // An order queue (app/order_queue.hpp) runs on this scale: between its
+    // runs the screen waits for the container swap instead of sitting in Done
+    bool queueHere(const UiContext& ctx) const {
+        const QueueStatus& q = ctx.g_state.queue;
+        return q.state == BatchState::Running && q.scale == scale_;
+    }
+
+    void enterQueue() {
+        state_ = DispenseState::Queue;
+        option_ = 1;   // Next
+        last_option_ = -1;
+    }
 
 public:
     void enter(UiContext& ctx) override {
+        scale_ = ctx.selected_scale;
         ctx.lcd.clear();
         char title[21];
-        if (ctx.names && ctx.names[ctx.selected_scale][0]) {
-            std::snprintf(title, sizeof(title), "Disp %d: %.12s",
-                          ctx.selected_scale + 1, ctx.names[ctx.selected_scale]);
+        if (ctx.names && ctx.names[scale_][0]) {
+            std::snprintf(title, sizeof(title), "Disp %d: %.12s", scale_ + 1, ctx.names[scale_]);
         } else {
-            std::snprintf(title, sizeof(title), "Dispense - Scale %d", ctx.selected_scale + 1);
+            std::snprintf(title, sizeof(title), "Dispense - Scale %d", scale_ + 1);
         }
         ctx.lcd.setCursor(0, 0);
         ctx.lcd.print(title);
@@ -654,28 +746,16 @@ public:
         state_ = DispenseState::Idle;
         option_ = 1;  // Default to Start
         last_option_ = -1;
-        resetLcdCache();
-
-        // Create PID if needed (output limits are set per dispense start -
-        // they depend on which scale's servo runs)
-        if (ctx.dispense_pid == nullptr) {
-            ctx.dispense_pid = new PID(&pid_input_, &pid_output_, &pid_setpoint_,
-                                       ctx.Kp, ctx.Ki, ctx.Kd, DIRECT);
-            // 100 ms matches the HX711's ~10 SPS so every PID compute sees a
-            // genuinely new sample
-            ctx.dispense_pid->SetSampleTime(100);
-        }
+        if (ctx.g_state.run_active[scale_]) enterRunning();   // came back to a running scale
+        else if (queueHere(ctx)) enterQueue();
     }
 
+    uint32_t periodMs() const override { return 20; }
+
     ScreenId update(UiContext& ctx) override {
-        // Freshest-available non-blocking read (a multi-sample read would block
-        // and throttle the PID loop)
-        float current_grams = ctx.scales[ctx.selected_scale]->read_weight();
-        float current_gross = ctx.scales[ctx.selected_scale]->last_gross();
-        // Weight decrease = positive dispensed
-        float dispensed_grams = start_weight_ - current_grams;
-        int display_dispensed = (int)(dispensed_grams + 0.5f);
-        if (display_dispensed < 0) display_dispensed = 0;
+        const ControlStatus& cs = control_poll();
+        float current_grams = ctx.scales[scale_]->read_weight();
+        bool active = ctx.g_state.run_active[scale_];   // started here or from the web
 
         int pos = ctx.enc.getPosition();
         int delta = pos - last_encoder_pos_;
@@ -685,6 +765,15 @@ public:
         switch (state_) {
         case DispenseState::Idle:
         {
+            if (active) {
+                enterRunning();
+                break;
+            }
+            if (queueHere(ctx)) {
+                enterQueue();
+                break;
+            }
+
             // Options: [Target] [Start] [Back]
             if (delta != 0) {
                 option_ += delta;
@@ -706,234 +795,143 @@ public:
             }
 
             char line[21];
-            if (ctx.target_grams != lcd_target_) {
-                std::snprintf(line, sizeof(line), "Target: %d g    ", ctx.target_grams);
-                ctx.lcd.setCursor(1, 0);
-                ctx.lcd.print(line);
-                lcd_target_ = ctx.target_grams;
-            }
-            int display_current = (int)(current_grams + 0.5f);
-            if (display_current != lcd_value_) {
+            std::snprintf(line, sizeof(line), "Target: %d g    ", ctx.target_grams);
+            ctx.lcd.setCursor(1, 0);
+            ctx.lcd.print(line);
+            // The bag level instead of the reading when it runs low: a run
+            // it can't finish doesn't start (main.cpp)
+            const BagStatus& bag = ctx.g_state.bag[scale_];
+            if (!bag_covers(ctx.g_state, scale_, (float)ctx.target_grams)) {
+                std::snprintf(line, sizeof(line), "Refill bag: %d g   ", (int)(bag.avail_g + 0.5f));
+            } else if (bag.runs_left >= 0 && bag.runs_left <= BAG_LOW_RUNS) {
+                std::snprintf(line, sizeof(line), "Bag low: %d left   ", bag.runs_left);
+            } else {
+                int display_current = (int)(current_grams + 0.5f);
                 std::snprintf(line, sizeof(line), "Current: %d g   ", display_current);
-                ctx.lcd.setCursor(2, 0);
-                ctx.lcd.print(line);
-                lcd_value_ = display_current;
             }
+            ctx.lcd.setCursor(2, 0);
+            ctx.lcd.print(line);
 
             // 7-segment shows target
             ctx.sevenSeg->clear();
             ctx.sevenSeg->printNumber(ctx.target_grams, 0, 255, 0);
             ctx.sevenSeg->show();
 
-            // Handle button or web-initiated start
-            bool do_start = ctx.web_start_dispense;
-            ctx.web_start_dispense = false;
-
             if (pressed && !was_pressed_) {
                 if (option_ == 0) {
                     // Set target - go to digit entry, come back here
                     ctx.after_target = ScreenId::Dispense;
                     next = ScreenId::SetTargetDigit;
                 } else if (option_ == 1) {
-                    do_start = true;
+                    // Picked up as run_active on the next update; not
+                    // started while the scale's last run is still closing
+                    WebCmd c;
+                    c.cmd = WebCommand::StartDispense;
+                    c.i0 = scale_;
+                    c.f0 = (float)ctx.target_grams;
+                    if (ctx.start_run(c)) enterRunning();
                 } else {
                     next = ScreenId::Menu;
                 }
             }
-            if (do_start) {
-                ctx.web_stop_dispense = false;  // Clear any stale stop request
-                // Start dispensing - first tare the scale
-                ctx.lcd.setCursor(2, 0);
-                ctx.lcd.print("Taring...           ");
-                ctx.scales[ctx.selected_scale]->tare();
-                ctx.bz.playMarioCoin();
-                sleep_ms(300);
-
-                start_weight_ = ctx.scales[ctx.selected_scale]->read_weight(3);
-                pid_setpoint_ = (double)ctx.target_grams;
-                pid_input_ = 0.0;
-                // Working range of THIS scale's servo: calibrated zero up to
-                // zero + 80 deg (mechanical end stop ~75 deg past zero), or the
-                // 85-170 default. Set here, not in enter(): the web side can
-                // switch scales while this screen idles.
-                ctx.dispense_pid->SetOutputLimits(
-                    servo_min_open(ctx.g_state, ctx.selected_scale),
-                    servo_max_open(ctx.g_state, ctx.selected_scale));
-                // Seed the output at the floor before enabling: SetMode's
-                // bumpless transfer latches the CURRENT output into the
-                // integrator, and with a tiny Ki a stale value from the last
-                // run never bleeds off - the gate then rides ~50 deg above
-                // the floor for the whole run (CSV runs 2-4: i_term 150-175).
-                // Seeded at the floor, the end-phase tapers to just above the
-                // flow-start point: angle = zero + Kp * grams_remaining.
-                pid_output_ = (double)servo_min_open(ctx.g_state, ctx.selected_scale);
-                ctx.dispense_pid->SetMode(AUTOMATIC);
-
-                // Start telemetry capture (under lwIP lock so a CSV download
-                // in flight can't observe the buffer reset mid-row)
-                dispense_start_ms_ = to_ms_since_boot(get_absolute_time());
-                ctx.net_lock();
-                telem_begin_run((uint8_t)ctx.selected_scale, (uint16_t)ctx.target_grams,
-                                (float)ctx.Kp, (float)ctx.Ki, (float)ctx.Kd,
-                                ctx.names ? ctx.names[ctx.selected_scale] : "");
-                ctx.net_unlock();
-
-                state_ = DispenseState::Running;
-                option_ = 0;
-                last_option_ = -1;
-                done_streak_ = 0;
-                servo_cmd_ = servo_min_open(ctx.g_state, ctx.selected_scale);
-                resetLcdCache();
-                ctx.net_lock();
-                ctx.g_state.dispensing = true;
-                ctx.g_state.dispense_done = false;
-                ctx.g_state.dispensed_grams = 0;
-                ctx.net_unlock();
-                ctx.lcd.setCursor(3, 0);
-                ctx.lcd.print("   [Stop]           ");
-            }
             break;
         }
 
         case DispenseState::Running:
         {
-            // PID control - input is dispensed amount, setpoint is target
-            // PID output is servo angle directly (like Arduino)
-            pid_input_ = (double)dispensed_grams;
-            bool pid_computed = ctx.dispense_pid->Compute();
-
-            // Slew-limit the commanded angle: glide, don't slam
-            if (pid_computed) {
-                float want = (float)pid_output_;
-                float step = want - servo_cmd_;
-                if (step >  SERVO_SLEW_DEG_PER_SAMPLE) step =  SERVO_SLEW_DEG_PER_SAMPLE;
-                if (step < -SERVO_SLEW_DEG_PER_SAMPLE) step = -SERVO_SLEW_DEG_PER_SAMPLE;
-                servo_cmd_ += step;
-            }
-            float servo_angle = servo_cmd_;
-
-            // Vibrator: assist the tail of the run; starts early because
-            // the motor takes a moment to spin up
-            constexpr float VIB_ASSIST_REMAINING_G = 80.0f;
-            float remaining = (float)ctx.target_grams - dispensed_grams;
-            if (remaining <= VIB_ASSIST_REMAINING_G) {
-                ctx.vibrators[ctx.selected_scale]->setIntensity(0.6f);
-            } else {
-                ctx.vibrators[ctx.selected_scale]->off();
-            }
-
-            ctx.servos[ctx.selected_scale]->writeDegrees(servo_angle);
-
-            // Log a telemetry sample per actual PID computation (10 Hz)
-            if (pid_computed) {
-                TelemetrySample ts;
-                ts.t_ms      = to_ms_since_boot(get_absolute_time()) - dispense_start_ms_;
-                ts.setpoint  = (float)pid_setpoint_;
-                ts.dispensed = dispensed_grams;
-                ts.weight    = current_grams;
-                ts.gross     = current_gross;
-                ts.servo     = servo_angle;
-                ts.p         = (float)ctx.dispense_pid->GetLastP();
-                ts.i         = (float)ctx.dispense_pid->GetLastI();
-                ts.d         = (float)ctx.dispense_pid->GetLastD();
-                ts.vib       = (remaining <= VIB_ASSIST_REMAINING_G) ? 0.6f : 0.0f;
-                telem_append(ts);
-            }
-
-            // Sync web state
-            ctx.net_lock();
-            ctx.g_state.dispensed_grams = dispensed_grams;
-            ctx.g_state.servo_angle = servo_angle;
-            ctx.g_state.vib_intensity = (remaining <= VIB_ASSIST_REMAINING_G) ? 0.6f : 0.0f;
-            ctx.net_unlock();
-
-            // Repaint only changed lines - LCD writes stall the control loop
-            char line[21];
-            if (ctx.target_grams != lcd_target_) {
-                std::snprintf(line, sizeof(line), "Target: %d g    ", ctx.target_grams);
-                ctx.lcd.setCursor(1, 0);
-                ctx.lcd.print(line);
-                lcd_target_ = ctx.target_grams;
+            // Options: [Stop] [Back] - Back leaves the run going
+            if (delta != 0) {
+                option_ += delta;
+                if (option_ < 0) option_ = 0;
+                if (option_ > 1) option_ = 1;
+                last_encoder_pos_ = pos;
             }
-            if (display_dispensed != lcd_value_) {
-                std::snprintf(line, sizeof(line), "Dispensing: %d g", display_dispensed);
-                ctx.lcd.setCursor(2, 0);
-                ctx.lcd.print(line);
-                lcd_value_ = display_dispensed;
+            if (option_ != last_option_) {
+                char opt_line[21];
+                std::snprintf(opt_line, sizeof(opt_line), "  %s%s%s   %s%s%s   ",
+                    option_ == 0 ? "[" : " ", "Stop", option_ == 0 ? "]" : " ",
+                    option_ == 1 ? "[" : " ", "Back", option_ == 1 ? "]" : " ");
+                ctx.lcd.setCursor(3, 0);
+                ctx.lcd.print(opt_line);
+                last_option_ = option_;
             }
 
+            // main.cpp keeps this at 0 until core 1 picked the run up
+            float dispensed_grams = ctx.g_state.run_grams[scale_];
+            int target = ctx.g_state.run_target[scale_];
+            int display_dispensed = (int)(dispensed_grams + 0.5f);
+            if (display_dispensed < 0) display_dispensed = 0;
+
+            char line[21];
+            if (queueHere(ctx)) {
+                const QueueStatus& q = ctx.g_state.queue;
+                std::snprintf(line, sizeof(line), "Queue %u/%u: %d g   ",
+                              (unsigned)q.done + 1, (unsigned)q.count, target);
+            } else {
+                std::snprintf(line, sizeof(line), "Target: %d g    ", target);
+            }
+            ctx.lcd.setCursor(1, 0);
+            ctx.lcd.print(line);
+            std::snprintf(line, sizeof(line), "Dispensing: %d g", display_dispensed);
+            ctx.lcd.setCursor(2, 0);
+            ctx.lcd.print(line);
+
             // 7-segment shows dispensed amount with two decimals, colored
             ctx.sevenSeg->clear();
             float seg_g = dispensed_grams < 0 ? 0.0f : dispensed_grams;
-            if (dispensed_grams < ctx.target_grams - 5) {
+            if (dispensed_grams < target - 5) {
                 ctx.sevenSeg->printFixed2(seg_g, 0, 0, 255);  // blue - dispensing
-            } else if (dispensed_grams > ctx.target_grams + 5) {
+            } else if (dispensed_grams > target + 5) {
                 ctx.sevenSeg->printFixed2(seg_g, 255, 0, 0);  // red - overshoot!
             } else {
                 ctx.sevenSeg->printFixed2(seg_g, 0, 255, 0);  // green - on target
             }
             ctx.sevenSeg->show();
 
-            // Check if done: target must hold for DONE_CONFIRM_SAMPLES
-            // consecutive fresh samples (counted on pid_computed - the loop
-            // spins many times per 100 ms sample, and counting iterations
-            // would confirm on the same noisy reading). While confirming the
-            // PID rides the floor, so the gate trickles ~0.1-0.5 g more,
-            // biasing the settled result to target instead of 2-3 g under.
-            if (pid_computed) {
-                if (dispensed_grams >= (float)ctx.target_grams) {
-                    done_streak_++;
-                } else {
-                    done_streak_ = 0;
+            // Manual stop; core 1 closes the gate and releases the servo
+            // 300 ms later
+            if (pressed && !was_pressed_) {
+                if (option_ == 1) {
+                    next = ScreenId::Menu;
+                } else if (!stop_sent_) {
+                    WebCmd c;
+                    c.cmd = WebCommand::StopDispense;
+                    c.i0 = scale_;
+                    stop_sent_ = control_send(c);
                 }
             }
-            if (done_streak_ >= DONE_CONFIRM_SAMPLES) {
-                final_dispensed_ = dispensed_grams;
-                float close_deg = servo_close(ctx.g_state, ctx.selected_scale);
-                ctx.servos[ctx.selected_scale]->writeDegrees(close_deg);
-                ctx.vibrators[ctx.selected_scale]->off();
-                ctx.dispense_pid->SetMode(MANUAL);
-                telem_end_run(final_dispensed_);
-                state_ = DispenseState::Done;
-                option_ = 0;
-                last_option_ = -1;
-                resetLcdCache();
-                ctx.net_lock();
-                ctx.g_state.dispensing = false;
-                ctx.g_state.dispense_done = true;
-                ctx.g_state.dispensed_grams = final_dispensed_;
-                ctx.g_state.servo_angle = close_deg;
-                ctx.g_state.vib_intensity = 0.0f;
-                ctx.net_unlock();
-                ctx.bz.playCloseEncounters();  // Complete! (also gives servo time to close)
-                ctx.servos[ctx.selected_scale]->off();  // Release servo (no holding torque)
-            }
-
-            // Manual stop (encoder press or web STOP)
-            if ((pressed && !was_pressed_) || ctx.web_stop_dispense) {
-                ctx.web_stop_dispense = false;
-                float close_deg = servo_close(ctx.g_state, ctx.selected_scale);
-                ctx.servos[ctx.selected_scale]->writeDegrees(close_deg);
-                ctx.vibrators[ctx.selected_scale]->off();
-                ctx.dispense_pid->SetMode(MANUAL);
-                telem_end_run(dispensed_grams);
-                ctx.net_lock();
-                ctx.g_state.servo_angle = close_deg;
-                ctx.g_state.vib_intensity = 0.0f;
-                ctx.g_state.dispensing = false;
-                ctx.net_unlock();
-                sleep_ms(300);  // Give servo time to close
-                ctx.servos[ctx.selected_scale]->off();  // Release servo
-                state_ = DispenseState::Idle;
-                option_ = 1;
+
+            // Run over (target confirmed or stopped; main.cpp chimed). A
+            // queue run: straight on to the next container.
+            if (!active && queueHere(ctx)) {
+                enterQueue();
+            } else if (!active) {
+                bool done = ctx.g_state.run_done[scale_];
+                option_ = done ? 0 : 1;
                 last_option_ = -1;
-                resetLcdCache();
+                state_ = done ? DispenseState::Done : DispenseState::Idle;
+                if (cs.run[scale_].no_flow) {
+                    // Core 1 gave up: gate wide open, nothing came
+                    ctx.lcd.setCursor(2, 0);
+                    ctx.lcd.print("Bag empty - refill! ");
+                    ctx.hold_ms = 1500;
+                }
             }
             break;
         }
 
         case DispenseState::Done:
         {
+            if (active) {
+                // A web START while sitting on the Done screen
+                enterRunning();
+                break;
+            }
+            if (queueHere(ctx)) {
+                enterQueue();
+                break;
+            }
+
             // Options: [Back] [Retry]
             if (delta != 0) {
                 option_ += delta;
@@ -952,60 +950,123 @@ public:
                 last_option_ = option_;
             }
 
-            // Keep reading scale to show LIVE weight (may have overshot after closing)
-            float live_dispensed = start_weight_ - ctx.scales[ctx.selected_scale]->read_weight();
+            // Core 1 keeps tracking the run's scale: LIVE amount (may have
+            // overshot after closing)
+            float live_dispensed = cs.run[scale_].dispensed;
+            int target = ctx.g_state.run_target[scale_];
             int display_live = (int)(live_dispensed + 0.5f);
             if (display_live < 0) display_live = 0;
 
             char line[21];
-            if (ctx.target_grams != lcd_target_) {
-                std::snprintf(line, sizeof(line), "Target: %d g    ", ctx.target_grams);
-                ctx.lcd.setCursor(1, 0);
-                ctx.lcd.print(line);
-                lcd_target_ = ctx.target_grams;
-            }
-            if (display_live != lcd_value_) {
-                std::snprintf(line, sizeof(line), "Dispensed: %d g ", display_live);
-                ctx.lcd.setCursor(2, 0);
-                ctx.lcd.print(line);
-                lcd_value_ = display_live;
-            }
+            std::snprintf(line, sizeof(line), "Target: %d g    ", target);
+            ctx.lcd.setCursor(1, 0);
+            ctx.lcd.print(line);
+            std::snprintf(line, sizeof(line), "Dispensed: %d g ", display_live);
+            ctx.lcd.setCursor(2, 0);
+            ctx.lcd.print(line);
 
-            // Color on 7-segment based on accuracy, two decimals
+            // Color on 7-segment based on accuracy, two decimals. While the
+            // in-flight grams are still landing, judged on core 1's
+            // prediction of where it will settle.
+            const RunStatus& rs = cs.run[scale_];
+            float expect = live_dispensed;
+            if (rs.settling && rs.final_dispensed + rs.in_flight > expect) {
+                expect = rs.final_dispensed + rs.in_flight;
+            }
             ctx.sevenSeg->clear();
             float seg_live = live_dispensed < 0 ? 0.0f : live_dispensed;
-            if (live_dispensed > ctx.target_grams + 5) {
+            if (expect > target + 5) {
                 ctx.sevenSeg->printFixed2(seg_live, 255, 0, 0);  // red - overshoot
             } else {
                 ctx.sevenSeg->printFixed2(seg_live, 0, 255, 0);  // green - good
             }
             ctx.sevenSeg->show();
 
-            // A web START while sitting on the Done screen: drop back to Idle,
-            // which consumes web_start_dispense on the next iteration.
-            if (ctx.web_start_dispense) {
+            if (pressed && !was_pressed_) {
+                if (option_ == 0) {
+                    next = ScreenId::Menu;
+                } else {
+                    // Retry - the same target again, right away: core 1
+                    // zeroes in the background as the run starts
+                    WebCmd c;
+                    c.cmd = WebCommand::StartDispense;
+                    c.i0 = scale_;
+                    c.f0 = (float)target;
+                    if (ctx.start_run(c)) enterRunning();
+                }
+            }
+            break;
+        }
+
+        case DispenseState::Queue:
+        {
+            // Between two queue runs: main.cpp starts the next one once the
+            // container swap showed on the weight stream (or Next was pressed)
+            if (active) {
+                enterRunning();
+                break;
+            }
+            const QueueStatus& q = ctx.g_state.queue;
+            if (!queueHere(ctx)) {
+                // Finished, stopped or failed
                 state_ = DispenseState::Idle;
                 option_ = 1;
                 last_option_ = -1;
-                resetLcdCache();
+                ctx.lcd.setCursor(2, 0);
+                if (q.state == BatchState::Done) {
+                    ctx.lcd.print("Queue done!         ");
+                } else {
+                    char msg[21];
+                    std::snprintf(msg, sizeof(msg), "%-20s", q.error);
+                    ctx.lcd.print(msg);
+                }
+                ctx.hold_ms = 1500;
+                break;
             }
 
+            // Options: [Stop] [Next] [Back] - Back leaves the queue going
+            if (delta != 0) {
+                option_ += delta;
+                if (option_ < 0) option_ = 0;
+                if (option_ > 2) option_ = 2;
+                last_encoder_pos_ = pos;
+            }
+            if (option_ != last_option_) {
+                char opt_line[21];
+                std::snprintf(opt_line, sizeof(opt_line), "%s%s%s%s%s%s%s%s%s",
+                    option_ == 0 ? "[" : " ", "Stop", option_ == 0 ? "]" : " ",
+                    option_ == 1 ? "[" : " ", "Next", option_ == 1 ? "]" : " ",
+                    option_ == 2 ? "[" : " ", "Back", option_ == 2 ? "]" : " ");
+                ctx.lcd.setCursor(3, 0);
+                ctx.lcd.print(opt_line);
+                last_option_ = option_;
+            }
+
+            char line[21];
+            std::snprintf(line, sizeof(line), "Queue %u/%u: %d g   ",
+                          (unsigned)q.done, (unsigned)q.count, (int)(q.last + 0.5f));
+            ctx.lcd.setCursor(1, 0);
+            ctx.lcd.print(line);
+            const char* what =
+                q.phase == QueuePhase::Settle ? "Settling...         " :
+                q.phase == QueuePhase::Remove ? "Remove the bag      " :
+                q.phase == QueuePhase::Place  ? "Place the next bag  " :
+                                                "Starting...         ";
+            ctx.lcd.setCursor(2, 0);
+            ctx.lcd.print(what);
+
+            showQueueProgress(ctx.sevenSeg, q.done, q.count);
+
             if (pressed && !was_pressed_) {
+                WebCmd c;
                 if (option_ == 0) {
-                    next = ScreenId::Menu;
+                    c.cmd = WebCommand::QueueStop;
+                    ctx.queue_cmd(c);
+                } else if (option_ == 1) {
+                    c.cmd = WebCommand::QueueNext;
+                    ctx.queue_cmd(c);
                 } else {
-                    // Retry - tare and restart (visible feedback while blocked)
-                    ctx.lcd.setCursor(2, 0);
-                    ctx.lcd.print("Zeroing...          ");
-                    ctx.scales[ctx.selected_scale]->tare();
-                    ctx.lcd.setCursor(2, 0);
-                    ctx.lcd.print("Zeroed!             ");
-                    ctx.bz.playMarioCoin();  // Bling!
-                    sleep_ms(700);
-                    state_ = DispenseState::Idle;
-                    option_ = 1;
-                    last_option_ = -1;
-                    resetLcdCache();
+                    next = ScreenId::Menu;
                 }
             }
             break;
@@ -1013,7 +1074,218 @@ public:
         }
 
         was_pressed_ = pressed;
-        sleep_ms(20);
+        return next;
+    }
+};
+
+// -------------------------------------------------------------- Autotune ----
+// Step test on the selected scale (app/autotune.hpp): core 1 runs it as an
+// open-loop run with telemetry; when it ends, the logged samples are read
+// back from the telemetry ring, the flow model fitted and PID gains proposed.
+// The proposal lands in g_state.tune[] (GET /api/autotune) and can be
+// applied live or applied and saved from here or from the web.
+
+class AutotuneScreen : public Screen {
+    enum class Phase { Idle, Running, Result };
+
+    Phase    phase_ = Phase::Idle;
+    int      option_ = 0;          // Idle: 0=Start 1=Back; Result: 0=Apply 1=Save 2=Back
+    int      last_option_ = -1;
+    int      last_encoder_pos_ = 0;
+    bool     was_pressed_ = false;
+    int      scale_ = 0;           // the scale under test (selected on entry)
+    uint32_t run_id_ = 0;
+    bool     stop_sent_ = false;
+    StepTuner tuner_;              // ~6 KB: static screen object, not the stack
+
+    void drawOptions(UiContext& ctx) {
+        char line[21];
+        if (phase_ == Phase::Idle) {
+            std::snprintf(line, sizeof(line), "  %sStart%s   %sBack%s     ",
+                option_ == 0 ? "[" : " ", option_ == 0 ? "]" : " ",
+                option_ == 1 ? "[" : " ", option_ == 1 ? "]" : " ");
+        } else {
+            std::snprintf(line, sizeof(line), "%sApply%s %sSave%s %sBack%s  ",
+                option_ == 0 ? "[" : " ", option_ == 0 ? "]" : " ",
+                option_ == 1 ? "[" : " ", option_ == 1 ? "]" : " ",
+                option_ == 2 ? "[" : " ", option_ == 2 ? "]" : " ");
+        }
+        ctx.lcd.setCursor(3, 0);
+        ctx.lcd.print(line);
+        last_option_ = option_;
+    }
+
+    void drawIdle(UiContext& ctx) {
+        char line[21];
+        std::snprintf(line, sizeof(line), "Step %d deg, <=%d g  ",
+                      (int)(ctx.tune_open + 0.5f), (int)(ctx.tune_max_g + 0.5f));
+        ctx.lcd.setCursor(1, 0);
+        ctx.lcd.print(line);
+        const TuneResult& r = ctx.g_state.tune[scale_];
+        if (r.state == TuneState::Done) {
+            std::snprintf(line, sizeof(line), "Last P%.2f I%.3f    ", (double)r.kp, (double)r.ki);
+        } else {
+            std::snprintf(line, sizeof(line), "%-20s", "Not tuned yet");
+        }
+        ctx.lcd.setCursor(2, 0);
+        ctx.lcd.print(line);
+        drawOptions(ctx);
+    }
+
+    void drawResult(UiContext& ctx) {
+        const TuneResult& r = ctx.g_state.tune[scale_];
+        char line[21];
+        std::snprintf(line, sizeof(line), "k%.2f L%.2f T%.2f   ",
+                      (double)r.k, (double)r.dead_s, (double)r.tau_s);
+        ctx.lcd.setCursor(1, 0);
+        ctx.lcd.print(line);
+        std::snprintf(line, sizeof(line), "P%.2f I%.3f D%.2f  ",
+                      (double)r.kp, (double)r.ki, (double)r.kd);
+        ctx.lcd.setCursor(2, 0);
+        ctx.lcd.print(line);
+        drawOptions(ctx);
+    }
+
+    void start(UiContext& ctx) {
+        WebCmd c;
+        c.cmd = WebCommand::Autotune;
+        c.i0 = scale_;
+        c.f0 = ctx.tune_open;
+        c.f1 = ctx.tune_max_g;
+        c.f2 = ctx.tune_tc;
+        run_id_ = ctx.start_run(c);   // 0: the scale's last run is still closing
+        if (!run_id_) return;
+        stop_sent_ = false;
+        phase_ = Phase::Running;
+        ctx.net_lock();
+        ctx.g_state.tune[scale_].state = TuneState::Running;
+        ctx.net_unlock();
+        ctx.lcd.setCursor(2, 0);
+        ctx.lcd.print("                    ");
+        ctx.lcd.setCursor(3, 0);
+        ctx.lcd.print("   [Stop]           ");
+    }
+
+    // Run over (main.cpp closed its telemetry): fit what was logged (a few
+    // tens of ms, once)
+    void finish(UiContext& ctx) {
+        const int i = scale_;
+        const bool complete = control_poll().run[i].done;   // step response recorded in full
+
+        TuneResult r;
+        r.state = TuneState::Failed;
+        StepModel m;
+        tuner_.reset();
+        TelemCursor cur;
+        TelemetrySample ts;
+        if (complete && telem_open(run_id_, cur)) {
+            while (telem_next(cur, ts) == 1 && tuner_.add(ts)) {}
+        }
+        if (complete && tuner_.fit(m)) {
+            PidProposal p = StepTuner::propose(m, ctx.tune_tc);
+            r = { TuneState::Done, m.k, m.dead_s, m.tau_s, ctx.tune_tc, p.kp, p.ki, p.kd };
+            printf("[tune] scale %d: k=%.3f g/s/deg dead=%.2f s tau=%.2f s rms=%.2f g"
+                   " -> kp=%.3f ki=%.4f kd=%.3f\n", i + 1, (double)m.k, (double)m.dead_s,
+                   (double)m.tau_s, (double)m.rms_g, (double)p.kp, (double)p.ki, (double)p.kd);
+        }
+
+        ctx.net_lock();
+        ctx.g_state.tune[i] = r;
+        ctx.net_unlock();
+
+        option_ = 0;
+        if (r.state == TuneState::Done) {
+            phase_ = Phase::Result;
+            ctx.bz.playMarioCoin();
+            drawResult(ctx);
+        } else {
+            phase_ = Phase::Idle;
+            drawIdle(ctx);
+            ctx.lcd.setCursor(2, 0);
+            ctx.lcd.print(complete ? "Fit failed          " : "Stopped / capped    ");
+            ctx.hold_ms = 1500;
+        }
+    }
+
+public:
+    void enter(UiContext& ctx) override {
+        scale_ = ctx.selected_scale;
+        ctx.lcd.clear();
+        char title[21];
+        std::snprintf(title, sizeof(title), "Autotune - Scale %d", scale_ + 1);
+        ctx.lcd.setCursor(0, 0);
+        ctx.lcd.print(title);
+
+        last_encoder_pos_ = ctx.enc.getPosition();
+        was_pressed_ = ctx.enc.isPressed();  // ignore carry-over press
+        phase_ = Phase::Idle;
+        option_ = 0;
+        drawIdle(ctx);
+    }
+
+    uint32_t periodMs() const override { return 20; }
+
+    ScreenId update(UiContext& ctx) override {
+        int pos = ctx.enc.getPosition();
+        int delta = pos - last_encoder_pos_;
+        bool pressed = ctx.enc.isPressed();
+        bool click = pressed && !was_pressed_;
+        was_pressed_ = pressed;
+        ScreenId next = ScreenId::Autotune;
+
+        switch (phase_) {
+        case Phase::Idle:
+        case Phase::Result: {
+            int last = phase_ == Phase::Idle ? 1 : 2;
+            if (delta != 0) {
+                option_ += delta;
+                if (option_ < 0) option_ = 0;
+                if (option_ > last) option_ = last;
+                last_encoder_pos_ = pos;
+            }
+            if (option_ != last_option_) drawOptions(ctx);
+
+            bool do_start = ctx.web_start_autotune;
+            ctx.web_start_autotune = false;
+            if (click) {
+                if (option_ == last) {
+                    next = ScreenId::Menu;
+                } else if (phase_ == Phase::Idle) {
+                    do_start = true;
+                } else {
+                    const TuneResult& r = ctx.g_state.tune[scale_];
+                    ctx.apply_pid(scale_, r.kp, r.ki, r.kd, option_ == 1);
+                    ctx.bz.playMarioCoin();
+                    ctx.lcd.setCursor(2, 0);
+                    ctx.lcd.print(option_ == 1 ? "Gains saved         " : "Gains applied       ");
+                    ctx.hold_ms = 1000;
+                    next = ScreenId::Menu;
+                }
+            }
+            if (do_start) start(ctx);
+            break;
+        }
+
+        case Phase::Running: {
+            // Numbers as main.cpp mirrors them (0 g until core 1 picked the
+            // test up)
+            char line[21];
+            std::snprintf(line, sizeof(line), "Gate %3d deg %5d g ",
+                          (int)(ctx.g_state.run_servo[scale_] + 0.5f),
+                          (int)(ctx.g_state.run_grams[scale_] + 0.5f));
+            ctx.lcd.setCursor(1, 0);
+            ctx.lcd.print(line);
+
+            if (click && !stop_sent_) {
+                WebCmd c;
+                c.cmd = WebCommand::StopDispense;
+                c.i0 = scale_;
+                stop_sent_ = control_send(c);
+            }
+            if (!ctx.g_state.run_active[scale_]) finish(ctx);
+            break;
+        }
+        }
         return next;
     }
 };
@@ -1021,40 +1293,56 @@ public:
 // -------------------------------------------------------------- TestMenu ----
 
 class TestMenuScreen : public Screen {
+    // Five entries on four rows: the list scrolls by one when the arrow
+    // moves past either edge
+    static constexpr int ITEMS = 5;
+    static constexpr const char* LABELS[ITEMS] = {
+        "Vibrators", "Servos", "Servo Zero", "Autotune", "Back"
+    };
+
     int  selected_ = 0;
     int  last_selected_ = -1;
+    int  top_ = 0;           // first entry on row 0
     int  last_encoder_pos_ = 0;
     bool was_pressed_ = false;
+
+    void draw(UiContext& ctx) {
+        for (int r = 0; r < 4; r++) {
+            char row[19];
+            std::snprintf(row, sizeof(row), "%-18s", LABELS[top_ + r]);
+            ctx.lcd.setCursor(r, 2);
+            ctx.lcd.print(row);
+        }
+        indicatorArrow(ctx.lcd, selected_ - top_, 0, 4);
+    }
+
 public:
     void enter(UiContext& ctx) override {
         ctx.lcd.clear();
-        ctx.lcd.setCursor(0, 2);
-        ctx.lcd.print("Vibrators");
-        ctx.lcd.setCursor(1, 2);
-        ctx.lcd.print("Servos");
-        ctx.lcd.setCursor(2, 2);
-        ctx.lcd.print("Servo Zero");
-        ctx.lcd.setCursor(3, 2);
-        ctx.lcd.print("Back");
-        indicatorArrow(ctx.lcd, 0, 0, 4);
         selected_ = 0;
         last_selected_ = 0;
+        top_ = 0;
+        draw(ctx);
         last_encoder_pos_ = ctx.enc.getPosition();
         was_pressed_ = ctx.enc.isPressed();  // ignore carry-over press
     }
 
+    uint32_t periodMs() const override { return 20; }
+
     ScreenId update(UiContext& ctx) override {
         int pos = ctx.enc.getPosition();
         int delta = pos - last_encoder_pos_;
         if (delta != 0) {
             selected_ += delta;
             if (selected_ < 0) selected_ = 0;
-            if (selected_ > 3) selected_ = 3;
+            if (selected_ > ITEMS - 1) selected_ = ITEMS - 1;
             last_encoder_pos_ = pos;
         }
 
         if (selected_ != last_selected_) {
-            indicatorArrow(ctx.lcd, selected_, 0, 4);
+            if (selected_ < top_) top_ = selected_;
+            if (selected_ > top_ + 3) top_ = selected_ - 3;
+            draw(ctx);
             last_selected_ = selected_;
         }
 
@@ -1064,11 +1352,13 @@ public:
             if (selected_ == 0) next = ScreenId::TestVibrator;
             else if (selected_ == 1) next = ScreenId::TestServo;
             else if (selected_ == 2) next = ScreenId::ServoCal;
+            else if (selected_ == 3) {
+                ctx.after_select = ScreenId::Autotune;
+                next = ScreenId::SelectScale;
+            }
             else next = ScreenId::Menu;
         }
         was_pressed_ = pressed;
-
-        sleep_ms(20);
         return next;
     }
 };
@@ -1171,8 +1461,6 @@ public:
             ctx.sevenSeg->printNumber(selected_ + 1, 0, 255, 0);
         }
         ctx.sevenSeg->show();
-
-        sleep_ms(50);
         return next;
     }
 };
@@ -1225,8 +1513,7 @@ public:
                 // Close, settle, release - off() also hands the shared PWM
                 // slice back so a later vibrator-3 test doesn't hum at 333 Hz
                 ctx.servos[selected_]->writeDegrees(servo_close(ctx.g_state, selected_));
-                sleep_ms(300);
-                ctx.servos[selected_]->off();
+                ctx.release_servo_later(selected_);
                 angle_ = 0;
             }
         } else {
@@ -1285,8 +1572,6 @@ public:
             ctx.sevenSeg->printNumber(selected_ + 1, 0, 255, 0);
         }
         ctx.sevenSeg->show();
-
-        sleep_ms(50);
         return next;
     }
 };
@@ -1313,8 +1598,7 @@ class ServoCalScreen : public Screen {
 
     static void closeAndRelease(UiContext& ctx, int i) {
         ctx.servos[i]->writeDegrees(servo_close(ctx.g_state, i));
-        sleep_ms(300);
-        ctx.servos[i]->off();
+        ctx.release_servo_later(i);
     }
 
     void drawSelect(UiContext& ctx) {
@@ -1485,8 +1769,6 @@ public:
             }
             break;
         }
-
-        sleep_ms(50);
         return next;
     }
 };
@@ -1501,6 +1783,7 @@ static SetTargetScreen      s_setTarget;
 static SetTargetDigitScreen s_setTargetDigit;
 static WeighScreen          s_weigh;
 static DispenseScreen       s_dispense;
+static AutotuneScreen       s_autotune;
 static TestMenuScreen       s_testMenu;
 static TestVibratorScreen   s_testVibrator;
 static TestServoScreen      s_testServo;
@@ -1516,6 +1799,7 @@ static Screen* screenFor(ScreenId id) {
     case ScreenId::SetTargetDigit: return &s_setTargetDigit;
     case ScreenId::Weigh:          return &s_weigh;
     case ScreenId::Dispense:       return &s_dispense;
+    case ScreenId::Autotune:       return &s_autotune;
     case ScreenId::TestMenu:       return &s_testMenu;
     case ScreenId::TestVibrator:   return &s_testVibrator;
     case ScreenId::TestServo:      return &s_testServo;
@@ -1525,19 +1809,26 @@ static Screen* screenFor(ScreenId id) {
 }
 
 void ScreenManager::init(UiContext& ctx, ScreenId start) {
-    current_ = start;
-    screenFor(current_)->enter(ctx);
+    goTo(ctx, start);
 }
 
 void ScreenManager::tick(UiContext& ctx) {
+    if (next_ != current_) {       // transition held back behind a message
+        goTo(ctx, next_);
+        return;
+    }
     ScreenId next = screenFor(current_)->update(ctx);
     if (next != current_) {
-        current_ = next;
-        screenFor(current_)->enter(ctx);
+        if (ctx.hold_ms) next_ = next;
+        else goTo(ctx, next);
     }
 }
 
 void ScreenManager::goTo(UiContext& ctx, ScreenId id) {
-    current_ = id;
+    current_ = next_ = id;
     screenFor(current_)->enter(ctx);
 }
+
+uint32_t ScreenManager::periodMs() const {
+    return screenFor(current_)->periodMs();
+}
@@ -5,22 +5,27 @@
 //
 // Lifecycle: ScreenManager calls enter() once when a screen becomes current
 // (draw the static header, capture encoder/button state so presses don't carry
-// over from the previous screen), then update() every loop tick. update()
+// over from the previous screen), then update() every periodMs(). update()
 // returns the ScreenId to show next - itself to stay put.
 //
+// Screens never sleep: main()'s scheduler paces them. To keep a message on
+// the LCD a while, set ctx.hold_ms - the next update (and a transition
+// returned together with the hold) waits that long.
+//
 // Per-screen state that used to live in function-local statics inside main()'s
 // big switch now lives in member variables, initialized in enter().
 
 class Lcd1602I2C;
 class Rotary_Button;
 class Buzzer;
-class hx711;
+class ScaleLink;
 class Servo;
 class Vibrator;
 class SevenSeg;
-class PID;
 struct ScaleConfig;
+struct PidEntry;
 struct DispenserState;
+struct WebCmd;
 
 enum class ScreenId {
     Menu,
@@ -31,6 +36,7 @@ enum class ScreenId {
     SetTargetDigit,
     Weigh,
     Dispense,
+    Autotune,
     TestMenu,
     TestVibrator,
     TestServo,
@@ -43,18 +49,16 @@ struct UiContext {
     Lcd1602I2C&     lcd;
     Rotary_Button&  enc;
     Buzzer&         bz;
-    hx711**         scales;      // [3]
+    ScaleLink**     scales;      // [3] core-0 views; the HX711s belong to core 1
     Servo**         servos;      // [3]
     Vibrator**      vibrators;   // [3]
     SevenSeg*&      sevenSeg;    // created after startup animation
     ScaleConfig&    sc;
     DispenserState& g_state;
 
-    // PID tuning state shared with the web command dispatcher in main()
-    double& Kp;
-    double& Ki;
-    double& Kd;
-    PID*&   dispense_pid;
+    // PID gains per scale, shared with the web command dispatcher in main()
+    // (the PID itself runs on core 1 - see app/control.hpp)
+    PidEntry*       pid_gains;   // [3]
 
     // lwIP lock (no-ops when the network stack is down)
     void (*net_lock)();
@@ -69,10 +73,35 @@ struct UiContext {
     int  target_grams   = 100;
     ScreenId after_select = ScreenId::Calibrate1;  // where SelectScale leads
     ScreenId after_target = ScreenId::Weigh;       // where SetTargetDigit returns
-    bool web_start_dispense = false;  // web requested a dispense start
-    bool web_stop_dispense  = false;  // web requested a dispense stop
     bool web_active         = false;  // web controls; local input mostly disabled
     bool servo_zero_save_request = false;  // ServoCal saved a zero; main() persists
+    bool web_start_autotune = false;  // web requested a step test (Autotune screen)
+
+    // Step test parameters (app/autotune.hpp); the web start command sets them
+    float tune_open  = 40.0f;    // step opening above the flow start (held at half first)
+    float tune_max_g = 400.0f;   // gram cap: the test stops here
+    float tune_tc    = 1.0f;     // closed-loop time constant for the proposal (s)
+    uint32_t hold_ms = 0;        // set by update(): pause the UI this long
+
+    // Release a servo once a just-commanded close has settled (300 ms
+    // one-shot in main()'s scheduler; a newer request for it replaces it)
+    void (*release_servo_later)(int i) = nullptr;
+
+    // New PID gains for scale i: live on core 1 once its run (if any) ends,
+    // persisted too when save (main.cpp defers the flash write while
+    // dispensing)
+    void (*apply_pid)(int i, float kp, float ki, float kd, bool save) = nullptr;
+
+    // Start a run on core 1 - StartDispense or Autotune, scale in i0; runs on
+    // the other scales carry on. main.cpp opens its telemetry, marks it in
+    // g_state.run_active[] and closes it when core 1 reports the end.
+    // Returns the telemetry run id, 0 = not started (the scale's last run is
+    // still closing, or the queue is full).
+    uint32_t (*start_run)(const WebCmd& c) = nullptr;
+
+    // Order queue (app/order_queue.hpp) commands: QueueNext, QueueStop. Its
+    // progress is g_state.queue.
+    void (*queue_cmd)(const WebCmd& c) = nullptr;
 };
 
 class Screen {
@@ -80,6 +109,7 @@ public:
     virtual ~Screen() = default;
     virtual void enter(UiContext& ctx) = 0;
     virtual ScreenId update(UiContext& ctx) = 0;
+    virtual uint32_t periodMs() const { return 50; }
 };
 
 class ScreenManager {
@@ -96,7 +126,9 @@ public:
     void goTo(UiContext& ctx, ScreenId id);
 
     ScreenId currentId() const { return current_; }
+    uint32_t periodMs() const;   // current screen's update period
 
 private:
     ScreenId current_ = ScreenId::Menu;
+    ScreenId next_    = ScreenId::Menu;   // != current_: transition after a hold
 };
@@ -3,6 +3,7 @@
 #include "pico/stdlib.h"
 #include "hardware/pwm.h"
 #include "hardware/clocks.h"
+#include "hardware/sync.h"
 #include <algorithm>
 #include <cmath>
 
@@ -68,34 +69,93 @@ void Buzzer::stopTone()
     pwm_set_enabled(_slice, true);
 }
 
-void Buzzer::playTone(uint32_t freq_hz, uint32_t duration_ms, float volume)
+// --- Sequencer ---
+
+bool Buzzer::play(const Note* notes, size_t count, Priority prio, float volume, uint32_t gap_ms)
 {
-    startTone(freq_hz, volume);
-    sleep_ms(duration_ms);
-    stopTone();
+    if (!notes || count == 0) return false;
+    if (count > MAX_NOTES) count = MAX_NOTES;
+
+    // The alarm callback reads the table from the timer IRQ on this core;
+    // keep it out while the table is swapped (<= 64 notes, a few us)
+    uint32_t irq = save_and_disable_interrupts();
+    if (alarm_ != 0) {
+        if (prio < _prio) {
+            restore_interrupts(irq);
+            return false;
+        }
+        cancel_alarm(alarm_);
+        alarm_ = 0;
+    }
+    std::copy(notes, notes + count, _seq);
+    _count  = count;
+    _next   = 0;
+    _gapMs  = gap_ms;
+    _gapDue = false;
+    _volume = volume;
+    _prio   = prio;
+
+    int64_t us = step();
+    alarm_id_t id = add_alarm_in_us((uint64_t)us, onAlarm, this, true);
+    if (id > 0) {
+        alarm_ = id;
+    } else {
+        stopTone();   // alarm pool full: skip the sound rather than block
+    }
+    restore_interrupts(irq);
+    return id > 0;
+}
+
+int64_t Buzzer::step()
+{
+    if (_gapDue) {
+        _gapDue = false;
+        stopTone();
+        return (int64_t)_gapMs * 1000;
+    }
+    if (_next >= _count) {
+        stopTone();
+        alarm_ = 0;
+        return 0;
+    }
+    const Note& n = _seq[_next++];
+    startTone(n.freq_hz, _volume);   // 0 Hz = rest
+    _gapDue = (_gapMs != 0);
+    return n.duration_ms ? (int64_t)n.duration_ms * 1000 : 1;
 }
 
-void Buzzer::rest(uint32_t duration_ms)
+int64_t Buzzer::onAlarm(alarm_id_t, void* user)
 {
+    return static_cast<Buzzer*>(user)->step();   // >0 reschedules, 0 ends
+}
+
+void Buzzer::stop()
+{
+    uint32_t irq = save_and_disable_interrupts();
+    if (alarm_ != 0) {
+        cancel_alarm(alarm_);
+        alarm_ = 0;
+    }
     stopTone();
-    sleep_ms(duration_ms);
+    restore_interrupts(irq);
+}
+
+bool Buzzer::playTone(uint32_t freq_hz, uint32_t duration_ms, float volume)
+{
+    const Note n = {freq_hz, duration_ms};
+    return play(&n, 1, Priority::Feedback, volume);
 }
 
-void Buzzer::beep(uint32_t duration_ms, float volume)
+bool Buzzer::beep(uint32_t duration_ms, float volume)
 {
     const uint32_t f1 = 1400, f2 = 1800;
-    playTone(f1, duration_ms, volume);
-    rest(duration_ms / 3);
-    playTone(f2, duration_ms, volume);
+    const Note notes[] = {{f1, duration_ms}, {0, duration_ms / 3}, {f2, duration_ms}};
+    return play(notes, 3, Priority::Feedback, volume);
 }
 
-void Buzzer::playMelody(const std::vector<Note>& melody, uint32_t gap_ms, float volume)
+bool Buzzer::playMelody(const std::vector<Note>& melody, uint32_t gap_ms, float volume)
 {
-    for (auto& n : melody) {
-        if (n.freq_hz == 0) rest(n.duration_ms);
-        else playTone(n.freq_hz, n.duration_ms, volume);
-        if (gap_ms) rest(gap_ms);
-    }
+    return play(melody.data(), melody.size(), Priority::Event, volume, gap_ms);
 }
 
 // --- Note frequencies ---
@@ -154,78 +214,66 @@ std::vector<Buzzer::Note> Buzzer::melodyTwinkle(uint32_t tempo_bpm)
 }
 
 // --- Special Sound Effects ---
+// Static note tables: play() copies them, nothing is built per call.
+
+namespace {
+// Mac-like startup chime - warm ascending arpeggio with sustained feel
+// F#maj chord approximation: F#, A#, C#, F# (octave up)
+// Using close frequencies for a pleasing "tech startup" sound
+constexpr uint32_t FS4 = 370, AS4 = 466, CS5 = 554, FS5 = 740;
+const Buzzer::Note MAC_STARTUP[] = {
+    // Quick arpeggio then hold the high note
+    {FS4, 80}, {AS4, 80}, {CS5, 80}, {FS5, 400}, {0, 50},
+};
+
+// The famous 5-note alien sequence from Close Encounters
+// Notes: G, A, F, F(octave down), C - 280 ms each, 60 ms apart
+const Buzzer::Note CLOSE_ENCOUNTERS[] = {
+    {NOTE_G4, 280}, {0, 60},
+    {NOTE_A4, 280}, {0, 60},
+    {NOTE_F4, 280}, {0, 60},
+    {NOTE_F3, 280}, {0, 60},   // Octave drop!
+    {NOTE_C4, 480}, {0, 100},  // Hold the last note longer
+};
+
+// Classic Mario coin "bling!" - two quick high notes
+// B5 -> E6, very snappy
+const Buzzer::Note MARIO_COIN[] = {
+    {NOTE_B5, 60}, {NOTE_E6, 180},
+};
+
+// Das Boot theme by Klaus Doldinger - the iconic synth melody
+// Key of E minor, slow dramatic tempo (~108 BPM): short 220, medium 350,
+// long 500 ms, 80 ms gaps
+constexpr uint32_t DB_E4 = 329, DB_FS4 = 370, DB_D4 = 293, DB_B3 = 246, DB_E3 = 164;
+const Buzzer::Note DAS_BOOT[] = {
+    // The iconic opening motif: E-E-E-D-E-F#-E (slow and dramatic)
+    {DB_E4, 220}, {0, 80}, {DB_E4, 220}, {0, 80}, {DB_E4, 220}, {0, 80},
+    {DB_D4, 220}, {0, 80}, {DB_E4, 350}, {0, 80}, {DB_FS4, 350}, {0, 80},
+    {DB_E4, 500}, {0, 80},
+    // Descending bass response
+    {DB_B3, 350}, {0, 80},
+    {DB_E3, 700},   // Hold the final low E
+};
+
+}
 
 void Buzzer::playMacStartup(float volume)
 {
-    // Mac-like startup chime - warm ascending arpeggio with sustained feel
-    // F#maj chord approximation: F#, A#, C#, F# (octave up)
-    // Using close frequencies for a pleasing "tech startup" sound
-    const uint32_t FS4 = 370;   // F#4
-    const uint32_t AS4 = 466;   // A#4
-    const uint32_t CS5 = 554;   // C#5
-    const uint32_t FS5 = 740;   // F#5
-
-    // Quick arpeggio then hold the high note
-    playTone(FS4, 80, volume);
-    playTone(AS4, 80, volume);
-    playTone(CS5, 80, volume);
-    playTone(FS5, 400, volume);  // Hold the top note
-    rest(50);
+    play(MAC_STARTUP, count_of(MAC_STARTUP), Priority::Event, volume);
 }
 
 void Buzzer::playCloseEncounters(float volume)
 {
-    // The famous 5-note alien sequence from Close Encounters
-    // Notes: G, A, F, F(octave down), C
-    // Iconic "communication" melody
-    const uint32_t dur = 280;  // Each note duration
-    const uint32_t gap = 60;   // Gap between notes
-
-    playTone(NOTE_G4, dur, volume);
-    rest(gap);
-    playTone(NOTE_A4, dur, volume);
-    rest(gap);
-    playTone(NOTE_F4, dur, volume);
-    rest(gap);
-    playTone(NOTE_F3, dur, volume);  // Octave drop!
-    rest(gap);
-    playTone(NOTE_C4, dur + 200, volume);  // Hold the last note longer
-    rest(100);
+    play(CLOSE_ENCOUNTERS, count_of(CLOSE_ENCOUNTERS), Priority::Alert, volume);
 }
 
 void Buzzer::playMarioCoin(float volume)
 {
-    // Classic Mario coin "bling!" - two quick high notes
-    // B5 -> E6, very snappy
-    playTone(NOTE_B5, 60, volume);
-    playTone(NOTE_E6, 180, volume);
+    play(MARIO_COIN, count_of(MARIO_COIN), Priority::Event, volume);
 }
 
 void Buzzer::playDasBoot(float volume)
 {
-    // Das Boot theme by Klaus Doldinger - the iconic synth melody
-    // Key of E minor, slow dramatic tempo (~108 BPM)
-    const uint32_t NOTE_E4 = 329;
-    const uint32_t NOTE_FS4 = 370;  // F#4
-    const uint32_t NOTE_D4 = 293;
-    const uint32_t NOTE_B3 = 246;
-    const uint32_t NOTE_E3 = 164;
-
-    const uint32_t s = 220;   // Short note (eighth)
-    const uint32_t m = 350;   // Medium note (quarter)
-    const uint32_t l = 500;   // Long note (held)
-    const uint32_t g = 80;    // Gap between notes
-
-    // The iconic opening motif: E-E-E-D-E-F#-E (slow and dramatic)
-    playTone(NOTE_E4, s, volume); rest(g);
-    playTone(NOTE_E4, s, volume); rest(g);
-    playTone(NOTE_E4, s, volume); rest(g);
-    playTone(NOTE_D4, s, volume); rest(g);
-    playTone(NOTE_E4, m, volume); rest(g);
-    playTone(NOTE_FS4, m, volume); rest(g);
-    playTone(NOTE_E4, l, volume); rest(g);
-
-    // Descending bass response
-    playTone(NOTE_B3, m, volume); rest(g);
-    playTone(NOTE_E3, l + 200, volume);  // Hold the final low E
-}
\ No newline at end of file
+    play(DAS_BOOT, count_of(DAS_BOOT), Priority::Event, volume);
+}
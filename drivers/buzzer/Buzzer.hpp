@@ -1,31 +1,53 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <vector>
+#include "pico/time.h"
 
+// Piezo buzzer on a PWM slice, with a background melody sequencer.
+//
+// Every play call copies its notes into a fixed table (MAX_NOTES, no heap)
+// and returns at once; a hardware alarm steps through the notes from the
+// timer IRQ. One sound plays at a time: a new one preempts a sound of equal
+// or lower priority and is dropped while a higher-priority one plays, so a
+// click can't cut off the dispense-done fanfare.
 class Buzzer {
 public:
     explicit Buzzer(int gpio_buzzer = 2);
 
-    // Simple short beep for button press feedback
-    void beep(uint32_t duration_ms = 60, float volume = 0.6f);
+    // Melody item: freq_hz == 0 means rest
+    struct Note { uint32_t freq_hz; uint32_t duration_ms; };
 
-    // Play a specific tone (blocking for duration_ms)
-    void playTone(uint32_t freq_hz, uint32_t duration_ms, float volume = 0.6f);
+    enum class Priority : uint8_t {
+        Feedback = 0,   // clicks, test tones
+        Event    = 1,   // coin, startup chime
+        Alert    = 2,   // dispense done
+    };
 
-    // Rest/silence (blocking)
-    void rest(uint32_t duration_ms);
+    static constexpr size_t MAX_NOTES = 64;
 
-    // Melody item: freq_hz == 0 means rest
-    struct Note { uint32_t freq_hz; uint32_t duration_ms; };
+    // Start a sequence (longer ones are cut at MAX_NOTES). Optional gap of
+    // silence after each note. False if a higher-priority sound is playing.
+    bool play(const Note* notes, size_t count, Priority prio = Priority::Event,
+              float volume = 0.6f, uint32_t gap_ms = 0);
 
-    // Play a melody (blocking). Optional gap between notes in ms.
-    void playMelody(const std::vector<Note>& melody, uint32_t gap_ms = 10, float volume = 0.6f);
+    // Simple short beep for button press feedback
+    bool beep(uint32_t duration_ms = 60, float volume = 0.6f);
+
+    // Play a specific tone (non-blocking)
+    bool playTone(uint32_t freq_hz, uint32_t duration_ms, float volume = 0.6f);
+
+    // Play a melody (non-blocking). Optional gap between notes in ms.
+    bool playMelody(const std::vector<Note>& melody, uint32_t gap_ms = 10, float volume = 0.6f);
+
+    void stop();                 // silence whatever is playing
+    bool playing() const { return alarm_ != 0; }
 
     // Built-in public-domain melodies
     static std::vector<Note> melodyOdeToJoy(uint32_t tempo_bpm = 120);
     static std::vector<Note> melodyTwinkle(uint32_t tempo_bpm = 100);
 
-    // Special sound effects
+    // Special sound effects (non-blocking)
     void playMacStartup(float volume = 0.5f);       // Mac-like startup chime
     void playCloseEncounters(float volume = 0.5f); // The famous 5-note alien sequence
     void playMarioCoin(float volume = 0.6f);       // Classic coin "bling!"
@@ -35,7 +57,20 @@ private:
     void startTone(uint32_t freq_hz, float volume);
     void stopTone();
 
+    // Sequencer: start the next note (or gap); us until the next step, 0 = done
+    int64_t step();
+    static int64_t onAlarm(alarm_id_t id, void* user);
+
     int _gpio;
     int _slice;
     int _channel;
-};
\ No newline at end of file
+
+    Note     _seq[MAX_NOTES];
+    size_t   _count = 0;
+    size_t   _next = 0;
+    uint32_t _gapMs = 0;
+    bool     _gapDue = false;
+    float    _volume = 0.6f;
+    Priority _prio = Priority::Feedback;
+    volatile alarm_id_t alarm_ = 0;   // 0 = idle
+};
@@ -0,0 +1,190 @@
+#include "config_log.hpp"
+
+#include <cstring>
+
+static uint32_t crc32_update(uint32_t c, const void* data, size_t len) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < len; ++i) {
+        c ^= p[i];
+        for (int b = 0; b < 8; ++b) {
+            c = (c >> 1) ^ (0xEDB88320u & (-(int)(c & 1)));
+        }
+    }
+    return c;
+}
+
+uint32_t config_crc32(const void* data, size_t len) {
+    return ~crc32_update(0xFFFFFFFFu, data, len);
+}
+
+const ConfigLog::RecordHeader* ConfigLog::record_at(uint32_t offset) const {
+    const RecordHeader* r = reinterpret_cast<const RecordHeader*>(f_.base + offset);
+    if (r->magic != CFG_LOG_MAGIC) return nullptr;
+    if (r->len > f_.page_size - sizeof(RecordHeader)) return nullptr;
+    // seq, key and len sit between magic and crc
+    uint32_t c = crc32_update(0xFFFFFFFFu, &r->seq, offsetof(RecordHeader, crc) - offsetof(RecordHeader, seq));
+    c = ~crc32_update(c, r + 1, r->len);
+    return (c == r->crc) ? r : nullptr;
+}
+
+bool ConfigLog::page_erased(uint32_t offset) const {
+    const uint32_t* w = reinterpret_cast<const uint32_t*>(f_.base + offset);
+    for (uint32_t i = 0; i < f_.page_size / 4; i++) {
+        if (w[i] != 0xFFFFFFFFu) return false;
+    }
+    return true;
+}
+
+bool ConfigLog::sector_erased(uint32_t sector) const {
+    for (uint32_t p = 0; p < pages_per_sector(); p++) {
+        if (!page_erased(sector * f_.sector_size + p * f_.page_size)) return false;
+    }
+    return true;
+}
+
+ConfigLog::Slot* ConfigLog::slot_for(uint16_t key) {
+    for (int i = 0; i < nslots_; i++) {
+        if (slots_[i].key == key) return &slots_[i];
+    }
+    return nullptr;
+}
+
+const ConfigLog::Slot* ConfigLog::slot_for(uint16_t key) const {
+    return const_cast<ConfigLog*>(this)->slot_for(key);
+}
+
+bool ConfigLog::mount(const ConfigFlash& flash) {
+    f_ = flash;
+    mounted_ = false;
+    nslots_ = 0;
+    seq_ = 0;
+    erases_ = 0;
+    if (f_.sector_count < 3 || f_.page_size > CFG_LOG_PAGE_MAX ||
+        f_.page_size < sizeof(RecordHeader) + 4 || f_.sector_size % f_.page_size != 0 ||
+        pages_per_sector() <= (uint32_t)CFG_LOG_MAX_KEYS) {
+        return false;
+    }
+
+    // Index every valid record: the highest seq wins, per key and overall
+    bool found = false;
+    uint32_t newest = 0;
+    uint32_t area = f_.sector_count * f_.sector_size;
+    for (uint32_t off = 0; off < area; off += f_.page_size) {
+        const RecordHeader* r = record_at(off);
+        if (!r) continue;
+        if (!found || r->seq > seq_) {
+            seq_ = r->seq;
+            newest = off;
+            found = true;
+        }
+        Slot* s = slot_for(r->key);
+        if (!s) {
+            if (nslots_ == CFG_LOG_MAX_KEYS) continue;
+            s = &slots_[nslots_++];
+            *s = Slot{r->key, off, r->seq};
+        } else if (r->seq > s->seq) {
+            s->offset = off;
+            s->seq = r->seq;
+        }
+    }
+
+    // Append after the newest record, past any torn pages
+    active_ = found ? newest / f_.sector_size : 0;
+    head_ = found ? (newest % f_.sector_size) / f_.page_size + 1 : 0;
+    while (head_ < pages_per_sector() &&
+           !page_erased(active_ * f_.sector_size + head_ * f_.page_size)) {
+        head_++;
+    }
+
+    mounted_ = true;
+
+    // Restore the erased spare (interrupted GC, or a fresh area)
+    uint32_t spare = (active_ + 1) % f_.sector_count;
+    if (!sector_erased(spare)) make_spare(spare);
+    return true;
+}
+
+bool ConfigLog::read(uint16_t key, void* out, uint16_t len) const {
+    if (!mounted_) return false;
+    const Slot* s = slot_for(key);
+    if (!s) return false;
+    const RecordHeader* r = record_at(s->offset);
+    if (!r || r->len != len) return false;
+    std::memcpy(out, r + 1, len);
+    return true;
+}
+
+bool ConfigLog::append(uint16_t key, const void* data, uint16_t len) {
+    if (head_ >= pages_per_sector()) return false;
+    Slot* s = slot_for(key);
+    if (!s && nslots_ == CFG_LOG_MAX_KEYS) return false;
+
+    // Build the page in RAM: data may point into the flash being programmed
+    alignas(4) uint8_t page[CFG_LOG_PAGE_MAX];
+    std::memset(page, 0xFF, f_.page_size);
+    RecordHeader h{CFG_LOG_MAGIC, seq_ + 1, key, len, 0};
+    std::memcpy(page, &h, sizeof(h));
+    std::memcpy(page + sizeof(h), data, len);
+    uint32_t c = crc32_update(0xFFFFFFFFu, page + offsetof(RecordHeader, seq),
+                              offsetof(RecordHeader, crc) - offsetof(RecordHeader, seq));
+    h.crc = ~crc32_update(c, page + sizeof(h), len);
+    std::memcpy(page, &h, sizeof(h));
+
+    // The page is used up whatever happens: a failed program is never retried
+    uint32_t off = active_ * f_.sector_size + head_ * f_.page_size;
+    head_++;
+    f_.program(off, page, f_.ctx);
+    const RecordHeader* r = record_at(off);
+    if (!r || r->seq != h.seq) return false;
+
+    seq_ = h.seq;
+    if (!s) {
+        s = &slots_[nslots_++];
+        s->key = key;
+    }
+    s->offset = off;
+    s->seq = h.seq;
+    return true;
+}
+
+bool ConfigLog::make_spare(uint32_t sector) {
+    // Copy forward every key whose newest record still lives here
+    alignas(4) uint8_t payload[CFG_LOG_PAGE_MAX];
+    for (int i = 0; i < nslots_; i++) {
+        if (slots_[i].offset / f_.sector_size != sector) continue;
+        const RecordHeader* r = record_at(slots_[i].offset);
+        if (!r) continue;
+        uint16_t len = r->len;
+        std::memcpy(payload, r + 1, len);
+        if (!append(slots_[i].key, payload, len)) return false;
+    }
+    f_.erase(sector * f_.sector_size, f_.ctx);
+    erases_++;
+    return sector_erased(sector);
+}
+
+bool ConfigLog::advance() {
+    // The spare must be clean: never program over records that may be live
+    uint32_t next = (active_ + 1) % f_.sector_count;
+    if (!sector_erased(next)) return false;
+    active_ = next;
+    head_ = 0;
+    return make_spare((active_ + 1) % f_.sector_count);
+}
+
+bool ConfigLog::write(uint16_t key, const void* data, uint16_t len) {
+    if (!mounted_ || len > f_.page_size - sizeof(RecordHeader)) return false;
+
+    // Saving an unchanged struct costs nothing
+    if (const Slot* s = slot_for(key)) {
+        const RecordHeader* r = record_at(s->offset);
+        if (r && r->len == len && std::memcmp(r + 1, data, len) == 0) return true;
+    }
+
+    // A page that fails verification is skipped; give up after a few
+    for (int attempt = 0; attempt < 3; attempt++) {
+        if (head_ >= pages_per_sector() && !advance()) return false;
+        if (append(key, data, len)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Append-only, CRC-checked record log for the config structs (config_store).
+//
+// The area is CFG_LOG_SECTORS erase sectors used round-robin. A save appends
+// one record to the active sector:
+//
+//   | magic "KDR1" | seq | key | len | crc32 | payload ... | 0xFF padding |
+//
+// Each record takes one whole flash page, so a save costs one page program
+// (~1 ms) instead of a sector erase (~50 ms), and a page is never
+// programmed twice. Reading a key returns its record with the highest seq.
+//
+// Power-fail rules:
+//  - A torn record fails its CRC and is ignored; the key's previous record is
+//    still there.
+//  - The sector after the active one is always kept erased. When the active
+//    sector fills, the log moves into that spare and then garbage-collects
+//    the sector after it: it copies any key whose newest record lives there,
+//    then erases it. A cut during the copy only leaves duplicates. A cut
+//    during the erase is finished by the next mount(), which restores the
+//    spare sector the same way.
+//
+// Wear: one erase per (pages per sector) saves, rotated over all sectors.
+//
+// No Pico SDK dependencies: the flash is reached through ConfigFlash, so the
+// log also runs against a RAM-backed flash on a host (e.g. to cut power at
+// every page program).
+
+inline constexpr uint32_t CFG_LOG_MAGIC    = 0x3152444B;   // "KDR1"
+inline constexpr int      CFG_LOG_MAX_KEYS = 8;     // fewer than pages per sector
+inline constexpr uint32_t CFG_LOG_PAGE_MAX = 256;   // largest supported page
+
+struct ConfigFlash {
+    const uint8_t* base;          // memory-mapped view of the area (XIP)
+    uint32_t sector_size;         // erase unit, e.g. 4096
+    uint32_t page_size;           // program unit, e.g. 256
+    uint32_t sector_count;        // >= 3
+    // Erase one sector / program one page (offsets relative to base).
+    // False on failure; the log re-reads base either way.
+    bool (*erase)(uint32_t offset, void* ctx);
+    bool (*program)(uint32_t offset, const uint8_t* page, void* ctx);
+    void* ctx;
+};
+
+// CRC32 (poly 0xEDB88320), also used for the config structs' own crc32 field
+uint32_t config_crc32(const void* data, size_t len);
+
+class ConfigLog {
+public:
+    // Scan the area, rebuild the index and finish an interrupted garbage
+    // collection. Must succeed before read()/write().
+    bool mount(const ConfigFlash& flash);
+    bool mounted() const { return mounted_; }
+
+    // Newest payload for key, copied into out when its length is exactly len
+    bool read(uint16_t key, void* out, uint16_t len) const;
+
+    // Append a record; false if the flash refused it (e.g. worn-out page
+    // that keeps failing verification) or the payload doesn't fit a page.
+    bool write(uint16_t key, const void* data, uint16_t len);
+
+    uint32_t erase_count() const { return erases_; }   // since mount
+
+private:
+    struct RecordHeader {
+        uint32_t magic;
+        uint32_t seq;
+        uint16_t key;
+        uint16_t len;
+        uint32_t crc;      // over seq, key, len and the payload
+    };
+    struct Slot {
+        uint16_t key;
+        uint32_t offset;   // record's page
+        uint32_t seq;
+    };
+
+    const RecordHeader* record_at(uint32_t offset) const;   // nullptr if invalid
+    bool page_erased(uint32_t offset) const;
+    bool sector_erased(uint32_t sector) const;
+    uint32_t pages_per_sector() const { return f_.sector_size / f_.page_size; }
+
+    Slot* slot_for(uint16_t key);
+    const Slot* slot_for(uint16_t key) const;
+    bool append(uint16_t key, const void* data, uint16_t len);
+    bool advance();                         // active sector full: move on + GC
+    bool make_spare(uint32_t sector);       // relocate live records, erase
+
+    ConfigFlash f_ = {};
+    bool     mounted_ = false;
+    Slot     slots_[CFG_LOG_MAX_KEYS] = {};
+    int      nslots_ = 0;
+    uint32_t seq_ = 0;            // last seq written
+    uint32_t active_ = 0;         // sector being appended to
+    uint32_t head_ = 0;           // next page within active_
+    uint32_t erases_ = 0;
+};
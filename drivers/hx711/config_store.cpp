@@ -1,11 +1,15 @@
 #include "config_store.hpp"
+#include "config_log.hpp"
 
 #include <cstddef>
 #include <cstring>
 
 #include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "pico/multicore.h"
 #include "hardware/flash.h"
 #include "hardware/sync.h" 
+#include <cstdio>
 
 #ifndef CFG_SECTOR_SIZE
 #define CFG_SECTOR_SIZE   FLASH_SECTOR_SIZE   // 4096
@@ -14,29 +18,101 @@
 #define CFG_PAGE_SIZE     FLASH_PAGE_SIZE     // 256
 #endif
 
-static constexpr uint32_t CFG_OFFSET   = (PICO_FLASH_SIZE_BYTES - CFG_SECTOR_SIZE);
-static constexpr uint32_t CFG_XIP_ADDR = (XIP_BASE + CFG_OFFSET);
-
-// CRC32 (poly 0xEDB88320)
-static uint32_t crc32_calc(const void* data, size_t len) {
-    const uint8_t* p = static_cast<const uint8_t*>(data);
-    uint32_t c = 0xFFFFFFFFu;
-    for (size_t i = 0; i < len; ++i) {
-        c ^= p[i];
-        for (int b = 0; b < 8; ++b) {
-            c = (c >> 1) ^ (0xEDB88320u & (-(int)(c & 1)));
-        }
+// Flash layout, from the end of flash down:
+//   5 legacy sectors - one per struct (Scale, PID, Name, Servo, Net), written by
+//                      firmware before the record log. Only read now, as the
+//                      fallback for a struct that has no log record yet, so an
+//                      updated unit keeps its calibration.
+//   4 log sectors    - ConfigLog (config_log.hpp); every save lands here.
+static constexpr uint32_t LEGACY_SECTORS = 5;
+static constexpr uint32_t LOG_SECTORS    = 4;
+static constexpr uint32_t LOG_OFFSET =
+    PICO_FLASH_SIZE_BYTES - (LEGACY_SECTORS + LOG_SECTORS) * CFG_SECTOR_SIZE;
+
+enum : uint16_t { KEY_SCALE = 1, KEY_PID, KEY_NAME, KEY_SERVO, KEY_NET, KEY_RECIPE, KEY_BAG,
+                  KEY_PID_SCALE };
+
+// Erase one sector / program one page. Disabling IRQs on this core is not
+// enough once the control loop runs on core 1: it executes from XIP flash
+// too. flash_safe_execute parks core 1 in RAM (IRQs off) for the ~1 ms of a
+// page program (~50 ms for the occasional GC erase). Before core 1 is up
+// there is nobody to park.
+struct FlashJob {
+    bool           erase;
+    uint32_t       offset;
+    const uint8_t* buf;
+};
+
+static void flash_job_run(void* p) {
+    const FlashJob* j = static_cast<const FlashJob*>(p);
+    if (j->erase) flash_range_erase(j->offset, CFG_SECTOR_SIZE);
+    else flash_range_program(j->offset, j->buf, CFG_PAGE_SIZE);
+}
+
+static bool flash_job(const FlashJob& job) {
+    if (!multicore_lockout_victim_is_initialized(1)) {
+        uint32_t irq_state = save_and_disable_interrupts();
+        flash_job_run(const_cast<FlashJob*>(&job));
+        restore_interrupts(irq_state);
+        return true;
+    }
+    int rc = flash_safe_execute(flash_job_run, const_cast<FlashJob*>(&job), 1000);
+    if (rc != PICO_OK) printf("[cfg] flash %s failed (%d)\n", job.erase ? "erase" : "program", rc);
+    return rc == PICO_OK;
+}
+
+static bool log_erase(uint32_t offset, void*) {
+    return flash_job(FlashJob{true, LOG_OFFSET + offset, nullptr});
+}
+
+static bool log_program(uint32_t offset, const uint8_t* page, void*) {
+    return flash_job(FlashJob{false, LOG_OFFSET + offset, page});
+}
+
+static ConfigLog s_log;
+
+// Mounted on first use (boot's first load_*), before core 1 starts
+static bool log_ready() {
+    if (s_log.mounted()) return true;
+    ConfigFlash f{
+        reinterpret_cast<const uint8_t*>(XIP_BASE + LOG_OFFSET),
+        CFG_SECTOR_SIZE, CFG_PAGE_SIZE, LOG_SECTORS,
+        log_erase, log_program, nullptr
+    };
+    if (!s_log.mount(f)) {
+        printf("[cfg] config log mount failed\n");
+        return false;
+    }
+    return true;
+}
+
+// Newest stored copy of a struct: its log record, else its legacy sector
+// (1 = last sector of flash; 0 = none: out's magic is cleared). The caller
+// validates magic/CRC/ranges.
+template <class T>
+static void read_config(uint16_t key, uint32_t legacy_sector, T& out) {
+    if (log_ready() && s_log.read(key, &out, sizeof(T))) return;
+    if (legacy_sector == 0) {
+        out.magic = 0;
+        return;
     }
-    return ~c;
+    uint32_t legacy = XIP_BASE + PICO_FLASH_SIZE_BYTES - legacy_sector * CFG_SECTOR_SIZE;
+    std::memcpy(&out, reinterpret_cast<const void*>(legacy), sizeof(T));
+}
+
+// Append a struct to the log (the log verifies the programmed page)
+template <class T>
+static bool write_config(uint16_t key, const T& cfg) {
+    return log_ready() && s_log.write(key, &cfg, sizeof(T));
 }
 
 bool load_scale_config(ScaleConfig& cfg) {
     ScaleConfig tmp{};
-    std::memcpy(&tmp, reinterpret_cast<const void*>(CFG_XIP_ADDR), sizeof(tmp));
+    read_config(KEY_SCALE, 1, tmp);
 
     if (tmp.magic != 0x48583133) return false;
 
-    uint32_t expected = crc32_calc(&tmp, offsetof(ScaleConfig, crc32));
+    uint32_t expected = config_crc32(&tmp, offsetof(ScaleConfig, crc32));
     if (expected != tmp.crc32) return false;
 
     cfg = tmp;
@@ -44,76 +120,68 @@ bool load_scale_config(ScaleConfig& cfg) {
 }
 
 bool save_scale_config(const ScaleConfig& cfg_in) {
-    alignas(FLASH_PAGE_SIZE) static uint8_t sector_buf[CFG_SECTOR_SIZE];
-    std::memset(sector_buf, 0xFF, sizeof(sector_buf));
-
     ScaleConfig tmp = cfg_in;
-    tmp.crc32 = crc32_calc(&tmp, offsetof(ScaleConfig, crc32));
-    std::memcpy(sector_buf, &tmp, sizeof(tmp));
+    tmp.crc32 = config_crc32(&tmp, offsetof(ScaleConfig, crc32));
+    return write_config(KEY_SCALE, tmp);
+}
 
-    uint32_t irq_state = save_and_disable_interrupts();
-    flash_range_erase(CFG_OFFSET, CFG_SECTOR_SIZE);
-    flash_range_program(CFG_OFFSET, sector_buf, CFG_SECTOR_SIZE);
-    restore_interrupts(irq_state);
+// ---- PID gain persistence ---------------------------------------------------
 
-    ScaleConfig check{};
-    std::memcpy(&check, reinterpret_cast<const void*>(CFG_XIP_ADDR), sizeof(check));
-    return (check.magic == tmp.magic) && (check.crc32 == tmp.crc32);
+// Reject garbage that happens to pass CRC-of-garbage odds: gains must be
+// finite and non-negative (NaN fails all comparisons, so use !(x >= 0)).
+static bool pid_gains_valid(float kp, float ki, float kd) {
+    if (!(kp >= 0.0f) || !(ki >= 0.0f) || !(kd >= 0.0f)) return false;
+    return kp <= 1000.0f && ki <= 1000.0f && kd <= 1000.0f;
 }
-// ---- PID gain persistence (second-to-last sector; calibration untouched) ----
-
-static constexpr uint32_t PID_CFG_OFFSET   = (PICO_FLASH_SIZE_BYTES - 2 * CFG_SECTOR_SIZE);
-static constexpr uint32_t PID_CFG_XIP_ADDR = (XIP_BASE + PID_CFG_OFFSET);
 
 bool load_pid_config(PidConfig& cfg) {
     PidConfig tmp{};
-    std::memcpy(&tmp, reinterpret_cast<const void*>(PID_CFG_XIP_ADDR), sizeof(tmp));
+    read_config(KEY_PID, 2, tmp);
 
     if (tmp.magic != 0x50494431) return false;
 
-    uint32_t expected = crc32_calc(&tmp, offsetof(PidConfig, crc32));
+    uint32_t expected = config_crc32(&tmp, offsetof(PidConfig, crc32));
     if (expected != tmp.crc32) return false;
 
-    // Reject garbage that happens to pass CRC-of-garbage odds: gains must be
-    // finite and non-negative (NaN fails all comparisons, so use !(x >= 0)).
-    if (!(tmp.kp >= 0.0f) || !(tmp.ki >= 0.0f) || !(tmp.kd >= 0.0f)) return false;
-    if (tmp.kp > 1000.0f || tmp.ki > 1000.0f || tmp.kd > 1000.0f) return false;
+    if (!pid_gains_valid(tmp.kp, tmp.ki, tmp.kd)) return false;
 
     cfg = tmp;
     return true;
 }
 
-bool save_pid_config(const PidConfig& cfg_in) {
-    alignas(FLASH_PAGE_SIZE) static uint8_t sector_buf[CFG_SECTOR_SIZE];
-    std::memset(sector_buf, 0xFF, sizeof(sector_buf));
+bool load_pid_scale_config(PidScaleConfig& cfg) {
+    PidScaleConfig tmp{};
+    read_config(KEY_PID_SCALE, 0, tmp);
+
+    if (tmp.magic != 0x50494433) return false;
 
-    PidConfig tmp = cfg_in;
-    tmp.magic = 0x50494431;
-    tmp.crc32 = crc32_calc(&tmp, offsetof(PidConfig, crc32));
-    std::memcpy(sector_buf, &tmp, sizeof(tmp));
+    uint32_t expected = config_crc32(&tmp, offsetof(PidScaleConfig, crc32));
+    if (expected != tmp.crc32) return false;
 
-    uint32_t irq_state = save_and_disable_interrupts();
-    flash_range_erase(PID_CFG_OFFSET, CFG_SECTOR_SIZE);
-    flash_range_program(PID_CFG_OFFSET, sector_buf, CFG_SECTOR_SIZE);
-    restore_interrupts(irq_state);
+    for (const PidEntry& e : tmp.entries) {
+        if (!pid_gains_valid(e.kp, e.ki, e.kd)) return false;
+    }
 
-    PidConfig check{};
-    std::memcpy(&check, reinterpret_cast<const void*>(PID_CFG_XIP_ADDR), sizeof(check));
-    return (check.magic == tmp.magic) && (check.crc32 == tmp.crc32);
+    cfg = tmp;
+    return true;
 }
 
-// ---- Per-scale content names (third-to-last sector) -------------------------
+bool save_pid_scale_config(const PidScaleConfig& cfg_in) {
+    PidScaleConfig tmp = cfg_in;
+    tmp.magic = 0x50494433;
+    tmp.crc32 = config_crc32(&tmp, offsetof(PidScaleConfig, crc32));
+    return write_config(KEY_PID_SCALE, tmp);
+}
 
-static constexpr uint32_t NAME_CFG_OFFSET   = (PICO_FLASH_SIZE_BYTES - 3 * CFG_SECTOR_SIZE);
-static constexpr uint32_t NAME_CFG_XIP_ADDR = (XIP_BASE + NAME_CFG_OFFSET);
+// ---- Per-scale content names ------------------------------------------------
 
 bool load_name_config(NameConfig& cfg) {
     NameConfig tmp{};
-    std::memcpy(&tmp, reinterpret_cast<const void*>(NAME_CFG_XIP_ADDR), sizeof(tmp));
+    read_config(KEY_NAME, 3, tmp);
 
     if (tmp.magic != 0x4E414D31) return false;
 
-    uint32_t expected = crc32_calc(&tmp, offsetof(NameConfig, crc32));
+    uint32_t expected = config_crc32(&tmp, offsetof(NameConfig, crc32));
     if (expected != tmp.crc32) return false;
 
     // Enforce termination and printable ASCII (the names travel through JSON,
@@ -130,36 +198,21 @@ bool load_name_config(NameConfig& cfg) {
 }
 
 bool save_name_config(const NameConfig& cfg_in) {
-    alignas(FLASH_PAGE_SIZE) static uint8_t sector_buf[CFG_SECTOR_SIZE];
-    std::memset(sector_buf, 0xFF, sizeof(sector_buf));
-
     NameConfig tmp = cfg_in;
     tmp.magic = 0x4E414D31;
-    tmp.crc32 = crc32_calc(&tmp, offsetof(NameConfig, crc32));
-    std::memcpy(sector_buf, &tmp, sizeof(tmp));
-
-    uint32_t irq_state = save_and_disable_interrupts();
-    flash_range_erase(NAME_CFG_OFFSET, CFG_SECTOR_SIZE);
-    flash_range_program(NAME_CFG_OFFSET, sector_buf, CFG_SECTOR_SIZE);
-    restore_interrupts(irq_state);
-
-    NameConfig check{};
-    std::memcpy(&check, reinterpret_cast<const void*>(NAME_CFG_XIP_ADDR), sizeof(check));
-    return (check.magic == tmp.magic) && (check.crc32 == tmp.crc32);
+    tmp.crc32 = config_crc32(&tmp, offsetof(NameConfig, crc32));
+    return write_config(KEY_NAME, tmp);
 }
 
-// ---- Per-servo zero angles (fourth-to-last sector) --------------------------
-
-static constexpr uint32_t SERVO_CFG_OFFSET   = (PICO_FLASH_SIZE_BYTES - 4 * CFG_SECTOR_SIZE);
-static constexpr uint32_t SERVO_CFG_XIP_ADDR = (XIP_BASE + SERVO_CFG_OFFSET);
+// ---- Per-servo zero angles ---------------------------------------------------
 
 bool load_servo_config(ServoConfig& cfg) {
     ServoConfig tmp{};
-    std::memcpy(&tmp, reinterpret_cast<const void*>(SERVO_CFG_XIP_ADDR), sizeof(tmp));
+    read_config(KEY_SERVO, 4, tmp);
 
     if (tmp.magic != 0x53525631) return false;
 
-    uint32_t expected = crc32_calc(&tmp, offsetof(ServoConfig, crc32));
+    uint32_t expected = config_crc32(&tmp, offsetof(ServoConfig, crc32));
     if (expected != tmp.crc32) return false;
 
     // Normalize per entry: anything outside 0-180 degrees (incl. NaN, which
@@ -175,36 +228,21 @@ bool load_servo_config(ServoConfig& cfg) {
 }
 
 bool save_servo_config(const ServoConfig& cfg_in) {
-    alignas(FLASH_PAGE_SIZE) static uint8_t sector_buf[CFG_SECTOR_SIZE];
-    std::memset(sector_buf, 0xFF, sizeof(sector_buf));
-
     ServoConfig tmp = cfg_in;
     tmp.magic = 0x53525631;
-    tmp.crc32 = crc32_calc(&tmp, offsetof(ServoConfig, crc32));
-    std::memcpy(sector_buf, &tmp, sizeof(tmp));
-
-    uint32_t irq_state = save_and_disable_interrupts();
-    flash_range_erase(SERVO_CFG_OFFSET, CFG_SECTOR_SIZE);
-    flash_range_program(SERVO_CFG_OFFSET, sector_buf, CFG_SECTOR_SIZE);
-    restore_interrupts(irq_state);
-
-    ServoConfig check{};
-    std::memcpy(&check, reinterpret_cast<const void*>(SERVO_CFG_XIP_ADDR), sizeof(check));
-    return (check.magic == tmp.magic) && (check.crc32 == tmp.crc32);
+    tmp.crc32 = config_crc32(&tmp, offsetof(ServoConfig, crc32));
+    return write_config(KEY_SERVO, tmp);
 }
 
-// ---- Network boot mode (fifth-to-last sector) --------------------------------
-
-static constexpr uint32_t NET_CFG_OFFSET   = (PICO_FLASH_SIZE_BYTES - 5 * CFG_SECTOR_SIZE);
-static constexpr uint32_t NET_CFG_XIP_ADDR = (XIP_BASE + NET_CFG_OFFSET);
+// ---- Network boot mode -------------------------------------------------------
 
 bool load_net_config(NetConfig& cfg) {
     NetConfig tmp{};
-    std::memcpy(&tmp, reinterpret_cast<const void*>(NET_CFG_XIP_ADDR), sizeof(tmp));
+    read_config(KEY_NET, 5, tmp);
 
     if (tmp.magic != 0x4E455431) return false;
 
-    uint32_t expected = crc32_calc(&tmp, offsetof(NetConfig, crc32));
+    uint32_t expected = config_crc32(&tmp, offsetof(NetConfig, crc32));
     if (expected != tmp.crc32) return false;
 
     if (tmp.mode > 1) return false;
@@ -214,20 +252,78 @@ bool load_net_config(NetConfig& cfg) {
 }
 
 bool save_net_config(const NetConfig& cfg_in) {
-    alignas(FLASH_PAGE_SIZE) static uint8_t sector_buf[CFG_SECTOR_SIZE];
-    std::memset(sector_buf, 0xFF, sizeof(sector_buf));
-
     NetConfig tmp = cfg_in;
     tmp.magic = 0x4E455431;
-    tmp.crc32 = crc32_calc(&tmp, offsetof(NetConfig, crc32));
-    std::memcpy(sector_buf, &tmp, sizeof(tmp));
+    tmp.crc32 = config_crc32(&tmp, offsetof(NetConfig, crc32));
+    return write_config(KEY_NET, tmp);
+}
+
+// ---- Recipe book -------------------------------------------------------------
+
+bool load_recipe_config(RecipeConfig& cfg) {
+    RecipeConfig tmp{};
+    read_config(KEY_RECIPE, 0, tmp);
+
+    if (tmp.magic != 0x52435031) return false;
+
+    uint32_t expected = config_crc32(&tmp, offsetof(RecipeConfig, crc32));
+    if (expected != tmp.crc32) return false;
+
+    // Per recipe: an out-of-range item empties that slot only. Names get the
+    // same treatment as the scale names (JSON, LCD).
+    for (Recipe& r : tmp.recipes) {
+        r.name[RECIPE_NAME_LEN - 1] = '\0';
+        for (char* p = r.name; *p; ++p) {
+            if (*p < 0x20 || *p > 0x7E) { *p = '\0'; break; }
+        }
+        bool ok = r.count <= RECIPE_ITEMS;
+        for (int i = 0; ok && i < r.count; i++) {
+            ok = r.items[i].scale <= 2 && r.items[i].stage <= 2;
+        }
+        if (!ok) r = Recipe{};
+    }
 
-    uint32_t irq_state = save_and_disable_interrupts();
-    flash_range_erase(NET_CFG_OFFSET, CFG_SECTOR_SIZE);
-    flash_range_program(NET_CFG_OFFSET, sector_buf, CFG_SECTOR_SIZE);
-    restore_interrupts(irq_state);
+    cfg = tmp;
+    return true;
+}
+
+bool save_recipe_config(const RecipeConfig& cfg_in) {
+    RecipeConfig tmp = cfg_in;
+    tmp.magic = 0x52435031;
+    tmp.crc32 = config_crc32(&tmp, offsetof(RecipeConfig, crc32));
+    return write_config(KEY_RECIPE, tmp);
+}
+
+// ---- Bag log -----------------------------------------------------------------
+
+bool load_bag_config(BagConfig& cfg) {
+    BagConfig tmp{};
+    read_config(KEY_BAG, 0, tmp);
+
+    if (tmp.magic != 0x42414731) return false;
+
+    uint32_t expected = config_crc32(&tmp, offsetof(BagConfig, crc32));
+    if (expected != tmp.crc32) return false;
+
+    for (uint16_t& r : tmp.log.reserve_g) {
+        if (r > 20000) r = 0;   // default
+    }
+    // Days must run oldest first, unused ones at the end: from the first one
+    // out of order on, the log is dropped
+    BagDay* d = tmp.log.days;
+    bool end = false;
+    for (int k = 0; k < BAG_DAYS; k++) {
+        end = end || d[k].day == 0 || (k > 0 && d[k].day <= d[k - 1].day);
+        if (end) d[k] = BagDay{};
+    }
+
+    cfg = tmp;
+    return true;
+}
 
-    NetConfig check{};
-    std::memcpy(&check, reinterpret_cast<const void*>(NET_CFG_XIP_ADDR), sizeof(check));
-    return (check.magic == tmp.magic) && (check.crc32 == tmp.crc32);
+bool save_bag_config(const BagConfig& cfg_in) {
+    BagConfig tmp = cfg_in;
+    tmp.magic = 0x42414731;
+    tmp.crc32 = config_crc32(&tmp, offsetof(BagConfig, crc32));
+    return write_config(KEY_BAG, tmp);
 }
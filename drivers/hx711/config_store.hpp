@@ -1,5 +1,11 @@
 #pragma once
 #include <cstdint>
+#include "dispenser_state.h"   // Recipe, BagLog
+
+// Persistent config structs. Every save appends one CRC-checked record to a
+// wear-leveled log in the last flash sectors (config_log.hpp): one page program
+// instead of a sector erase, and a power cut mid-save keeps the previous copy.
+// Each struct still carries its own magic + crc32, checked on load.
 
 // Stores calibration for up to 3 HX711 instances
 struct ScaleEntry {
@@ -16,8 +22,9 @@ struct ScaleConfig {
 bool load_scale_config(ScaleConfig& cfg);
 bool save_scale_config(const ScaleConfig& cfg);
 
-// PID tuning gains, persisted in the second-to-last flash sector (the scale
-// calibration above owns the last sector and is never touched by these).
+// PID tuning gains, one set for all scales. Superseded by PidScaleConfig:
+// only read now, as the starting gains of every scale on a unit that has
+// no per-scale record yet.
 struct PidConfig {
     uint32_t magic = 0x50494431;   // "PID1"
     float kp = 0.0f;
@@ -27,10 +34,26 @@ struct PidConfig {
 };
 
 bool load_pid_config(PidConfig& cfg);
-bool save_pid_config(const PidConfig& cfg);
 
-// Per-scale content names ("Wheat", "Spelt", ...), persisted in the
-// third-to-last flash sector. Changed whenever a bag is swapped.
+// PID tuning gains per scale (each gate and grain is tuned on its own). Log
+// only.
+struct PidEntry {
+    float kp = 0.0f;
+    float ki = 0.0f;
+    float kd = 0.0f;
+};
+
+struct PidScaleConfig {
+    uint32_t magic = 0x50494433;   // "PID3"
+    PidEntry entries[3];
+    uint32_t crc32 = 0;
+};
+
+bool load_pid_scale_config(PidScaleConfig& cfg);
+bool save_pid_scale_config(const PidScaleConfig& cfg);
+
+// Per-scale content names ("Wheat", "Spelt", ...). Changed whenever a bag is
+// swapped.
 inline constexpr int SCALE_NAME_LEN = 16;   // 15 chars + NUL
 
 struct NameConfig {
@@ -42,8 +65,8 @@ struct NameConfig {
 bool load_name_config(NameConfig& cfg);
 bool save_name_config(const NameConfig& cfg);
 
-// Per-servo flow-start ("zero") angle in degrees, persisted in the
-// fourth-to-last flash sector. open_deg < 0 = servo not calibrated.
+// Per-servo flow-start ("zero") angle in degrees. open_deg < 0 = servo not
+// calibrated.
 struct ServoConfig {
     uint32_t magic = 0x53525631;   // "SRV1"
     float open_deg[3] = {-1.0f, -1.0f, -1.0f};
@@ -53,8 +76,8 @@ struct ServoConfig {
 bool load_servo_config(ServoConfig& cfg);
 bool save_servo_config(const ServoConfig& cfg);
 
-// Network boot mode, persisted in the fifth-to-last flash sector. Chosen on
-// the LCD at boot (encoder); the last choice is the default for next boot.
+// Network boot mode. Chosen on the LCD at boot (encoder); the last choice is
+// the default for next boot.
 struct NetConfig {
     uint32_t magic = 0x4E455431;   // "NET1"
     uint8_t  mode = 0;             // 0 = home WiFi (STA), 1 = hotspot (AP)
@@ -65,6 +88,30 @@ struct NetConfig {
 bool load_net_config(NetConfig& cfg);
 bool save_net_config(const NetConfig& cfg);
 
+// Recipe book (Recipe in dispenser_state.h). Log only: it came after the
+// legacy one-sector-per-struct layout. Must fit one record page.
+struct RecipeConfig {
+    uint32_t magic = 0x52435031;   // "RCP1"
+    Recipe   recipes[RECIPE_SLOTS];
+    uint32_t crc32 = 0;
+};
+static_assert(sizeof(RecipeConfig) <= 240, "RecipeConfig must fit one config log page");
+
+bool load_recipe_config(RecipeConfig& cfg);
+bool save_recipe_config(const RecipeConfig& cfg);
+
+// Bag reserves and the consumption log (BagLog in dispenser_state.h). Log
+// only, saved every few minutes while it changes. Must fit one record page.
+struct BagConfig {
+    uint32_t magic = 0x42414731;   // "BAG1"
+    BagLog   log;
+    uint32_t crc32 = 0;
+};
+static_assert(sizeof(BagConfig) <= 240, "BagConfig must fit one config log page");
+
+bool load_bag_config(BagConfig& cfg);
+bool save_bag_config(const BagConfig& cfg);
+
 template <class HX711>
 inline void apply_scale_config(HX711& scale, const ScaleEntry& e) {
     scale.set_offset(e.offset_counts);
@@ -12,6 +12,8 @@
 #include "pico/time.h"
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/timer.h"
 #include "hx711_reader.pio.h"
 #include <algorithm>
 #include <numeric>
@@ -32,20 +34,166 @@ hx711::hx711(uint clockPin, uint dataPin)
 
 ///////////////////////////////////////////////////////////////
 //
-//  READ
+//  CAPTURE
 //
-//  From datasheet page 4
-int32_t hx711::read_raw_hx711()
+// Two chained DMA channels per scale, re-triggering each other forever:
+//   raw: PIO RX FIFO -> ring raw word, paced by the SM's RX DREQ, 1 transfer
+//   ts : timer_hw->timerawl -> ring stamp, unpaced, 1 transfer
+// raw completes, chains to ts (stamp taken ~100 ns after the word left the
+// FIFO), ts completes, chains back to raw which waits for the next DREQ. Both
+// write with address wrap, so ts's write pointer is the ring head. No IRQ and
+// no CPU time per conversion; the RX FIFO never overflows even if the main
+// loop stalls in a blocking screen (only the ring can lap - see sample_ring).
+bool hx711::start_capture()
 {
-    uint32_t raw = pio_sm_get_blocking(pio_, sm_);
+    if (dma_raw_ >= 0) return true;
+
+    int a = dma_claim_unused_channel(false);
+    int b = dma_claim_unused_channel(false);
+    if (a < 0 || b < 0) {
+        if (a >= 0) dma_channel_unclaim(a);
+        if (b >= 0) dma_channel_unclaim(b);
+        printf("[hx711] no free DMA channel for DT pin %u, polling FIFO\n", dataPin_);
+        return false;
+    }
 
-    // Sign-extend 24 → 32 bits
-    if (raw & 0x00800000)
-    {
-        raw |= 0xFF000000;
+    // Hand-over: anything already in the ring/FIFO keeps its ordering
+    pump_fifo();
+    int32_t newest;
+    if (drain_newest(newest)) {
+        last_raw_ = newest;
+        has_last_ = true;
+    }
+    ring_.reset();
+
+    dma_channel_config c = dma_channel_get_default_config(a);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, ring_.RING_BITS);
+    channel_config_set_dreq(&c, pio_get_dreq(pio_, sm_, false));
+    channel_config_set_chain_to(&c, b);
+    dma_channel_configure(a, &c, ring_.raw_words(), &pio_->rxf[sm_], 1, false);
+
+    c = dma_channel_get_default_config(b);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, ring_.RING_BITS);
+    channel_config_set_chain_to(&c, a);
+    dma_channel_configure(b, &c, ring_.stamps(), &timer_hw->timerawl, 1, false);
+
+    dma_raw_ = a;
+    dma_ts_  = b;
+    dma_channel_start(a);
+    return true;
+}
+
+uint32_t hx711::ring_head() const
+{
+    if (dma_ts_ < 0) return ring_.soft_head();
+    uintptr_t w = (uintptr_t)dma_hw->ch[dma_ts_].write_addr;
+    return (uint32_t)((w - (uintptr_t)ring_.stamps()) / sizeof(uint32_t));
+}
+
+void hx711::pump_fifo()
+{
+    if (dma_raw_ >= 0) return;
+    while (!pio_sm_is_rx_fifo_empty(pio_, sm_))
+        ring_.push(pio_sm_get(pio_, sm_), time_us_32());
+}
+
+uint32_t hx711::read_samples(HxSample* out, uint32_t max)
+{
+    pump_fifo();
+    uint32_t n = ring_.read(ring_head(), out, max);
+    for (uint32_t i = 0; i < n; i++) {
+        track_period(out[i].t_us);
+        op_feed(out[i]);
+    }
+    if (op_state_ == HxOpStatus::Busy && time_us_32() - op_last_us_ > OP_TIMEOUT_US) {
+        printf("[hx711] %s timeout on DT pin %u\n",
+               op_kind_ == OP_TARE ? "tare" : "calibrate", dataPin_);
+        op_state_ = HxOpStatus::Failed;
+    }
+    if (n) {
+        last_raw_  = out[n - 1].raw;
+        last_t_us_ = out[n - 1].t_us;
+        has_last_  = true;
+    }
+    return n;
+}
+
+// Smoothed conversion period (1/8 weight per sample). Gaps longer than 4x
+// the current estimate are capture holes (overrun, power_down), not periods.
+void hx711::track_period(uint32_t t_us)
+{
+    uint32_t dt = t_us - prev_t_us_;
+    prev_t_us_ = t_us;
+    if (dt == 0 || dt > 4 * period_us_) return;
+    period_us_ = (uint32_t)((int32_t)period_us_ + ((int32_t)dt - (int32_t)period_us_) / 8);
+}
+
+///////////////////////////////////////////////////////////////
+//
+//  RATE / FILTER
+//
+void hx711::set_rate(uint ratePin, bool fast)
+{
+    gpio_init(ratePin);
+    gpio_set_dir(ratePin, GPIO_OUT);
+    gpio_put(ratePin, fast);
+    fast_ = fast;
+    period_us_ = fast ? 12500 : 100000;
+
+    // Datasheet: output settles within 4 conversions of a rate change -
+    // wait those out and forget everything captured at the old rate
+    sleep_us(4 * period_us_ + 10000);
+    pump_fifo();
+    ring_.skip_to(ring_head());
+    prev_t_us_ = 0;
+    filter_.reset();
+    has_filt_ = false;
+}
+
+void hx711::set_filter(const WeightFilterConfig& cfg)
+{
+    filter_.configure(cfg);
+    has_filt_ = false;
+}
+
+bool hx711::drain_filtered(int32_t& value)
+{
+    HxSample buf[16];
+    uint32_t n;
+    bool got = false;
+    while ((n = read_samples(buf, 16)) > 0) {
+        got = true;
+        for (uint32_t i = 0; i < n; i++) {
+            int32_t y;
+            if (filter_.push(buf[i].raw, y)) {
+                filt_raw_  = y;
+                filt_t_us_ = buf[i].t_us;
+                has_filt_  = true;
+            }
+        }
     }
+    if (!has_filt_) return false;
+    value = filt_raw_;
+    last_t_us_ = filt_t_us_;   // stamp of the conversion the value ends on
+    return got;
+}
 
-    return static_cast<int32_t>(raw);
+///////////////////////////////////////////////////////////////
+//
+//  READ
+//
+//  From datasheet page 4
+int32_t hx711::read_raw_hx711()
+{
+    int32_t v;
+    while (!read_raw_timeout(v, 1000000)) {}
+    return v;
 }
 
 // Wait up to timeout_us for a conversion. A disconnected/unpowered HX711 never
@@ -54,24 +202,30 @@ int32_t hx711::read_raw_hx711()
 bool hx711::read_raw_timeout(int32_t& out, uint32_t timeout_us)
 {
     absolute_time_t deadline = make_timeout_time_us(timeout_us);
-    while (pio_sm_is_rx_fifo_empty(pio_, sm_))
+    HxSample s;
+    while (read_samples(&s, 1) == 0)
     {
         if (time_reached(deadline)) return false;
         tight_loop_contents();
     }
-    uint32_t raw = pio_sm_get(pio_, sm_);
-    if (raw & 0x00800000) raw |= 0xFF000000;
-    out = static_cast<int32_t>(raw);
+    out = s.raw;
     return true;
 }
 
-// FIFO discard before reading average. Returns NAN if the sensor produces no
-// data (disconnected) so callers can abort instead of freezing the firmware.
+// Backlog + settling discard before reading average. Returns NAN if the sensor
+// produces no data (disconnected) so callers can abort instead of freezing the
+// firmware. At 80 SPS both counts are scaled 8x so the averaging window (and
+// with it the noise of tare/calibration) stays what it was at 10 SPS.
 float hx711::calibr_read_average(uint8_t times)
 {
-    const uint32_t discardReads = 6;
+    const int os = fast_ ? 8 : 1;
+    const int discardReads = 6 * os;
+    const int n = times * os;
+    pump_fifo();
+    ring_.skip_to(ring_head());     // the ring may hold >1 s of stale samples
+    prev_t_us_ = 0;
     int64_t sum = 0;                 // accumulate in wider int
-    for (uint8_t i = 0; i < times + discardReads; i++)
+    for (int i = 0; i < n + discardReads; i++)
     {
         int32_t v;
         if (!read_raw_timeout(v, 150000)) {
@@ -80,7 +234,7 @@ float hx711::calibr_read_average(uint8_t times)
         }
         if (i >= discardReads) sum += v;
     }
-    float calibration = (float)sum / (float)times;
+    float calibration = (float)sum / (float)n;
     printf("Calibration read average : %.6f\n", calibration);
     return calibration;
 }
@@ -89,17 +243,16 @@ float hx711::calibr_read_average(uint8_t times)
 //
 //  MODE
 //
-// Drain the RX FIFO, keeping only the newest queued sample. The HX711 free-runs
-// at ~10 SPS into a 4-deep FIFO; when consumed slower than that, the oldest
-// entry is ~1 s stale - always skip to the freshest.
-bool hx711::drain_fifo(int32_t& newest)
+// Drain the ring, keeping only the newest queued sample. The HX711 free-runs
+// at 10 or 80 SPS; when consumed slower than that, the oldest entry is stale -
+// always skip to the freshest.
+bool hx711::drain_newest(int32_t& newest)
 {
+    HxSample buf[16];
+    uint32_t n;
     bool got = false;
-    while (!pio_sm_is_rx_fifo_empty(pio_, sm_))
-    {
-        uint32_t raw = pio_sm_get(pio_, sm_);
-        if (raw & 0x00800000) raw |= 0xFF000000;
-        newest = (int32_t)raw;
+    while ((n = read_samples(buf, 16)) > 0) {
+        newest = buf[n - 1].raw;
         got = true;
     }
     return got;
@@ -109,7 +262,7 @@ float hx711::read_weight(int samples /*=1*/)
 {
     if (samples < 1) samples = 1;
 
-    // ~150 ms covers one conversion at 10 SPS with margin
+    // ~150 ms covers one conversion at 10 SPS (the slow rate) with margin
     constexpr uint32_t SAMPLE_TIMEOUT_US = 150000;
 
     if (samples == 1)
@@ -117,28 +270,31 @@ float hx711::read_weight(int samples /*=1*/)
         // Freshest-available, non-blocking once a first sample exists:
         // take the newest queued sample, else keep the last known one.
         int32_t v;
-        if (drain_fifo(v)) {
+        bool got = filter_.passthrough() ? drain_newest(v) : drain_filtered(v);
+        if (got) {
+            if (last_t_us_ != prev_update_t_) updates_++;
+            prev_update_t_ = last_t_us_;
             last_raw_ = v;
             has_last_ = true;
         } else if (!has_last_) {
-            // Very first read: wait one conversion, but never hang on a dead
-            // sensor - probe again at most every 2 s and report 0 g meanwhile
-            if (!time_reached(next_probe_)) return 0.0f;
-            if (read_raw_timeout(v, SAMPLE_TIMEOUT_US)) {
-                last_raw_ = v;
-                has_last_ = true;
-            } else {
+            // Nothing captured yet: report 0 g without waiting - this runs
+            // inside the control core's period. A sensor that stays silent
+            // (disconnected/unpowered) is reported every 2 s.
+            if (is_nil_time(next_probe_)) {
+                next_probe_ = make_timeout_time_ms(2000);
+            } else if (time_reached(next_probe_)) {
                 printf("[hx711] no data on DT pin %u (sensor disconnected?)\n", dataPin_);
                 next_probe_ = make_timeout_time_ms(2000);
-                return 0.0f;
             }
+            return 0.0f;
         }
     }
     else
     {
         // Averaged read: discard the stale backlog, then wait for fresh samples
-        int32_t dump;
-        drain_fifo(dump);
+        pump_fifo();
+        ring_.skip_to(ring_head());
+        prev_t_us_ = 0;
         int64_t sum = 0;
         int got = 0;
         for (int i = 0; i < samples; ++i) {
@@ -210,13 +366,14 @@ float hx711::read_weight_trimmed_mavg()
 void hx711::tare(int samples)
 {
     if (samples < 1) samples = 7;
-    float avg = calibr_read_average((uint8_t)samples);
-    if (avg != avg) {   // NAN - dead sensor, keep the previous offset
-        printf("Tare skipped: no sensor data\n");
-        return;
-    }
-    offset_ = (int32_t)avg;
-    printf("Tare Offset : %d\n",offset_);
+    if (!begin_tare(samples)) return;
+    while (poll_op() == HxOpStatus::Busy) tight_loop_contents();
+}
+
+bool hx711::begin_tare(int samples, int discard)
+{
+    if (samples < 1) samples = 7;
+    return begin_op(OP_TARE, samples, discard);
 }
 
 // Return the tare offset expressed in grams
@@ -272,23 +429,107 @@ int32_t hx711::get_cal_offset() const
 // Assumes tare() has been set.
 // Use calibration averaging & discard ONLY here
 void hx711::calibrate_scale(float known_grams, int samples /*=10*/)
+{
+    if (!begin_calibrate(known_grams, samples)) return;
+    while (poll_op() == HxOpStatus::Busy) tight_loop_contents();
+}
+
+bool hx711::begin_calibrate(float known_grams, int samples, int discard)
 {
     if (samples < 1) samples = 7;
-    if (known_grams <= 0.0f) return;   // ignore bad input
+    if (known_grams <= 0.0f) return false;   // ignore bad input
     printf("Known gramms : %6.f\n",known_grams);
-    // Assumes you've already called tare()
-    float avg_f = calibr_read_average((uint8_t)samples);
-    if (avg_f != avg_f) {   // NAN - dead sensor, leave calibration unchanged
-        printf("Calibrate skipped: no sensor data\n");
+    if (!begin_op(OP_CAL, samples, discard)) return false;
+    op_known_g_ = known_grams;
+    return true;
+}
+
+///////////////////////////////////////////////////////////////
+//
+//  INCREMENTAL OPS
+//
+// Tare/calibration used to block in calibr_read_average for ~1.6 s: LCD,
+// web queue and PID all froze. Now the averaging rides on the conversions
+// the loop reads anyway. Same window as before - 6 settling discards, then
+// the average of `samples`, both x8 at 80 SPS - just spread across ticks.
+bool hx711::begin_op(uint8_t kind, int samples, int discard)
+{
+    if (op_state_ == HxOpStatus::Busy) return false;
+    const int os = fast_ ? 8 : 1;
+    if (discard < 0) discard = 0;
+    op_kind_    = kind;
+    op_discard_ = discard * os;
+    op_need_    = samples * os;
+    op_got_     = 0;
+    op_sum_     = 0;
+    op_last_us_ = time_us_32();
+    op_state_   = HxOpStatus::Busy;
+    // Only conversions taken from now on count (the ring may hold >1 s of
+    // stale ones)
+    pump_fifo();
+    ring_.skip_to(ring_head());
+    prev_t_us_ = 0;
+    return true;
+}
+
+void hx711::op_feed(const HxSample& s)
+{
+    if (op_state_ != HxOpStatus::Busy) return;
+    op_last_us_ = time_us_32();
+    if (op_discard_ > 0) {
+        op_discard_--;
+        return;
+    }
+    op_sum_ += s.raw;
+    if (++op_got_ >= op_need_) op_finish();
+}
+
+void hx711::op_finish()
+{
+    int32_t avg = (int32_t)(op_sum_ / op_got_);
+    printf("Calibration read average : %d\n", avg);
+    if (op_kind_ == OP_TARE) {
+        offset_ = avg;
+        printf("Tare Offset : %d\n",offset_);
+        op_state_ = HxOpStatus::Done;
         return;
     }
-    int32_t avg = (int32_t)avg_f;
     int32_t net = avg - offset_;                // counts due to known_grams
-    float cpg = (float)net / known_grams;       // counts per gram
-    if (cpg <= 0.0f) cpg = 1.0f;
+    float cpg = (float)net / op_known_g_;       // counts per gram
+    if (cpg <= 0.0f) {
+        // Weight not on the scale (or tare missing) - keep the old scale
+        // rather than the 1.0 placeholder that reads every load as counts
+        printf("Calibrate failed: cpg %f\n", cpg);
+        op_state_ = HxOpStatus::Failed;
+        return;
+    }
     printf("cpg : %6f\n", cpg);
     printf("offset : %d\n", offset_);
     scale_cpg_ = cpg;
+    op_state_ = HxOpStatus::Done;
+}
+
+HxOpStatus hx711::poll_op()
+{
+    HxOpStatus st = op_state_;
+    if (st == HxOpStatus::Busy) {
+        // Feeds the op through the normal read path (filter state included)
+        read_weight(1);
+        st = op_state_;
+    }
+    if (st == HxOpStatus::Done || st == HxOpStatus::Failed) op_state_ = HxOpStatus::Idle;
+    return st;
+}
+
+int hx711::op_progress() const
+{
+    if (op_need_ <= 0) return 0;
+    return op_got_ * 100 / op_need_;
+}
+
+void hx711::cancel_op()
+{
+    op_state_ = HxOpStatus::Idle;
 }
 
 ///////////////////////////////////////////////////////////////
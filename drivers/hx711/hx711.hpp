@@ -3,6 +3,14 @@
 #include <cstdint>
 #include "hardware/pio.h"
 #include "pico/time.h"
+#include "sample_ring.hpp"
+#include "weight_filter.hpp"
+
+// Conversions buffered per scale: 1.6 s at 80 SPS, 12.8 s at 10 SPS
+inline constexpr uint32_t HX711_RING_LEN = 128;
+
+// Incremental tare/calibration (see begin_tare)
+enum class HxOpStatus : uint8_t { Idle, Busy, Done, Failed };
 
 class hx711
 {
@@ -21,14 +29,58 @@ public:
     //  Returns NAN when the sensor produces no data.
     float   calibr_read_average(uint8_t times);
 
+    ///////////////////////////////////////////////////////
+    //
+    //  CAPTURE
+    //
+    //  Every conversion lands in a per-scale ring with a microsecond capture
+    //  stamp (see sample_ring.hpp). start_capture() hands the PIO RX FIFO to a
+    //  DMA chain so nothing is lost however late the main loop reads; without it
+    //  (or when no DMA channel is free: returns false) the FIFO is polled into
+    //  the same ring on every read, stamped at poll time.
+    bool     start_capture();
+    //  All conversions since the previous read, oldest first (up to max; the
+    //  remainder stays queued). Never blocks. The newest one becomes the sample
+    //  read_weight()/last_gross() report.
+    uint32_t read_samples(HxSample* out, uint32_t max);
+    //  Capture stamp (time_us_32) of the sample read_weight last used
+    uint32_t last_sample_us() const { return last_t_us_; }
+    //  Conversions lost because the consumer fell a full ring behind
+    uint32_t capture_overruns() const { return ring_.overruns(); }
+
+    ///////////////////////////////////////////////////////
+    //
+    //  RATE / FILTER
+    //
+    //  RATE pin high = 80 SPS, low = 10 SPS (datasheet p.1). The pin is only
+    //  driven if wired to a GPIO; boards with RATE strapped to GND stay at 10.
+    //  Switching flushes the ring and filter (the first conversions after a
+    //  rate change are unsettled).
+    void     set_rate(uint ratePin, bool fast);
+    bool     high_rate() const { return fast_; }
+    //  Measured conversion period from the capture stamps (nominal until
+    //  enough samples were seen)
+    uint32_t sample_period_us() const { return period_us_; }
+    //  Filter chain applied by read_weight(1) (see weight_filter.hpp).
+    //  Averaged reads, tare and calibration stay unfiltered.
+    void     set_filter(const WeightFilterConfig& cfg);
+    //  Period of read_weight(1) updates: conversion period x decimation
+    uint32_t output_period_us() const { return period_us_ * filter_.config().decimate; }
+    //  Filter latency behind the newest conversion
+    uint32_t filter_latency_us() const { return (uint32_t)(filter_.delay_samples() * period_us_); }
+    //  Increments with every new value read_weight(1) picks up - lets a
+    //  control loop act on fresh data only
+    uint32_t updates() const { return updates_; }
+
     ///////////////////////////////////////////////////////
     //
     //  MODE
     //
-    //  read_weight(1) is non-blocking after the first call: it drains the PIO RX
-    //  FIFO and uses the NEWEST queued sample (the HX711 free-runs at ~10 SPS and
-    //  the 4-deep FIFO otherwise serves ~1 s old readings). samples>1 discards the
-    //  backlog, then blocks for that many fresh conversions.
+    //  read_weight(1) never blocks: it drains the ring and uses the NEWEST
+    //  sample (use read_samples() for the full history), 0 g until the first
+    //  conversion arrived.
+    //  samples>1 discards the backlog, then blocks for that many fresh
+    //  conversions.
     float  read_weight(int samples = 1);
     //  Gross (absolute) weight from the same sample read_weight last used, computed
     //  against the CALIBRATED zero - unaffected by tare(). E.g. the corn bag's true
@@ -41,7 +93,14 @@ public:
     //
     //  TARE
     //
+    //  Blocking: begin_tare + poll_op until finished (~1.6 s at defaults)
     void    tare(int samples = 10);
+    //  Non-blocking: collects `samples` conversions (after `discard` settling
+    //  ones; both x8 at 80 SPS) from whatever reads happen anyway - every
+    //  read_weight/read_samples call feeds it. Call poll_op() once per loop
+    //  tick; it also keeps the op fed when nothing else reads. offset_ only
+    //  changes when the op completes. False if another op is still running.
+    bool    begin_tare(int samples = 10, int discard = 6);
     float   get_tare();
     bool    tare_set();
 
@@ -66,6 +125,17 @@ public:
     //  scale is calculated.
     //  Calibrate: known weight in grams, compute counts_per_gram
     void   calibrate_scale(float known_grams, int samples = 10);
+    //  Non-blocking variant, same rules as begin_tare
+    bool   begin_calibrate(float known_grams, int samples = 10, int discard = 6);
+
+    //  Busy while an op runs; returns Done/Failed exactly ONCE when it ends
+    //  (then Idle). Failed = no conversion for 500 ms (dead sensor) or a bad
+    //  result; the previous offset/scale are kept.
+    HxOpStatus poll_op();
+    //  0..100 % of the samples collected
+    int    op_progress() const;
+    bool   op_busy() const { return op_state_ == HxOpStatus::Busy; }
+    void   cancel_op();
 
     ///////////////////////////////////////////////////////////////
     //
@@ -81,8 +151,45 @@ private:
     static inline bool programLoaded = false;
     static inline uint programOffset = 0;
 
-    // Drain the RX FIFO keeping only the newest queued sample; true if any was queued
-    bool drain_fifo(int32_t& newest);
+    // Drain the ring keeping only the newest queued sample; true if any was queued
+    bool drain_newest(int32_t& newest);
+    // Ring producer position (DMA write pointer, or the software head)
+    uint32_t ring_head() const;
+    // No-DMA fallback: move queued FIFO words into the ring, stamped now
+    void pump_fifo();
+    // Drain the ring through filter_; true if any conversion was consumed
+    bool drain_filtered(int32_t& value);
+    void track_period(uint32_t t_us);
+    bool begin_op(uint8_t kind, int samples, int discard);
+    void op_feed(const HxSample& s);
+    void op_finish();
+
+    SampleRing<HX711_RING_LEN> ring_;
+    int      dma_raw_ = -1;   // PIO RX FIFO -> ring_ raw words
+    int      dma_ts_  = -1;   // timer -> ring_ stamps (chained after each word)
+    uint32_t last_t_us_ = 0;
+
+    WeightFilter filter_;
+    int32_t  filt_raw_  = 0;
+    uint32_t filt_t_us_ = 0;
+    bool     has_filt_  = false;
+    uint32_t updates_   = 0;
+    uint32_t prev_update_t_ = 0;
+    bool     fast_      = false;
+    uint32_t period_us_ = 100000;   // 10 SPS nominal
+    uint32_t prev_t_us_ = 0;
+
+    // --- Incremental tare/calibration state ---
+    static constexpr uint8_t  OP_TARE = 0, OP_CAL = 1;
+    static constexpr uint32_t OP_TIMEOUT_US = 500000;
+    HxOpStatus op_state_  = HxOpStatus::Idle;
+    uint8_t  op_kind_     = OP_TARE;
+    int      op_discard_  = 0;
+    int      op_need_     = 0;
+    int      op_got_      = 0;
+    int64_t  op_sum_      = 0;
+    float    op_known_g_  = 0.0f;
+    uint32_t op_last_us_  = 0;   // start, then last fed conversion (timeout)
 
     uint    clockPin_;
     uint    dataPin_;
@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Timestamped HX711 conversion ring, one per scale.
+//
+// Single producer, single consumer, no locks:
+//   - Producer: a two-channel DMA chain (hx711::start_capture) - channel A moves
+//     one word PIO RX FIFO -> raw_[], then chains to channel B, which copies the
+//     1 MHz timer's low word -> t_[] and chains back to A. Both channels write
+//     with address wrap, so the slot after the last COMPLETE entry is simply
+//     channel B's write pointer. Without DMA (no free channel) the software
+//     push() below plays the same role, fed from the polled FIFO.
+//   - Consumer: read(), called from the main loop with the producer's current
+//     slot. The raw word lands before its timestamp, so a slot below the head is
+//     always complete.
+//
+// Nothing here touches Pico SDK headers: the ring builds and runs on a host.
+//
+// Lap detection: the slot just before tail_ still holds the newest sample the
+// consumer took (last_t_). If the producer went a full lap around, that stamp
+// has been overwritten - the backlog is discarded down to the N-1 newest
+// complete entries and counted in overruns(). Consumers must therefore read at
+// least once per N-1 conversions (N = 128: 1.6 s at 80 SPS, 12.8 s at 10 SPS).
+
+struct HxSample {
+    int32_t  raw;    // sign-extended 24-bit conversion
+    uint32_t t_us;   // capture time, low word of the 1 MHz system timer
+};
+
+template <uint32_t N>
+class SampleRing {
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "ring length must be a power of two");
+
+    static constexpr uint32_t log2(uint32_t v) { return v > 1 ? 1 + log2(v >> 1) : 0; }
+
+public:
+    static constexpr uint32_t LEN  = N;
+    static constexpr uint32_t MASK = N - 1;
+    // DMA address-wrap size (bytes, log2) for either array
+    static constexpr uint32_t RING_BITS = log2(N * sizeof(uint32_t));
+
+    SampleRing() { reset(); }
+
+    // Forget everything queued and restart both producer and consumer at slot 0
+    // (the DMA chain is (re)started with its write pointers at the array bases).
+    void reset() {
+        tail_ = 0;
+        last_t_ = SENTINEL;
+        t_[MASK] = SENTINEL;   // lap detector: overwritten only by a full lap
+        head_.store(0, std::memory_order_relaxed);
+        overruns_ = 0;
+    }
+
+    // DMA targets (must stay 2^RING_BITS aligned - see alignas below)
+    volatile uint32_t* raw_words() { return raw_; }
+    volatile uint32_t* stamps()    { return t_; }
+    const volatile uint32_t* stamps() const { return t_; }
+
+    // Software producer: same write order as the DMA chain (raw, stamp, then
+    // publish), so the consumer cannot tell the two apart.
+    void push(uint32_t raw, uint32_t t_us) {
+        uint32_t h = head_.load(std::memory_order_relaxed);
+        raw_[h & MASK] = raw;
+        t_[h & MASK]   = t_us;
+        head_.store(h + 1, std::memory_order_release);
+    }
+    // Software producer's next write slot (unwrapped; read() masks it)
+    uint32_t soft_head() const { return head_.load(std::memory_order_acquire); }
+
+    // Copy up to max complete entries, oldest first, from the consumer position
+    // up to (excluding) slot `head`. Returns the number copied; the rest stays
+    // queued for the next call.
+    uint32_t read(uint32_t head, HxSample* out, uint32_t max) {
+        head &= MASK;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (t_[(tail_ - 1) & MASK] != last_t_) {
+            // Lapped: slot `head` itself may already hold the next raw word with
+            // a stale stamp, so the oldest trustworthy entry is head + 1
+            overruns_++;
+            tail_ = (head + 1) & MASK;
+        }
+
+        uint32_t avail = (head - tail_) & MASK;
+        uint32_t n = avail < max ? avail : max;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t slot = (tail_ + i) & MASK;
+            uint32_t raw = raw_[slot];
+            if (raw & 0x00800000) raw |= 0xFF000000;   // sign-extend 24 -> 32 bits
+            out[i].raw  = (int32_t)raw;
+            out[i].t_us = t_[slot];
+        }
+        if (n) {
+            tail_ = (tail_ + n) & MASK;
+            last_t_ = out[n - 1].t_us;
+        }
+        return n;
+    }
+
+    // Drop everything queued up to slot `head` (stale backlog)
+    void skip_to(uint32_t head) {
+        head &= MASK;
+        if (head == tail_) return;
+        tail_ = head;
+        last_t_ = t_[(head - 1) & MASK];
+    }
+
+    // Entries waiting below slot `head`
+    uint32_t pending(uint32_t head) const { return ((head & MASK) - tail_) & MASK; }
+
+    uint32_t overruns() const { return overruns_; }
+
+private:
+    static constexpr uint32_t SENTINEL = 0xFFFFFFFFu;
+
+    alignas(N * sizeof(uint32_t)) volatile uint32_t raw_[N] = {};
+    alignas(N * sizeof(uint32_t)) volatile uint32_t t_[N]   = {};
+
+    std::atomic<uint32_t> head_{0};   // software producer only
+    uint32_t tail_   = 0;             // consumer position (slot)
+    uint32_t last_t_ = SENTINEL;      // stamp of the newest consumed entry
+    uint32_t overruns_ = 0;
+};
@@ -0,0 +1,75 @@
+#include "weight_filter.hpp"
+
+void WeightFilter::configure(const WeightFilterConfig& cfg)
+{
+    cfg_ = cfg;
+    if (cfg_.median < 1) cfg_.median = 1;
+    if (cfg_.median > WEIGHT_MEDIAN_MAX) cfg_.median = WEIGHT_MEDIAN_MAX;
+    if ((cfg_.median & 1) == 0) cfg_.median--;            // odd windows only
+    if (cfg_.fir_taps < 1) cfg_.fir_taps = 1;
+    if (cfg_.fir_taps > WEIGHT_FIR_MAX) cfg_.fir_taps = WEIGHT_FIR_MAX;
+    if (!(cfg_.iir_alpha > 0.0f)) cfg_.iir_alpha = 1.0f;  // also catches NAN
+    if (cfg_.iir_alpha > 1.0f) cfg_.iir_alpha = 1.0f;
+    if (cfg_.decimate < 1) cfg_.decimate = 1;
+    reset();
+}
+
+void WeightFilter::reset()
+{
+    med_idx_ = med_fill_ = 0;
+    fir_sum_ = 0;
+    fir_idx_ = fir_fill_ = 0;
+    iir_init_ = false;
+    dec_count_ = 0;
+}
+
+bool WeightFilter::push(int32_t raw, int32_t& out)
+{
+    // --- Median: insertion sort of at most 5 values ---
+    int32_t x = raw;
+    if (cfg_.median > 1) {
+        med_buf_[med_idx_] = raw;
+        med_idx_ = (uint8_t)((med_idx_ + 1) % cfg_.median);
+        if (med_fill_ < cfg_.median) med_fill_++;
+        int32_t s[WEIGHT_MEDIAN_MAX];
+        for (uint8_t i = 0; i < med_fill_; i++) {
+            int32_t v = med_buf_[i];
+            uint8_t j = i;
+            while (j > 0 && s[j - 1] > v) { s[j] = s[j - 1]; j--; }
+            s[j] = v;
+        }
+        x = s[med_fill_ / 2];
+    }
+
+    // --- Smoother ---
+    int32_t y = x;
+    if (cfg_.smooth == FilterStage::Fir) {
+        if (fir_fill_ == cfg_.fir_taps) fir_sum_ -= fir_buf_[fir_idx_];
+        else fir_fill_++;
+        fir_buf_[fir_idx_] = x;
+        fir_sum_ += x;
+        fir_idx_ = (uint8_t)((fir_idx_ + 1) % cfg_.fir_taps);
+        y = (int32_t)(fir_sum_ / fir_fill_);
+    } else if (cfg_.smooth == FilterStage::Iir) {
+        // 24-bit counts fit a float mantissa exactly; seeding on the first
+        // sample avoids a slow ramp up from zero
+        if (!iir_init_) { iir_y_ = (float)x; iir_init_ = true; }
+        else iir_y_ += cfg_.iir_alpha * ((float)x - iir_y_);
+        y = (int32_t)(iir_y_ + (iir_y_ >= 0.0f ? 0.5f : -0.5f));
+    }
+
+    // --- Decimator: first value out immediately, then every D-th ---
+    bool emit = (dec_count_ == 0);
+    dec_count_ = (uint8_t)((dec_count_ + 1) % cfg_.decimate);
+    if (emit) out = y;
+    return emit;
+}
+
+float WeightFilter::delay_samples() const
+{
+    float d = (cfg_.median - 1) * 0.5f;
+    if (cfg_.smooth == FilterStage::Fir) d += (cfg_.fir_taps - 1) * 0.5f;
+    else if (cfg_.smooth == FilterStage::Iir) d += (1.0f - cfg_.iir_alpha) / cfg_.iir_alpha;
+    d += (cfg_.decimate - 1) * 0.5f;
+    return d;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+
+// Decimating filter chain between the HX711 raw stream and read_weight():
+//
+//   raw --> median-of-N --> IIR one-pole | FIR boxcar --> keep every D-th --> out
+//
+// Runs in the raw-count domain, so tare()/calibration changes never disturb
+// its state. At 80 SPS the median rejects single-sample spikes (vibrator
+// knocks, servo current steps on the supply) and the smoother + decimator
+// trade the 8x higher per-sample noise back against latency; see
+// delay_samples() for the cost of a given setting.
+//
+// No Pico SDK dependencies: the chain compiles and runs on a host, so
+// recorded raw streams (e.g. the raw column of a dispense CSV) can be replayed
+// through candidate settings offline.
+
+inline constexpr uint8_t WEIGHT_MEDIAN_MAX = 5;
+inline constexpr uint8_t WEIGHT_FIR_MAX    = 16;
+
+enum class FilterStage : uint8_t { None, Iir, Fir };
+
+struct WeightFilterConfig {
+    uint8_t     median    = 1;      // window 1 (off), 3 or 5
+    FilterStage smooth    = FilterStage::None;
+    uint8_t     fir_taps  = 4;      // boxcar length, 1..WEIGHT_FIR_MAX
+    float       iir_alpha = 0.5f;   // y += alpha * (x - y), 0 < alpha <= 1
+    uint8_t     decimate  = 1;      // emit every D-th smoothed value
+};
+
+class WeightFilter {
+public:
+    WeightFilter() { configure(WeightFilterConfig{}); }
+
+    // Clamps out-of-range fields and resets the state
+    void configure(const WeightFilterConfig& cfg);
+    const WeightFilterConfig& config() const { return cfg_; }
+    bool passthrough() const {
+        return cfg_.median == 1 && cfg_.smooth == FilterStage::None && cfg_.decimate == 1;
+    }
+
+    void reset();
+
+    // Feed one conversion; true (and out set) when the decimator emits.
+    // Until the windows fill, partial windows are used, so the very first
+    // conversion already produces a sane value.
+    bool push(int32_t raw, int32_t& out);
+
+    // Latency of an emitted value behind the newest input, in input samples:
+    // median (N-1)/2 + FIR (taps-1)/2 or IIR (1-a)/a, plus (D-1)/2 average
+    // staleness from decimation. E.g. median 3, FIR 4, D 2 = 3.0 samples,
+    // 37.5 ms at 80 SPS - vs 100-200 ms for a single 10 SPS sample.
+    float delay_samples() const;
+
+private:
+    WeightFilterConfig cfg_;
+
+    int32_t  med_buf_[WEIGHT_MEDIAN_MAX] = {};
+    uint8_t  med_idx_ = 0;
+    uint8_t  med_fill_ = 0;
+
+    int32_t  fir_buf_[WEIGHT_FIR_MAX] = {};
+    int64_t  fir_sum_ = 0;
+    uint8_t  fir_idx_ = 0;
+    uint8_t  fir_fill_ = 0;
+
+    float    iir_y_ = 0.0f;
+    bool     iir_init_ = false;
+
+    uint8_t  dec_count_ = 0;
+};
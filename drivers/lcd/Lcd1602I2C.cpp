@@ -1,8 +1,23 @@
 #include "Lcd1602I2C.hpp"
+#include <cstdio>
+#include <cstring>
 #include "pico/binary_info.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+// 20x4 row addressing
+static const uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
+
+// Instance whose DMA channel raises DMA_IRQ_1 (one LCD per firmware)
+static Lcd1602I2C* s_dmaOwner = nullptr;
 
 Lcd1602I2C::Lcd1602I2C(i2c_inst_t* i2c, uint8_t addr, uint8_t cols, uint8_t rows)
-: _i2c(i2c), _addr(addr), _cols(cols), _rows(rows) {}
+: _i2c(i2c), _addr(addr),
+  _cols(cols > MAX_COLS ? MAX_COLS : cols),
+  _rows(rows > MAX_ROWS ? MAX_ROWS : rows) {
+    memset(_fb, ' ', sizeof(_fb));
+    memset(_shown, ' ', sizeof(_shown));
+}
 
 void Lcd1602I2C::init(uint sda_gpio, uint scl_gpio, uint32_t baud) {
     // I2C setup
@@ -12,6 +27,7 @@ void Lcd1602I2C::init(uint sda_gpio, uint scl_gpio, uint32_t baud) {
     gpio_pull_up(sda_gpio);
     gpio_pull_up(scl_gpio);
     bi_decl(bi_2pins_with_func(sda_gpio, scl_gpio, GPIO_FUNC_I2C));
+    initDma();
 
     // Power-up wait
     sleep_ms(50);
@@ -35,8 +51,10 @@ void Lcd1602I2C::init(uint sda_gpio, uint scl_gpio, uint32_t baud) {
     _displayCtl = 0;
     sendCmd(LCD_DISPLAYCONTROL | _displayCtl);
 
-    // Clear
-    clear();
+    // Clear (the one real clear: from here on _shown tracks the DDRAM)
+    sendCmd(LCD_CLEARDISPLAY);
+    sleep_ms(2);
+    memset(_shown, ' ', sizeof(_shown));
 
     // Entry mode
     _entryMode = LCD_ENTRYLEFT;
@@ -45,26 +63,158 @@ void Lcd1602I2C::init(uint sda_gpio, uint scl_gpio, uint32_t baud) {
     // Display on
     _displayCtl = LCD_DISPLAYON;
     sendCmd(LCD_DISPLAYCONTROL | _displayCtl);
+
+    // Draw whatever was printed before init
+    flush();
 }
 
-void Lcd1602I2C::clear() { sendCmd(LCD_CLEARDISPLAY); sleep_ms(2); }
-void Lcd1602I2C::home()  { sendCmd(LCD_RETURNHOME);   sleep_ms(2); }
+// --- framebuffer ---
+// No LCD_CLEARDISPLAY here: it blanks the panel for 1.5 ms and would make
+// every redraw flicker. flush() overwrites only what actually changed. Not
+// auto-flushed either - the print that normally follows does it, so a
+// clear + redraw never sends the blanks first.
+void Lcd1602I2C::clear() {
+    memset(_fb, ' ', sizeof(_fb));
+    _curLine = _curCol = 0;
+}
+void Lcd1602I2C::home() { _curLine = _curCol = 0; }
 
 void Lcd1602I2C::setCursor(uint8_t line, uint8_t col) {
-    // 20x4 row addressing
-    static const uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
     if (line >= _rows) line = _rows - 1;
-    sendCmd(LCD_SETDDRAMADDR | (row_offsets[line] + col));
+    _curLine = line;
+    _curCol  = col;
 }
 
-void Lcd1602I2C::writeChar(char c) { sendData((uint8_t)c); }
+void Lcd1602I2C::writeChar(char c) {
+    // The HD44780 would wrap into the next-but-one line; clip instead
+    if (_curCol < _cols) _fb[_curLine][_curCol] = c;
+    if (_curCol < 0xFF) ++_curCol;
+    if (_autoFlush) flush();
+}
 
 void Lcd1602I2C::print(const char* s) {
     if (!s) return;
-    while (*s) writeChar(*s++);
+    print(std::string_view(s));
 }
 void Lcd1602I2C::print(std::string_view s) {
+    bool af = _autoFlush;
+    _autoFlush = false;                   // one flush for the whole string
     for (char c : s) writeChar(c);
+    _autoFlush = af;
+    if (_autoFlush) flush();
+}
+
+void Lcd1602I2C::flush() {
+    waitIdle();
+    size_t n = encodeChanges();
+    if (n && i2c_write_blocking(_i2c, _addr, _tx, n, false) < 0)
+        memset(_shown, 0, sizeof(_shown));   // NAK: repaint everything next time
+}
+
+bool Lcd1602I2C::flushAsync() {
+    if (_dma < 0) { flush(); return true; }
+    if (busy()) { ++_skipped; return false; }
+
+    i2c_hw_t* hw = i2c_get_hw(_i2c);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        // Previous stream was NAKed (panel unplugged / glitched) and the
+        // controller flushed its FIFO: what's shown is unknown, repaint all
+        (void)hw->clr_tx_abrt;
+        memset(_shown, 0, sizeof(_shown));
+    }
+
+    size_t n = encodeChanges();
+    if (!n) return true;
+    for (size_t i = 0; i < n; ++i) _txWords[i] = _tx[i];
+    _txWords[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    // Same target-address switch i2c_write_blocking does per call
+    hw->enable = 0;
+    hw->tar = _addr;
+    hw->enable = 1;
+    dma_channel_transfer_from_buffer_now(_dma, _txWords, n);
+    return true;
+}
+
+bool Lcd1602I2C::busy() const {
+    if (_dma >= 0 && dma_channel_is_busy(_dma)) return true;
+    uint32_t st = i2c_get_hw(_i2c)->status;
+    return !(st & I2C_IC_STATUS_TFE_BITS) || (st & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+void Lcd1602I2C::waitIdle() {
+    while (busy()) tight_loop_contents();
+}
+
+// Per line, each run of changed cells becomes an address command plus its
+// characters. Runs split by a single unchanged cell are merged: resending it
+// costs 6 bus bytes, the same as the address command of a second run. All
+// runs go out back to back in one I2C write - the PCF8574 just latches each
+// byte, so the stream needs no framing between them.
+size_t Lcd1602I2C::encodeChanges() {
+    uint8_t* p = _tx;
+    for (uint8_t line = 0; line < _rows; ++line) {
+        const char* want = _fb[line];
+        char* have = _shown[line];
+        uint8_t col = 0;
+        while (col < _cols) {
+            if (want[col] == have[col]) { ++col; continue; }
+            uint8_t start = col, end = col + 1;   // [start, end) changed
+            for (uint8_t c = end; c < _cols; ++c) {
+                if (want[c] == have[c]) continue;
+                if (c - end > 1) break;
+                end = c + 1;
+            }
+            p = packByte(p, LCD_SETDDRAMADDR | (row_offsets[line] + start), false);
+            for (uint8_t c = start; c < end; ++c)
+                p = packByte(p, (uint8_t)want[c], true);
+            memcpy(have + start, want + start, end - start);
+            col = end;
+        }
+    }
+    return (size_t)(p - _tx);
+}
+
+// The channel writes 32-bit IC_DATA_CMD words (data byte + STOP on the last
+// one) paced by the I2C TX DREQ; i2c_init already enabled TDMAE. A full
+// screen is 504 bytes, ~12 ms at 400 kHz, none of it on the CPU.
+void Lcd1602I2C::initDma() {
+    if (_dma >= 0) return;
+    int ch = dma_claim_unused_channel(false);
+    if (ch < 0) {
+        printf("[lcd] no free DMA channel, flushing blocking\n");
+        return;
+    }
+    dma_channel_config c = dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, i2c_get_dreq(_i2c, true));
+    dma_channel_configure(ch, &c, &i2c_get_hw(_i2c)->data_cmd, _txWords, 0, false);
+    _dma = ch;
+
+    s_dmaOwner = this;
+    dma_channel_set_irq1_enabled(ch, true);
+    irq_add_shared_handler(DMA_IRQ_1, dmaIrq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_1, true);
+}
+
+void Lcd1602I2C::dmaIrq() {
+    Lcd1602I2C* l = s_dmaOwner;
+    if (!l || !dma_channel_get_irq1_status(l->_dma)) return;   // shared IRQ
+    dma_channel_acknowledge_irq1(l->_dma);
+    if (l->_onDone) l->_onDone(l->_onDoneCtx);
+}
+
+uint8_t* Lcd1602I2C::packByte(uint8_t* out, uint8_t v, bool rs) const {
+    const uint8_t ctl = _blMask | (rs ? LCD_RS : 0x00);
+    for (uint8_t nib : { (uint8_t)(v & 0xF0), (uint8_t)((v << 4) & 0xF0) }) {
+        uint8_t b = ctl | nib;
+        *out++ = b;
+        *out++ = b | LCD_ENABLE;
+        *out++ = b & ~LCD_ENABLE;
+    }
+    return out;
 }
 
 void Lcd1602I2C::displayOn(bool on) {
@@ -101,8 +251,8 @@ void Lcd1602I2C::sendData(uint8_t v){
 }
 
 void Lcd1602I2C::pulseEnable(uint8_t bus) {
-    // No explicit delays: each I2C byte at 100 kHz takes ~90 us on the wire,
-    // which already dwarfs the HD44780's EN pulse width (450 ns) and command
+    // No explicit delays: each I2C byte takes ~23 us on the wire at 400 kHz
+    // (~90 us at 100 kHz), which already dwarfs the HD44780's EN pulse width (450 ns) and command
     // execution time (37 us). The previous 3x600 us sleeps here made every
     // character cost ~3.6 ms - a full LCD line stalled the control loop ~60 ms
     // and halved the PID rate during dispensing.
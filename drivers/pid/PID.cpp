@@ -21,17 +21,18 @@ PID::PID(double* Input, double* Output, double* Setpoint,
     myInput = Input;
     mySetpoint = Setpoint;
     inAuto = false;
+    dispKp = dispKi = dispKd = 0;   // read by UpdateCore before SetTunings runs
 
     PID::SetOutputLimits(0, 255);                //default output limit corresponds to
                                                  //the arduino pwm limits
 
-    SampleTime = 100;                             //default Controller Sample Time is 0.1 seconds
+    SampleTime = 100000;                          //default Controller Sample Time is 0.1 seconds
 
     PID::SetControllerDirection(ControllerDirection);
     PID::SetTunings(Kp, Ki, Kd, POn);
 
-    // ---- CHANGED: millis() -> Pico SDK time in ms since boot ----
-    lastTime = to_ms_since_boot(get_absolute_time()) - SampleTime;
+    // ---- CHANGED: millis() -> Pico SDK time in us since boot ----
+    lastTime = time_us_64() - SampleTime;
 }
 
 /*Constructor (...)*********************************************************
@@ -57,48 +58,52 @@ bool PID::Compute()
 {
    if(!inAuto) return false;
 
-   // ---- CHANGED: millis() -> Pico SDK time in ms since boot ----
-   unsigned long now = to_ms_since_boot(get_absolute_time());
-   unsigned long timeChange = (now - lastTime);
+   // ---- CHANGED: millis() -> Pico SDK time in us since boot (a 12.5 ms
+   // HX711 period is not a whole number of ms) ----
+   uint64_t now = time_us_64();
+   uint64_t timeChange = (now - lastTime);
    if(timeChange>=SampleTime)
    {
-      /*Compute all the working error variables*/
-      double input = *myInput;
-      double error = *mySetpoint - input;
-      double dInput = (input - lastInput);
-      outputSum+= (ki * error);
-
-      /*Add Proportional on Measurement, if P_ON_M is specified*/
-      if(!pOnE) outputSum-= kp * dInput;
-
-      if(outputSum > outMax) outputSum= outMax;
-      else if(outputSum < outMin) outputSum= outMin;
-
-      /*Add Proportional on Error, if P_ON_E is specified*/
-      double output;
-      if(pOnE) output = kp * error;
-      else output = 0;
-
-      /*Compute Rest of PID Output*/
-      output += outputSum - kd * dInput;
-
-      if(output > outMax) output = outMax;
-      else if(output < outMin) output = outMin;
-      *myOutput = output;
-
-      /*Capture term contributions for tuning telemetry (GetLastP/I/D)*/
-      lastPTerm = pOnE ? kp * error : 0.0;
-      lastITerm = outputSum;
-      lastDTerm = -kd * dInput;
+      /*The arithmetic runs in PidCore (pid_core.hpp), single precision*/
+      pid_real_t output = core.step((pid_real_t)*myInput, (pid_real_t)*mySetpoint, pOnE);
+      *myOutput = (double)output;
 
       /*Remember some variables for next time*/
-      lastInput = input;
       lastTime = now;
       return true;
    }
    else return false;
 }
 
+/* UpdateCore()****************************************************************
+ * Hands the tunings, schedule and derivative filter to the core in its
+ * per-sample, direction-signed form. Called whenever one of them, the sample
+ * time or the direction changes.
+ ******************************************************************************/
+void PID::UpdateCore()
+{
+   double SampleTimeInSec = ((double)SampleTime)/1000000;
+   double sign = controllerDirection == REVERSE ? -1.0 : 1.0;
+   auto perSample = [&](double Kp, double Ki, double Kd) {
+      return PidCore<pid_real_t>::Gains{ (pid_real_t)(sign * Kp),
+                                         (pid_real_t)(sign * Ki * SampleTimeInSec),
+                                         (pid_real_t)(sign * Kd / SampleTimeInSec) };
+   };
+
+   core.set_gains(perSample(dispKp, dispKi, dispKd));
+
+   PidCore<pid_real_t>::Point pts[MAX_GAIN_POINTS];
+   for(int i = 0; i < scheduleLen; i++)
+   {
+      pts[i].error = (pid_real_t)schedule[i].error;
+      pts[i].g = perSample(schedule[i].kp, schedule[i].ki, schedule[i].kd);
+   }
+   core.set_schedule(pts, scheduleLen);
+
+   double T = SampleTimeInSec * 1000;
+   core.set_d_alpha((pid_real_t)(dFilterMs > 0 ? T / (dFilterMs + T) : 1.0));
+}
+
 /* SetTunings(...)*************************************************************
  * This function allows the controller's dynamic performance to be adjusted.
  * it's called automatically from the constructor, but tunings can also
@@ -112,18 +117,7 @@ void PID::SetTunings(double Kp, double Ki, double Kd, int POn)
    pOnE = POn == P_ON_E;
 
    dispKp = Kp; dispKi = Ki; dispKd = Kd;
-
-   double SampleTimeInSec = ((double)SampleTime)/1000;
-   kp = Kp;
-   ki = Ki * SampleTimeInSec;
-   kd = Kd / SampleTimeInSec;
-
-  if(controllerDirection ==REVERSE)
-   {
-      kp = (0 - kp);
-      ki = (0 - ki);
-      kd = (0 - kd);
-   }
+   UpdateCore();
 }
 
 /* SetTunings(...)*************************************************************
@@ -137,17 +131,67 @@ void PID::SetTunings(double Kp, double Ki, double Kd){
  * sets the period, in Milliseconds, at which the calculation is performed
  ******************************************************************************/
 void PID::SetSampleTime(int NewSampleTime)
+{
+   if (NewSampleTime > 0) SetSampleTimeUs((uint32_t)NewSampleTime * 1000);
+}
+
+/* SetSampleTimeUs(...) *******************************************************
+ * same, in microseconds
+ ******************************************************************************/
+void PID::SetSampleTimeUs(uint32_t NewSampleTime)
 {
    if (NewSampleTime > 0)
    {
-      double ratio  = (double)NewSampleTime
-                      / (double)SampleTime;
-      ki *= ratio;
-      kd /= ratio;
-      SampleTime = (unsigned long)NewSampleTime;
+      SampleTime = NewSampleTime;
+      UpdateCore();
    }
 }
 
+/* SetGainSchedule(...) *******************************************************
+ * Gains by distance from the setpoint: aggressive far away, gentle in the last
+ * units. Points must be sorted by error; they are copied.
+ ******************************************************************************/
+void PID::SetGainSchedule(const GainPoint* Points, int Count)
+{
+   if(Count < 0) Count = 0;
+   if(Count > MAX_GAIN_POINTS) Count = MAX_GAIN_POINTS;
+   for(int i = 0; i < Count; i++)
+   {
+      if(Points[i].kp < 0 || Points[i].ki < 0 || Points[i].kd < 0) return;
+      if(i > 0 && Points[i].error < Points[i-1].error) return;
+   }
+   for(int i = 0; i < Count; i++) schedule[i] = Points[i];
+   scheduleLen = Count;
+   UpdateCore();
+}
+
+/* SetAntiWindup(...) *********************************************************
+ * AW_CLAMP: the integrator is clamped to the output limits (Arduino default).
+ * AW_BACK_CALC: additionally, every Compute moves it by Kt times the gap
+ * between the value reported by TrackOutput() and the controller's own
+ * unclamped output, so it stops winding up while the actuator lags behind
+ * (slew limit) instead of only once it hits the limits.
+ ******************************************************************************/
+void PID::SetAntiWindup(int Mode, double Kt)
+{
+   if(Kt < 0) return;
+   core.set_back_calc(Mode == AW_BACK_CALC, (pid_real_t)Kt);
+}
+
+void PID::TrackOutput(double Applied)
+{
+   core.track((pid_real_t)Applied);
+}
+
+/* SetDerivativeFilter(...) ***************************************************
+ * first-order low-pass on the derivative input, time constant in ms
+ ******************************************************************************/
+void PID::SetDerivativeFilter(double TauMs)
+{
+   dFilterMs = TauMs > 0 ? TauMs : 0;
+   UpdateCore();
+}
+
 /* SetOutputLimits(...)****************************************************
  *     This function will be used far more often than SetInputLimits.  while
  *  the input to the controller will generally be in the 0-1023 range (which is
@@ -161,14 +205,12 @@ void PID::SetOutputLimits(double Min, double Max)
    if(Min >= Max) return;
    outMin = Min;
    outMax = Max;
+   core.set_limits((pid_real_t)Min, (pid_real_t)Max);   // clamps the integrator too
 
    if(inAuto)
    {
        if(*myOutput > outMax) *myOutput = outMax;
        else if(*myOutput < outMin) *myOutput = outMin;
-
-       if(outputSum > outMax) outputSum= outMax;
-       else if(outputSum < outMin) outputSum= outMin;
    }
 }
 
@@ -193,10 +235,7 @@ void PID::SetMode(int Mode)
  ******************************************************************************/
 void PID::Initialize()
 {
-   outputSum = *myOutput;
-   lastInput = *myInput;
-   if(outputSum > outMax) outputSum = outMax;
-   else if(outputSum < outMin) outputSum = outMin;
+   core.reset((pid_real_t)*myOutput, (pid_real_t)*myInput);
 }
 
 /* SetControllerDirection(...)*************************************************
@@ -207,13 +246,8 @@ void PID::Initialize()
  ******************************************************************************/
 void PID::SetControllerDirection(int Direction)
 {
-   if(inAuto && Direction !=controllerDirection)
-   {
-       kp = (0 - kp);
-       ki = (0 - ki);
-       kd = (0 - kd);
-   }
    controllerDirection = Direction;
+   UpdateCore();
 }
 
 /* Status Funcions*************************************************************
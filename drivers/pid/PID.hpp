@@ -1,4 +1,12 @@
 
+#include <cstdint>
+#include "pid_core.hpp"
+
+// ---- CHANGED: the double API below is kept as a wrapper; Compute() runs in
+// PidCore<pid_real_t> (pid_core.hpp). float uses the M33's FPU - every double
+// operation on the RP2350 is a software routine. ----
+typedef float pid_real_t;
+
 class PID
 {
 
@@ -12,6 +20,11 @@ class PID
   #define REVERSE  1
   #define P_ON_M 0
   #define P_ON_E 1
+  #define AW_CLAMP     0    // anti-windup: clamp the integrator to the output limits
+  #define AW_BACK_CALC 1    //   ... or bleed it by what the actuator did not follow
+
+  // One gain-schedule point: gains in effect at |setpoint - input| == error
+  struct GainPoint { double error, kp, ki, kd; };
 
   //commonly used functions **************************************************************************
     PID(double*, double*, double*,        // * constructor.  links the PID to the Input, Output, and 
@@ -47,6 +60,20 @@ class PID
 										  //   once it is set in the constructor.
     void SetSampleTime(int);              // * sets the frequency, in Milliseconds, with which 
                                           //   the PID calculation is performed.  default is 100
+    void SetSampleTimeUs(uint32_t);       // * same, in microseconds (timing is kept in us)
+
+  //Additions for the dispenser *********************************************************************
+    void SetGainSchedule(const GainPoint*,// * gains interpolated by |error| between the points
+                         int);            //   (sorted by error, copied; up to MAX_GAIN_POINTS).
+                                          //   Beyond the ends the end point holds. 0 points =
+                                          //   the SetTunings gains. GetKp/i/d stay the tunings.
+    void SetAntiWindup(int Mode,          // * AW_CLAMP (default) or AW_BACK_CALC with tracking
+                       double Kt = 0.5);  //   gain Kt per sample: the integrator is pulled toward
+                                          //   what the actuator actually did (see TrackOutput)
+    void TrackOutput(double);             // * the value actually applied after the last Compute
+                                          //   (e.g. slew-limited). Used by AW_BACK_CALC.
+    void SetDerivativeFilter(double);     // * first-order low-pass on the derivative, time
+                                          //   constant in ms (0 = off, the default)
 										  
 										  
 										  
@@ -59,24 +86,21 @@ class PID
 
 	// Last computed term contributions (for tuning telemetry). Their sum equals the
 	// pre-clamp output of the most recent Compute() that returned true.
-	double GetLastP() const { return lastPTerm; }   // kp*error (0 when P_ON_M)
-	double GetLastI() const { return lastITerm; }   // clamped integrator sum
-	double GetLastD() const { return lastDTerm; }   // -kd*dInput
+	double GetLastP() const { return (double)core.last_p(); }   // kp*error (0 when P_ON_M)
+	double GetLastI() const { return (double)core.last_i(); }   // clamped integrator sum
+	double GetLastD() const { return (double)core.last_d(); }   // -kd*dInput (filtered)
+
+	static constexpr int MAX_GAIN_POINTS = PidCore<pid_real_t>::MAX_POINTS;
 
   private:
 	void Initialize();
+	void UpdateCore();            // push gains/schedule/filter in per-sample form
+
+	PidCore<pid_real_t> core;
 
-	double lastPTerm = 0.0;     // * last P/I/D contributions captured in Compute(),
-	double lastITerm = 0.0;     //   exposed via GetLastP/I/D for tuning telemetry
-	double lastDTerm = 0.0;     //
-	
 	double dispKp;				// * we'll hold on to the tuning parameters in user-entered 
 	double dispKi;				//   format for display purposes
 	double dispKd;				//
-    
-	double kp;                  // * (P)roportional Tuning Parameter
-    double ki;                  // * (I)ntegral Tuning Parameter
-    double kd;                  // * (D)erivative Tuning Parameter
 
 	int controllerDirection;
 	int pOn;
@@ -86,10 +110,14 @@ class PID
     double *mySetpoint;           //   PID, freeing the user from having to constantly tell us
                                   //   what these values are.  with pointers we'll just know.
 			  
-	unsigned long lastTime;
-	double outputSum, lastInput;
+	uint64_t lastTime;            // us
 
-	unsigned long SampleTime;
+	uint32_t SampleTime;          // us
 	double outMin, outMax;
 	bool inAuto, pOnE;
+
+	GainPoint schedule[MAX_GAIN_POINTS];   // user units, converted by UpdateCore
+	int scheduleLen = 0;
+
+	double dFilterMs = 0.0;
 };
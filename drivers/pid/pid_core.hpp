@@ -0,0 +1,108 @@
+#pragma once
+
+// The arithmetic of one PID step, templated on the number type: float for
+// the RP2350's single-precision FPU (double is software-emulated there, ~10x
+// slower per operation) or Q16 (q16.hpp) fixed point. No timing, no pointers
+// and no Pico SDK: the PID class owns those and converts its double API at the
+// edges, and the core also runs on a host.
+//
+// Gains are in per-sample form, direction sign included: kp, ki * Ts, kd / Ts
+// (the Arduino PID's internal form). Behavior matches PID::Compute: integrator
+// clamped to the output limits, optional back-calculation against the applied
+// output, optional first-order low-pass on the derivative, gains interpolated
+// by |error| from a schedule.
+
+template <typename T>
+class PidCore {
+public:
+    struct Gains { T kp, ki, kd; };
+    struct Point { T error; Gains g; };   // gains in effect at |error|
+    static constexpr int MAX_POINTS = 6;
+
+    void set_gains(const Gains& g) { gains_ = g; }
+
+    // Sorted by error; beyond the ends the end point holds. 0 = set_gains
+    void set_schedule(const Point* p, int n) {
+        n_ = n < 0 ? 0 : (n > MAX_POINTS ? MAX_POINTS : n);
+        for (int i = 0; i < n_; i++) sched_[i] = p[i];
+    }
+
+    void set_limits(T lo, T hi) {
+        lo_ = lo;
+        hi_ = hi;
+        sum_ = clamp(sum_);
+    }
+
+    void set_back_calc(bool on, T kt) { back_calc_ = on; kt_ = kt; }
+
+    // Weight of a new derivative sample: Ts / (tau + Ts); 1 = unfiltered
+    void set_d_alpha(T a) { d_alpha_ = a; }
+
+    // Bumpless start from the current output and input
+    void reset(T output, T input) {
+        sum_ = clamp(output);
+        last_input_ = input;
+        raw_ = sum_;
+        have_applied_ = false;
+        d_filt_ = T(0);
+    }
+
+    // Value actually applied after the last step (back-calculation)
+    void track(T applied) { applied_ = applied; have_applied_ = true; }
+
+    T step(T input, T setpoint, bool p_on_e) {
+        T error = setpoint - input;
+        T d_input = input - last_input_;
+        Gains g = n_ > 0 ? scheduled(error < T(0) ? -error : error) : gains_;
+
+        if (back_calc_ && have_applied_) sum_ += kt_ * (applied_ - raw_);
+        have_applied_ = false;
+
+        sum_ += g.ki * error;
+        if (!p_on_e) sum_ -= g.kp * d_input;
+        sum_ = clamp(sum_);
+
+        d_filt_ += (d_input - d_filt_) * d_alpha_;
+
+        p_ = p_on_e ? g.kp * error : T(0);
+        d_ = -(g.kd * d_filt_);
+        raw_ = p_ + sum_ + d_;
+        last_input_ = input;
+        return clamp(raw_);
+    }
+
+    T sum() const    { return sum_; }
+    T last_p() const { return p_; }
+    T last_i() const { return sum_; }
+    T last_d() const { return d_; }
+
+private:
+    T clamp(T v) const { return v > hi_ ? hi_ : (v < lo_ ? lo_ : v); }
+
+    Gains scheduled(T e) const {
+        if (e <= sched_[0].error) return sched_[0].g;
+        if (e >= sched_[n_ - 1].error) return sched_[n_ - 1].g;
+        int i = 1;
+        while (sched_[i].error < e) i++;
+        const Point& a = sched_[i - 1];
+        const Point& b = sched_[i];
+        T f = (e - a.error) / (b.error - a.error);   // b.error > e > a.error
+        return { a.g.kp + (b.g.kp - a.g.kp) * f,
+                 a.g.ki + (b.g.ki - a.g.ki) * f,
+                 a.g.kd + (b.g.kd - a.g.kd) * f };
+    }
+
+    Gains gains_ = {T(0), T(0), T(0)};
+    Point sched_[MAX_POINTS] = {};
+    int   n_ = 0;
+
+    T lo_ = T(0), hi_ = T(255);
+    T sum_ = T(0), last_input_ = T(0);
+    T raw_ = T(0);              // pre-clamp output of the last step
+    T applied_ = T(0);
+    bool have_applied_ = false;
+    bool back_calc_ = false;
+    T kt_ = T(0);
+    T d_alpha_ = T(1), d_filt_ = T(0);
+    T p_ = T(0), d_ = T(0);
+};
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+
+// Q16.16 signed fixed point: 16 integer bits (+-32767), 16 fraction bits
+// (1.5e-5). Enough arithmetic to instantiate PidCore<Q16>: + - * / and the
+// comparisons. Products and quotients go through 64 bits, round to nearest
+// and saturate; sums wrap like int32_t.
+//
+// Range check for the dispenser: grams up to ~30 kg, angles, and the
+// per-sample gains (Kd / 12.5 ms = 64) all fit. Ki * Ts is the weak spot:
+// 0.08 * 0.0125 = 0.001 is 66 LSBs, a 1.5 % gain step.
+
+class Q16 {
+public:
+    static constexpr int32_t ONE = 1 << 16;
+
+    constexpr Q16() : v_(0) {}
+    constexpr Q16(int i) : v_((int32_t)((uint32_t)i << 16)) {}
+    constexpr Q16(float f) : v_(sat(f * (float)ONE + (f < 0 ? -0.5f : 0.5f))) {}
+    constexpr Q16(double d) : v_(sat((float)(d * ONE + (d < 0 ? -0.5 : 0.5)))) {}
+    static constexpr Q16 raw(int32_t r) { Q16 q; q.v_ = r; return q; }
+
+    constexpr int32_t raw() const { return v_; }
+    constexpr explicit operator float() const { return (float)v_ / (float)ONE; }
+    constexpr explicit operator double() const { return (double)v_ / (double)ONE; }
+
+    constexpr Q16 operator-() const { return raw((int32_t)(0u - (uint32_t)v_)); }
+    constexpr Q16 operator+(Q16 o) const { return raw((int32_t)((uint32_t)v_ + (uint32_t)o.v_)); }
+    constexpr Q16 operator-(Q16 o) const { return raw((int32_t)((uint32_t)v_ - (uint32_t)o.v_)); }
+    constexpr Q16 operator*(Q16 o) const {
+        int64_t p = (int64_t)v_ * o.v_;
+        return raw(sat64((p + (p < 0 ? -(ONE / 2) : ONE / 2)) / ONE));
+    }
+    constexpr Q16 operator/(Q16 o) const {
+        if (o.v_ == 0) return raw(v_ < 0 ? INT32_MIN : INT32_MAX);
+        int64_t n = (int64_t)v_ * ONE;
+        int64_t h = (o.v_ < 0 ? -(int64_t)o.v_ : o.v_) / 2;
+        return raw(sat64(((n < 0) == (o.v_ < 0) ? n + h : n - h) / o.v_));
+    }
+    Q16& operator+=(Q16 o) { return *this = *this + o; }
+    Q16& operator-=(Q16 o) { return *this = *this - o; }
+
+    constexpr bool operator<(Q16 o) const  { return v_ < o.v_; }
+    constexpr bool operator>(Q16 o) const  { return v_ > o.v_; }
+    constexpr bool operator<=(Q16 o) const { return v_ <= o.v_; }
+    constexpr bool operator>=(Q16 o) const { return v_ >= o.v_; }
+    constexpr bool operator==(Q16 o) const { return v_ == o.v_; }
+
+private:
+    static constexpr int32_t sat(float x) {
+        return x >= 2147483520.0f ? INT32_MAX : (x <= -2147483648.0f ? INT32_MIN : (int32_t)x);
+    }
+    static constexpr int32_t sat64(int64_t x) {
+        return x > INT32_MAX ? INT32_MAX : (x < INT32_MIN ? INT32_MIN : (int32_t)x);
+    }
+    int32_t v_;
+};
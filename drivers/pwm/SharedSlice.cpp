@@ -1,13 +1,19 @@
 #include "SharedSlice.hpp"
 #include "hardware/pwm.h"
 
+void SharedSlice::initLock() {
+    if (!critical_section_is_initialized(&_lock)) critical_section_init(&_lock);
+}
+
 void SharedSlice::registerServo(int slice, float div, uint16_t top) {
+    initLock();
     _slice    = slice;
     _servoDiv = div;
     _servoTop = top;
 }
 
 void SharedSlice::registerVib(SliceDutyClient* client, int slice, float div, uint16_t top) {
+    initLock();
     _slice     = slice;
     _vibClient = client;
     _vibDiv    = div;
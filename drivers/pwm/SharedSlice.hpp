@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include "pico/critical_section.h"
 
 // Interface for a PWM channel whose duty (level) must be recomputed whenever the
 // shared slice's wrap (TOP) changes - i.e. when the slice frequency is switched.
@@ -20,13 +21,35 @@ protected:
 // 333 Hz), so it adapts its duty to whatever the slice currently runs at.
 //
 // Rule: slice = 333 Hz whenever the servo is active, 20 kHz otherwise.
+//
+// With parallel dispensing the two channels belong to different runs (servo1 =
+// scale 1's gate, vib3 = scale 3's assist), so the switch happens mid-run in
+// either direction: scale 3's vibrator hums at 333 Hz for as long as scale 1's
+// gate is driven, and gets its 20 kHz back when that servo is released. Its
+// intensity is kept across every switch. Core 1 drives both during runs, core 0
+// jogs and releases in between; the drivers hold a Guard around a switch and
+// the level written against it, so neither core can slip a wrap change between
+// the other's switch and its level write.
 class SharedSlice {
 public:
     SharedSlice() = default;
 
-    // Registration - called from the drivers' attachShared(). The drivers pass the
-    // timing they already computed in their constructors so there is a single source
-    // of truth per device and no duplicated frequency math.
+    // Held by the drivers around their output (null = unshared: no-op).
+    // Not recursive: reapplyAgainstTop() runs with it held.
+    class Guard {
+    public:
+        explicit Guard(SharedSlice* s) : s_(s) { if (s_) critical_section_enter_blocking(&s_->_lock); }
+        ~Guard() { if (s_) critical_section_exit(&s_->_lock); }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    private:
+        SharedSlice* s_;
+    };
+
+    // Registration - called from the drivers' attachShared(), before core 1 is
+    // launched. The drivers pass the timing they already computed in their
+    // constructors so there is a single source of truth per device and no
+    // duplicated frequency math.
     void registerServo(int slice, float div, uint16_t top);
     void registerVib(SliceDutyClient* client, int slice, float div, uint16_t top);
 
@@ -44,6 +67,7 @@ private:
     enum class Mode { Vib20k, Servo333 };
     void setServo333();
     void setVib20k();
+    void initLock();
 
     int      _slice     = -1;
     float    _servoDiv  = 1.0f;
@@ -55,4 +79,5 @@ private:
     Mode     _mode        = Mode::Vib20k;
     uint16_t _currentTop  = 0;
     bool     _servoActive = false;
+    critical_section_t _lock = {};
 };
@@ -60,6 +60,7 @@ void Servo::applyPulseUs(uint16_t us) {
 
 void Servo::writeMicros(uint16_t us) {
     us = clamp_u16(us, US_MIN, US_MAX);
+    SharedSlice::Guard g(_shared);
     if (_shared) _shared->onServoActive();   // ensure 333 Hz on the shared slice first
     applyPulseUs(us);
 }
@@ -70,6 +71,7 @@ void Servo::center() {
 
 void Servo::off() {
     // Stop PWM signal - servo will relax and not hold torque
+    SharedSlice::Guard g(_shared);
     pwm_set_chan_level(_slice, _channel, 0);
     // Release the shared slice back to the vibrator's 20 kHz (if it is running).
     if (_shared) _shared->onServoIdle();
@@ -0,0 +1,125 @@
+#include "telem_codec.hpp"
+#include <cmath>
+
+// Encoding order = mask bit order
+enum : int { F_WEIGHT, F_SERVO, F_P, F_I, F_D, F_DISPENSED, F_GROSS, F_T, F_VIB, F_SETPOINT };
+
+static constexpr float SCALE[TELEM_CODEC_FIELDS] = {
+    10.0f, 10.0f, 100.0f, 100.0f, 100.0f, 10.0f, 10.0f, 1.0f, 100.0f, 10.0f,
+};
+
+static int32_t quantize(float v, float scale) {
+    float x = v * scale;
+    if (!(x > -2.0e9f)) return x != x ? 0 : -2000000000;   // NaN -> 0
+    if (x > 2.0e9f) return 2000000000;
+    return (int32_t)lroundf(x);
+}
+
+static void to_fields(const TelemetrySample& s, int32_t* q) {
+    q[F_WEIGHT]    = quantize(s.weight, SCALE[F_WEIGHT]);
+    q[F_SERVO]     = quantize(s.servo, SCALE[F_SERVO]);
+    q[F_P]         = quantize(s.p, SCALE[F_P]);
+    q[F_I]         = quantize(s.i, SCALE[F_I]);
+    q[F_D]         = quantize(s.d, SCALE[F_D]);
+    q[F_DISPENSED] = quantize(s.dispensed, SCALE[F_DISPENSED]);
+    q[F_GROSS]     = quantize(s.gross, SCALE[F_GROSS]);
+    q[F_T]         = (int32_t)s.t_ms;
+    q[F_VIB]       = quantize(s.vib, SCALE[F_VIB]);
+    q[F_SETPOINT]  = quantize(s.setpoint, SCALE[F_SETPOINT]);
+}
+
+static void from_fields(const int32_t* q, TelemetrySample& s) {
+    s.weight    = q[F_WEIGHT] / SCALE[F_WEIGHT];
+    s.servo     = q[F_SERVO] / SCALE[F_SERVO];
+    s.p         = q[F_P] / SCALE[F_P];
+    s.i         = q[F_I] / SCALE[F_I];
+    s.d         = q[F_D] / SCALE[F_D];
+    s.dispensed = q[F_DISPENSED] / SCALE[F_DISPENSED];
+    s.gross     = q[F_GROSS] / SCALE[F_GROSS];
+    s.t_ms      = (uint32_t)q[F_T];
+    s.vib       = q[F_VIB] / SCALE[F_VIB];
+    s.setpoint  = q[F_SETPOINT] / SCALE[F_SETPOINT];
+}
+
+// Prediction for field f. Fields are decoded in order, so q[F_WEIGHT] is
+// already the new value when dispensed and gross are predicted. Arithmetic
+// wraps (uint32) on both sides, so any residual round-trips exactly.
+static int32_t predict(int f, const TelemCodecState& prev, const int32_t* q) {
+    uint32_t dw;
+    switch (f) {
+    case F_DISPENSED:
+        dw = (uint32_t)q[F_WEIGHT] - (uint32_t)prev.q[F_WEIGHT];
+        return (int32_t)((uint32_t)prev.q[f] - dw);
+    case F_GROSS:
+        dw = (uint32_t)q[F_WEIGHT] - (uint32_t)prev.q[F_WEIGHT];
+        return (int32_t)((uint32_t)prev.q[f] + dw);
+    case F_T:         return (int32_t)((uint32_t)prev.q[f] + (uint32_t)prev.dt);
+    default:          return prev.q[f];
+    }
+}
+
+static int put_varint(uint8_t* out, uint32_t v) {
+    int n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// 0 on truncation or a varint longer than 5 bytes
+static int get_varint(const uint8_t* in, int len, uint32_t& v) {
+    v = 0;
+    for (int n = 0; n < len && n < 5; n++) {
+        v |= (uint32_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) return n + 1;
+    }
+    return 0;
+}
+
+static uint32_t zigzag(int32_t v)    { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int32_t  unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+int TelemEncoder::encode(const TelemetrySample& s, uint8_t* out) {
+    int32_t q[TELEM_CODEC_FIELDS];
+    to_fields(s, q);
+
+    uint32_t mask = 0;
+    uint32_t res[TELEM_CODEC_FIELDS];
+    for (int f = 0; f < TELEM_CODEC_FIELDS; f++) {
+        res[f] = zigzag((int32_t)((uint32_t)q[f] - (uint32_t)predict(f, s_, q)));
+        if (res[f]) mask |= 1u << f;
+    }
+
+    int n = put_varint(out, mask);
+    for (int f = 0; f < TELEM_CODEC_FIELDS; f++) {
+        if (mask & (1u << f)) n += put_varint(out + n, res[f]);
+    }
+
+    s_.dt = (int32_t)((uint32_t)q[F_T] - (uint32_t)s_.q[F_T]);
+    for (int f = 0; f < TELEM_CODEC_FIELDS; f++) s_.q[f] = q[f];
+    return n;
+}
+
+int TelemDecoder::decode(const uint8_t* in, int len, TelemetrySample& out) {
+    uint32_t mask;
+    int n = get_varint(in, len, mask);
+    if (n == 0 || mask >> TELEM_CODEC_FIELDS) return 0;
+
+    int32_t q[TELEM_CODEC_FIELDS];
+    for (int f = 0; f < TELEM_CODEC_FIELDS; f++) {
+        uint32_t r = 0;
+        if (mask & (1u << f)) {
+            int k = get_varint(in + n, len - n, r);
+            if (k == 0) return 0;
+            n += k;
+        }
+        q[f] = (int32_t)((uint32_t)predict(f, s_, q) + (uint32_t)unzigzag(r));
+    }
+
+    s_.dt = (int32_t)((uint32_t)q[F_T] - (uint32_t)s_.q[F_T]);
+    for (int f = 0; f < TELEM_CODEC_FIELDS; f++) s_.q[f] = q[f];
+    from_fields(q, out);
+    return n;
+}
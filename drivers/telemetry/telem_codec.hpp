@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+
+// Compact sample stream for the telemetry ring: fixed-point, delta and varint
+// encoded, 6-10 bytes per sample during a run instead of 40.
+//
+// Each field is quantized to the precision /api/log.csv prints anyway
+// (0.1 g / 0.1 deg, 0.01 for the PID terms and vib), so a decoded sample
+// formats to the same CSV row as the float original (up to half-way rounding).
+//
+// A sample is encoded against the previous one:
+//
+//   | varint mask | varint zigzag(residual) for every set mask bit ... |
+//
+// The residual of a field is its change minus a prediction:
+//   - weight, servo, p, i, d, vib, setpoint: predicted unchanged
+//   - dispensed: predicted -delta(weight) (dispensed = start - weight)
+//   - gross:     predicted +delta(weight) (same load cell, other zero)
+//   - t_ms:      predicted the previous interval (steady PID rate)
+// A zero residual costs nothing, only its clear mask bit. The fields that move
+// every PID sample come first, so the mask usually fits its first byte.
+//
+// reset() makes the next sample a keyframe (encoded against zero): a decoder
+// can start at any keyframe. No Pico SDK dependencies - round-trips on a host.
+
+struct TelemetrySample {
+    uint32_t t_ms;       // ms since dispense start
+    float setpoint;      // target grams
+    float dispensed;     // PID input (grams dispensed so far)
+    float weight;        // tare-relative scale reading (grams)
+    float gross;         // absolute bag weight vs calibrated zero (grams)
+    float servo;         // PID output = servo angle (degrees)
+    float p, i, d;       // PID term contributions (GetLastP/I/D)
+    float vib;           // vibrator intensity 0..1
+};
+static_assert(sizeof(TelemetrySample) == 40, "unexpected padding");
+
+inline constexpr int TELEM_CODEC_FIELDS    = 10;
+inline constexpr int TELEM_CODEC_MAX_BYTES = 2 + TELEM_CODEC_FIELDS * 5;   // worst case per sample
+
+// Quantized sample, fields in encoding (mask bit) order
+struct TelemCodecState {
+    int32_t q[TELEM_CODEC_FIELDS];
+    int32_t dt;          // previous t_ms interval
+};
+
+class TelemEncoder {
+public:
+    void reset() { s_ = {}; }
+    // Encode s into out (TELEM_CODEC_MAX_BYTES room) and return its length
+    int encode(const TelemetrySample& s, uint8_t* out);
+private:
+    TelemCodecState s_ = {};
+};
+
+class TelemDecoder {
+public:
+    void reset() { s_ = {}; }
+    // Decode one sample from in[0..len); bytes consumed, or 0 when the input
+    // is truncated or malformed (state left unchanged)
+    int decode(const uint8_t* in, int len, TelemetrySample& out);
+private:
+    TelemCodecState s_ = {};
+};
@@ -1,64 +1,295 @@
 #include "telemetry.hpp"
 #include "pico/stdlib.h"
 #include "hardware/sync.h"
+#include <cstring>
 
-static TelemetrySample s_buf[TELEM_CAPACITY];
-static volatile uint32_t s_count  = 0;
-static volatile uint32_t s_run_id = 0;
-static volatile bool     s_active = false;
+// Block number n lives at s_blocks[n % TELEM_BLOCKS]. used/count/sealed are
+// the only fields that change while the block is open (core 1); the header is
+// written before the block is published through s_nblk. Bytes below used never
+// change until the block is reused.
+struct Block {
+    uint32_t          run_id;
+    uint32_t          first_idx;   // run sample index of the block's keyframe
+    volatile uint16_t used;        // bytes written to data (>= those of count samples)
+    volatile uint16_t count;       // samples published in data
+    volatile bool     sealed;      // count final, the run's next block published
+    uint8_t           data[TELEM_BLOCK_BYTES];
+};
+static Block s_blocks[TELEM_BLOCKS];
+static volatile uint32_t s_nblk = 0;   // blocks ever opened
+static volatile uint32_t s_lo   = 0;   // oldest block number still in s_blocks
 
-// Run metadata (written only between runs / at run boundaries)
-static uint8_t  s_scale    = 0;
-static uint16_t s_target_g = 0;
-static float    s_kp = 0, s_ki = 0, s_kd = 0;
-static float    s_final_g  = 0;
-static char     s_name[16] = {0};
+// Writer state per stream (scale). run_id is set on core 0 by begin_run before
+// StartDispense goes out; the rest is core 1's during the run.
+struct Writer {
+    uint32_t     run_id;      // 0 = no run on this stream
+    TelemEncoder enc;
+    uint32_t     blk;         // the stream's open block
+    uint32_t     used;        // bytes used in it
+    bool         has_block;
+};
+static Writer s_writers[TELEM_STREAMS];
 
-void telem_begin_run(uint8_t scale, uint16_t target_g, float kp, float ki, float kd,
-                     const char* name) {
+// One run slot per run_id % TELEM_MAX_RUNS. count is the only field written
+// while a run is active (core 1); the rest change at run boundaries.
+struct RunSlot {
+    TelemetryMeta     meta;
+    uint32_t          first_blk;   // block number of the run's first block
+    volatile uint32_t count;
+};
+static RunSlot s_runs[TELEM_MAX_RUNS];
+static volatile uint32_t s_run_id = 0;   // newest run; 0 = none yet
+
+// RAM budget: the linear 2000-sample buffer telemetry had before the ring.
+// More runs or samples have to come from the codec, not from more RAM.
+static_assert(sizeof(s_blocks) + sizeof(s_writers) + sizeof(s_runs) <=
+                  2000 * sizeof(TelemetrySample),
+              "telemetry outgrew the 2000-sample RAM budget");
+
+static RunSlot& slot_of(uint32_t run_id) { return s_runs[run_id % TELEM_MAX_RUNS]; }
+
+// a < b for block numbers (wrap-safe)
+static bool before(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+uint32_t telem_begin_run(uint8_t scale, uint16_t target_g, float kp, float ki, float kd,
+                         const char* name, uint16_t sample_ms) {
     // Caller holds the lwIP lock (cyw43_arch_lwip_begin) so an in-flight CSV
-    // reader cannot observe the reset mid-row.
-    s_count  = 0;
-    s_scale  = scale;
-    s_target_g = target_g;
-    s_kp = kp; s_ki = ki; s_kd = kd;
-    s_final_g = 0;
-    s_name[0] = '\0';
+    // reader of the run that used this slot before cannot observe the rewrite.
+    uint32_t id = s_run_id + 1;
+    RunSlot& r = slot_of(id);
+    TelemetryMeta& m = r.meta;
+    m = {};
+    m.run_id = id;
+    m.active = true;
+    m.scale  = scale;
+    m.target_g = target_g;
+    m.kp = kp; m.ki = ki; m.kd = kd;
+    m.sample_ms = sample_ms;
     if (name) {
-        for (unsigned i = 0; i < sizeof(s_name) - 1 && name[i]; i++) s_name[i] = name[i];
-        s_name[sizeof(s_name) - 1] = '\0';
+        for (unsigned i = 0; i < sizeof(m.name) - 1 && name[i]; i++) m.name[i] = name[i];
+    }
+    // Blocks opened before now belong to other runs; this one's come later
+    r.first_blk = s_nblk;
+    r.count = 0;
+    __dmb();          // slot complete before the new id makes it the newest run
+    s_run_id = id;
+
+    Writer& w = s_writers[scale % TELEM_STREAMS];
+    w.has_block = false;
+    w.run_id = id;    // core 1 sees it after the StartDispense that follows
+    return id;
+}
+
+// Start block s_nblk for a stream, retiring the oldest block first if the
+// ring is full, then seal the stream's previous block
+static void open_block(Writer& w, uint32_t first_idx) {
+    uint32_t n = s_nblk;
+    if (n - s_lo >= TELEM_BLOCKS) {
+        s_lo = n + 1 - TELEM_BLOCKS;
+        __dmb();      // readers of the old block see it retired before it changes
+    }
+    Block& b = s_blocks[n % TELEM_BLOCKS];
+    b.count     = 0;
+    b.used      = 0;
+    b.sealed    = false;
+    b.run_id    = w.run_id;
+    b.first_idx = first_idx;
+    __dmb();
+    s_nblk = n + 1;
+    if (w.has_block && !before(w.blk, s_lo)) {
+        __dmb();      // successor published before the seal points readers at it
+        s_blocks[w.blk % TELEM_BLOCKS].sealed = true;
     }
-    s_active  = true;
-    s_run_id  = s_run_id + 1;
+    w.blk = n;
+    w.used = 0;
+    w.has_block = true;
+    w.enc.reset();    // keyframe: the block decodes on its own
 }
 
-void telem_append(const TelemetrySample& s) {
-    uint32_t idx = s_count;
-    if (idx >= TELEM_CAPACITY) return;   // buffer full - stop recording
-    s_buf[idx] = s;
-    __dmb();          // row fully written before publishing the new count
-    s_count = idx + 1;
+void telem_append(uint8_t scale, const TelemetrySample& s) {
+    Writer& w = s_writers[scale % TELEM_STREAMS];
+    if (w.run_id == 0) return;
+    RunSlot& r = slot_of(w.run_id);
+    uint8_t enc[TELEM_CODEC_MAX_BYTES];
+    int n = 0;
+    // The open block can only have been reused if the other streams filled
+    // the whole ring meanwhile - start afresh rather than write into it
+    bool have_block = w.has_block && !before(w.blk, s_lo);
+    if (have_block) {
+        n = w.enc.encode(s, enc);
+        if (w.used + n > TELEM_BLOCK_BYTES) have_block = false;
+    }
+    if (!have_block) {
+        open_block(w, r.count);
+        n = w.enc.encode(s, enc);
+    }
+    Block& b = s_blocks[w.blk % TELEM_BLOCKS];
+    memcpy(b.data + w.used, enc, n);
+    w.used += n;
+    b.used = (uint16_t)w.used;
+    __dmb();          // bytes fully written before publishing the new count
+    b.count = b.count + 1;
+    r.count = r.count + 1;
+}
+
+void telem_end_run(uint8_t scale, float final_g) {
+    Writer& w = s_writers[scale % TELEM_STREAMS];
+    if (w.run_id == 0) return;
+    TelemetryMeta& m = slot_of(w.run_id).meta;
+    m.final_g = final_g;
+    m.active  = false;
+    if (w.has_block && !before(w.blk, s_lo)) {
+        s_blocks[w.blk % TELEM_BLOCKS].sealed = true;   // no successor: the run ended
+    }
+    w.run_id = 0;
 }
 
-void telem_end_run(float final_g) {
-    s_final_g = final_g;
-    s_active  = false;
+// Find run_id's first block numbered blk or later: 1 (blk set to it), 0 = not
+// opened yet, -1 = blk already reused. Other streams' blocks are skipped.
+static int seek_block(uint32_t run_id, uint32_t& blk) {
+    uint32_t nblk = s_nblk;
+    __dmb();          // headers of blocks behind nblk are written
+    for (uint32_t b = blk; before(b, nblk); b++) {
+        uint32_t rid = s_blocks[b % TELEM_BLOCKS].run_id;
+        __dmb();
+        if (before(b, s_lo)) return -1;   // reused while reading its header
+        if (rid == run_id) { blk = b; return 1; }
+    }
+    return before(blk, s_lo) ? -1 : 0;
+}
+
+// First sample index still held for a run starting at first_blk with count
+// samples (count when all of it was overwritten)
+static uint32_t dropped_of(uint32_t run_id, uint32_t first_blk, uint32_t count) {
+    for (;;) {
+        uint32_t lo = s_lo;
+        if (!before(first_blk, lo)) return 0;
+        uint32_t blk = lo;
+        int r = seek_block(run_id, blk);
+        if (r < 0) continue;        // ring moved on while scanning
+        if (r == 0) return count;
+        uint32_t first = s_blocks[blk % TELEM_BLOCKS].first_idx;
+        __dmb();
+        if (before(blk, s_lo)) continue;
+        return first;
+    }
+}
+
+bool telem_run_meta(uint32_t run_id, TelemetryMeta& out) {
+    if (run_id == 0) return false;
+    const RunSlot& r = slot_of(run_id);
+    if (r.meta.run_id != run_id) return false;   // slot reused by a newer run
+    out = r.meta;
+    out.count   = r.count;
+    out.dropped = dropped_of(run_id, r.first_blk, out.count);
+    // A finished run with every sample overwritten is gone; an empty run
+    // (stopped before the first PID sample) stays until its slot is reused
+    return out.active || out.count == 0 || out.dropped < out.count;
 }
 
 TelemetryMeta telem_meta() {
     TelemetryMeta m;
-    m.run_id  = s_run_id;
-    m.count   = s_count;
-    m.active  = s_active;
-    m.scale   = s_scale;
-    m.target_g = s_target_g;
-    m.kp = s_kp; m.ki = s_ki; m.kd = s_kd;
-    m.final_g = s_final_g;
-    for (unsigned i = 0; i < sizeof(m.name); i++) m.name[i] = s_name[i];
+    if (!telem_run_meta(s_run_id, m)) {
+        m = {};
+        m.run_id = s_run_id;   // keeps "has a run happened" visible to the UI
+    }
     return m;
 }
 
-const TelemetrySample* telem_sample(uint32_t idx) {
-    if (idx >= s_count) return nullptr;
-    return &s_buf[idx];
+uint32_t telem_runs(uint32_t* ids, uint32_t max) {
+    uint32_t newest = s_run_id;
+    uint32_t n = 0;
+    TelemetryMeta m;
+    for (uint32_t k = 0; k < TELEM_MAX_RUNS && k < newest && n < max; k++) {
+        if (telem_run_meta(newest - k, m)) ids[n++] = newest - k;
+    }
+    return n;
+}
+
+bool telem_open(uint32_t run_id, TelemCursor& c) {
+    TelemetryMeta m;
+    if (!telem_run_meta(run_id, m)) return false;
+    uint32_t first_blk = slot_of(run_id).first_blk;
+    for (;;) {
+        uint32_t lo = s_lo;
+        uint32_t blk = first_blk, idx = 0;
+        if (before(first_blk, lo)) {
+            // Head of the run overwritten: start at its oldest block left
+            blk = lo;
+            int r = seek_block(run_id, blk);
+            if (r < 0) continue;
+            if (r == 0) {
+                if (!m.active) return false;
+                idx = m.count;        // nothing held yet: wait for new blocks
+            } else {
+                idx = s_blocks[blk % TELEM_BLOCKS].first_idx;
+                __dmb();
+                if (before(blk, s_lo)) continue;   // reused while reading its header
+            }
+        }
+        c.run_id = run_id;
+        c.idx = idx;
+        c.blk = blk;
+        c.k   = 0;
+        c.off = 0;
+        c.dec.reset();
+        return true;
+    }
+}
+
+int telem_next(TelemCursor& c, TelemetrySample& out) {
+    for (;;) {
+        uint32_t blk = c.blk;
+        int r = seek_block(c.run_id, blk);
+        if (r <= 0) return r;
+        const Block& b = s_blocks[blk % TELEM_BLOCKS];
+        if (blk != c.blk) {           // skipped other streams' blocks
+            c.blk = blk;
+            c.idx = b.first_idx;      // re-checked against s_lo below
+            c.k = 0;
+            c.off = 0;
+            c.dec.reset();
+        }
+        bool sealed = b.sealed;
+        __dmb();      // sealed read before count: a sealed block's count is final
+        uint16_t cnt = b.count;
+        __dmb();      // count read before the bytes it publishes
+        if (before(c.blk, s_lo)) return -1;
+
+        if (c.k < cnt) {
+            TelemDecoder d = c.dec;
+            int n = d.decode(b.data + c.off, (int)(TELEM_BLOCK_BYTES - c.off), out);
+            __dmb();  // decoded before re-checking the block wasn't reused
+            if (before(c.blk, s_lo) || n == 0) return -1;
+            c.dec = d;
+            c.off += n;
+            c.k++;
+            c.idx++;
+            return 1;
+        }
+        if (!sealed) return 0;    // open block, nothing new yet
+        c.blk++;                  // block finished: next keyframe
+        c.k = 0;
+        c.off = 0;
+        c.dec.reset();
+    }
+}
+
+int telem_block(uint32_t run_id, uint32_t& blk, TelemBlockRef& out) {
+    int r = seek_block(run_id, blk);
+    if (r <= 0) return r;
+    const Block& b = s_blocks[blk % TELEM_BLOCKS];
+    out.first_idx = b.first_idx;
+    out.count = b.count;
+    __dmb();          // count before used: used covers at least count samples
+    out.bytes = b.used;
+    out.data  = b.data;
+    __dmb();
+    if (before(blk, s_lo)) return -1;
+    return 1;
+}
+
+bool telem_block_valid(uint32_t blk) {
+    __dmb();
+    return !before(blk, s_lo);
 }
@@ -1,50 +1,104 @@
 #pragma once
 #include <cstdint>
+#include "telem_codec.hpp"
 
-// PID tuning telemetry: captures one sample per actual PID computation (20 Hz)
-// during a dispense run into a fixed linear buffer, for the /api/log.csv endpoint.
+// PID tuning telemetry: captures one sample per actual PID computation (10-40 Hz,
+// see sample_ms) during a dispense run, for the /api/runs and /api/log.csv
+// endpoints.
 //
-// Concurrency contract (single core, no locks needed for reads):
-//   - Writer: main loop only (telem_begin_run / telem_append / telem_end_run).
-//   - Reader: lwIP callbacks in background-IRQ context (telem_meta / telem_sample).
-//   - telem_append fills the row completely BEFORE incrementing the published count,
-//     so a reader never sees a half-written sample.
-//   - telem_begin_run resets the buffer; the CALLER must wrap it in
-//     cyw43_arch_lwip_begin()/end() so the reset cannot interleave with an
-//     in-flight CSV send. Readers snapshot run_id and drop the connection if it
-//     changes mid-stream.
+// Samples are stored encoded (telem_codec.hpp, ~7 bytes instead of 40) in a
+// ring of fixed-size blocks shared by the last TELEM_MAX_RUNS runs. Blocks get
+// an absolute sequence number; each belongs to one run and starts with a
+// keyframe, so a run can be decoded from any of its blocks. Up to TELEM_STREAMS
+// runs record at once (one per scale, parallel dispensing), so a run's blocks
+// are the ones tagged with its id from its begin_run on, interleaved with the
+// other streams'. When the ring is full the oldest block is reused, so a long
+// run overwrites the oldest runs instead of stopping, and a run whose blocks
+// all left the ring is dropped from the index. A run's metadata lives in slot
+// run_id % TELEM_MAX_RUNS.
 //
-// Linear capture, not a ring: recording simply stops when full (first ~100 s of a
-// run at 20 Hz). Within one run a written sample is immutable — lock-free reads.
+// Concurrency contract (no locks needed for reads):
+//   - One writer per stream: telem_begin_run / telem_end_run for a scale run on
+//     core 0 before StartDispense is sent and after core 1 reported that
+//     scale's run end; telem_append runs on core 1 (app/control.cpp) only in
+//     between. All appends come from the one core-1 loop, so opening blocks
+//     never races itself.
+//   - Reader: lwIP callbacks in background-IRQ context on core 0.
+//   - telem_append raises the oldest valid block number BEFORE it reuses a
+//     block, and writes a sample's bytes completely BEFORE publishing the
+//     block's new count (DMBs in both places, so this holds across the cores).
+//     A stream seals its block only after its next block is published, so a
+//     sealed block's count is final and the run continues further on.
+//     telem_next decodes in place and then re-checks the oldest valid block:
+//     a sample that raced the writer is reported as overwritten, never
+//     returned torn.
+//   - telem_begin_run / telem_end_run rewrite a run slot; the CALLER must wrap
+//     them in cyw43_arch_lwip_begin()/end() so that cannot interleave with an
+//     in-flight CSV send. Readers hold a run_id, and a reused slot no longer
+//     matches it.
 
-struct TelemetrySample {
-    uint32_t t_ms;       // ms since dispense start
-    float setpoint;      // target grams
-    float dispensed;     // PID input (grams dispensed so far)
-    float weight;        // tare-relative scale reading (grams)
-    float gross;         // absolute bag weight vs calibrated zero (grams)
-    float servo;         // PID output = servo angle (degrees)
-    float p, i, d;       // PID term contributions (GetLastP/I/D)
-    float vib;           // vibrator intensity 0..1
-};
-static_assert(sizeof(TelemetrySample) == 40, "unexpected padding");
-
-inline constexpr uint32_t TELEM_CAPACITY = 2000;   // 100 s @ 20 Hz, ~70 KB static
+// The ring stays within the RAM the old 2000-sample buffer took: 256 blocks
+// of 272 bytes (header included) are 68 KB. telem_codec_bench's dispense
+// packs ~49 samples a block (5.5 B/sample with the header, against 40 raw),
+// so that is ~12000 samples, about 7x fewer bytes per sample; noisier runs
+// and short ones (a partly filled last block) hold fewer.
+inline constexpr uint32_t TELEM_BLOCK_BYTES = 256;   // encoded samples per block (~49)
+inline constexpr uint32_t TELEM_BLOCKS      = 256;   // ~68 KB static, ~12000 samples
+inline constexpr uint32_t TELEM_MAX_RUNS    = 16;    // run index depth
+inline constexpr uint32_t TELEM_STREAMS     = 3;     // concurrent runs, one per scale
 
 struct TelemetryMeta {
     uint32_t run_id;     // increments each begin_run; 0 = no run yet
-    uint32_t count;      // valid samples
+    uint32_t count;      // samples appended to the run
+    uint32_t dropped;    // leading samples already overwritten (<= count)
     bool     active;     // run in progress
     uint8_t  scale;      // 0..2
     uint16_t target_g;
     float    kp, ki, kd;
     float    final_g;    // set by end_run (0 while active)
     char     name[16];   // scale contents at run start ("Wheat", ...)
+    uint16_t sample_ms;  // PID sample time of the run (HX711 rate / filter)
 };
 
-void telem_begin_run(uint8_t scale, uint16_t target_g, float kp, float ki, float kd,
-                     const char* name);
-void telem_append(const TelemetrySample& s);        // drops silently when full
-void telem_end_run(float final_g);
-TelemetryMeta telem_meta();                          // safe from IRQ context
-const TelemetrySample* telem_sample(uint32_t idx);   // nullptr if idx >= count
+// The scale is also the stream: one run per scale at a time. Returns the run id.
+uint32_t telem_begin_run(uint8_t scale, uint16_t target_g, float kp, float ki, float kd,
+                         const char* name, uint16_t sample_ms);
+// Overwrites the oldest samples when full; ignored with no run on the scale
+void telem_append(uint8_t scale, const TelemetrySample& s);
+void telem_end_run(uint8_t scale, float final_g);
+
+// Sequential reader over one run's samples (decoder state included)
+struct TelemCursor {
+    uint32_t     run_id;
+    uint32_t     idx;    // run sample index of the next sample
+    uint32_t     blk;    // absolute block number
+    uint16_t     k;      // samples already read from blk
+    uint16_t     off;    // byte offset of the next sample in blk
+    TelemDecoder dec;
+};
+
+// All readers are safe from IRQ context.
+TelemetryMeta telem_meta();                                // newest run (run_id 0 if none)
+bool telem_run_meta(uint32_t run_id, TelemetryMeta& out);  // false once the run is gone
+// Ids of the runs that still have samples (or are active), newest first
+uint32_t telem_runs(uint32_t* ids, uint32_t max);
+// Position c at the run's oldest sample still held (c.idx = samples dropped)
+bool telem_open(uint32_t run_id, TelemCursor& c);
+// 1 = next sample in out, 0 = no further sample published (yet),
+// -1 = the ring overwrote the cursor's position
+int telem_next(TelemCursor& c, TelemetrySample& out);
+
+// Raw access to the encoded blocks, for streaming them out as they are
+// (/api/log.bin). data[0..bytes) starts with a keyframe and holds at least
+// count samples; those bytes stay unchanged until the block is reused.
+struct TelemBlockRef {
+    const uint8_t* data;
+    uint16_t       bytes;
+    uint16_t       count;
+    uint32_t       first_idx;   // run sample index of the block's first sample
+};
+// The run's first block numbered blk or later (blk updated to it): 1 = found,
+// 0 = none opened yet, -1 = blk already reused
+int telem_block(uint32_t run_id, uint32_t& blk, TelemBlockRef& out);
+// Still not reused (re-check after copying out of a TelemBlockRef)
+bool telem_block_valid(uint32_t blk);
@@ -53,6 +53,7 @@ void Vibrator::attachShared(SharedSlice* s) {
 }
 
 void Vibrator::setIntensity(float intensity) {
+    SharedSlice::Guard g(_shared);   // no-op on an unshared slice
     _intensity = clamp01(intensity);
     if (_shared) {
         // Coordinator picks the frequency (20 kHz while the servo is idle, 333 Hz
@@ -0,0 +1,55 @@
+# Build step for the webserver driver: gzip the WEB_PAGE raw string out of
+# web_page.h into a byte-array header, so GET / can send ~10 KB instead of
+# ~40 KB. web_page.h stays the one file to edit; this re-runs whenever it
+# changes.
+#
+#   cmake -DIN=web_page.h -DOUT=web_page_gz.h -DFW_VERSION=0.1 -P gzip_page.cmake
+#
+# The ETag is the firmware version plus a hash of the uncompressed page (the
+# gzip header carries an mtime, so the compressed bytes aren't reproducible):
+# a new flash with a changed page always invalidates a phone's cached copy.
+cmake_minimum_required(VERSION 3.19)   # file(ARCHIVE_CREATE ... COMPRESSION_LEVEL)
+
+file(READ "${IN}" src)
+string(FIND "${src}" "R\"rawhtml(" begin)
+string(FIND "${src}" ")rawhtml\"" end)
+if(begin EQUAL -1 OR end EQUAL -1)
+    message(FATAL_ERROR "gzip_page: no R\"rawhtml(...)rawhtml\" literal in ${IN}")
+endif()
+math(EXPR begin "${begin} + 10")
+math(EXPR len "${end} - ${begin}")
+string(SUBSTRING "${src}" ${begin} ${len} page)
+string(SHA1 page_hash "${page}")
+string(SUBSTRING "${page_hash}" 0 12 page_hash)
+
+get_filename_component(work "${OUT}" DIRECTORY)
+set(html "${work}/web_page.html")
+set(gz "${work}/web_page.html.gz")
+file(WRITE "${html}" "${page}")
+file(REMOVE "${gz}")
+file(ARCHIVE_CREATE OUTPUT "${gz}" PATHS "${html}"
+     FORMAT raw COMPRESSION GZip COMPRESSION_LEVEL 9)
+
+file(READ "${gz}" hex HEX)
+string(LENGTH "${hex}" hex_len)
+math(EXPR gz_len "${hex_len} / 2")
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+string(REPEAT "0x[0-9a-f][0-9a-f]," 16 row)   # CMake regexes have no {n}
+string(REGEX REPLACE "(${row})" "\\1\n    " bytes "${bytes}")
+
+file(WRITE "${OUT}"
+"// Generated by drivers/webserver/gzip_page.cmake from web_page.h - do not edit.
+#ifndef _WEB_PAGE_GZ_H
+#define _WEB_PAGE_GZ_H
+
+#include <cstdint>
+
+#define WEB_PAGE_ETAG \"\\\"${FW_VERSION}-${page_hash}\\\"\"
+
+static const unsigned WEB_PAGE_GZ_LEN = ${gz_len};
+static const uint8_t WEB_PAGE_GZ[] = {
+    ${bytes}
+};
+
+#endif // _WEB_PAGE_GZ_H
+")
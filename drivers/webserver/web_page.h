@@ -5,7 +5,7 @@
 // as "ui" in /api/status), the UI_V constant in the page script, and the
 // version tag in the masthead. The page compares UI_V against the status
 // field to detect a stale cached copy of itself.
-#define KD_UI_VERSION 9
+#define KD_UI_VERSION 16
 
 static const char WEB_PAGE[] = R"rawhtml(<!DOCTYPE html>
 <html lang="en">
@@ -74,6 +74,8 @@ section.closed .sbody{display:none}
 .scell .sw.low{color:var(--red)}
 .scell .sc{font-size:10px;letter-spacing:.05em;color:var(--ink2)}
 .scell .sc.no{color:var(--red)}
+.scell .sr{font-size:11px;font-weight:600;min-height:14px;margin-top:2px;color:var(--ink2)}
+.scell .sr.on{color:var(--red)}
 .bignum{font-size:60px;font-weight:700;letter-spacing:-.02em;text-align:center;
  padding:6px 0 2px;line-height:1}
 .bignum small{font-size:22px;font-weight:400;color:var(--ink2)}
@@ -150,7 +152,7 @@ body.estop-on{padding-bottom:64px}
 OLD CACHED PAGE &middot; clear Safari website data, or remove &amp; re-add the home-screen icon</div>
 
 <header class="masthead">
-<h1>KORN DISPENSER <span style="font-size:10px;font-weight:400;color:var(--ink2);letter-spacing:0">v9</span></h1>
+<h1>KORN DISPENSER <span style="font-size:10px;font-weight:400;color:var(--ink2);letter-spacing:0">v16</span></h1>
 <div class="statusline num" id="statusText">CONNECTING&hellip;</div>
 </header>
 
@@ -165,6 +167,9 @@ OLD CACHED PAGE &middot; clear Safari website data, or remove &amp; re-add the h
 <h2 onclick="toggleSec('sec-contents')">Contents<span class="chev">&#9662;</span></h2>
 <div class="sbody">
 <div id="contentsRows"></div>
+<div class="lbl" style="margin-top:18px">Bags &middot; reserve = gross weight where the flow stops</div>
+<table><tbody id="bagBody"></tbody></table>
+<div class="substatus num" id="bagLog"></div>
 </div>
 </section>
 
@@ -184,6 +189,43 @@ OLD CACHED PAGE &middot; clear Safari website data, or remove &amp; re-add the h
 </div>
 </section>
 
+<section id="sec-queue">
+<h2 onclick="toggleSec('sec-queue')">Order Queue<span class="chev">&#9662;</span></h2>
+<div class="sbody">
+<div class="field"><label for="queCount">Bags &middot; the selected scale and target each</label>
+<input type="number" id="queCount" min="1" max="999" value="10"></div>
+<div class="substatus num" id="queInfo"></div>
+<div class="row">
+<button class="btn btn-pri" id="queStart" onclick="queStart()">Start Queue</button>
+<button class="btn" id="queNext" onclick="queNext()" style="display:none">Next Bag</button>
+<button class="btn btn-stop" id="queStop" onclick="queStop()" style="display:none">Stop Queue</button>
+</div>
+</div>
+</section>
+
+<section id="sec-recipe">
+<h2 onclick="toggleSec('sec-recipe')">Recipes<span class="chev">&#9662;</span></h2>
+<div class="sbody">
+<table><tbody id="rcpBody"></tbody></table>
+<div class="empty" id="rcpEmpty">No recipes saved yet.</div>
+<div class="field"><label for="rcpRunTotal">Batch &middot; grams (blank = as saved)</label>
+<input type="number" id="rcpRunTotal" min="1" max="9999"></div>
+<div class="substatus num" id="batchInfo"></div>
+<div class="row" id="batchStop" style="display:none">
+<button class="btn btn-stop" onclick="rcpStop()">Stop Batch</button>
+</div>
+<div class="lbl" style="margin-top:18px">Edit</div>
+<div class="crow"><span class="lbl">Slot</span><select id="rcpSlot" onchange="rcpEdit()"></select></div>
+<div class="crow"><span class="lbl">Name</span><input type="text" id="rcpName" maxlength="15"></div>
+<div class="crow"><span class="lbl">Total g</span><input type="text" id="rcpTotal" inputmode="numeric" placeholder="for % items"></div>
+<div id="rcpItems"></div>
+<div class="row">
+<button class="btn btn-pri" onclick="rcpSave()">Save</button>
+<button class="btn" onclick="rcpDelete()">Delete</button>
+</div>
+</div>
+</section>
+
 <section id="sec-chart">
 <h2 onclick="toggleSec('sec-chart')">Run Chart<span class="chev">&#9662;</span></h2>
 <div class="sbody">
@@ -202,6 +244,7 @@ OLD CACHED PAGE &middot; clear Safari website data, or remove &amp; re-add the h
 <section id="sec-pid">
 <h2 onclick="toggleSec('sec-pid')">PID<span class="chev">&#9662;</span></h2>
 <div class="sbody">
+<div class="runmeta" id="pidScale"></div>
 <div class="pidgrid">
 <div class="field"><label for="pidKp">Kp</label><input type="number" id="pidKp" step="0.1" min="0"></div>
 <div class="field"><label for="pidKi">Ki</label><input type="number" id="pidKi" step="0.01" min="0"></div>
@@ -211,6 +254,19 @@ OLD CACHED PAGE &middot; clear Safari website data, or remove &amp; re-add the h
 <button class="btn btn-pri" onclick="applyPID()">Apply</button>
 </div>
 <div style="text-align:center;margin-top:8px"><span class="saved" id="pidSaved">Saved</span></div>
+<div class="pidgrid" style="margin-top:14px">
+<div class="field"><label for="atOpen">Step&deg;</label><input type="number" id="atOpen" step="5" min="10" max="80" value="40"></div>
+<div class="field"><label for="atMax">Max g</label><input type="number" id="atMax" step="50" min="50" value="400"></div>
+<div class="field"><label for="atTc">Tc s</label><input type="number" id="atTc" step="0.1" min="0.1" value="1.0"></div>
+</div>
+<div class="row">
+<button class="btn" id="btnTune" onclick="startTune()">Autotune</button>
+</div>
+<div class="runmeta" id="atInfo"></div>
+<div class="row" id="atUse" style="display:none">
+<button class="btn" onclick="useTune(0)">Use</button>
+<button class="btn btn-pri" onclick="useTune(1)">Use + Save</button>
+</div>
 </div>
 </section>
 
@@ -286,18 +342,20 @@ OLD CACHED PAGE &middot; clear Safari website data, or remove &amp; re-add the h
 
 <script>
 const $=id=>document.getElementById(id);
-const UI_V=9; // must match KD_UI_VERSION + the masthead tag
+const UI_V=16; // must match KD_UI_VERSION + the masthead tag
 const LOW_BAG_G=500; // bag weight below this renders red on the scale cards
+const BAG_LOW_RUNS=3; // ... or this few runs left (BAG_LOW_RUNS in the firmware)
 const INK='#111',INK2='#666',HAIR='#ddd',RED='#E30613';
 // Series colors - validated categorical set (dispensed stays ink, setpoint red)
 const CSRV='#2a78d6',CBAG='#eda100',CVIB='#1baf7a',CP='#eb6834',CI='#4a3aa7',CD='#008300';
 
-// --- Live graph state (750 ms poll samples) ---
-const G={buf:[],gross:[],servo:[],vib:[],max:60};
+// --- Live graph state: one sample per 250 ms of status (45 s window; the
+// polling fallback only delivers one per 750 ms, stretching it to 135 s) ---
+const G={buf:[],gross:[],servo:[],vib:[],max:180,ms:250,last:0};
 let graphCanvas,graphCtx;
 let lastTgt=100;
 
-// --- Post-run data (full 10 Hz from /api/log.csv) ---
+// --- Post-run data (full 10 Hz from /api/log.bin) ---
 let R=null;                 // {t,sp,disp,w,gross,servo,p,i,d,vib,meta}
 let lastRunLoaded=0;
 let loadingRun=false;
@@ -309,13 +367,14 @@ let pendingScale=-1,pendingUntil=0;
 
 // --- History ---
 let history=JSON.parse(localStorage.getItem('kd_history')||'[]');
-let prevDone=false,prevDisp=false;
-let pidLoaded=false;
+let prevAct=null;            // run_active at the previous status
+let runQueue=[],runTries=0;  // finished runs whose logs are still to fetch
+let pidLoaded=false,pidScale=-1;
 let busy=false;
 
 // --- Collapsible sections (state remembered per device) ---
 const SEC_DEFAULT={'sec-scales':1,'sec-contents':0,'sec-dispense':1,'sec-chart':1,
- 'sec-pid':0,'sec-test':0,'sec-servo':0,'sec-cal':0,'sec-hist':0};
+ 'sec-queue':1,'sec-recipe':1,'sec-pid':0,'sec-test':0,'sec-servo':0,'sec-cal':0,'sec-hist':0};
 let secOpen=Object.assign({},SEC_DEFAULT,JSON.parse(localStorage.getItem('kd_sec')||'{}'));
 function applySec(){
  for(let k in SEC_DEFAULT){
@@ -390,11 +449,13 @@ function selScale(i){
 }
 function setTarget(v){api('POST','/api/target',{target:v});}
 function doTare(){api('POST','/api/tare');}
+// Runs are per scale (all three can dispense at once): start and stop the
+// selected one; the target travels with the command
 function startDisp(){
  setTarget(WHEELS.twheel.v);
- api('POST','/api/dispense',{action:'start'});
+ api('POST','/api/dispense',{action:'start',scale:lastSel,target:WHEELS.twheel.v});
 }
-function stopDisp(){api('POST','/api/dispense',{action:'stop'});}
+function stopDisp(){api('POST','/api/dispense',{action:'stop',scale:lastSel});}
 function sendServo(v){
  $('servoVal').textContent=v+'°';
  api('POST','/api/test/servo',{angle:parseInt(v)});
@@ -478,15 +539,179 @@ function doCal(){
  $('calStatus').textContent='Calibrating…';
  setTimeout(()=>$('calStatus').textContent='Done.',2000);
 }
+// Gains of the scale the fields show (the selected one when they loaded)
 function applyPID(){
  let kp=parseFloat($('pidKp').value)||0;
  let ki=parseFloat($('pidKi').value)||0;
  let kd=parseFloat($('pidKd').value)||0;
- api('POST','/api/pid',{kp:kp,ki:ki,kd:kd}).then(()=>{
+ api('POST','/api/pid',{scale:pidScale<0?lastSel:pidScale,kp:kp,ki:ki,kd:kd}).then(()=>{
   $('pidSaved').classList.add('show');
   setTimeout(()=>$('pidSaved').classList.remove('show'),2000);
  });
 }
+// --- Autotune: step test on the selected scale, then the fitted model and
+// proposed gains from /api/autotune ---
+let tuneScale=0,tuneWatch=false,tuneT0=0,tuneFetching=false;
+function startTune(){
+ tuneScale=lastSel;tuneWatch=true;tuneT0=Date.now();
+ $('atUse').style.display='none';
+ $('atInfo').textContent='Step test running on scale '+(tuneScale+1)+'…';
+ api('POST','/api/autotune',{action:'start',scale:tuneScale,
+  open:parseFloat($('atOpen').value)||40,max:parseFloat($('atMax').value)||400,
+  tc:parseFloat($('atTc').value)||1});
+}
+function loadTune(){
+ if(tuneFetching)return;
+ tuneFetching=true;
+ fetch('/api/autotune').then(r=>r.json()).then(j=>{
+  tuneFetching=false;
+  let t=j.scales[tuneScale];
+  if(t.state==='running')return;
+  tuneWatch=false;
+  if(t.state!=='done'){$('atInfo').textContent='Autotune failed (stopped, capped or no step found)';return;}
+  $('atInfo').textContent='k '+t.k.toFixed(3)+' g/s/° · dead '+t.dead.toFixed(2)+' s · tau '+
+   t.tau.toFixed(2)+' s → Kp '+t.kp.toFixed(3)+' Ki '+t.ki.toFixed(4)+' Kd '+t.kd.toFixed(3);
+  $('atUse').style.display='';
+ }).catch(()=>{tuneFetching=false;});
+}
+function useTune(save){
+ api('POST','/api/autotune',{action:'apply',scale:tuneScale,save:save}).then(()=>{
+  pidLoaded=false;
+  if(save){
+   $('pidSaved').classList.add('show');
+   setTimeout(()=>$('pidSaved').classList.remove('show'),2000);
+  }
+ });
+}
+// --- Order queue: /api/queue, fetched when the status reports a queue change
+// and every second while one runs ---
+let QUE={q:null,state:'',last:0,fetching:false};
+const QUE_PHASE={start:'STARTING',run:'DISPENSING',settle:'SETTLING',remove:'REMOVE THE BAG',
+ place:'PLACE THE NEXT BAG'};
+function queFetch(){
+ if(QUE.fetching)return;
+ QUE.fetching=true;QUE.last=Date.now();
+ fetch('/api/queue').then(r=>r.json()).then(j=>{
+  QUE.fetching=false;QUE.q=j;queRender();
+ }).catch(()=>{QUE.fetching=false;});
+}
+function queRender(){
+ let q=QUE.q,txt='',on=q&&q.state==='running';
+ if(q&&q.state!=='idle'){
+  txt='SCALE '+(q.scale+1)+' · '+q.done+'/'+q.count+' × '+q.target+' g · ';
+  txt+=on?QUE_PHASE[q.phase]:q.state.toUpperCase();
+  if(q.done)txt+=' · LAST '+q.last.toFixed(1)+' g · TOTAL '+q.total.toFixed(0)+' g';
+  if(q.error)txt+=' · '+q.error;
+ }
+ $('queInfo').textContent=txt;
+ $('queStart').style.display=on?'none':'';
+ $('queNext').style.display=on&&q.phase!=='run'&&q.phase!=='start'?'':'none';
+ $('queStop').style.display=on?'':'none';
+}
+function queStart(){
+ let n=parseInt($('queCount').value)||0;
+ if(n<1||n>999)return;
+ setTarget(WHEELS.twheel.v);
+ api('POST','/api/queue',{action:'start',scale:lastSel,target:WHEELS.twheel.v,count:n})
+  .then(()=>setTimeout(queFetch,300));
+}
+function queNext(){api('POST','/api/queue',{action:'next'}).then(()=>setTimeout(queFetch,300));}
+function queStop(){api('POST','/api/queue',{action:'stop'}).then(()=>setTimeout(queFetch,300));}
+// --- Recipes: the book and the running batch from /api/recipe, fetched when
+// the status reports a batch change and every second while one runs ---
+let RCP={list:[],batch:null,state:'',last:0,fetching:false};
+function rcpFetch(){
+ if(RCP.fetching)return;
+ RCP.fetching=true;RCP.last=Date.now();
+ fetch('/api/recipe').then(r=>r.json()).then(j=>{
+  RCP.fetching=false;
+  RCP.list=j.recipes||[];RCP.batch=j.batch||null;
+  rcpRender();
+ }).catch(()=>{RCP.fetching=false;});
+}
+function rcpItemText(it){
+ let n=(S&&S.names&&S.names[it[0]])||('Scale '+(it[0]+1));
+ return n+' '+it[2]+(it[3]==='%'?'%':' g')+(it[1]?' ('+(it[1]+1)+')':'');
+}
+function rcpRender(){
+ let html='';
+ for(let r of RCP.list){
+  html+='<tr><td>'+r.name+'</td><td>'+r.items.map(rcpItemText).join(' · ')+
+   (r.total?' of '+r.total+' g':'')+'</td><td><button class="tg" onclick="rcpRun('+r.slot+
+   ')">Run</button></td></tr>';
+ }
+ $('rcpBody').innerHTML=html;
+ $('rcpEmpty').style.display=RCP.list.length?'none':'block';
+ let b=RCP.batch,txt='';
+ if(b&&b.state!=='idle'){
+  let r=RCP.list.find(x=>x.slot===b.slot);
+  txt='BATCH '+(r?r.name.toUpperCase():'')+' · '+b.state.toUpperCase();
+  if(b.state==='running')txt+=' · STAGE '+(b.stage+1);
+  if(b.factor!==1)txt+=' · ×'+b.factor.toFixed(3);
+  if(b.error)txt+=' · '+b.error;
+  for(let it of b.items){
+   txt+=' · '+(it[0]+1)+': '+(it[4]==='pending'?it[2]+' g':
+    it[3].toFixed(1)+'/'+it[2]+(it[4]==='done'?' ✓':it[4]==='failed'?' ✗':''));
+  }
+ }
+ $('batchInfo').textContent=txt;
+ $('batchStop').style.display=b&&b.state==='running'?'':'none';
+ if(!$('rcpSlot').options.length)rcpInitEdit();
+}
+function rcpInitEdit(){
+ let o='';
+ for(let s=0;s<7;s++)o+='<option value="'+s+'">'+(s+1)+'</option>';
+ $('rcpSlot').innerHTML=o;
+ let h='';
+ for(let i=0;i<3;i++){
+  h+='<div class="crow"><span class="lbl">'+(i+1)+'</span>'+
+   '<select id="rcpS'+i+'"><option value="-1">&mdash;</option><option value="0">Scale 1</option>'+
+   '<option value="1">Scale 2</option><option value="2">Scale 3</option></select>'+
+   '<select id="rcpSt'+i+'"><option value="0">Stage 1</option><option value="1">Stage 2</option>'+
+   '<option value="2">Stage 3</option></select>'+
+   '<input type="text" id="rcpA'+i+'" inputmode="decimal" style="max-width:70px">'+
+   '<select id="rcpU'+i+'" style="max-width:50px"><option value="g">g</option>'+
+   '<option value="%">%</option></select></div>';
+ }
+ $('rcpItems').innerHTML=h;
+ rcpEdit();
+}
+// Fill the form from the chosen slot (blank when empty)
+function rcpEdit(){
+ let s=parseInt($('rcpSlot').value)||0;
+ let r=RCP.list.find(x=>x.slot===s);
+ $('rcpName').value=r?r.name:'';
+ $('rcpTotal').value=r&&r.total?r.total:'';
+ for(let i=0;i<3;i++){
+  let it=r&&r.items[i];
+  $('rcpS'+i).value=it?it[0]:-1;
+  $('rcpSt'+i).value=it?it[1]:i;
+  $('rcpA'+i).value=it?it[2]:'';
+  $('rcpU'+i).value=it?it[3]:'g';
+ }
+}
+function rcpSave(){
+ let items=[];
+ for(let i=0;i<3;i++){
+  let sc=parseInt($('rcpS'+i).value),a=parseFloat($('rcpA'+i).value);
+  if(sc<0||!(a>0))continue;
+  let it={scale:sc,stage:parseInt($('rcpSt'+i).value)};
+  if($('rcpU'+i).value==='%')it.pct=a;else it.g=Math.round(a);
+  items.push(it);
+ }
+ api('POST','/api/recipe',{action:'save',slot:parseInt($('rcpSlot').value)||0,
+  name:$('rcpName').value.trim()||('Recipe '+$('rcpSlot').value),
+  total:parseInt($('rcpTotal').value)||0,items:items}).then(()=>setTimeout(rcpFetch,300));
+}
+function rcpDelete(){
+ api('POST','/api/recipe',{action:'delete',slot:parseInt($('rcpSlot').value)||0})
+  .then(()=>setTimeout(()=>{rcpFetch();setTimeout(rcpEdit,300);},300));
+}
+function rcpRun(slot){
+ let t=parseInt($('rcpRunTotal').value)||0;
+ api('POST','/api/recipe',{action:'run',slot:slot,total:t}).then(()=>setTimeout(rcpFetch,300));
+}
+function rcpStop(){api('POST','/api/recipe',{action:'stop'});}
 function tgl(k){
  show[k]=!show[k];
  $('tg'+k.toUpperCase()).classList.toggle('on',show[k]);
@@ -534,6 +759,44 @@ function syncNames(d){
  }
 }
 
+// --- Bag levels and consumption (/api/bag), every 10 s while Contents is open ---
+let BAG={last:0,fetching:false};
+function bagFetch(){
+ if(BAG.fetching)return;
+ BAG.fetching=true;BAG.last=Date.now();
+ fetch('/api/bag').then(r=>r.json()).then(j=>{BAG.fetching=false;bagRender(j);})
+  .catch(()=>{BAG.fetching=false;});
+}
+function bagRender(j){
+ let html='<tr><th></th><th>Left</th><th>Runs</th><th>g/day</th><th>Days</th><th>Reserve</th></tr>';
+ j.scales.forEach((b,i)=>{
+  let ed=document.activeElement&&document.activeElement.id==='bagR'+i;
+  html+='<tr><td>'+(i+1)+'</td><td>'+b.avail+' g</td><td>'+(b.runs<0?'&ndash;':b.runs)+
+   '</td><td>'+(b.rate||'&ndash;')+'</td><td>'+(b.days<0?'&ndash;':b.days.toFixed(1))+
+   '</td><td><input type="text" id="bagR'+i+'" inputmode="numeric" style="max-width:60px" value="'+
+   (ed?$('bagR'+i).value:b.reserve)+'" onchange="bagReserve('+i+')">'+(b.learned?'':' *')+'</td></tr>';
+ });
+ $('bagBody').innerHTML=html;
+ // Newest week of the log, newest first
+ let rows=j.log.slice(-7).reverse().map(r=>{
+  let d=new Date(r[0]*86400000);
+  return d.getUTCDate()+'.'+(d.getUTCMonth()+1)+': '+r.slice(1).map(g=>(g/1000).toFixed(1)).join(' / ')+' kg';
+ });
+ $('bagLog').textContent=rows.length?rows.join(' · '):'No consumption logged yet.';
+}
+function bagReserve(i){
+ let v=$('bagR'+i).value.trim();
+ api('POST','/api/bag',{scale:i,reserve:v===''?-1:parseInt(v)}).then(()=>setTimeout(bagFetch,1500));
+}
+// The board has no clock: the bag log counts on the page's calendar day.
+// Sent again every 10 minutes (the board may have restarted meanwhile).
+let clockT=0;
+function sendClock(){
+ clockT=Date.now();
+ let now=new Date(),ms=now.getTime()-now.getTimezoneOffset()*60000;
+ api('POST','/api/clock',{day:Math.floor(ms/86400000),sec:Math.floor(ms%86400000/1000)});
+}
+
 // --- Scale dashboard ---
 let dashBuilt=false;
 function buildDash(d){
@@ -543,7 +806,8 @@ function buildDash(d){
    html+='<div class="scell" id="sc'+i+'"><div class="lbl">Scale '+(i+1)+'</div>'+
     '<div class="sn" id="scn'+i+'">&mdash;</div>'+
     '<div class="sw num" id="scw'+i+'">&ndash;</div>'+
-    '<div class="sc" id="scc'+i+'"></div></div>';
+    '<div class="sc" id="scc'+i+'"></div>'+
+    '<div class="sr num" id="scr'+i+'"></div></div>';
   }
   $('scaleDash').innerHTML=html;
   for(let j=0;j<3;j++){
@@ -565,10 +829,18 @@ function buildDash(d){
   let g=d.gross?d.gross[i]:d.weights[i];   // cards show the bag's absolute weight
   $('scw'+i).textContent=g.toFixed(0)+' g';
   // Red when the bag runs low (calibrated scales only - raw counts aren't grams)
-  $('scw'+i).classList.toggle('low',!!d.scale_calibrated[i]&&g<LOW_BAG_G);
+  // Runs of the target the bag has left (firmware); older firmware: by weight
+  let runs=d.bag_runs?d.bag_runs[i]:-1;
+  let low=runs>=0?runs<=BAG_LOW_RUNS:(!!d.scale_calibrated[i]&&g<LOW_BAG_G);
+  $('scw'+i).classList.toggle('low',low);
   let ce=$('scc'+i),cal=d.scale_calibrated[i];
-  ce.textContent=cal?'CAL':'NOT CAL';
+  ce.textContent=(cal?'CAL':'NOT CAL')+(runs>=0?' · '+runs+' LEFT':'');
   ce.className='sc'+(cal?'':' no');
+  // This scale's run: progress while it goes, a tick once it reached its target
+  let re=$('scr'+i);
+  if(d.run_active[i])re.textContent=d.run_grams[i].toFixed(0)+' / '+d.run_target[i]+' g';
+  else re.textContent=d.run_done[i]?'\u2713 '+d.run_grams[i].toFixed(0)+' g':'';
+  re.className='sr num'+(d.run_active[i]?' on':'');
  }
 }
 
@@ -771,42 +1043,91 @@ function drawRun(){
  drawLegend(ctx,lg);
 }
 
-// --- CSV run loading ---
+// --- Run loading: /api/log.bin is the device's stored blocks as they are
+// (~7 bytes a sample vs ~60 as CSV); decoded here, mirror of telem_codec.cpp
+const LOG_SC=[10,10,100,100,100,10,10,1,100,10]; // weight,servo,p,i,d,disp,gross,t,vib,sp
+function decodeLog(buf){
+ let v=new DataView(buf),u=new Uint8Array(buf),n=buf.byteLength;
+ if(n<64||String.fromCharCode(u[0],u[1],u[2],u[3])!=='KDLB')return null;
+ let name='';
+ for(let k=48;k<64&&u[k];k++)name+=String.fromCharCode(u[k]);
+ let meta={run_id:v.getUint32(8,true),samples:v.getUint32(12,true),dropped:v.getUint32(16,true),
+  kp:+v.getFloat32(24,true).toFixed(3),ki:+v.getFloat32(28,true).toFixed(4),
+  kd:+v.getFloat32(32,true).toFixed(3),final_g:+v.getFloat32(36,true).toFixed(1),
+  target_g:v.getUint16(40,true),sample_ms:v.getUint16(42,true),scale:u[44],name:name};
+ let data={t:[],sp:[],disp:[],w:[],gross:[],servo:[],p:[],i:[],d:[],vib:[]};
+ let p=v.getUint16(6,true),ended=false;
+ function vi(){
+  let x=0;
+  for(let s=0;s<35;s+=7){
+   if(p>=n)throw 0;
+   let b=u[p++];
+   x+=(b&127)*2**s;
+   if(b<128)return x>>>0;
+  }
+  throw 0;
+ }
+ try{
+  while(p+4<=n){
+   let cnt=v.getUint16(p,true),nb=v.getUint16(p+2,true);
+   p+=4;
+   if(cnt===0xFFFF){ended=true;break;}
+   let end=p+nb;
+   if(end>n)return null;
+   let q=[0,0,0,0,0,0,0,0,0,0],dt=0; // keyframe per frame
+   for(let k=0;k<cnt;k++){
+    let m=vi(),pq=q.slice(),dw=0;
+    for(let f=0;f<10;f++){
+     let r=(m>>f)&1?vi():0;
+     let z=((r>>>1)^-(r&1))|0;
+     let pred=f===5?pq[5]-dw:f===6?pq[6]+dw:f===7?pq[7]+dt:pq[f];
+     q[f]=(pred+z)|0;
+     if(f===0)dw=q[0]-pq[0];
+    }
+    dt=(q[7]-pq[7])|0;
+    data.w.push(q[0]/10);data.servo.push(q[1]/10);
+    data.p.push(q[2]/100);data.i.push(q[3]/100);data.d.push(q[4]/100);
+    data.disp.push(q[5]/10);data.gross.push(q[6]/10);data.t.push(q[7]>>>0);
+    data.vib.push(q[8]/100);data.sp.push(q[9]/10);
+   }
+   p=end;
+  }
+ }catch(e){return null;}
+ // No end frame or short: the ring lapped the stream - retry later
+ if(!ended||data.t.length!==meta.samples)return null;
+ return {meta:meta,data:data};
+}
+// Same text the device's /api/log.csv sends, for the per-run CSV cache
+function logCsv(m,d){
+ let f1=x=>x.toFixed(1),f2=x=>x.toFixed(2);
+ let out='# korndispenser-pid-log v2\n# run_id='+m.run_id+',scale='+m.scale+
+  ',name='+m.name+',target_g='+m.target_g+',kp='+m.kp.toFixed(3)+',ki='+m.ki.toFixed(4)+
+  ',kd='+m.kd.toFixed(3)+',samples='+m.samples+',dropped='+m.dropped+
+  ',final_g='+m.final_g.toFixed(1)+',sample_ms='+m.sample_ms+
+  '\nt_ms,setpoint_g,dispensed_g,weight_g,gross_g,servo_deg,p_term,i_term,d_term,vib\n';
+ for(let k=0;k<d.t.length;k++){
+  out+=d.t[k]+','+f1(d.sp[k])+','+f1(d.disp[k])+','+f1(d.w[k])+','+f1(d.gross[k])+','+
+   f1(d.servo[k])+','+f2(d.p[k])+','+f2(d.i[k])+','+f2(d.d[k])+','+f2(d.vib[k])+'\n';
+ }
+ return out;
+}
 function loadRun(id){
  if(loadingRun)return;
  loadingRun=true;
- fetch('/api/log.csv').then(r=>{
+ fetch('/api/log.bin?run='+id).then(r=>{
   if(!r.ok)throw 0;
-  return r.text();
- }).then(txt=>{
-  let lines=txt.split('\n');
-  let meta={};
-  let data={t:[],sp:[],disp:[],w:[],gross:[],servo:[],p:[],i:[],d:[],vib:[]};
-  for(let ln of lines){
-   if(!ln)continue;
-   if(ln[0]==='#'){
-    for(let kv of ln.slice(1).split(',')){
-     let m=kv.trim().split('=');
-     if(m.length===2)meta[m[0]]=parseFloat(m[1])||m[1];
-    }
-    continue;
-   }
-   if(ln[0]==='t')continue; // header row
-   let c=ln.split(',');
-   if(c.length<10)continue;
-   data.t.push(+c[0]);data.sp.push(+c[1]);data.disp.push(+c[2]);
-   data.w.push(+c[3]);data.gross.push(+c[4]);data.servo.push(+c[5]);
-   data.p.push(+c[6]);data.i.push(+c[7]);data.d.push(+c[8]);data.vib.push(+c[9]);
-  }
-  // Validate against metadata (stream may truncate if a new run started)
-  if(meta.samples&&data.t.length<meta.samples)throw 0;
-  R=data;
+  return r.arrayBuffer();
+ }).then(buf=>{
+  let L=decodeLog(buf);
+  if(!L)throw 0;
+  let meta=L.meta;
+  R=L.data;
   R.meta={run_id:meta.run_id||id,scale:meta.scale||1,name:meta.name||'',
    target:meta.target_g||0,
-   kp:meta.kp,ki:meta.ki,kd:meta.kd,final:meta.final_g,samples:data.t.length};
+   kp:meta.kp,ki:meta.ki,kd:meta.kd,final:meta.final_g,samples:R.t.length};
   lastRunLoaded=id;
   loadingRun=false;
-  saveRunCsv(R.meta.run_id,txt);
+  saveRunCsv(R.meta.run_id,logCsv(meta,R));
   $('runMeta').textContent='RUN '+R.meta.run_id+' · SCALE '+R.meta.scale+
    (R.meta.name?' · '+String(R.meta.name).toUpperCase():'')+
    ' · '+R.meta.samples+' SAMPLES · KP '+R.meta.kp+' KI '+R.meta.ki+
@@ -815,9 +1136,10 @@ function loadRun(id){
  }).catch(()=>{loadingRun=false;});
 }
 
-// --- Per-run CSV cache: the device only keeps the LATEST run in RAM, so
-// each finished run's CSV is stashed here (newest KEEP_CSV runs) and can be
-// downloaded from the History table long after the machine moved on.
+// --- Per-run CSV cache: the device keeps only its last few runs in RAM (a
+// long run overwrites older ones), so each finished run's CSV is stashed here
+// (newest KEEP_CSV runs) and can be downloaded from the History table long
+// after the machine moved on. Uncached runs are fetched from the device.
 const KEEP_CSV=8;
 function csvIndex(){return JSON.parse(localStorage.getItem('kd_csvs')||'[]');}
 function saveRunCsv(id,txt){
@@ -839,7 +1161,11 @@ function dlBlob(name,txt){
 }
 function dlRun(id){
  let t=localStorage.getItem('kd_csv_'+id);
- if(t)dlBlob('pid_run_'+id+'.csv',t);
+ if(t){dlBlob('pid_run_'+id+'.csv',t);return;}
+ fetch('/api/log.csv?run='+id).then(r=>{
+  if(!r.ok)throw 0;
+  return r.text();
+ }).then(t=>dlBlob('pid_run_'+id+'.csv',t)).catch(()=>{});
 }
 function dlAllRuns(){
  let out='';
@@ -865,7 +1191,7 @@ function renderHistory(){
   let e=history[i];
   let acc=(e.actual/e.target*100).toFixed(1);
   let bad=Math.abs(e.actual-e.target)>e.target*0.05;
-  let dl=(e.run&&localStorage.getItem('kd_csv_'+e.run))?
+  let dl=e.run?
    '<button class="tg" onclick="dlRun('+e.run+')">CSV</button>':'';
   html+='<tr><td>'+e.time+'</td><td>'+(e.name||e.scale)+'</td><td>'+e.target+' g</td><td>'+
    e.actual.toFixed(1)+' g</td><td'+(bad?' class="bad"':'')+'>'+acc+'%</td><td>'+dl+'</td></tr>';
@@ -880,68 +1206,131 @@ function clearHistory(){
  renderHistory();
 }
 
-// --- Poll ---
+// --- Live status: /api/events stream, /api/status polling as fallback ---
+// The stream opens with a full status object, then sends only changed fields
+// under the same keys; S is the merged view both paths hand to onStatus().
+let S=null;
+let es=null,esLast=0,esRetry=0;
+let polling=false,pollGen=0;
+function startEvents(){
+ if(typeof EventSource==='undefined'){startPolling();return;}
+ esRetry=esLast=Date.now();
+ es=new EventSource('/api/events');
+ es.onmessage=e=>{
+  let d;
+  try{d=JSON.parse(e.data);}catch(x){return;}
+  esLast=Date.now();
+  if(d.names)S=d;                 // full status
+  else if(S)Object.assign(S,d);   // delta
+  else return;
+  polling=false;
+  onStatus(S);
+ };
+ // CLOSED = refused (503: stream slots full) - the browser won't retry
+ es.onerror=()=>{if(es&&es.readyState===2){es=null;startPolling();}};
+}
+// Stream watchdog: the server sends a full status at least every 2 s, so
+// 5 s of silence means the stream is dead even if the socket isn't. Poll
+// meanwhile and try the stream again every 30 s.
+setInterval(()=>{
+ if(es&&Date.now()-esLast>5000){
+  es.close();es=null;
+  $('statusText').textContent='CONNECTION LOST…';
+  startPolling();
+ }
+ if(!es&&Date.now()-esRetry>30000)startEvents();
+},1000);
+function startPolling(){
+ if(polling)return;
+ polling=true;
+ let g=++pollGen;
+ let next=()=>setTimeout(()=>{
+  if(!polling||g!==pollGen)return;   // the stream took over
+  if(busy){next();return;}
+  poll().finally(next);
+ },750);
+ poll().finally(next);
+}
+
 function poll(){
  let c=new AbortController();
  setTimeout(()=>c.abort(),3000);
  return fetch('/api/status',{signal:c.signal}).then(r=>r.json()).then(d=>{
-  let w=d.weights[d.selected_scale];
-  let tgt=d.target_grams;
-  let disp=d.dispensed_grams;
-  let displayW=d.dispensing?disp:w;
-  let over=(d.dispensing?disp:w)>tgt+5;
-
-  $('weight').innerHTML=displayW.toFixed(0)+'<small> g</small>';
-  $('weight').className='bignum num'+(over?' over':'');
-
-  let pct=tgt>0?Math.min(100,Math.max(0,(d.dispensing?disp:0)/tgt*100)):0;
-  $('progress').style.width=pct+'%';
-  $('progress').className='pfill'+(over&&d.dispensing?' over':'');
-
-  $('btnStart').style.display=d.dispensing?'none':'block';
-  $('btnStop').style.display=d.dispensing?'block':'none';
-
-  wSet('twheel',tgt);
-
-  // Masthead status
-  let cal=d.scale_calibrated[d.selected_scale];
-  let st=d.dispensing?'DISPENSING':(d.dispense_done?'COMPLETE':'READY');
-  let net;
-  if(d.mode==='ap'){
-   net='<span class="ap">AP MODE · 192.168.4.1</span>';
-  }else{
-   let rssi=d.rssi||0;
-   let bars=rssi>-50?'▂▄▆█':rssi>-65?'▂▄▆':rssi>-75?'▂▄':'▂';
-   net=bars+' '+rssi+' dBm';
-  }
-  let gname=(d.names&&d.names[d.selected_scale])?' · '+d.names[d.selected_scale].toUpperCase():'';
-  $('statusText').innerHTML='<span class="on">SCALE '+(d.selected_scale+1)+gname+'</span> · '+st+
-   (cal?'':' · <span class="ap">NOT CALIBRATED</span>')+' · '+net;
-  let bag=d.gross?d.gross[d.selected_scale]:0;
-  $('dispStatus').textContent=(d.dispensing?
-   disp.toFixed(1)+' of '+tgt+' g':'Target '+tgt+' g')+' · Bag '+bag.toFixed(0)+' g';
-
-  buildDash(d);
-  syncNames(d);
-  if(d.szero){SV.zeros=d.szero;if(SV.sel>=0)svRender();}
-  lastDispensing=!!d.dispensing;
-  syncEstop();
-
-  // Stale-page detector: firmware reports its bundled UI version; if this
-  // page is older, try one cache-busting reload, then warn visibly.
-  if(d.ui&&d.ui!==UI_V){
-   if(!sessionStorage.getItem('kd_rl')){
-    sessionStorage.setItem('kd_rl','1');
-    location.replace('/?r='+Date.now());
-    return;
-   }
-   $('stale').style.display='block';
-  }else if(d.ui){
-   sessionStorage.removeItem('kd_rl');
+  S=d;
+  onStatus(d);
+ }).catch(()=>{
+  $('statusText').textContent='CONNECTION LOST…';
+ });
+}
+
+let lastSel=0;
+function onStatus(d){
+ lastSel=d.selected_scale;
+ // The Dispense card follows the selected scale's run; the others show on
+ // the dashboard cards
+ let sel=d.selected_scale;
+ let running=!!d.run_active[sel];
+ let w=d.weights[sel];
+ let tgt=running?d.run_target[sel]:d.target_grams;
+ let disp=d.run_grams[sel];
+ let displayW=running?disp:w;
+ let over=displayW>tgt+5;
+
+ $('weight').innerHTML=displayW.toFixed(0)+'<small> g</small>';
+ $('weight').className='bignum num'+(over?' over':'');
+
+ let pct=tgt>0?Math.min(100,Math.max(0,(running?disp:0)/tgt*100)):0;
+ $('progress').style.width=pct+'%';
+ $('progress').className='pfill'+(over&&running?' over':'');
+
+ $('btnStart').style.display=running?'none':'block';
+ $('btnStop').style.display=running?'block':'none';
+
+ wSet('twheel',d.target_grams);
+
+ // Masthead status
+ let cal=d.scale_calibrated[sel];
+ let st=running?'DISPENSING':(d.run_done[sel]?'COMPLETE':'READY');
+ let others=[0,1,2].filter(i=>i!==sel&&d.run_active[i]).map(i=>i+1);
+ if(others.length)st+=' · ALSO RUNNING '+others.join(', ');
+ let net;
+ if(d.mode==='ap'){
+  net='<span class="ap">AP MODE · 192.168.4.1</span>';
+ }else{
+  let rssi=d.rssi||0;
+  let bars=rssi>-50?'▂▄▆█':rssi>-65?'▂▄▆':rssi>-75?'▂▄':'▂';
+  net=bars+' '+rssi+' dBm';
+ }
+ let gname=(d.names&&d.names[d.selected_scale])?' · '+d.names[d.selected_scale].toUpperCase():'';
+ $('statusText').innerHTML='<span class="on">SCALE '+(d.selected_scale+1)+gname+'</span> · '+st+
+  (cal?'':' · <span class="ap">NOT CALIBRATED</span>')+' · '+net;
+ let bag=d.gross?d.gross[d.selected_scale]:0;
+ $('dispStatus').textContent=(running?
+  disp.toFixed(1)+' of '+tgt+' g':'Target '+tgt+' g')+' · Bag '+bag.toFixed(0)+' g';
+
+ buildDash(d);
+ syncNames(d);
+ if(d.szero){SV.zeros=d.szero;if(SV.sel>=0)svRender();}
+ lastDispensing=!!d.dispensing;
+ syncEstop();
+
+ // Stale-page detector: firmware reports its bundled UI version; if this
+ // page is older, try one cache-busting reload, then warn visibly.
+ if(d.ui&&d.ui!==UI_V){
+  if(!sessionStorage.getItem('kd_rl')){
+   sessionStorage.setItem('kd_rl','1');
+   location.replace('/?r='+Date.now());
+   return;
   }
+  $('stale').style.display='block';
+ }else if(d.ui){
+  sessionStorage.removeItem('kd_rl');
+ }
 
-  // Live graph while dispensing (or before any run is loaded)
-  lastTgt=tgt;
+ // Live graph while dispensing (or before any run is loaded)
+ lastTgt=tgt;
+ if(Date.now()-G.last>=G.ms){
+  G.last=Date.now();
   G.buf.push(displayW);
   if(G.buf.length>G.max)G.buf.shift();
   G.gross.push(bag);
@@ -950,39 +1339,72 @@ function poll(){
   if(G.servo.length>G.max)G.servo.shift();
   G.vib.push((d.vib||0)*100);
   if(G.vib.length>G.max)G.vib.shift();
-  if(d.dispensing||!R)drawLive(tgt);
+  if(running||!R)drawLive(tgt);
+ }
 
-  // Post-run: when a run just finished, fetch the full 20 Hz log
-  if(d.run&&d.run.id>0&&!d.run.active&&!d.dispensing&&d.run.id!==lastRunLoaded){
-   loadRun(d.run.id);
-  }
+ // Post-run: every run that just finished (any scale) has its full 20 Hz log
+ // fetched, one at a time - drawn on the chart and cached for History. On
+ // page load, the newest run if it is over.
+ if(!prevAct){
+  if(d.run&&d.run.id>0&&!d.run.active)runQueue.push(d.run.id);
+ }else{
+  for(let i=0;i<3;i++)
+   if(prevAct[i]&&!d.run_active[i]&&d.run_ids[i])runQueue.push(d.run_ids[i]);
+ }
+ if(runQueue.length&&runQueue[0]===lastRunLoaded){runQueue.shift();runTries=0;}
+ if(runQueue.length&&!loadingRun){
+  if(++runTries>10){runQueue.shift();runTries=0;}   // lapped for good
+  else loadRun(runQueue[0]);
+ }
 
-  // PID field sync
-  if(d.pid){
-   let ae=document.activeElement;
-   let pidInputs=[$('pidKp'),$('pidKi'),$('pidKd')];
-   if(!pidLoaded||pidInputs.indexOf(ae)===-1){
-    $('pidKp').value=d.pid.kp;
-    $('pidKi').value=d.pid.ki;
-    $('pidKd').value=d.pid.kd;
-    pidLoaded=true;
-   }
-  }
+ if(Date.now()-clockT>=600000)sendClock();
+ // Bag levels: while the Contents section is open
+ if(secOpen['sec-contents']&&Date.now()-BAG.last>=10000)bagFetch();
 
-  // History entry on dispense completion (run id links to the cached CSV)
-  if(d.dispense_done&&!prevDone&&prevDisp){
-   history.push({time:new Date().toLocaleTimeString(),scale:d.selected_scale+1,
-    name:(d.names&&d.names[d.selected_scale])||'',target:tgt,actual:disp,
-    run:(d.run&&d.run.id)||0});
-   localStorage.setItem('kd_history',JSON.stringify(history));
-   renderHistory();
+ // Order queue: same
+ if(d.queue!==QUE.state||(d.queue==='running'&&Date.now()-QUE.last>=1000)){
+  QUE.state=d.queue;
+  queFetch();
+ }
+
+ // Recipe batch: refresh on a state change, every second while it runs
+ if(d.batch!==RCP.state||(d.batch==='running'&&Date.now()-RCP.last>=1000)){
+  RCP.state=d.batch;
+  rcpFetch();
+ }
+
+ // Autotune finished: fetch its result
+ if(tuneWatch&&!d.run_active[tuneScale]&&Date.now()-tuneT0>1500)loadTune();
+
+ // PID field sync: the selected scale's gains
+ if(d.pid){
+  let ae=document.activeElement;
+  let pidInputs=[$('pidKp'),$('pidKi'),$('pidKd')];
+  let s=d.selected_scale,g=d.pid[s];
+  $('pidScale').textContent='SCALE '+(s+1)+(d.run_active[s]?' · NEW GAINS FROM ITS NEXT RUN':'');
+  if(!pidLoaded||pidScale!==s||pidInputs.indexOf(ae)===-1){
+   $('pidKp').value=g.kp;
+   $('pidKi').value=g.ki;
+   $('pidKd').value=g.kd;
+   pidScale=s;
+   pidLoaded=true;
   }
-  prevDone=d.dispense_done;
-  prevDisp=d.dispensing||d.dispense_done;
+ }
 
- }).catch(()=>{
-  $('statusText').textContent='CONNECTION LOST…';
- });
+ // History entry per completed run, any scale (run id links to the cached CSV)
+ let added=false;
+ for(let i=0;prevAct&&i<3;i++){
+  if(!prevAct[i]||d.run_active[i]||!d.run_done[i])continue;
+  history.push({time:new Date().toLocaleTimeString(),scale:i+1,
+   name:(d.names&&d.names[i])||'',target:d.run_target[i],actual:d.run_grams[i],
+   run:d.run_ids[i]||0});
+  added=true;
+ }
+ if(added){
+  localStorage.setItem('kd_history',JSON.stringify(history));
+  renderHistory();
+ }
+ prevAct=d.run_active.slice();
 }
 
 applySec();
@@ -1003,13 +1425,7 @@ window.addEventListener('resize',()=>{
  repaintChart();
 });
 renderHistory();
-function schedulePoll(){
- setTimeout(()=>{
-  if(busy){schedulePoll();return;}
-  poll().finally(schedulePoll);
- },750);
-}
-poll().finally(schedulePoll);
+startEvents();
 </script>
 </body>
 </html>)rawhtml";
@@ -1,5 +1,6 @@
 #include "web_server.h"
 #include "web_page.h"
+#include "web_page_gz.h"
 #include "dispenser_state.h"
 #include "telemetry.hpp"
 
@@ -7,9 +8,12 @@
 #include "pico/cyw43_arch.h"
 #include "lwip/tcp.h"
 
+#include <cstdarg>
 #include <cstdio>
 #include <cstring>
 #include <cstdlib>
+#include <cmath>
+#include <strings.h>
 
 static DispenserState* g_state = nullptr;
 
@@ -91,82 +95,322 @@ static bool parse_string_field(const char* body, const char* key, char* out, int
     return true;
 }
 
+// The i-th object of array field `key` ("items":[{...},{...}]), copied
+// NUL-terminated into out for the field parsers above. Flat objects only.
+static bool parse_array_object(const char* body, const char* key, int i, char* out, int out_len) {
+    char search[64];
+    snprintf(search, sizeof(search), "\"%s\"", key);
+    const char* p = strstr(body, search);
+    if (!p) return false;
+    p = strchr(p + strlen(search), '[');
+    if (!p) return false;
+    for (;;) {
+        p++;
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n' || *p == ',') p++;
+        if (*p != '{') return false;   // ']' - no i-th object
+        const char* e = strchr(p, '}');
+        if (!e) return false;
+        if (i-- == 0) {
+            int n = (int)(e - p) + 1;
+            if (n > out_len - 1) n = out_len - 1;
+            memcpy(out, p, n);
+            out[n] = '\0';
+            return true;
+        }
+        p = e;
+    }
+}
+
+// Unsigned value of `key` in a URL query ("run=12&x=1"), 0 if absent
+static uint32_t query_uint(const char* query, const char* key) {
+    size_t klen = strlen(key);
+    for (const char* p = query; *p; ) {
+        if (strncmp(p, key, klen) == 0 && p[klen] == '=') {
+            return (uint32_t)strtoul(p + klen + 1, nullptr, 10);
+        }
+        p = strchr(p, '&');
+        if (!p) break;
+        p++;
+    }
+    return 0;
+}
+
+// Value of header `name` (case-insensitive) within the first hdr_len bytes,
+// or nullptr. Skips the request line.
+static const char* find_header(const char* req, int hdr_len, const char* name) {
+    size_t nlen = strlen(name);
+    const char* end = req + hdr_len;
+    const char* p = strstr(req, "\r\n");
+    while (p && p + 2 < end) {
+        p += 2;
+        if (strncasecmp(p, name, nlen) == 0 && p[nlen] == ':') {
+            p += nlen + 1;
+            while (*p == ' ' || *p == '\t') p++;
+            return p;
+        }
+        p = strstr(p, "\r\n");
+    }
+    return nullptr;
+}
+
+// Does a header value (from find_header) contain token? Stops at the line end.
+static bool header_has(const char* value, const char* token) {
+    if (!value) return false;
+    const char* eol = strstr(value, "\r\n");
+    const char* hit = strstr(value, token);
+    return hit && (!eol || hit < eol);
+}
+
 // ---------- HTTP response constants ------------------------------------------
+//
+// Status line + fixed headers only: send_response() appends Content-Length
+// (never on a 204/304), the Connection header and the blank line.
 
 static const char HTTP_200_JSON[] =
     "HTTP/1.1 200 OK\r\n"
     "Content-Type: application/json\r\n"
-    "Connection: close\r\n"
-    "Access-Control-Allow-Origin: *\r\n"
-    "Content-Length: ";
+    "Access-Control-Allow-Origin: *\r\n";
 
 static const char HTTP_204[] =
     "HTTP/1.1 204 No Content\r\n"
-    "Connection: close\r\n"
-    "Access-Control-Allow-Origin: *\r\n\r\n";
+    "Access-Control-Allow-Origin: *\r\n";
+
+// The phone's cached page is still current (If-None-Match hit)
+static const char HTTP_304_PAGE[] =
+    "HTTP/1.1 304 Not Modified\r\n"
+    "Cache-Control: no-cache\r\n"
+    "ETag: " WEB_PAGE_ETAG "\r\n";
 
 // A visible body: a bodyless 404 renders as a silent white page on iOS Safari
 static const char HTTP_404[] =
     "HTTP/1.1 404 Not Found\r\n"
-    "Connection: close\r\n"
-    "Content-Type: text/plain\r\n"
-    "Content-Length: 13\r\n\r\n"
-    "404 not found";
+    "Content-Type: text/plain\r\n";
+static const char BODY_404[] = "404 not found";
+
+// A request (headers + body) that can never fit REQ_BUF_SIZE
+static const char HTTP_413[] =
+    "HTTP/1.1 413 Content Too Large\r\n"
+    "Content-Type: text/plain\r\n";
+static const char BODY_413[] = "too large";
+
+// Too many live-status streams: the page falls back to polling /api/status
+static const char HTTP_503_EVENTS[] =
+    "HTTP/1.1 503 Service Unavailable\r\n"
+    "Content-Type: text/plain\r\n";
+static const char BODY_503_EVENTS[] = "busy";
+
+// Complete header block: the stream is delimited by connection close
+static const char HTTP_200_EVENTS[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-store\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "Connection: keep-alive\r\n\r\n"
+    "retry: 2000\n\n";
 
 static const char HTTP_OPTIONS[] =
     "HTTP/1.1 204 No Content\r\n"
     "Access-Control-Allow-Origin: *\r\n"
     "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
-    "Access-Control-Allow-Headers: Content-Type\r\n"
-    "Connection: close\r\n\r\n";
+    "Access-Control-Allow-Headers: Content-Type\r\n";
+
+static const char CONN_KEEP_ALIVE[] =
+    "Connection: keep-alive\r\n"
+    "Keep-Alive: timeout=5\r\n\r\n";
+static const char CONN_CLOSE[] = "Connection: close\r\n\r\n";
 
 // ---------- connection state -------------------------------------------------
 
 #define REQ_BUF_SIZE 1024
 
-// State for streaming large responses (like the HTML page)
+// Persistent connections (HTTP/1.1 keep-alive, pipelined requests answered in
+// order). One pool slot per lwIP PCB (MEMP_NUM_TCP_PCB defaults to 5) - no
+// heap traffic per request. A full pool evicts the longest-idle keep-alive
+// connection: a phone parks several of them after loading the page.
+#define CONN_POOL_SIZE     5
+#define KEEPALIVE_IDLE_MS  5000    // matches the Keep-Alive: timeout=5 we advertise
+#define REQUEST_TIMEOUT_MS 10000   // half-received request / stalled response
+#define CONN_POLL_TICKS    2       // tcp_poll interval, 500 ms slow-timer ticks
+// Don't start the next pipelined response unless the biggest one-shot reply
+// (status JSON + header) fits the send buffer whole
+#define RESP_MIN_SNDBUF    1400
+
+// Live-status streams (/api/events). Each holds a PCB for as long as the page
+// is open; lwIP has MEMP_NUM_TCP_PCB = 5 in total, so leave two for the page
+// load and the POSTs. Phones beyond this get a 503 and poll instead.
+#define SSE_MAX_CLIENTS   3
+#define SSE_PERIOD_RUN_MS 50     // 20 Hz while dispensing
+#define SSE_PERIOD_IDLE_MS 200   // 5 Hz otherwise (bags being loaded, taring)
+#define SSE_KEYFRAME_MS   2000   // full snapshot: slow fields + keep-alive
+#define SSE_STALL_MS      10000  // nothing accepted for this long -> drop client
+
+// What a stream client last received, in the units it was printed with
+// (tenths of a gram / degree, hundredths of vibrator intensity), so a value
+// that would print the same is never resent.
+struct SseSent {
+    int32_t  w10[3];
+    int32_t  gross10[3];
+    int32_t  disp10;
+    int32_t  servo10;
+    int32_t  vib100;
+    int32_t  target;
+    int8_t   sel;
+    bool     dispensing;
+    bool     done;
+    uint32_t run_id;
+    uint32_t run_samples;
+    bool     run_active;
+    // Per-scale runs (parallel dispensing)
+    int32_t  run_g10[3];
+    int32_t  run_servo10[3];
+    int32_t  run_vib100[3];
+    int32_t  run_target[3];
+    uint32_t run_ids[3];
+    uint8_t  run_on;       // bit i: scale i running
+    uint8_t  run_ok;       // bit i: scale i's last run reached its target
+    BatchState batch;
+    BatchState queue;
+};
+
+// Per-connection state, from a fixed pool (s_pool). Stays valid after the
+// connection is torn down (in_use = false), which is what lets a callback
+// check whether the response it just sent closed the connection.
 struct ConnState {
-    // Request buffer (used during receive phase)
+    bool            in_use = false;
+    struct tcp_pcb* pcb    = nullptr;
+    uint32_t        last_ms = 0;     // last receive / send progress
+
+    // Request framing. Received data waits in rx_q (and in the TCP window:
+    // tcp_recved() is only called as bytes move into req_buf) until req_buf
+    // has room; req_buf holds the current request and whatever was pipelined
+    // behind it.
+    struct pbuf* rx_q = nullptr;
     char req_buf[REQ_BUF_SIZE];
-    int  req_len;
+    int  req_len      = 0;
+    int  req_consumed = 0;       // length of the request being answered
+    char req_saved    = 0;       // byte overwritten by its NUL terminator
+    bool keep_alive   = false;   // connection stays open after this response
+    bool busy         = false;   // a streamed response is still being queued
 
     // Response streaming (used during send phase)
-    const char* send_data;   // Pointer to data being sent (header or body)
-    int         send_total;  // Total bytes to send
-    int         send_offset; // Bytes already queued
+    int         send_offset = 0; // Bytes already queued
 
     // For two-part responses (header + body)
-    char        resp_header[256];
-    int         resp_header_len;
-    const char* resp_body;
-    int         resp_body_len;
-    bool        header_done;  // Header fully queued?
+    char        resp_header[320];
+    int         resp_header_len = 0;
+    const char* resp_body       = nullptr;
+    int         resp_body_len   = 0;
+    bool        header_done     = false;  // Header fully queued?
 
     // CSV log streaming (/api/log.csv) - rows are generated on the fly from the
-    // telemetry buffer, one line at a time, into csv_buf.
-    enum class SendMode : uint8_t { FlashBody, CsvLog };
+    // telemetry buffer, one line at a time, into csv_buf. /api/log.bin reuses
+    // these fields (send_more_bin).
+    enum class SendMode : uint8_t { FlashBody, CsvLog, BinLog, Events };
     SendMode      mode      = SendMode::FlashBody;
     TelemetryMeta csv_meta  = {};   // snapshot taken at request time
-    uint32_t      csv_row   = 0;    // next sample index to format
+    TelemCursor   csv_cur   = {};   // decodes the run's samples in order
     uint8_t       csv_phase = 0;    // 0 = metadata+header lines, 1 = rows, 2 = done
     char          csv_buf[256];     // one formatted line (or the header block)
     int           csv_len   = 0;
     int           csv_off   = 0;
+
+    // Live-status stream (/api/events): deltas are taken against what this
+    // client last accepted, so an event skipped for backpressure is folded
+    // into the next one instead of being lost.
+    SseSent       sse_sent    = {};
+    uint32_t      sse_key_ms  = 0;   // last keyframe queued
+    uint32_t      sse_ok_ms   = 0;   // last event tcp_write accepted
 };
 
-// ---------- streaming send with tcp_sent callback ----------------------------
+static ConnState  s_pool[CONN_POOL_SIZE];
+static ConnState* s_sse[SSE_MAX_CLIENTS] = {};
 
-static void cleanup_conn(struct tcp_pcb* pcb, ConnState* cs) {
-    if (cs) {
-        delete cs;
+static uint32_t now_ms() { return to_ms_since_boot(get_absolute_time()); }
+
+static void sse_unregister(ConnState* cs) {
+    for (auto& c : s_sse) {
+        if (c == cs) c = nullptr;
     }
+}
+
+// ---------- connection pool --------------------------------------------------
+
+static bool conn_evictable(const ConnState& c) {
+    return c.in_use && c.mode == ConnState::SendMode::FlashBody && !c.busy &&
+           c.req_len == 0 && !c.rx_q;
+}
+
+static void conn_free(ConnState* cs) {
+    sse_unregister(cs);
+    if (cs->rx_q) pbuf_free(cs->rx_q);
+    cs->rx_q = nullptr;
+    cs->pcb = nullptr;
+    cs->in_use = false;
+}
+
+static void cleanup_conn(struct tcp_pcb* pcb, ConnState* cs) {
+    if (cs) conn_free(cs);
     tcp_arg(pcb, nullptr);
     tcp_sent(pcb, nullptr);
     tcp_recv(pcb, nullptr);
     tcp_err(pcb, nullptr);
-    tcp_close(pcb);
+    tcp_poll(pcb, nullptr, 0);
+    if (tcp_close(pcb) != ERR_OK) tcp_abort(pcb);   // out of memory for the FIN
 }
 
+// A free slot, else the longest-idle keep-alive connection closed for it
+static ConnState* conn_alloc(struct tcp_pcb* pcb) {
+    ConnState* victim = nullptr;
+    for (ConnState& c : s_pool) {
+        if (!c.in_use) { victim = &c; break; }
+        if (conn_evictable(c) && (!victim || (int32_t)(c.last_ms - victim->last_ms) < 0)) {
+            victim = &c;
+        }
+    }
+    if (!victim) return nullptr;
+    if (victim->in_use) cleanup_conn(victim->pcb, victim);
+    *victim = ConnState{};
+    victim->in_use = true;
+    victim->pcb = pcb;
+    victim->last_ms = now_ms();
+    return victim;
+}
+
+// Drop the answered request from req_buf, keeping anything pipelined behind it
+static void consume_request(ConnState* cs) {
+    int n = cs->req_consumed;
+    if (n <= 0) return;
+    cs->req_buf[n] = cs->req_saved;
+    memmove(cs->req_buf, cs->req_buf + n, cs->req_len - n);
+    cs->req_len -= n;
+    cs->req_buf[cs->req_len] = '\0';
+    cs->req_consumed = 0;
+}
+
+// The current response is completely queued: close, or go back to reading
+// (the caller then runs process_requests() for anything pipelined)
+static void finish_response(struct tcp_pcb* pcb, ConnState* cs) {
+    tcp_output(pcb);
+    if (!cs->keep_alive) {
+        cleanup_conn(pcb, cs);
+        return;
+    }
+    consume_request(cs);
+    cs->busy = false;
+    cs->mode = ConnState::SendMode::FlashBody;
+    cs->header_done = false;
+    cs->send_offset = 0;
+    cs->resp_body = nullptr;
+    cs->resp_body_len = 0;
+    cs->last_ms = now_ms();
+}
+
+static const char* conn_header(const ConnState* cs) {
+    return cs->keep_alive ? CONN_KEEP_ALIVE : CONN_CLOSE;
+}
+
+// ---------- streaming send with tcp_sent callback ----------------------------
+
 static err_t send_more(struct tcp_pcb* pcb, ConnState* cs) {
     // Send header first
     if (!cs->header_done) {
@@ -206,12 +450,38 @@ static err_t send_more(struct tcp_pcb* pcb, ConnState* cs) {
         cs->send_offset += chunk;
     }
 
-    // All data queued — flush and close
-    tcp_output(pcb);
-    cleanup_conn(pcb, cs);
+    // All data queued - flush, then close or wait for the next request
+    finish_response(pcb, cs);
     return ERR_OK;
 }
 
+// Queue a copy of data[off..len) as far as the send buffer allows. Wait =
+// flushed, retry on the next tcp_sent callback (ERR_MEM included); Closed =
+// the connection was torn down.
+enum class Queued : uint8_t { Done, Wait, Closed };
+static Queued queue_bytes(struct tcp_pcb* pcb, ConnState* cs, const void* data, int len, int& off) {
+    while (off < len) {
+        int avail = (int)tcp_sndbuf(pcb);
+        if (avail == 0) {
+            tcp_output(pcb);
+            return Queued::Wait;
+        }
+        int chunk = len - off;
+        if (chunk > avail) chunk = avail;
+        err_t err = tcp_write(pcb, (const uint8_t*)data + off, chunk, TCP_WRITE_FLAG_COPY);
+        if (err == ERR_MEM) {
+            tcp_output(pcb);
+            return Queued::Wait;
+        }
+        if (err != ERR_OK) {
+            cleanup_conn(pcb, cs);
+            return Queued::Closed;
+        }
+        off += chunk;
+    }
+    return Queued::Done;
+}
+
 // CSV analogue of send_more(): generates the response line by line from the
 // telemetry buffer. Unlike the flash-body path, lines live in a reused per-
 // connection buffer, so every tcp_write MUST copy; and ERR_MEM means "flush and
@@ -219,24 +489,8 @@ static err_t send_more(struct tcp_pcb* pcb, ConnState* cs) {
 static err_t send_more_csv(struct tcp_pcb* pcb, ConnState* cs) {
     // HTTP header first
     if (!cs->header_done) {
-        while (cs->send_offset < cs->resp_header_len) {
-            int avail = (int)tcp_sndbuf(pcb);
-            if (avail == 0) {
-                tcp_output(pcb);
-                return ERR_OK;  // Wait for tcp_sent callback
-            }
-            int chunk = cs->resp_header_len - cs->send_offset;
-            if (chunk > avail) chunk = avail;
-            err_t err = tcp_write(pcb, cs->resp_header + cs->send_offset, chunk, TCP_WRITE_FLAG_COPY);
-            if (err == ERR_MEM) {
-                tcp_output(pcb);
-                return ERR_OK;  // Retry on next tcp_sent callback
-            }
-            if (err != ERR_OK) {
-                cleanup_conn(pcb, cs);
-                return ERR_OK;
-            }
-            cs->send_offset += chunk;
+        if (queue_bytes(pcb, cs, cs->resp_header, cs->resp_header_len, cs->send_offset) != Queued::Done) {
+            return ERR_OK;
         }
         cs->header_done = true;
         cs->csv_len = 0;
@@ -245,24 +499,8 @@ static err_t send_more_csv(struct tcp_pcb* pcb, ConnState* cs) {
 
     while (true) {
         // Flush the pending line
-        while (cs->csv_off < cs->csv_len) {
-            int avail = (int)tcp_sndbuf(pcb);
-            if (avail == 0) {
-                tcp_output(pcb);
-                return ERR_OK;
-            }
-            int chunk = cs->csv_len - cs->csv_off;
-            if (chunk > avail) chunk = avail;
-            err_t err = tcp_write(pcb, cs->csv_buf + cs->csv_off, chunk, TCP_WRITE_FLAG_COPY);
-            if (err == ERR_MEM) {
-                tcp_output(pcb);
-                return ERR_OK;
-            }
-            if (err != ERR_OK) {
-                cleanup_conn(pcb, cs);
-                return ERR_OK;
-            }
-            cs->csv_off += chunk;
+        if (queue_bytes(pcb, cs, cs->csv_buf, cs->csv_len, cs->csv_off) != Queued::Done) {
+            return ERR_OK;
         }
 
         // Line drained - generate the next one
@@ -271,38 +509,35 @@ static err_t send_more_csv(struct tcp_pcb* pcb, ConnState* cs) {
             cs->csv_len = snprintf(cs->csv_buf, sizeof(cs->csv_buf),
                 "# korndispenser-pid-log v2\n"
                 "# run_id=%u,scale=%u,name=%s,target_g=%u,kp=%.3f,ki=%.4f,kd=%.3f,"
-                "samples=%u,final_g=%.1f,sample_ms=100\n"
+                "samples=%u,dropped=%u,final_g=%.1f,sample_ms=%u\n"
                 "t_ms,setpoint_g,dispensed_g,weight_g,gross_g,servo_deg,p_term,i_term,d_term,vib\n",
                 (unsigned)m.run_id, (unsigned)(m.scale + 1), m.name, (unsigned)m.target_g,
                 (double)m.kp, (double)m.ki, (double)m.kd,
-                (unsigned)m.count, (double)m.final_g);
+                (unsigned)(m.count - m.dropped), (unsigned)m.dropped,
+                (double)m.final_g, (unsigned)m.sample_ms);
             cs->csv_off = 0;
             cs->csv_phase = 1;
         } else if (cs->csv_phase == 1) {
-            // A new dispense resets the buffer - abandon the stream (short read)
-            if (telem_meta().run_id != cs->csv_meta.run_id) {
-                tcp_output(pcb);
-                cleanup_conn(pcb, cs);
-                return ERR_OK;
-            }
-            if (cs->csv_row >= cs->csv_meta.count) {
+            if (cs->csv_cur.idx >= cs->csv_meta.count) {
                 cs->csv_phase = 2;
                 continue;
             }
-            const TelemetrySample* s = telem_sample(cs->csv_row);
-            if (!s) {
-                cs->csv_phase = 2;
-                continue;
+            // Fails only when a long run lapped the ring under this stream -
+            // abandon it (short read, the page retries with the fresh meta)
+            TelemetrySample s;
+            if (telem_next(cs->csv_cur, s) != 1) {
+                tcp_output(pcb);
+                cleanup_conn(pcb, cs);
+                return ERR_OK;
             }
             cs->csv_len = snprintf(cs->csv_buf, sizeof(cs->csv_buf),
                 "%lu,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f,%.2f,%.2f\n",
-                (unsigned long)s->t_ms,
-                (double)s->setpoint, (double)s->dispensed, (double)s->weight,
-                (double)s->gross,
-                (double)s->servo, (double)s->p, (double)s->i, (double)s->d,
-                (double)s->vib);
+                (unsigned long)s.t_ms,
+                (double)s.setpoint, (double)s.dispensed, (double)s.weight,
+                (double)s.gross,
+                (double)s.servo, (double)s.p, (double)s.i, (double)s.d,
+                (double)s.vib);
             cs->csv_off = 0;
-            cs->csv_row++;
         } else {
             // All rows sent - flush and close
             tcp_output(pcb);
@@ -312,46 +547,185 @@ static err_t send_more_csv(struct tcp_pcb* pcb, ConnState* cs) {
     }
 }
 
+// /api/log.bin layout (little-endian, as the M33 and every browser are):
+//   BinLogHeader, then one frame per telemetry block:
+//     | u16 count | u16 bytes | bytes of encoded samples (telem_codec.hpp) |
+//   each frame starts with a keyframe and holds at least count samples (decode
+//   count, skip the rest); a frame with count 0xFFFF ends the file. A stream
+//   cut short (lapped by the ring) has no end frame.
+struct BinLogHeader {
+    char     magic[4];      // "KDLB"
+    uint16_t version;       // 1
+    uint16_t header_len;    // sizeof(BinLogHeader): frames start here
+    uint32_t run_id;
+    uint32_t samples;       // samples in the file
+    uint32_t first_idx;     // run sample index of the first (earlier ones overwritten)
+    uint32_t run_samples;   // samples in the run
+    float    kp, ki, kd;
+    float    final_g;
+    uint16_t target_g;
+    uint16_t sample_ms;
+    uint8_t  scale;         // 1..3
+    uint8_t  active;
+    uint16_t block_bytes;   // TELEM_BLOCK_BYTES, largest frame payload
+    char     name[16];
+};
+static_assert(sizeof(BinLogHeader) == 64, "unexpected padding");
+
+// Binary analogue of send_more_csv(): streams the telemetry blocks as stored,
+// a 4-byte frame header plus the block's encoded bytes. No per-sample
+// formatting; csv_buf holds the header / frame header / end frame, and
+// resp_body / resp_body_len / send_offset track the block being queued.
+static err_t send_more_bin(struct tcp_pcb* pcb, ConnState* cs) {
+    if (!cs->header_done) {
+        if (queue_bytes(pcb, cs, cs->resp_header, cs->resp_header_len, cs->send_offset) != Queued::Done) {
+            return ERR_OK;
+        }
+        cs->header_done = true;
+        cs->csv_len = 0;
+        cs->csv_off = 0;
+        cs->resp_body_len = 0;
+        cs->send_offset = 0;
+    }
+
+    while (true) {
+        if (queue_bytes(pcb, cs, cs->csv_buf, cs->csv_len, cs->csv_off) != Queued::Done) {
+            return ERR_OK;
+        }
+        if (cs->send_offset < cs->resp_body_len) {
+            // Always copied: lwIP re-reads what it holds for a retransmission
+            // for as long as the client stalls, and nothing would notice the
+            // ring reusing the block by then (the frames carry no CRC)
+            uint32_t blk = cs->csv_cur.blk - 1;   // block being queued
+            Queued q = queue_bytes(pcb, cs, cs->resp_body, cs->resp_body_len, cs->send_offset);
+            if (q == Queued::Closed) return ERR_OK;
+            if (!telem_block_valid(blk)) {
+                // Reused under us: what went out may be torn - end without the
+                // end frame so the page discards it
+                tcp_output(pcb);
+                cleanup_conn(pcb, cs);
+                return ERR_OK;
+            }
+            if (q == Queued::Wait) return ERR_OK;
+        }
+
+        // Frame drained - set up the next one
+        if (cs->csv_phase == 0) {
+            const TelemetryMeta& m = cs->csv_meta;
+            BinLogHeader h = {};
+            memcpy(h.magic, "KDLB", 4);
+            h.version     = 1;
+            h.header_len  = sizeof(h);
+            h.run_id      = m.run_id;
+            h.samples     = m.count - m.dropped;
+            h.first_idx   = m.dropped;
+            h.run_samples = m.count;
+            h.kp = m.kp; h.ki = m.ki; h.kd = m.kd;
+            h.final_g     = m.final_g;
+            h.target_g    = m.target_g;
+            h.sample_ms   = m.sample_ms;
+            h.scale       = (uint8_t)(m.scale + 1);
+            h.active      = m.active;
+            h.block_bytes = TELEM_BLOCK_BYTES;
+            memcpy(h.name, m.name, sizeof(h.name));
+            memcpy(cs->csv_buf, &h, sizeof(h));
+            cs->csv_len = sizeof(h);
+            cs->csv_off = 0;
+            cs->csv_phase = 1;
+        } else if (cs->csv_phase == 1) {
+            uint16_t frame[2];
+            if (cs->csv_cur.idx >= cs->csv_meta.count) {
+                frame[0] = 0xFFFF;   // end frame
+                frame[1] = 0;
+                cs->csv_phase = 2;
+            } else {
+                // The run's next block, past other scales' runs interleaved
+                // with it (parallel dispensing)
+                TelemBlockRef b;
+                uint32_t blk = cs->csv_cur.blk;
+                if (telem_block(cs->csv_meta.run_id, blk, b) != 1) {
+                    tcp_output(pcb);   // lapped by the ring - short read
+                    cleanup_conn(pcb, cs);
+                    return ERR_OK;
+                }
+                uint32_t want = cs->csv_meta.count - b.first_idx;
+                frame[0] = b.count < want ? b.count : (uint16_t)want;
+                frame[1] = b.bytes;
+                cs->csv_cur.idx = b.first_idx + frame[0];
+                cs->csv_cur.blk = blk + 1;
+                cs->resp_body = (const char*)b.data;
+                cs->resp_body_len = b.bytes;
+                cs->send_offset = 0;
+            }
+            memcpy(cs->csv_buf, frame, sizeof(frame));
+            cs->csv_len = sizeof(frame);
+            cs->csv_off = 0;
+        } else {
+            tcp_output(pcb);
+            cleanup_conn(pcb, cs);
+            return ERR_OK;
+        }
+    }
+}
+
+static void process_requests(struct tcp_pcb* pcb, ConnState* cs);
+
 static err_t tcp_sent_cb(void* arg, struct tcp_pcb* pcb, u16_t len) {
     ConnState* cs = (ConnState*)arg;
     if (!cs) return ERR_OK;
-    if (cs->mode == ConnState::SendMode::CsvLog) return send_more_csv(pcb, cs);
-    return send_more(pcb, cs);
+    if (cs->mode == ConnState::SendMode::Events) return ERR_OK;  // pushed by web_server_tick
+    cs->last_ms = now_ms();
+    if (cs->busy) {
+        if (cs->mode == ConnState::SendMode::CsvLog) send_more_csv(pcb, cs);
+        else if (cs->mode == ConnState::SendMode::BinLog) send_more_bin(pcb, cs);
+        else send_more(pcb, cs);
+    }
+    // Send buffer space back: answer requests pipelined behind this one
+    if (cs->in_use && !cs->busy) process_requests(pcb, cs);
+    return ERR_OK;
 }
 
 // ---------- small response helpers -------------------------------------------
 
-static void send_and_close(struct tcp_pcb* pcb, ConnState* cs, const char* data, int len) {
-    tcp_write(pcb, data, len, TCP_WRITE_FLAG_COPY);
-    tcp_output(pcb);
-    cleanup_conn(pcb, cs);
-}
-
-static void send_json_response(struct tcp_pcb* pcb, ConnState* cs, const char* json, int json_len) {
-    // JSON responses are small enough to send in one shot
-    char header[256];
-    int hlen = snprintf(header, sizeof(header), "%s%d\r\n\r\n", HTTP_200_JSON, json_len);
-    tcp_write(pcb, header, hlen, TCP_WRITE_FLAG_COPY);
-    tcp_write(pcb, json, json_len, TCP_WRITE_FLAG_COPY);
-    tcp_output(pcb);
-    cleanup_conn(pcb, cs);
+// One-shot response: small enough to queue whole (process_requests() checked
+// RESP_MIN_SNDBUF before dispatching)
+static void send_response(struct tcp_pcb* pcb, ConnState* cs, const char* head,
+                          const char* body = nullptr, int body_len = 0) {
+    char header[320];
+    int n = snprintf(header, sizeof(header), "%s", head);
+    if (strncmp(head + 9, "204", 3) != 0 && strncmp(head + 9, "304", 3) != 0) {
+        n += snprintf(header + n, sizeof(header) - n, "Content-Length: %d\r\n", body_len);
+    }
+    n += snprintf(header + n, sizeof(header) - n, "%s", conn_header(cs));
+    err_t err = tcp_write(pcb, header, n, TCP_WRITE_FLAG_COPY);
+    if (err == ERR_OK && body_len > 0) err = tcp_write(pcb, body, body_len, TCP_WRITE_FLAG_COPY);
+    if (err != ERR_OK) {
+        cleanup_conn(pcb, cs);
+        return;
+    }
+    finish_response(pcb, cs);
 }
 
 // Start a streamed large response (header + body via callbacks)
 static void start_streaming_response(struct tcp_pcb* pcb, ConnState* cs,
-                                      const char* body, int body_len) {
-    // no-store: the page ships inside the firmware - a cached copy on the
-    // phone silently shows an outdated UI after every flash
+                                      const char* body, int body_len, bool gzip) {
+    // no-cache + ETag: the phone may keep the page but must revalidate on
+    // every load, so a new flash (new ETag) is never shadowed by a stale copy
+    // while an unchanged page costs one 304
     cs->resp_header_len = snprintf(cs->resp_header, sizeof(cs->resp_header),
         "HTTP/1.1 200 OK\r\n"
         "Content-Type: text/html; charset=utf-8\r\n"
-        "Cache-Control: no-store\r\n"
-        "Connection: close\r\n"
-        "Content-Length: %d\r\n\r\n", body_len);
+        "%s"
+        "Vary: Accept-Encoding\r\n"
+        "Cache-Control: no-cache\r\n"
+        "ETag: " WEB_PAGE_ETAG "\r\n"
+        "Content-Length: %d\r\n%s",
+        gzip ? "Content-Encoding: gzip\r\n" : "", body_len, conn_header(cs));
     cs->resp_body = body;
     cs->resp_body_len = body_len;
     cs->header_done = false;
     cs->send_offset = 0;
+    cs->busy = true;
 
     // Install the sent callback for streaming
     tcp_sent(pcb, tcp_sent_cb);
@@ -360,36 +734,532 @@ static void start_streaming_response(struct tcp_pcb* pcb, ConnState* cs,
     send_more(pcb, cs);
 }
 
-// Start the streamed CSV telemetry response
-static void start_csv_response(struct tcp_pcb* pcb, ConnState* cs) {
-    TelemetryMeta m = telem_meta();
-    if (m.run_id == 0) {
-        // No dispense has ever run - nothing to export
-        send_and_close(pcb, cs, HTTP_404, strlen(HTTP_404));
+// Start the streamed telemetry response for one run (0 = the newest): CSV rows,
+// or the stored blocks as they are (binary)
+static void start_log_response(struct tcp_pcb* pcb, ConnState* cs, uint32_t run_id, bool binary) {
+    if (run_id == 0) run_id = telem_meta().run_id;
+    TelemetryMeta m;
+    if (!telem_run_meta(run_id, m) || !telem_open(run_id, cs->csv_cur)) {
+        // No dispense has ever run, or the run has left the ring
+        send_response(pcb, cs, HTTP_404, BODY_404, strlen(BODY_404));
         return;
     }
 
-    cs->mode = ConnState::SendMode::CsvLog;
+    // Length is delimited by connection close (no Content-Length)
+    cs->keep_alive = false;
+    cs->busy = true;
+    cs->mode = binary ? ConnState::SendMode::BinLog : ConnState::SendMode::CsvLog;
+    m.dropped = cs->csv_cur.idx;   // where the cursor actually starts
     cs->csv_meta = m;   // snapshot: rows < m.count are immutable for this run_id
-    cs->csv_row = 0;
     cs->csv_phase = 0;
     cs->csv_len = 0;
     cs->csv_off = 0;
 
-    // Length is delimited by connection close (no Content-Length).
     cs->resp_header_len = snprintf(cs->resp_header, sizeof(cs->resp_header),
         "HTTP/1.1 200 OK\r\n"
-        "Content-Type: text/csv\r\n"
-        "Content-Disposition: attachment; filename=\"pid_run_%u.csv\"\r\n"
+        "Content-Type: %s\r\n"
+        "Content-Disposition: attachment; filename=\"pid_run_%u.%s\"\r\n"
         "Cache-Control: no-store\r\n"
         "Access-Control-Allow-Origin: *\r\n"
         "Connection: close\r\n\r\n",
-        (unsigned)m.run_id);
+        binary ? "application/octet-stream" : "text/csv",
+        (unsigned)m.run_id, binary ? "bin" : "csv");
     cs->header_done = false;
     cs->send_offset = 0;
 
     tcp_sent(pcb, tcp_sent_cb);
-    send_more_csv(pcb, cs);
+    if (binary) send_more_bin(pcb, cs);
+    else send_more_csv(pcb, cs);
+}
+
+// ---------- status JSON ------------------------------------------------------
+
+// Full status object: the /api/status body and the /api/events keyframe.
+// Returns the snprintf length (clamp before sending).
+static const char* const BATCH_STATE[] = {"idle", "running", "done", "failed"};
+
+static int format_status_json(char* buf, size_t len) {
+    // Get WiFi signal strength (meaningless in AP mode - UI hides it)
+    int32_t rssi = -100;
+    cyw43_wifi_get_rssi(&cyw43_state, &rssi);
+
+    TelemetryMeta tm = telem_meta();
+
+    return snprintf(buf, len,
+        "{"
+        "\"weights\":[%.1f,%.1f,%.1f],"
+        "\"gross\":[%.1f,%.1f,%.1f],"
+        "\"names\":[\"%s\",\"%s\",\"%s\"],"
+        "\"selected_scale\":%d,"
+        "\"target_grams\":%d,"
+        "\"dispensing\":%s,"
+        "\"dispense_done\":%s,"
+        "\"dispensed_grams\":%.1f,"
+        "\"run_active\":[%s,%s,%s],"
+        "\"run_done\":[%s,%s,%s],"
+        "\"run_grams\":[%.1f,%.1f,%.1f],"
+        "\"run_target\":[%d,%d,%d],"
+        "\"run_servo\":[%.1f,%.1f,%.1f],"
+        "\"run_vib\":[%.2f,%.2f,%.2f],"
+        "\"run_ids\":[%u,%u,%u],"
+        "\"scale_calibrated\":[%s,%s,%s],"
+        "\"szero\":[%.0f,%.0f,%.0f],"
+        "\"ui\":%d,"
+        "\"pid\":[{\"kp\":%.3f,\"ki\":%.4f,\"kd\":%.3f},"
+        "{\"kp\":%.3f,\"ki\":%.4f,\"kd\":%.3f},"
+        "{\"kp\":%.3f,\"ki\":%.4f,\"kd\":%.3f}],"
+        "\"servo\":%.1f,\"vib\":%.2f,"
+        "\"rssi\":%ld,"
+        "\"run\":{\"id\":%u,\"samples\":%u,\"active\":%s},"
+        "\"batch\":\"%s\","
+        "\"queue\":\"%s\","
+        "\"bag_runs\":[%d,%d,%d],"
+        "\"mode\":\"%s\""
+        "}",
+        g_state->weights[0], g_state->weights[1], g_state->weights[2],
+        g_state->gross[0], g_state->gross[1], g_state->gross[2],
+        g_state->names[0], g_state->names[1], g_state->names[2],
+        g_state->selected_scale,
+        g_state->target_grams,
+        g_state->dispensing ? "true" : "false",
+        g_state->dispense_done ? "true" : "false",
+        g_state->dispensed_grams,
+        g_state->run_active[0] ? "true" : "false",
+        g_state->run_active[1] ? "true" : "false",
+        g_state->run_active[2] ? "true" : "false",
+        g_state->run_done[0] ? "true" : "false",
+        g_state->run_done[1] ? "true" : "false",
+        g_state->run_done[2] ? "true" : "false",
+        (double)g_state->run_grams[0], (double)g_state->run_grams[1],
+        (double)g_state->run_grams[2],
+        g_state->run_target[0], g_state->run_target[1], g_state->run_target[2],
+        (double)g_state->run_servo[0], (double)g_state->run_servo[1],
+        (double)g_state->run_servo[2],
+        (double)g_state->run_vib[0], (double)g_state->run_vib[1],
+        (double)g_state->run_vib[2],
+        (unsigned)g_state->run_id[0], (unsigned)g_state->run_id[1],
+        (unsigned)g_state->run_id[2],
+        g_state->scale_calibrated[0] ? "true" : "false",
+        g_state->scale_calibrated[1] ? "true" : "false",
+        g_state->scale_calibrated[2] ? "true" : "false",
+        (double)g_state->servo_zero[0], (double)g_state->servo_zero[1],
+        (double)g_state->servo_zero[2],
+        KD_UI_VERSION,
+        (double)g_state->pid_kp[0], (double)g_state->pid_ki[0], (double)g_state->pid_kd[0],
+        (double)g_state->pid_kp[1], (double)g_state->pid_ki[1], (double)g_state->pid_kd[1],
+        (double)g_state->pid_kp[2], (double)g_state->pid_ki[2], (double)g_state->pid_kd[2],
+        (double)g_state->servo_angle, (double)g_state->vib_intensity,
+        (long)rssi,
+        (unsigned)tm.run_id, (unsigned)tm.count, tm.active ? "true" : "false",
+        BATCH_STATE[(int)g_state->batch.state],
+        BATCH_STATE[(int)g_state->queue.state],
+        g_state->bag[0].runs_left, g_state->bag[1].runs_left, g_state->bag[2].runs_left,
+        g_state->ap_mode ? "ap" : "sta"
+    );
+}
+
+// ---------- live status stream (/api/events) ---------------------------------
+//
+// One long-lived text/event-stream response per client instead of a fresh
+// TCP connection every 750 ms. Every tick pushes a compact delta holding
+// only the fast fields that changed, using the /api/status key names, so the
+// page merges it into its last full status. Every SSE_KEYFRAME_MS a full
+// status object goes out. It refreshes the slow fields (names, PID, zeros,
+// RSSI) and keeps idle proxies/phones from timing the stream out.
+//
+// Backpressure: an event is only queued if tcp_sndbuf() has room for all of
+// it. Otherwise the tick skips that client, and the next delta (still taken
+// against what it last accepted) carries the change. A phone that stops
+// ACKing - screen locked, walked out of range - fills its buffer and is
+// aborted after SSE_STALL_MS to free the PCB.
+
+static int32_t tenths(float v)     { return (int32_t)lroundf(v * 10.0f); }
+static int32_t hundredths(float v) { return (int32_t)lroundf(v * 100.0f); }
+
+static SseSent sse_snapshot() {
+    SseSent s;
+    for (int i = 0; i < 3; i++) {
+        s.w10[i]     = tenths(g_state->weights[i]);
+        s.gross10[i] = tenths(g_state->gross[i]);
+    }
+    s.disp10     = tenths(g_state->dispensed_grams);
+    s.servo10    = tenths(g_state->servo_angle);
+    s.vib100     = hundredths(g_state->vib_intensity);
+    s.target     = g_state->target_grams;
+    s.sel        = (int8_t)g_state->selected_scale;
+    s.dispensing = g_state->dispensing;
+    s.done       = g_state->dispense_done;
+    TelemetryMeta tm = telem_meta();
+    s.run_id      = tm.run_id;
+    s.run_samples = tm.count;
+    s.run_active  = tm.active;
+    s.batch = g_state->batch.state;
+    s.queue = g_state->queue.state;
+    s.run_on = s.run_ok = 0;
+    for (int i = 0; i < 3; i++) {
+        s.run_g10[i]     = tenths(g_state->run_grams[i]);
+        s.run_servo10[i] = tenths(g_state->run_servo[i]);
+        s.run_vib100[i]  = hundredths(g_state->run_vib[i]);
+        s.run_target[i]  = g_state->run_target[i];
+        s.run_ids[i]     = g_state->run_id[i];
+        if (g_state->run_active[i]) s.run_on |= (uint8_t)(1u << i);
+        if (g_state->run_done[i])   s.run_ok |= (uint8_t)(1u << i);
+    }
+    return s;
+}
+
+static void appendf(char* buf, size_t len, int& n, const char* fmt, ...) {
+    if (n < 0 || (size_t)n >= len) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int k = vsnprintf(buf + n, len - n, fmt, ap);
+    va_end(ap);
+    n = (k < 0) ? -1 : n + k;
+}
+
+// Comma-separated "key":value pairs for every field of `now` that differs
+// from `was`; empty (0) when nothing changed.
+static int format_status_delta(char* buf, size_t len, const SseSent& now, const SseSent& was) {
+    int n = 0;
+    buf[0] = '\0';
+    auto sep = [&]() { if (n > 0) appendf(buf, len, n, ","); };
+    if (memcmp(now.w10, was.w10, sizeof(now.w10)) != 0) {
+        sep();
+        appendf(buf, len, n, "\"weights\":[%.1f,%.1f,%.1f]",
+                now.w10[0] / 10.0, now.w10[1] / 10.0, now.w10[2] / 10.0);
+    }
+    if (memcmp(now.gross10, was.gross10, sizeof(now.gross10)) != 0) {
+        sep();
+        appendf(buf, len, n, "\"gross\":[%.1f,%.1f,%.1f]",
+                now.gross10[0] / 10.0, now.gross10[1] / 10.0, now.gross10[2] / 10.0);
+    }
+    if (now.disp10 != was.disp10) {
+        sep(); appendf(buf, len, n, "\"dispensed_grams\":%.1f", now.disp10 / 10.0);
+    }
+    if (now.servo10 != was.servo10) {
+        sep(); appendf(buf, len, n, "\"servo\":%.1f", now.servo10 / 10.0);
+    }
+    if (now.vib100 != was.vib100) {
+        sep(); appendf(buf, len, n, "\"vib\":%.2f", now.vib100 / 100.0);
+    }
+    if (now.target != was.target) {
+        sep(); appendf(buf, len, n, "\"target_grams\":%d", (int)now.target);
+    }
+    if (now.sel != was.sel) {
+        sep(); appendf(buf, len, n, "\"selected_scale\":%d", (int)now.sel);
+    }
+    if (now.dispensing != was.dispensing) {
+        sep(); appendf(buf, len, n, "\"dispensing\":%s", now.dispensing ? "true" : "false");
+    }
+    if (now.done != was.done) {
+        sep(); appendf(buf, len, n, "\"dispense_done\":%s", now.done ? "true" : "false");
+    }
+    auto bools = [&](const char* key, uint8_t bits) {
+        sep();
+        appendf(buf, len, n, "\"%s\":[%s,%s,%s]", key, (bits & 1) ? "true" : "false",
+                (bits & 2) ? "true" : "false", (bits & 4) ? "true" : "false");
+    };
+    if (now.run_on != was.run_on) bools("run_active", now.run_on);
+    if (now.run_ok != was.run_ok) bools("run_done", now.run_ok);
+    if (memcmp(now.run_g10, was.run_g10, sizeof(now.run_g10)) != 0) {
+        sep();
+        appendf(buf, len, n, "\"run_grams\":[%.1f,%.1f,%.1f]",
+                now.run_g10[0] / 10.0, now.run_g10[1] / 10.0, now.run_g10[2] / 10.0);
+    }
+    if (memcmp(now.run_target, was.run_target, sizeof(now.run_target)) != 0) {
+        sep();
+        appendf(buf, len, n, "\"run_target\":[%d,%d,%d]",
+                (int)now.run_target[0], (int)now.run_target[1], (int)now.run_target[2]);
+    }
+    if (memcmp(now.run_servo10, was.run_servo10, sizeof(now.run_servo10)) != 0) {
+        sep();
+        appendf(buf, len, n, "\"run_servo\":[%.1f,%.1f,%.1f]",
+                now.run_servo10[0] / 10.0, now.run_servo10[1] / 10.0, now.run_servo10[2] / 10.0);
+    }
+    if (memcmp(now.run_vib100, was.run_vib100, sizeof(now.run_vib100)) != 0) {
+        sep();
+        appendf(buf, len, n, "\"run_vib\":[%.2f,%.2f,%.2f]",
+                now.run_vib100[0] / 100.0, now.run_vib100[1] / 100.0, now.run_vib100[2] / 100.0);
+    }
+    if (memcmp(now.run_ids, was.run_ids, sizeof(now.run_ids)) != 0) {
+        sep();
+        appendf(buf, len, n, "\"run_ids\":[%u,%u,%u]", (unsigned)now.run_ids[0],
+                (unsigned)now.run_ids[1], (unsigned)now.run_ids[2]);
+    }
+    if (now.run_id != was.run_id || now.run_samples != was.run_samples ||
+        now.run_active != was.run_active) {
+        sep();
+        appendf(buf, len, n, "\"run\":{\"id\":%u,\"samples\":%u,\"active\":%s}",
+                (unsigned)now.run_id, (unsigned)now.run_samples,
+                now.run_active ? "true" : "false");
+    }
+    if (now.batch != was.batch) {
+        sep(); appendf(buf, len, n, "\"batch\":\"%s\"", BATCH_STATE[(int)now.batch]);
+    }
+    if (now.queue != was.queue) {
+        sep(); appendf(buf, len, n, "\"queue\":\"%s\"", BATCH_STATE[(int)now.queue]);
+    }
+    return n;
+}
+
+// Drop a stream from the tick itself (not from an lwIP callback)
+static void abort_events_conn(ConnState* cs) {
+    struct tcp_pcb* pcb = cs->pcb;
+    conn_free(cs);
+    tcp_arg(pcb, nullptr);
+    tcp_sent(pcb, nullptr);
+    tcp_recv(pcb, nullptr);
+    tcp_err(pcb, nullptr);
+    tcp_poll(pcb, nullptr, 0);
+    tcp_abort(pcb);
+}
+
+// Queue one whole event or nothing
+static bool sse_write(ConnState* cs, const char* ev, int len, uint32_t now_ms) {
+    struct tcp_pcb* pcb = cs->pcb;
+    if ((int)tcp_sndbuf(pcb) < len || tcp_sndqueuelen(pcb) >= TCP_SND_QUEUELEN - 1) {
+        return false;
+    }
+    if (tcp_write(pcb, ev, len, TCP_WRITE_FLAG_COPY) != ERR_OK) return false;
+    tcp_output(pcb);
+    cs->sse_ok_ms = now_ms;
+    return true;
+}
+
+static void start_events_response(struct tcp_pcb* pcb, ConnState* cs) {
+    int slot = -1;
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++) {
+        if (!s_sse[i]) { slot = i; break; }
+    }
+    if (slot < 0) {
+        cs->keep_alive = false;
+        send_response(pcb, cs, HTTP_503_EVENTS, BODY_503_EVENTS, strlen(BODY_503_EVENTS));
+        return;
+    }
+    if (tcp_write(pcb, HTTP_200_EVENTS, strlen(HTTP_200_EVENTS), TCP_WRITE_FLAG_COPY) != ERR_OK) {
+        cleanup_conn(pcb, cs);
+        return;
+    }
+    // Small events must leave now, not wait for the previous one's ACK
+    tcp_nagle_disable(pcb);
+    tcp_output(pcb);
+
+    uint32_t now = now_ms();
+    cs->mode = ConnState::SendMode::Events;
+    cs->sse_ok_ms = now;
+    cs->sse_key_ms = now - SSE_KEYFRAME_MS;   // first tick sends a full status
+    tcp_sent(pcb, tcp_sent_cb);
+    s_sse[slot] = cs;
+}
+
+void web_server_tick() {
+    if (!g_state) return;
+    bool any = false;
+    for (ConnState* c : s_sse) any |= (c != nullptr);
+    if (!any) return;
+
+    static uint32_t last_ms = 0;
+    uint32_t now = now_ms();
+    uint32_t period = g_state->dispensing ? SSE_PERIOD_RUN_MS : SSE_PERIOD_IDLE_MS;
+    if (now - last_ms < period) return;
+    last_ms = now;
+
+    SseSent snap = sse_snapshot();
+    static char key[1040];      // "data: " + status JSON + "\n\n", built once per tick
+    int key_len = 0;
+
+    for (ConnState* cs : s_sse) {
+        if (!cs) continue;
+        if (now - cs->sse_ok_ms > SSE_STALL_MS) {
+            printf("[web] events client stalled - dropping\n");
+            abort_events_conn(cs);
+            continue;
+        }
+
+        if (now - cs->sse_key_ms >= SSE_KEYFRAME_MS) {
+            if (key_len == 0) {
+                int n = format_status_json(key + 6, sizeof(key) - 8);
+                if (n < 0 || n > (int)sizeof(key) - 9) continue;
+                memcpy(key, "data: ", 6);
+                key[6 + n] = '\n';
+                key[7 + n] = '\n';
+                key_len = n + 8;
+            }
+            if (sse_write(cs, key, key_len, now)) {
+                cs->sse_key_ms = now;
+                cs->sse_sent = snap;
+            }
+            continue;
+        }
+
+        char ev[704];   // every fast field changed at once, per-scale runs included
+        int n = format_status_delta(ev + 7, sizeof(ev) - 10, snap, cs->sse_sent);
+        if (n <= 0 || n > (int)sizeof(ev) - 11) continue;   // nothing changed (or no room)
+        memcpy(ev, "data: {", 7);
+        memcpy(ev + 7 + n, "}\n\n", 3);
+        if (sse_write(cs, ev, n + 10, now)) cs->sse_sent = snap;
+    }
+}
+
+// ---------- run index JSON ---------------------------------------------------
+
+// /api/runs body: the runs still in the telemetry ring, newest first, as rows
+// (not objects) so all TELEM_MAX_RUNS fit one send_response under
+// RESP_MIN_SNDBUF. "kept" is the number of rows /api/log.csv?run=<id> returns.
+static int format_runs_json(char* buf, size_t len) {
+    uint32_t ids[TELEM_MAX_RUNS];
+    uint32_t nruns = telem_runs(ids, TELEM_MAX_RUNS);
+    int n = 0;
+    appendf(buf, len, n, "{\"cols\":[\"id\",\"scale\",\"name\",\"target_g\",\"final_g\","
+                         "\"samples\",\"kept\",\"sample_ms\",\"active\"],\"runs\":[");
+    bool first = true;
+    for (uint32_t k = 0; k < nruns; k++) {
+        TelemetryMeta m;
+        if (!telem_run_meta(ids[k], m)) continue;
+        // Names are sanitized on entry (no quotes or backslashes)
+        char row[96];
+        int r = snprintf(row, sizeof(row), "%s[%u,%u,\"%s\",%u,%.1f,%u,%u,%u,%d]",
+                         first ? "" : ",", (unsigned)m.run_id, (unsigned)(m.scale + 1),
+                         m.name, (unsigned)m.target_g, (double)m.final_g,
+                         (unsigned)m.count, (unsigned)(m.count - m.dropped),
+                         (unsigned)m.sample_ms, m.active ? 1 : 0);
+        if (r < 0 || r >= (int)sizeof(row) || n + r + 3 > (int)len) break;   // keep it valid JSON
+        appendf(buf, len, n, "%s", row);
+        first = false;
+    }
+    appendf(buf, len, n, "]}");
+    return n;
+}
+
+// ---------- autotune JSON ----------------------------------------------------
+
+// /api/autotune body: the last step test per scale (app/autotune.hpp) - its
+// state, fitted flow model and proposed gains
+static int format_tune_json(char* buf, size_t len) {
+    static const char* const STATE[] = {"none", "running", "done", "failed"};
+    int n = 0;
+    appendf(buf, len, n, "{\"scales\":[");
+    for (int i = 0; i < 3; i++) {
+        const TuneResult& r = g_state->tune[i];
+        appendf(buf, len, n,
+                "%s{\"state\":\"%s\",\"k\":%.3f,\"dead\":%.2f,\"tau\":%.2f,\"tc\":%.2f,"
+                "\"kp\":%.3f,\"ki\":%.4f,\"kd\":%.3f}",
+                i ? "," : "", STATE[(int)r.state], (double)r.k, (double)r.dead_s,
+                (double)r.tau_s, (double)r.tc_s, (double)r.kp, (double)r.ki, (double)r.kd);
+    }
+    appendf(buf, len, n, "]}");
+    return n;
+}
+
+// /api/recipe body: the recipe book (saved slots only) and the running or
+// last batch. Items are arrays to keep seven recipes in one small buffer:
+// recipe items [scale, stage, amount, "g" | "%"], batch items [scale, stage,
+// target g, actual g, state].
+static int format_recipe_json(char* buf, size_t len) {
+    static const char* const ITEM[] = {"pending", "running", "done", "failed"};
+    int n = 0;
+    appendf(buf, len, n, "{\"recipes\":[");
+    bool first = true;
+    for (int s = 0; s < RECIPE_SLOTS; s++) {
+        const Recipe& r = g_state->recipes[s];
+        if (r.count == 0) continue;
+        appendf(buf, len, n, "%s{\"slot\":%d,\"name\":\"%s\",\"total\":%u,\"items\":[",
+                first ? "" : ",", s, r.name, (unsigned)r.total_g);
+        for (int i = 0; i < r.count && i < RECIPE_ITEMS; i++) {
+            const RecipeItem& it = r.items[i];
+            if (r.percent & (1u << i)) {
+                appendf(buf, len, n, "%s[%u,%u,%.1f,\"%%\"]", i ? "," : "", (unsigned)it.scale,
+                        (unsigned)it.stage, it.amount / 10.0);
+            } else {
+                appendf(buf, len, n, "%s[%u,%u,%u,\"g\"]", i ? "," : "", (unsigned)it.scale,
+                        (unsigned)it.stage, (unsigned)it.amount);
+            }
+        }
+        appendf(buf, len, n, "]}");
+        first = false;
+    }
+    const BatchStatus& b = g_state->batch;
+    appendf(buf, len, n,
+            "],\"batch\":{\"state\":\"%s\",\"slot\":%d,\"stage\":%u,\"factor\":%.3f,"
+            "\"error\":\"%s\",\"items\":[",
+            BATCH_STATE[(int)b.state], (int)b.slot, (unsigned)b.stage, (double)b.factor, b.error);
+    for (int i = 0; i < b.count && i < RECIPE_ITEMS; i++) {
+        const BatchItem& it = b.items[i];
+        appendf(buf, len, n, "%s[%u,%u,%.0f,%.1f,\"%s\"]", i ? "," : "", (unsigned)it.scale,
+                (unsigned)it.stage, (double)it.target, (double)it.actual, ITEM[(int)it.state]);
+    }
+    appendf(buf, len, n, "]}}");
+    return n;
+}
+
+// /api/recipe save: the body's recipe, checked item by item. Items on an
+// unknown scale are dropped; amounts are clamped to 1-9999 g or 0.1-100 %.
+static Recipe parse_recipe(const char* body) {
+    Recipe r;
+    char name[RECIPE_NAME_LEN] = {0};
+    parse_string_field(body, "name", name, sizeof(name));
+    sanitize_name(name);
+    memcpy(r.name, name, sizeof(r.name));
+    int total = parse_int_field(body, "total");
+    r.total_g = (uint16_t)(total < 0 ? 0 : (total > 9999 ? 9999 : total));
+
+    char obj[96];
+    for (int k = 0; k < 8 && r.count < RECIPE_ITEMS; k++) {
+        if (!parse_array_object(body, "items", k, obj, sizeof(obj))) break;
+        int scale = has_field(obj, "scale") ? parse_int_field(obj, "scale") : -1;
+        if (scale < 0 || scale > 2) continue;
+        int stage = parse_int_field(obj, "stage");
+        RecipeItem& it = r.items[r.count];
+        it.scale = (uint8_t)scale;
+        it.stage = (uint8_t)(stage < 0 ? 0 : (stage > 2 ? 2 : stage));
+        if (has_field(obj, "pct")) {
+            int t = (int)lroundf(parse_float_field(obj, "pct") * 10.0f);
+            it.amount = (uint16_t)(t < 1 ? 1 : (t > 1000 ? 1000 : t));
+            r.percent |= (uint8_t)(1u << r.count);
+        } else {
+            int g = parse_int_field(obj, "g");
+            it.amount = (uint16_t)(g < 1 ? 1 : (g > 9999 ? 9999 : g));
+        }
+        r.count++;
+    }
+    return r;
+}
+
+// /api/queue body: the running (or last) order queue
+static int format_queue_json(char* buf, size_t len) {
+    static const char* const PHASE[] = {"start", "run", "settle", "remove", "place"};
+    const QueueStatus& q = g_state->queue;
+    return snprintf(buf, len,
+        "{\"state\":\"%s\",\"phase\":\"%s\",\"scale\":%d,\"count\":%u,\"done\":%u,"
+        "\"target\":%.0f,\"last\":%.1f,\"total\":%.1f,\"error\":\"%s\"}",
+        BATCH_STATE[(int)q.state], PHASE[(int)q.phase], (int)q.scale, (unsigned)q.count,
+        (unsigned)q.done, (double)q.target, (double)q.last, (double)q.total, q.error);
+}
+
+// /api/bag body: per scale the grain left above the reserve, the runs of its
+// target that leaves, grams per day and the days the bag lasts at that rate
+// (-1 = unknown); then the consumption log as [day, g, g, g] rows, day =
+// local calendar day since 1970, oldest first.
+static int format_bag_json(char* buf, size_t len) {
+    int n = 0;
+    appendf(buf, len, n, "{\"scales\":[");
+    for (int i = 0; i < 3; i++) {
+        const BagStatus& b = g_state->bag[i];
+        appendf(buf, len, n,
+                "%s{\"avail\":%.0f,\"reserve\":%.0f,\"learned\":%s,\"runs\":%d,"
+                "\"rate\":%.0f,\"days\":%.1f}",
+                i ? "," : "", (double)b.avail_g, (double)b.reserve_g,
+                g_state->bag_log.reserve_g[i] ? "true" : "false", b.runs_left,
+                (double)b.rate_gpd, (double)b.days_left);
+    }
+    appendf(buf, len, n, "],\"log\":[");
+    for (int k = 0; k < BAG_DAYS && g_state->bag_log.days[k].day; k++) {
+        const BagDay& d = g_state->bag_log.days[k];
+        appendf(buf, len, n, "%s[%u,%u,%u,%u]", k ? "," : "", (unsigned)d.day,
+                d.g10[0] * 10u, d.g10[1] * 10u, d.g10[2] * 10u);
+    }
+    appendf(buf, len, n, "]}");
+    return n;
 }
 
 // ---------- route handling ---------------------------------------------------
@@ -405,13 +1275,15 @@ static void handle_request(struct tcp_pcb* pcb, ConnState* cs) {
     // Route on the path alone: cache-busting loads like "/?r=1720..." (sent by
     // the page's stale-copy detector) must serve the page, not 404 into a
     // blank white screen.
+    const char* query = "";
     if (char* q = strchr(path, '?')) {
         *q = '\0';
+        query = q + 1;
     }
 
     // CORS preflight
     if (strcmp(method, "OPTIONS") == 0) {
-        send_and_close(pcb, cs, HTTP_OPTIONS, strlen(HTTP_OPTIONS));
+        send_response(pcb, cs, HTTP_OPTIONS);
         return;
     }
 
@@ -421,99 +1293,129 @@ static void handle_request(struct tcp_pcb* pcb, ConnState* cs) {
 
     // --- GET / ---
     if (strcmp(method, "GET") == 0 && strcmp(path, "/") == 0) {
-        // Large response — use streaming
-        start_streaming_response(pcb, cs, WEB_PAGE, strlen(WEB_PAGE));
-        return;  // cs stays alive for callbacks, don't delete
+        int hdr_len = (int)(body - req);
+        const char* inm = find_header(req, hdr_len, "If-None-Match");
+        if (header_has(inm, WEB_PAGE_ETAG)) {
+            send_response(pcb, cs, HTTP_304_PAGE);
+            return;
+        }
+        // Large response - use streaming. The build gzips the page (about
+        // 13 KB instead of 40 KB); the plain copy is for clients that don't
+        // accept gzip.
+        if (header_has(find_header(req, hdr_len, "Accept-Encoding"), "gzip")) {
+            start_streaming_response(pcb, cs, (const char*)WEB_PAGE_GZ, WEB_PAGE_GZ_LEN, true);
+        } else {
+            start_streaming_response(pcb, cs, WEB_PAGE, strlen(WEB_PAGE), false);
+        }
+        return;  // cs stays busy until tcp_sent_cb has queued the body
     }
 
     // --- GET /api/status ---
     if (strcmp(method, "GET") == 0 && strcmp(path, "/api/status") == 0) {
-        // Get WiFi signal strength (meaningless in AP mode - UI hides it)
-        int32_t rssi = -100;
-        cyw43_wifi_get_rssi(&cyw43_state, &rssi);
+        char json[1024];
+        int n = format_status_json(json, sizeof(json));
+        if (n > (int)sizeof(json) - 1) n = sizeof(json) - 1;
+        send_response(pcb, cs, HTTP_200_JSON, json, n);
+        return;
+    }
+
+    // --- GET /api/events ---
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/events") == 0) {
+        start_events_response(pcb, cs);
+        return;  // cs stays registered until the client goes away
+    }
+
+    // --- GET /api/runs ---
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/runs") == 0) {
+        char json[1100];
+        int n = format_runs_json(json, sizeof(json));
+        send_response(pcb, cs, HTTP_200_JSON, json, n);
+        return;
+    }
+
+    // --- GET /api/autotune ---
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/autotune") == 0) {
+        char json[640];
+        int n = format_tune_json(json, sizeof(json));
+        send_response(pcb, cs, HTTP_200_JSON, json, n);
+        return;
+    }
 
-        TelemetryMeta tm = telem_meta();
+    // --- GET /api/recipe ---
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/recipe") == 0) {
+        char json[1100];
+        int n = format_recipe_json(json, sizeof(json));
+        if (n > (int)sizeof(json) - 1) n = sizeof(json) - 1;
+        send_response(pcb, cs, HTTP_200_JSON, json, n);
+        return;
+    }
 
+    // --- GET /api/queue ---
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/queue") == 0) {
+        char json[224];
+        int n = format_queue_json(json, sizeof(json));
+        if (n > (int)sizeof(json) - 1) n = sizeof(json) - 1;
+        send_response(pcb, cs, HTTP_200_JSON, json, n);
+        return;
+    }
+
+    // --- GET /api/bag ---
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/bag") == 0) {
         char json[1024];
-        int n = snprintf(json, sizeof(json),
-            "{"
-            "\"weights\":[%.1f,%.1f,%.1f],"
-            "\"gross\":[%.1f,%.1f,%.1f],"
-            "\"names\":[\"%s\",\"%s\",\"%s\"],"
-            "\"selected_scale\":%d,"
-            "\"target_grams\":%d,"
-            "\"dispensing\":%s,"
-            "\"dispense_done\":%s,"
-            "\"dispensed_grams\":%.1f,"
-            "\"scale_calibrated\":[%s,%s,%s],"
-            "\"szero\":[%.0f,%.0f,%.0f],"
-            "\"ui\":%d,"
-            "\"pid\":{\"kp\":%.3f,\"ki\":%.4f,\"kd\":%.3f},"
-            "\"servo\":%.1f,\"vib\":%.2f,"
-            "\"rssi\":%ld,"
-            "\"run\":{\"id\":%u,\"samples\":%u,\"active\":%s},"
-            "\"mode\":\"%s\""
-            "}",
-            g_state->weights[0], g_state->weights[1], g_state->weights[2],
-            g_state->gross[0], g_state->gross[1], g_state->gross[2],
-            g_state->names[0], g_state->names[1], g_state->names[2],
-            g_state->selected_scale,
-            g_state->target_grams,
-            g_state->dispensing ? "true" : "false",
-            g_state->dispense_done ? "true" : "false",
-            g_state->dispensed_grams,
-            g_state->scale_calibrated[0] ? "true" : "false",
-            g_state->scale_calibrated[1] ? "true" : "false",
-            g_state->scale_calibrated[2] ? "true" : "false",
-            (double)g_state->servo_zero[0], (double)g_state->servo_zero[1],
-            (double)g_state->servo_zero[2],
-            KD_UI_VERSION,
-            (double)g_state->pid_kp, (double)g_state->pid_ki, (double)g_state->pid_kd,
-            (double)g_state->servo_angle, (double)g_state->vib_intensity,
-            (long)rssi,
-            (unsigned)tm.run_id, (unsigned)tm.count, tm.active ? "true" : "false",
-            g_state->ap_mode ? "ap" : "sta"
-        );
-        send_json_response(pcb, cs, json, n);
+        int n = format_bag_json(json, sizeof(json));
+        if (n > (int)sizeof(json) - 1) n = sizeof(json) - 1;
+        send_response(pcb, cs, HTTP_200_JSON, json, n);
         return;
     }
 
-    // --- GET /api/log.csv ---
+    // --- GET /api/log.csv[?run=<id>] ---
     if (strcmp(method, "GET") == 0 && strcmp(path, "/api/log.csv") == 0) {
-        start_csv_response(pcb, cs);
+        start_log_response(pcb, cs, query_uint(query, "run"), false);
         return;  // cs stays alive for callbacks on success
     }
 
+    // --- GET /api/log.bin[?run=<id>] --- (layout: BinLogHeader)
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/log.bin") == 0) {
+        start_log_response(pcb, cs, query_uint(query, "run"), true);
+        return;
+    }
+
     // --- POST routes ---
     if (strcmp(method, "POST") == 0) {
+        // {"action":"start"} dispenses the target from the selected scale;
+        // "scale" (0-2) and "target" (g) pick another, so runs on several
+        // scales go side by side. {"action":"stop"} stops every run,
+        // {"action":"stop","scale":n} just that scale's.
         if (strcmp(path, "/api/dispense") == 0) {
             char action[16];
             if (parse_string_field(body, "action", action, sizeof(action))) {
+                int scale = has_field(body, "scale") ? parse_int_field(body, "scale") : -1;
                 if (strcmp(action, "start") == 0) {
-                    push_cmd(WebCommand::StartDispense);
+                    push_cmd(WebCommand::StartDispense, scale,
+                             has_field(body, "target") ? (float)parse_int_field(body, "target") : 0.0f);
                 } else if (strcmp(action, "stop") == 0) {
-                    push_cmd(WebCommand::StopDispense);
+                    push_cmd(WebCommand::StopDispense, scale);
                 }
             }
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
         if (strcmp(path, "/api/target") == 0) {
             push_cmd(WebCommand::SetTarget, parse_int_field(body, "target"));
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
         if (strcmp(path, "/api/tare") == 0) {
             push_cmd(WebCommand::Tare);
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
         if (strcmp(path, "/api/select-scale") == 0) {
             push_cmd(WebCommand::SelectScale, parse_int_field(body, "scale"));
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
@@ -522,34 +1424,129 @@ static void handle_request(struct tcp_pcb* pcb, ConnState* cs) {
             // UI); without it the command follows the selected scale (-1)
             int servo = has_field(body, "servo") ? parse_int_field(body, "servo") : -1;
             push_cmd(WebCommand::TestServo, servo, parse_float_field(body, "angle"));
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
         if (strcmp(path, "/api/test/vibrator") == 0) {
             push_cmd(WebCommand::TestVibrator, 0, parse_float_field(body, "intensity"));
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
         if (strcmp(path, "/api/test/stop") == 0) {
             push_cmd(WebCommand::TestStop);
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
+        // {"scale":n,"kp":..,"ki":..,"kd":..} - without "scale", the selected
+        // one's gains
         if (strcmp(path, "/api/pid") == 0) {
-            push_cmd(WebCommand::SetPID, 0,
+            push_cmd(WebCommand::SetPID,
+                     has_field(body, "scale") ? parse_int_field(body, "scale") : g_state->selected_scale,
                      parse_float_field(body, "kp"),
                      parse_float_field(body, "ki"),
                      parse_float_field(body, "kd"));
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
+            return;
+        }
+
+        // {"action":"start","scale":0,"open":40,"max":400,"tc":1.0} - omitted
+        // parameters keep their last values; {"action":"apply","scale":0,
+        // "save":1} takes the proposal; "stop" ends the test like a dispense
+        if (strcmp(path, "/api/autotune") == 0) {
+            char action[16];
+            if (parse_string_field(body, "action", action, sizeof(action))) {
+                int scale = parse_int_field(body, "scale");
+                if (strcmp(action, "start") == 0) {
+                    push_cmd(WebCommand::Autotune, scale,
+                             parse_float_field(body, "open"),
+                             parse_float_field(body, "max"),
+                             parse_float_field(body, "tc"));
+                } else if (strcmp(action, "apply") == 0) {
+                    push_cmd(WebCommand::AutotuneApply, scale,
+                             (float)parse_int_field(body, "save"));
+                } else if (strcmp(action, "stop") == 0) {
+                    push_cmd(WebCommand::StopDispense, scale);
+                }
+            }
+            send_response(pcb, cs, HTTP_204);
+            return;
+        }
+
+        // {"action":"save","slot":0,"name":"Mix","total":1000,"items":[
+        //   {"scale":0,"stage":0,"pct":60},{"scale":1,"stage":1,"g":400}]}
+        // stores a recipe (slots 0-6); "delete" empties one; {"action":"run",
+        // "slot":0,"total":1200} dispenses it as a batch (total optional:
+        // rescales every item); "stop" ends the batch
+        if (strcmp(path, "/api/recipe") == 0) {
+            char action[16];
+            int slot = parse_int_field(body, "slot");
+            if (parse_string_field(body, "action", action, sizeof(action))) {
+                bool in_range = slot >= 0 && slot < RECIPE_SLOTS;
+                if (strcmp(action, "save") == 0 && in_range) {
+                    g_state->recipe_stage[slot] = parse_recipe(body);
+                    push_cmd(WebCommand::RecipeSave, slot);
+                } else if (strcmp(action, "delete") == 0 && in_range) {
+                    g_state->recipe_stage[slot] = Recipe{};
+                    push_cmd(WebCommand::RecipeSave, slot);
+                } else if (strcmp(action, "run") == 0 && in_range) {
+                    push_cmd(WebCommand::RecipeRun, slot, parse_float_field(body, "total"));
+                } else if (strcmp(action, "stop") == 0) {
+                    push_cmd(WebCommand::RecipeStop);
+                }
+            }
+            send_response(pcb, cs, HTTP_204);
+            return;
+        }
+
+        // {"action":"start","scale":0,"target":250,"count":20} dispenses the
+        // target 20 times, each once the container was swapped (scale and
+        // target optional: the selected ones); "next" skips the wait for the
+        // swap; "stop" ends the queue and its run
+        if (strcmp(path, "/api/queue") == 0) {
+            char action[16];
+            if (parse_string_field(body, "action", action, sizeof(action))) {
+                if (strcmp(action, "start") == 0) {
+                    int scale = has_field(body, "scale") ? parse_int_field(body, "scale") : -1;
+                    push_cmd(WebCommand::QueueStart, scale,
+                             has_field(body, "target") ? (float)parse_int_field(body, "target") : 0.0f,
+                             (float)parse_int_field(body, "count"));
+                } else if (strcmp(action, "next") == 0) {
+                    push_cmd(WebCommand::QueueNext);
+                } else if (strcmp(action, "stop") == 0) {
+                    push_cmd(WebCommand::QueueStop);
+                }
+            }
+            send_response(pcb, cs, HTTP_204);
+            return;
+        }
+
+        // {"scale":0,"reserve":180} sets the gross weight where that bag stops
+        // flowing (learned on its own from an empty-bag stop); -1 goes back
+        // to the default
+        if (strcmp(path, "/api/bag") == 0) {
+            if (has_field(body, "scale") && has_field(body, "reserve")) {
+                push_cmd(WebCommand::BagReserve, parse_int_field(body, "scale"),
+                         parse_float_field(body, "reserve"));
+            }
+            send_response(pcb, cs, HTTP_204);
+            return;
+        }
+
+        // {"day":20375,"sec":41200}: the page's local calendar day (days
+        // since 1970) and seconds into it - the bag log's clock
+        if (strcmp(path, "/api/clock") == 0) {
+            push_cmd(WebCommand::SetClock, parse_int_field(body, "day"),
+                     parse_float_field(body, "sec"));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
         if (strcmp(path, "/api/calibrate") == 0) {
             push_cmd(WebCommand::Calibrate, parse_int_field(body, "weight"));
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
@@ -557,13 +1554,13 @@ static void handle_request(struct tcp_pcb* pcb, ConnState* cs) {
             push_cmd(WebCommand::SetServoZero,
                      parse_int_field(body, "servo"),
                      parse_float_field(body, "angle"));
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
         if (strcmp(path, "/api/estop") == 0) {
             push_cmd(WebCommand::EStop);
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
 
@@ -575,13 +1572,80 @@ static void handle_request(struct tcp_pcb* pcb, ConnState* cs) {
             if (scale >= 0 && scale <= 2) {
                 push_cmd(WebCommand::SetName, scale, 0, 0, 0, name);
             }
-            send_and_close(pcb, cs, HTTP_204, strlen(HTTP_204));
+            send_response(pcb, cs, HTTP_204);
             return;
         }
     }
 
     // 404 for anything else
-    send_and_close(pcb, cs, HTTP_404, strlen(HTTP_404));
+    send_response(pcb, cs, HTTP_404, BODY_404, strlen(BODY_404));
+}
+
+// ---------- request framing --------------------------------------------------
+
+// HTTP/1.1 stays open unless the client says "Connection: close";
+// HTTP/1.0 only with an explicit "Connection: keep-alive".
+static bool wants_keep_alive(const char* req, int hdr_len) {
+    const char* conn = find_header(req, hdr_len, "Connection");
+    if (conn && strncasecmp(conn, "close", 5) == 0) return false;
+    const char* eol = strstr(req, "\r\n");
+    const char* v10 = strstr(req, "HTTP/1.0");
+    if (v10 && eol && v10 < eol) return conn && strncasecmp(conn, "keep-alive", 10) == 0;
+    return true;
+}
+
+// Move as much of rx_q into req_buf as fits, opening the TCP window by as much
+static void pull_rx(struct tcp_pcb* pcb, ConnState* cs) {
+    if (!cs->rx_q) return;
+    int room = REQ_BUF_SIZE - 1 - cs->req_len;
+    int n = cs->rx_q->tot_len < room ? cs->rx_q->tot_len : room;
+    if (n <= 0) return;
+    pbuf_copy_partial(cs->rx_q, cs->req_buf + cs->req_len, n, 0);
+    cs->req_len += n;
+    cs->req_buf[cs->req_len] = '\0';
+    cs->rx_q = pbuf_free_header(cs->rx_q, n);   // nullptr once all consumed
+    tcp_recved(pcb, n);
+}
+
+// Length of the first complete request in req_buf (headers + Content-Length
+// body); 0 while incomplete, -1 if it can never fit the buffer
+static int complete_request_len(const ConnState* cs) {
+    const char* hdr_end = strstr(cs->req_buf, "\r\n\r\n");
+    if (!hdr_end) return (cs->req_len >= REQ_BUF_SIZE - 1) ? -1 : 0;
+    int body_offset = (int)(hdr_end - cs->req_buf) + 4;
+    const char* cl = find_header(cs->req_buf, body_offset, "Content-Length");
+    int content_length = cl ? atoi(cl) : 0;
+    if (content_length < 0 || body_offset + content_length > REQ_BUF_SIZE - 1) return -1;
+    if (cs->req_len < body_offset + content_length) return 0;
+    return body_offset + content_length;
+}
+
+// Answer every complete request in req_buf, in order, until one starts a
+// streamed response, closes the connection, or the send buffer runs low
+// (tcp_sent_cb picks up from there)
+static void process_requests(struct tcp_pcb* pcb, ConnState* cs) {
+    while (cs->in_use && !cs->busy && cs->mode == ConnState::SendMode::FlashBody) {
+        pull_rx(pcb, cs);
+        int len = complete_request_len(cs);
+        if (len == 0) return;
+        if (len < 0) {
+            cs->keep_alive = false;
+            send_response(pcb, cs, HTTP_413, BODY_413, strlen(BODY_413));
+            return;
+        }
+        if ((int)tcp_sndbuf(pcb) < RESP_MIN_SNDBUF ||
+            tcp_sndqueuelen(pcb) >= TCP_SND_QUEUELEN - 4) {
+            return;
+        }
+
+        // Terminate this request so the parsers can't run into the next one
+        cs->req_consumed = len;
+        cs->req_saved = cs->req_buf[len];
+        cs->req_buf[len] = '\0';
+        cs->keep_alive = wants_keep_alive(cs->req_buf, len);
+        cs->last_ms = now_ms();
+        handle_request(pcb, cs);
+    }
 }
 
 // ---------- lwIP TCP callbacks -----------------------------------------------
@@ -591,57 +1655,67 @@ static err_t tcp_recv_cb(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t e
 
     if (!p) {
         // Connection closed by client
-        if (cs) {
-            delete cs;
-            tcp_arg(pcb, nullptr);
+        if (cs) conn_free(cs);
+        tcp_arg(pcb, nullptr);
+        tcp_poll(pcb, nullptr, 0);
+        if (tcp_close(pcb) != ERR_OK) {
+            tcp_abort(pcb);
+            return ERR_ABRT;
         }
-        tcp_close(pcb);
         return ERR_OK;
     }
-
-    // Accumulate data
-    int copy_len = p->tot_len;
-    if (cs->req_len + copy_len >= REQ_BUF_SIZE - 1) {
-        copy_len = REQ_BUF_SIZE - 1 - cs->req_len;
-    }
-    if (copy_len > 0) {
-        pbuf_copy_partial(p, cs->req_buf + cs->req_len, copy_len, 0);
-        cs->req_len += copy_len;
-        cs->req_buf[cs->req_len] = '\0';
+    if (!cs) {
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
     }
 
-    tcp_recved(pcb, p->tot_len);
-    pbuf_free(p);
-
-    // Check if we have a complete request (headers + full body)
-    const char* hdr_end = strstr(cs->req_buf, "\r\n\r\n");
-    if (hdr_end) {
-        int body_offset = (hdr_end - cs->req_buf) + 4;
-        int body_received = cs->req_len - body_offset;
-
-        // Check Content-Length to see if we need to wait for body data
-        int content_length = 0;
-        const char* cl = strstr(cs->req_buf, "Content-Length:");
-        if (!cl) cl = strstr(cs->req_buf, "content-length:");
-        if (cl) {
-            cl += 15; // skip "Content-Length:"
-            while (*cl == ' ') cl++;
-            content_length = atoi(cl);
-        }
-
-        if (body_received >= content_length) {
-            // Don't delete cs here — handle_request may keep it for streaming
-            handle_request(pcb, cs);
-        }
-        // else: wait for more data in next tcp_recv_cb call
+    // A stream already answered its one request: swallow anything else
+    if (cs->mode == ConnState::SendMode::Events) {
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
+        return ERR_OK;
     }
 
+    // Queue it; tcp_recved() follows as process_requests() consumes it, so a
+    // client pipelining faster than we answer is throttled by its window
+    if (cs->rx_q) pbuf_cat(cs->rx_q, p);
+    else cs->rx_q = p;
+    cs->last_ms = now_ms();
+    process_requests(pcb, cs);
     return ERR_OK;
 }
 
 static void tcp_err_cb(void* arg, err_t err) {
     ConnState* cs = (ConnState*)arg;
-    if (cs) delete cs;
+    if (cs) conn_free(cs);   // the PCB is already gone
+}
+
+// Every CONN_POLL_TICKS: idle/request timeouts, and a retry for a streamed
+// response that stalled on ERR_MEM with nothing in flight to trigger tcp_sent
+static err_t tcp_poll_cb(void* arg, struct tcp_pcb* pcb) {
+    ConnState* cs = (ConnState*)arg;
+    if (!cs) return ERR_OK;
+    if (cs->mode == ConnState::SendMode::Events) return ERR_OK;   // web_server_tick watches streams
+
+    uint32_t idle = now_ms() - cs->last_ms;
+    if (idle > REQUEST_TIMEOUT_MS) {
+        conn_free(cs);
+        tcp_arg(pcb, nullptr);
+        tcp_abort(pcb);
+        return ERR_ABRT;
+    }
+    if (!cs->busy && cs->req_len == 0 && !cs->rx_q && idle > KEEPALIVE_IDLE_MS) {
+        cleanup_conn(pcb, cs);
+        return ERR_OK;
+    }
+    if (cs->busy) {
+        if (cs->mode == ConnState::SendMode::CsvLog) send_more_csv(pcb, cs);
+        else if (cs->mode == ConnState::SendMode::BinLog) send_more_bin(pcb, cs);
+        else send_more(pcb, cs);
+    }
+    if (cs->in_use && !cs->busy) process_requests(pcb, cs);
+    return ERR_OK;
 }
 
 static err_t tcp_accept_cb(void* arg, struct tcp_pcb* newpcb, err_t err) {
@@ -649,20 +1723,18 @@ static err_t tcp_accept_cb(void* arg, struct tcp_pcb* newpcb, err_t err) {
 
     tcp_setprio(newpcb, TCP_PRIO_MIN);
 
-    ConnState* cs = new ConnState();
-    cs->req_len = 0;
-    cs->req_buf[0] = '\0';
-    cs->send_data = nullptr;
-    cs->send_total = 0;
-    cs->send_offset = 0;
-    cs->resp_body = nullptr;
-    cs->resp_body_len = 0;
-    cs->resp_header_len = 0;
-    cs->header_done = false;
+    ConnState* cs = conn_alloc(newpcb);
+    if (!cs) {
+        // Every slot is mid-request or streaming; lwIP aborts the new PCB
+        printf("[web] connection pool full\n");
+        return ERR_MEM;
+    }
 
     tcp_arg(newpcb, cs);
     tcp_recv(newpcb, tcp_recv_cb);
+    tcp_sent(newpcb, tcp_sent_cb);
     tcp_err(newpcb, tcp_err_cb);
+    tcp_poll(newpcb, tcp_poll_cb, CONN_POLL_TICKS);
 
     return ERR_OK;
 }
@@ -7,4 +7,9 @@
 // state must remain valid for the lifetime of the server.
 void web_server_init(DispenserState* state, uint16_t port = 80);
 
+// Push live status to the /api/events (Server-Sent Events) clients. Call
+// often from the main loop WITH the lwIP lock held; it rate-limits itself
+// (50 ms while dispensing, 200 ms idle). No-op before web_server_init().
+void web_server_tick();
+
 #endif // _WEB_SERVER_H
@@ -1,10 +1,16 @@
 #include "Ws2812.hpp"
+#include <cstdio>
 #include "pico/stdlib.h"
+#include "hardware/dma.h"
 #include "hardware/gpio.h"
 #include "hardware/pio.h"
 #include "hardware/sync.h"
 #include "ws2812.pio.h"
 
+// 24 bits at 800 kHz per LED, then >50 us low to latch (80 us for margin)
+static constexpr uint32_t LED_US   = 30;
+static constexpr uint32_t LATCH_US = 80;
+
 Ws2812::Ws2812(uint pin, uint leds)
 : pin_(pin), leds_(leds), buf_(leds, 0)
 {
@@ -19,6 +25,23 @@ Ws2812::Ws2812(uint pin, uint leds)
 
     // Enable SM
     pio_sm_set_enabled(pio_, sm_, true);
+
+    // Frames are allocated once; show() never allocates or copies vectors
+    frames_[0] = new uint32_t[leds_]();
+    frames_[1] = new uint32_t[leds_]();
+    frame_us_ = leds_ * LED_US + LATCH_US;
+
+    dma_ = dma_claim_unused_channel(false);
+    if (dma_ < 0) {
+        printf("[ws2812] no free DMA channel for GPIO %u, blocking show()\n", pin_);
+        return;
+    }
+    dma_channel_config c = dma_channel_get_default_config(dma_);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio_, sm_, true));
+    dma_channel_configure(dma_, &c, &pio_->txf[sm_], frames_[0], 0, false);
 }
 
 void Ws2812::setPixel(uint i, uint8_t r, uint8_t g, uint8_t b) {
@@ -36,19 +59,70 @@ void Ws2812::clear() {
 }
 
 void Ws2812::show() {
+    if (dma_ < 0) { showBlocking(); return; }
+
     // Skip identical frames. Callers repaint every UI tick; retransmitting an
     // unchanged frame only creates flicker windows.
-    if (ever_shown_ && buf_ == last_) return;
+    const uint32_t* newest = frames_[newest_];
+    bool changed = !ever_shown_;
+    for (uint i = 0; i < leds_ && !changed; ++i)
+        changed = (buf_[i] << 8u) != newest[i];
+    if (!changed) return;
+
+    // Short critical section (a 48-word copy, ~1 us) so the latch alarm
+    // can't start the back buffer while it's half written
+    uint32_t irq = save_and_disable_interrupts();
+    // The buffer not on the wire: a parked frame is simply overwritten
+    uint8_t back = (sending_ && pending_) ? newest_ : (uint8_t)(newest_ ^ 1);
+    uint32_t* f = frames_[back];
+    for (uint i = 0; i < leds_; ++i) f[i] = buf_[i] << 8u;
+    newest_ = back;
+    ever_shown_ = true;
+    if (sending_) pending_ = true;
+    else          startFrame(back);
+    restore_interrupts(irq);
+}
+
+void Ws2812::startFrame(uint8_t f) {
+    sending_ = true;
+    pending_ = false;
+    dma_channel_transfer_from_buffer_now(dma_, frames_[f], leds_);
+    // Fires once the last bit and the latch gap are over. If the alarm pool
+    // is full, wait here instead: correct, just blocking like before.
+    if (add_alarm_in_us(frame_us_, latchDone, this, true) < 0) {
+        busy_wait_us_32(frame_us_);
+        sending_ = false;
+    }
+}
+
+int64_t Ws2812::latchDone(alarm_id_t, void* user) {
+    Ws2812* s = static_cast<Ws2812*>(user);
+    if (!s->pending_) {
+        s->sending_ = false;
+        return 0;
+    }
+    // A show() arrived mid-frame: send it now and keep the alarm going
+    s->pending_ = false;
+    dma_channel_transfer_from_buffer_now(s->dma_, s->frames_[s->newest_], s->leds_);
+    return s->frame_us_;
+}
+
+void Ws2812::showBlocking() {
+    const uint32_t* last = frames_[0];
+    bool changed = !ever_shown_;
+    for (uint i = 0; i < leds_ && !changed; ++i)
+        changed = (buf_[i] << 8u) != last[i];
+    if (!changed) return;
 
     // Transmit atomically: an interrupt pausing the stream >50us mid-frame
     // (e.g. WiFi/lwIP work while using the web app) makes the strip latch a
     // partial frame - visible as flicker. 48 LEDs take ~1.5 ms.
     uint32_t irq = save_and_disable_interrupts();
     for (uint i = 0; i < leds_; ++i) {
-        pio_sm_put_blocking(pio_, sm_, buf_[i] << 8u);
+        frames_[0][i] = buf_[i] << 8u;
+        pio_sm_put_blocking(pio_, sm_, frames_[0][i]);
     }
     restore_interrupts(irq);
-    sleep_us(80); // >50µs reset/latch
-    last_ = buf_;
+    sleep_us(LATCH_US); // >50µs reset/latch
     ever_shown_ = true;
-}
\ No newline at end of file
+}
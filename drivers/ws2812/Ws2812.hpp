@@ -2,7 +2,17 @@
 #include <cstdint>
 #include <vector>
 #include "hardware/pio.h"
+#include "pico/time.h"
 
+// WS2812 strip on a PIO state machine, fed by DMA.
+//
+// show() encodes the draw buffer into one of two pre-shifted frame buffers
+// and starts a DMA channel into the SM's TX FIFO - no interrupt masking, no
+// waiting. The PIO clocks the bits out at 800 kHz and the DMA (paced by the
+// TX DREQ) keeps the FIFO topped up, so the bitstream stays continuous while
+// lwIP or the encoder IRQ run. An alarm fires once the frame plus the >50 us
+// latch gap is over; a show() in the meantime parks its frame in the other
+// buffer and that alarm starts it (newest frame wins).
 class Ws2812 {
 public:
     Ws2812(uint pin, uint leds);
@@ -20,7 +30,7 @@ public:
     // Buffer-based API
     void setPixel(uint i, uint8_t r, uint8_t g, uint8_t b); // i in [0, leds)
     void clear();
-    void show();
+    void show();    // returns immediately; unchanged frames aren't resent
 
     // Global brightness for this strip, 0-255 (255 = full). Applied in
     // setPixel, so callers keep passing full-range colors.
@@ -36,15 +46,24 @@ private:
         return (uint32_t(g) << 16) | (uint32_t(r) << 8) | uint32_t(b);
     }
 
+    void showBlocking();                    // no DMA channel: old path
+    void startFrame(uint8_t f);             // IRQs off
+    static int64_t latchDone(alarm_id_t id, void* user);
+
     // Resources claimed/used by this strip instance
     PIO  pio_    = nullptr;
     uint sm_     = 0;
     uint offset_ = 0;
     uint pin_    = 0;
     uint leds_   = 0;
+    int  dma_    = -1;
 
     std::vector<uint32_t> buf_;  // 24‑bit GRB per LED (unshifted)
-    std::vector<uint32_t> last_; // last transmitted frame (skip-if-unchanged)
+    uint32_t* frames_[2] = {};   // DMA sources, GRB << 8 as the PIO wants
+    uint8_t  newest_ = 0;        // frame holding the last show()
+    uint32_t frame_us_ = 0;      // bits on the wire + latch gap
+    volatile bool sending_ = false;   // DMA/latch in progress
+    volatile bool pending_ = false;   // frames_[newest_] waits for the latch
     bool ever_shown_ = false;
     uint8_t brightness_ = 255;
 };
\ No newline at end of file
@@ -6,8 +6,8 @@
 enum class WebCommand : uint8_t {
     None = 0,
     Tare,
-    StartDispense,
-    StopDispense,
+    StartDispense,  // i0 scale (-1 = selected), f0 target grams (0 = current)
+    StopDispense,   // i0 scale, -1 = every run
     SetTarget,
     SelectScale,
     TestServo,
@@ -18,18 +18,178 @@ enum class WebCommand : uint8_t {
     SetName,
     SetServoZero,
     EStop,
+    CancelOp,       // control core only: abandon a scale's tare/calibration
+    Autotune,       // step test: i0 scale, f0 step opening (deg), f1 gram cap, f2 tc (s)
+    AutotuneApply,  // use scale i0's proposed gains; f0 != 0 also saves them
+    RecipeSave,     // store recipe_stage[i0] in slot i0 (count 0 deletes it)
+    RecipeRun,      // run recipe i0 as a batch; f0 batch weight (0 = as saved)
+    RecipeStop,     // stop the batch and its runs
+    QueueStart,     // order queue: i0 scale (-1 = selected), f0 target (0 = current), f1 count
+    QueueNext,      // the next container is in place: skip the swap detection
+    QueueStop,      // stop the queue and its run
+    BagReserve,     // i0 scale, f0 gross grams where its flow stops (< 0 = default)
+    SetClock,       // i0 local calendar day (days since 1970), f0 seconds into it
 };
 
 // One queued web command with its payload
 struct WebCmd {
     WebCommand cmd = WebCommand::None;
     int   i0 = 0;                  // target grams / scale index / cal weight
-    float f0 = 0, f1 = 0, f2 = 0;  // servo angle / vib intensity / kp,ki,kd
+    float f0 = 0, f1 = 0, f2 = 0;  // servo angle / vib intensity / kp,ki,kd (SetPID: scale i0)
     char  s0[16] = {0};            // scale content name (SetName)
+    uint16_t id = 0;               // control core: request id, echoed in ScaleStatus
 };
 
 inline constexpr uint8_t WEBCMD_QUEUE_LEN = 8;
 
+// --- Control core (core 1) -> UI core snapshot ------------------------------
+// Published every control period through a lock-free queue (app/control.cpp).
+// Snapshots may be dropped when the UI core lags, so completion events are
+// carried as sequence numbers / ids, never as one-shot flags.
+
+struct ScaleStatus {
+    float    weight      = 0;    // tare-relative grams (filtered, read_weight(1))
+    float    gross       = 0;    // vs the calibrated zero
+    int32_t  offset      = 0;    // tare zero (raw counts)
+    int32_t  cal_offset  = 0;    // calibrated zero (raw counts)
+    float    cpg         = 1.0f; // counts per gram
+    uint16_t sample_ms   = 100;  // filtered output period
+    uint8_t  op_busy     = 0;    // tare/calibration running
+    uint8_t  op_progress = 0;    // 0..100 %
+    uint16_t op_id       = 0;    // id of the last FINISHED op (WebCmd::id)
+    uint8_t  op_ok       = 0;    // its result: 1 = Done, 0 = Failed/cancelled
+};
+
+// One scale's dispense run; the three scales run independently (in parallel)
+struct RunStatus {
+    bool     dispensing      = false;
+    bool     done            = false;// last run reached its target
+    uint16_t seq             = 0;    // bumps when a run ends (done or stopped)
+    float    dispensed       = 0;    // grams so far; keeps tracking after the
+                                     // close (post-close overshoot)
+    float    final_dispensed = 0;    // at the end of the last run (the close)
+    float    in_flight       = 0;    // grams predicted to land after that close
+    bool     settling        = false;// closed, in-flight grams still landing:
+                                     // no new run on the scale yet
+    uint16_t settled_seq     = 0;    // bumps when the landing is over
+    float    settled         = 0;    // grams dispensed then: the run's result
+    bool     no_flow         = false;// last run stopped: gate wide open, nothing came
+    float    servo_angle     = 0;
+    float    vib             = 0;
+};
+
+struct ControlStatus {
+    ScaleStatus scale[3];
+    RunStatus   run[3];
+    uint32_t tick_overruns   = 0;    // control periods that ran late
+};
+
+// Autotune (app/autotune.hpp): the last step test on one scale - its fitted
+// flow model and the gains proposed from it
+enum class TuneState : uint8_t { None = 0, Running, Done, Failed };
+
+struct TuneResult {
+    TuneState state = TuneState::None;
+    float k      = 0;   // g/s per degree of opening
+    float dead_s = 0;
+    float tau_s  = 0;
+    float tc_s   = 0;   // closed-loop time constant the gains were proposed for
+    float kp = 0, ki = 0, kd = 0;
+};
+
+// Recipes (app/recipe.hpp runs them): up to three items, each a scale and its
+// share of the batch in grams or in percent of the recipe's total. Items in
+// one stage dispense side by side, stages in order. Stored as is in flash
+// (RecipeConfig), so the layout is fixed: all seven fit one config page.
+inline constexpr int RECIPE_SLOTS    = 7;
+inline constexpr int RECIPE_ITEMS    = 3;
+inline constexpr int RECIPE_NAME_LEN = 16;   // 15 chars + NUL
+
+struct RecipeItem {
+    uint8_t  scale   = 0;   // 0-2
+    uint8_t  stage   = 0;   // 0-2
+    uint16_t amount  = 0;   // grams, or 0.1 % of total_g (Recipe::percent)
+};
+
+struct Recipe {
+    char       name[RECIPE_NAME_LEN] = {0};
+    uint16_t   total_g = 0;      // batch weight the percentages are of
+    uint8_t    count   = 0;      // items in use; 0 = empty slot
+    uint8_t    percent = 0;      // bit i: items[i] is in 0.1 %
+    RecipeItem items[RECIPE_ITEMS];
+};
+
+// The running (or last) batch, published by main.cpp for /api/recipe
+enum class BatchState : uint8_t { Idle = 0, Running, Done, Failed };
+enum class ItemState : uint8_t { Pending = 0, Running, Done, Failed };
+
+struct BatchItem {
+    uint8_t   scale  = 0;
+    uint8_t   stage  = 0;
+    ItemState state  = ItemState::Pending;
+    float     target = 0;   // grams asked for (carry-forward included)
+    float     actual = 0;   // settled grams at the run's end
+};
+
+struct BatchStatus {
+    BatchState state  = BatchState::Idle;
+    int8_t     slot   = -1;     // recipe
+    uint8_t    count  = 0;
+    uint8_t    stage  = 0;      // stage running (or last run)
+    float      factor = 1.0f;   // carry-forward scale on the later stages
+    BatchItem  items[RECIPE_ITEMS];
+    char       error[24] = {0}; // why it failed
+};
+
+// Order queue (app/order_queue.hpp): N identical dispenses on one scale,
+// back to back, each started once the container under the gate was swapped.
+// Its state reuses BatchState. Phase of the current dispense:
+enum class QueuePhase : uint8_t {
+    Start = 0,   // next run due
+    Run,         // run going
+    Settle,      // run over: waiting for the bag to hang still (baseline)
+    Remove,      // waiting for the full container to be taken away
+    Place,       // waiting for the next one to be put in place
+};
+
+struct QueueStatus {
+    BatchState state  = BatchState::Idle;
+    QueuePhase phase  = QueuePhase::Start;
+    int8_t     scale  = -1;
+    uint16_t   count  = 0;      // dispenses asked for
+    uint16_t   done   = 0;      // finished
+    float      target = 0;      // grams each
+    float      last   = 0;      // grams of the last run
+    float      total  = 0;      // grams of all finished runs
+    char       error[24] = {0}; // why it failed
+};
+
+// Bag level (app/bag_level.hpp): grain left in each scale's bag, from the
+// gross weight, and the grams dispensed per calendar day. The log is stored
+// as is in flash (BagConfig), so the layout is fixed.
+inline constexpr int   BAG_DAYS     = 24;
+inline constexpr float BAG_MARGIN_G = 20.0f;   // a run needs its target + this left
+inline constexpr int   BAG_LOW_RUNS = 3;       // warn at this many runs left
+
+struct BagDay {
+    uint16_t day    = 0;          // local calendar day, days since 1970 (0 = unused)
+    uint16_t g10[3] = {0, 0, 0};  // grams dispensed / 10, per scale
+};
+
+struct BagLog {
+    uint16_t reserve_g[3] = {0, 0, 0};   // gross weight where the flow stops, 0 = default
+    uint16_t pad = 0;
+    BagDay   days[BAG_DAYS];             // oldest first; unused ones at the end
+};
+
+struct BagStatus {
+    float avail_g   = 0;    // grain left above the reserve
+    float reserve_g = 0;
+    int   runs_left = -1;   // whole runs of the scale's target; -1 = unknown (not calibrated)
+    float rate_gpd  = 0;    // grams per calendar day over the log
+    float days_left = -1;   // at that rate; -1 = no history yet
+};
+
 struct DispenserState {
     // --- Written by main loop, read by web server ---
     float weights[3]       = {0, 0, 0};   // Tare-relative weight per scale (grams)
@@ -38,18 +198,38 @@ struct DispenserState {
     char  names[3][16]     = {{0},{0},{0}};  // Scale contents ("Wheat", "Spelt", ...)
     int   selected_scale   = 0;            // 0-2
     int   target_grams     = 100;
-    bool  dispensing       = false;
-    bool  dispense_done    = false;
+    bool  dispensing       = false;        // any scale's run (guards flash, jogs, tare)
+    bool  dispense_done    = false;        // these two: the selected scale's run
     float dispensed_grams  = 0;            // Amount dispensed so far
     bool  scale_calibrated[3] = {false, false, false};
-    float pid_kp = 0;
-    float pid_ki = 0;
-    float pid_kd = 0;
-    float servo_angle    = 0;              // Current servo angle (degrees)
-    float vib_intensity  = 0;              // Current vibrator intensity (0-1)
+    float pid_kp[3] = {0, 0, 0};           // per scale
+    float pid_ki[3] = {0, 0, 0};
+    float pid_kd[3] = {0, 0, 0};
+    float servo_angle    = 0;              // Selected scale's servo angle (degrees)
+    float vib_intensity  = 0;              // Selected scale's vibrator intensity (0-1)
+    // Per-scale runs (parallel dispensing); set through set_run_active()
+    bool  run_active[3]  = {false, false, false};
+    bool  run_done[3]    = {false, false, false};   // last run reached its target
+    float run_grams[3]   = {0, 0, 0};      // dispensed so far / final
+    int   run_target[3]  = {0, 0, 0};
+    float run_servo[3]   = {0, 0, 0};
+    float run_vib[3]     = {0, 0, 0};
+    uint32_t run_id[3]   = {0, 0, 0};      // telemetry run of the current/last run
     bool  ap_mode        = false;          // True when serving own AP instead of joining WiFi
     float servo_zero[3]  = {-1, -1, -1};   // Calibrated flow-start angle per servo
                                            // (degrees); < 0 = not calibrated
+    TuneResult tune[3];                    // last autotune per scale (GET /api/autotune)
+    Recipe      recipes[RECIPE_SLOTS];     // recipe book (GET /api/recipe)
+    BatchStatus batch;
+    QueueStatus queue;                     // order queue (GET /api/queue)
+    BagStatus   bag[3];                    // bag levels (GET /api/bag)
+    BagLog      bag_log;                   // reserves + consumption per day
+
+    // --- Written by the web server, read by main loop ---
+    // POST /api/recipe stages a recipe here and queues RecipeSave for its
+    // slot; the main loop copies it into recipes[] and persists it. Per slot,
+    // so a second save queued behind the first can't swap their contents.
+    Recipe recipe_stage[RECIPE_SLOTS];
 
     // --- Command ring queue: web server (lwIP context) pushes at head, main loop
     // drains from tail under the lwIP lock. A queue (not a single slot) so commands
@@ -59,10 +239,25 @@ struct DispenserState {
     volatile uint8_t cmd_tail = 0;   // next read slot (main loop)
 };
 
+// A run started or ended on scale i. dispensing follows in the same step, so
+// nothing that checks it (flash saves, jogs) can slip in between.
+inline void set_run_active(DispenserState& s, int i, bool on) {
+    s.run_active[i] = on;
+    s.dispensing = s.run_active[0] || s.run_active[1] || s.run_active[2];
+}
+
+// The bag on scale i holds enough for a run of target grams. Uncalibrated
+// scales always do: their raw counts aren't grams.
+inline bool bag_covers(const DispenserState& s, int i, float target) {
+    if (!s.scale_calibrated[i]) return true;
+    return s.gross[i] - s.bag[i].reserve_g >= target + BAG_MARGIN_G;
+}
+
 // --- Servo working-range helpers -------------------------------------------
 // Each dispenser mechanism differs, so the angle where grain starts to flow is
 // calibrated per servo (servo_zero[], jogged + saved by the user). Servos
-// without a calibration keep the historical fixed values.
+// without a calibration keep the historical fixed values. Each helper also
+// takes the zero itself, for core 1, which keeps just those three angles.
 
 inline constexpr float SERVO_CLOSE_BACKOFF_DEG = 15.0f;  // close this far below zero
 inline constexpr float SERVO_DEFAULT_MIN_OPEN  = 85.0f;  // uncalibrated PID floor
@@ -71,31 +266,42 @@ inline constexpr float SERVO_FULL_OPEN         = 170.0f; // uncalibrated PID cei
 // the flow-start point; +5 deg of lean guarantees "fully open" is reached.
 inline constexpr float SERVO_OPEN_SPAN_DEG     = 80.0f;
 
+inline bool servo_zero_set(float zero) {
+    return zero >= 0.0f && zero <= 180.0f;
+}
 inline bool servo_zero_set(const DispenserState& s, int i) {
-    return s.servo_zero[i] >= 0.0f && s.servo_zero[i] <= 180.0f;
+    return servo_zero_set(s.servo_zero[i]);
 }
 
 // PID lower output limit. Clamped to 175 so min < max always holds (see
 // servo_max_open) - PID::SetOutputLimits(min, max) silently ignores min >= max.
+inline float servo_min_open(float zero) {
+    if (!servo_zero_set(zero)) return SERVO_DEFAULT_MIN_OPEN;
+    return zero > 175.0f ? 175.0f : zero;
+}
 inline float servo_min_open(const DispenserState& s, int i) {
-    if (!servo_zero_set(s, i)) return SERVO_DEFAULT_MIN_OPEN;
-    float z = s.servo_zero[i];
-    return z > 175.0f ? 175.0f : z;
+    return servo_min_open(s.servo_zero[i]);
 }
 
 // PID upper output limit: zero + usable span, capped at the servo's 180 limit.
-inline float servo_max_open(const DispenserState& s, int i) {
-    if (!servo_zero_set(s, i)) return SERVO_FULL_OPEN;
-    float m = s.servo_zero[i] + SERVO_OPEN_SPAN_DEG;
+inline float servo_max_open(float zero) {
+    if (!servo_zero_set(zero)) return SERVO_FULL_OPEN;
+    float m = zero + SERVO_OPEN_SPAN_DEG;
     return m > 180.0f ? 180.0f : m;
 }
+inline float servo_max_open(const DispenserState& s, int i) {
+    return servo_max_open(s.servo_zero[i]);
+}
 
 // Physical closed position: just below the flow-start point instead of a full
 // sweep to 0 - faster, gentler closes. Uncalibrated: 0 (historical behavior).
-inline float servo_close(const DispenserState& s, int i) {
-    if (!servo_zero_set(s, i)) return 0.0f;
-    float c = s.servo_zero[i] - SERVO_CLOSE_BACKOFF_DEG;
+inline float servo_close(float zero) {
+    if (!servo_zero_set(zero)) return 0.0f;
+    float c = zero - SERVO_CLOSE_BACKOFF_DEG;
     return c < 0.0f ? 0.0f : c;
 }
+inline float servo_close(const DispenserState& s, int i) {
+    return servo_close(s.servo_zero[i]);
+}
 
 #endif // _DISPENSER_STATE_H
@@ -0,0 +1,48 @@
+#ifndef _SPSC_QUEUE_H
+#define _SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer ring for passing fixed-size
+// messages between the two cores (core 0 UI/web <-> core 1 control).
+//
+// One slot stays empty to tell full from empty, so N slots hold N-1 items.
+// The producer fills the slot before the release-store of head_; the consumer
+// acquire-loads head_ before reading it - the RP2350's M33 cores need nothing
+// beyond those barriers (no caches on SRAM). Never blocks: push() on a full
+// queue returns false and the caller decides (drop / retry next tick).
+
+template <typename T, uint32_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "queue length must be a power of two");
+
+public:
+    bool push(const T& v) {
+        uint32_t h = head_.load(std::memory_order_relaxed);
+        uint32_t next = (h + 1) & (N - 1);
+        if (next == tail_.load(std::memory_order_acquire)) return false;   // full
+        buf_[h] = v;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& out) {
+        uint32_t t = tail_.load(std::memory_order_relaxed);
+        if (t == head_.load(std::memory_order_acquire)) return false;      // empty
+        out = buf_[t];
+        tail_.store((t + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+private:
+    T buf_[N];
+    std::atomic<uint32_t> head_{0};   // written by the producer only
+    std::atomic<uint32_t> tail_{0};   // written by the consumer only
+};
+
+#endif // _SPSC_QUEUE_H
@@ -0,0 +1,190 @@
+// StepTuner (app/autotune.cpp) against a synthetic step test: a gate whose
+// flow follows its angle with a known gain, dead time and time constant,
+// grams integrated from it with load-cell noise on every reading, logged the
+// way step_tune (control.cpp) logs the experiment and read back through the
+// telemetry codec the way the autotune screen reads it. Checks the fit finds
+// k, dead and tau, that the gains proposed from it are those of the true
+// model, and that runs without a usable step are refused.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "autotune.hpp"
+#include "check.hpp"
+#include "telem_csv.hpp"
+
+static const float SERVO_ZERO = 35.0f;
+static const uint32_t TUNE_HOLD_MS = 3000;   // control.cpp
+static const uint32_t TUNE_STEP_MS = 4000;
+
+// The plant: flow = k * (gate angle - zero), reached through the dead time
+// and then a first-order lag
+struct Truth {
+    float k = 0.6f;        // g/s per degree
+    float dead_s = 0.30f;
+    float tau_s = 0.40f;
+    float noise_g = 0.2f;
+};
+
+// One step test: half the opening for TUNE_HOLD_MS, then the full opening
+// for TUNE_STEP_MS, a logged sample per scale output (period_us). The plant
+// runs at 1 ms.
+static std::vector<TelemetrySample> step_test(const Truth& p, float open, uint32_t seed,
+                                              uint32_t period_us = 12500)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, p.noise_g);
+    const float dt = 0.001f;
+    const int dead = (int)std::lround(p.dead_s / dt);
+    std::vector<float> cmd_hist;   // commanded flow per ms, for the dead time
+    float servo = SERVO_ZERO + 0.5f * open;
+    // Steady at the hold opening from the start, as after the tare
+    float flow = p.k * (servo - SERVO_ZERO), grams = 0.0f;
+    std::vector<TelemetrySample> out;
+    uint64_t next_us = 0;
+    for (uint64_t us = 0; us <= (TUNE_HOLD_MS + TUNE_STEP_MS) * 1000ull; us += 1000) {
+        if (us >= next_us) {
+            next_us += period_us;
+            TelemetrySample s{};
+            s.t_ms = (uint32_t)(us / 1000);
+            s.setpoint = 1000.0f;   // the gram cap, never reached
+            s.dispensed = grams + noise(rng);
+            s.weight = 1500.0f - s.dispensed;
+            s.gross = 1900.0f - s.dispensed;
+            // The command issued after this sample, as step_tune logs it
+            servo = SERVO_ZERO + (s.t_ms < TUNE_HOLD_MS ? 0.5f * open : open);
+            s.servo = servo;
+            out.push_back(s);
+        }
+        cmd_hist.push_back(p.k * (servo - SERVO_ZERO));
+        float target = (int)cmd_hist.size() > dead ? cmd_hist[cmd_hist.size() - 1 - dead] : cmd_hist.front();
+        flow += (target - flow) * dt / p.tau_s;
+        grams += flow * dt;
+    }
+    return telem_as_logged(out);
+}
+
+// Fed the way the autotune screen does: in order until the tuner is full
+static bool fit(const std::vector<TelemetrySample>& run, StepModel& m)
+{
+    StepTuner tuner;
+    for (const auto& s : run) {
+        if (!tuner.add(s)) break;
+    }
+    return tuner.fit(m);
+}
+
+static void check_recovers(const Truth& p, float open, uint32_t seed, uint32_t period_us,
+                           float k_tol, float dead_tol, float tau_tol)
+{
+    StepModel m;
+    CHECK(fit(step_test(p, open, seed, period_us), m));
+    std::printf("k %.3f dead %.3f tau %.3f (truth %.3f %.3f %.3f, noise %.1f g, %u us): "
+                "rms %.2f g, base %.2f g/s\n",
+                (double)m.k, (double)m.dead_s, (double)m.tau_s, (double)p.k, (double)p.dead_s,
+                (double)p.tau_s, (double)p.noise_g, (unsigned)period_us, (double)m.rms_g,
+                (double)m.base_gps);
+    CHECK_NEAR(m.k, p.k, k_tol * p.k);
+    CHECK_NEAR(m.dead_s, p.dead_s, dead_tol);
+    CHECK_NEAR(m.tau_s, p.tau_s, tau_tol);
+    CHECK_NEAR(m.du_deg, 0.5f * open, 0.1f);
+    CHECK_NEAR(m.base_gps, p.k * 0.5f * open, 0.05f * p.k * 0.5f * open + 0.2f);
+}
+
+// Without noise the fit is limited by its grid and the codec's 0.1 g steps
+static void test_noise_free()
+{
+    Truth p;
+    p.noise_g = 0.0f;
+    check_recovers(p, 40.0f, 1, 12500, 0.02f, 0.03f, 0.05f);
+}
+
+// Different gates and lags, at the scale's usual output periods
+static void test_plants()
+{
+    const Truth plants[] = {
+        { 0.6f, 0.30f, 0.40f, 0.2f },
+        { 0.3f, 0.15f, 0.20f, 0.2f },   // fine grain: little flow, quick
+        { 1.2f, 0.60f, 1.00f, 0.2f },   // coarse, slow gate
+        { 0.8f, 0.45f, 0.10f, 0.2f },   // mostly dead time
+    };
+    uint32_t seed = 10;
+    for (const Truth& p : plants) {
+        check_recovers(p, 40.0f, seed++, 12500, 0.05f, 0.06f, 0.12f + 0.1f * p.tau_s);
+        check_recovers(p, 30.0f, seed++, 25000, 0.05f, 0.06f, 0.12f + 0.1f * p.tau_s);
+    }
+}
+
+// With the vibrator's noise on every reading, still close enough to tune
+static void test_heavy_noise()
+{
+    Truth p;
+    p.noise_g = 0.8f;
+    for (uint32_t seed = 20; seed < 25; seed++) check_recovers(p, 40.0f, seed, 12500, 0.08f, 0.1f, 0.2f);
+}
+
+// The gains from the fitted model are the gains of the true one
+static void test_proposal()
+{
+    Truth p;
+    StepModel m;
+    CHECK(fit(step_test(p, 40.0f, 30), m));
+    StepModel truth = m;
+    truth.k = p.k;
+    truth.dead_s = p.dead_s;
+    truth.tau_s = p.tau_s;
+    for (float tc : {0.5f, 1.0f, 2.0f}) {
+        PidProposal got = StepTuner::propose(m, tc);
+        PidProposal want = StepTuner::propose(truth, tc);
+        CHECK_NEAR(got.kp, want.kp, 0.1f * want.kp);
+        CHECK_NEAR(got.ki, want.ki, 0.1f * want.ki);
+        CHECK_NEAR(got.kd, want.kd, 0.2f * want.kd);
+    }
+    // SIMC for the integrating process: Kc = 1 / (k (tc + dead)), Ti = 4 (tc + dead),
+    // Td = tau, series to parallel
+    PidProposal g = StepTuner::propose(truth, 1.0f);
+    float kc = 1.0f / (p.k * (1.0f + p.dead_s)), ti = 4.0f * (1.0f + p.dead_s);
+    CHECK_NEAR(g.kp, kc * (1.0f + p.tau_s / ti), 1e-4f);
+    CHECK_NEAR(g.ki, kc / ti, 1e-5f);
+    CHECK_NEAR(g.kd, kc * p.tau_s, 1e-4f);
+}
+
+// Runs the fit must refuse
+static void test_refused()
+{
+    Truth p;
+    StepModel m;
+
+    // The gate never stepped (a 0 deg step test)
+    CHECK(!fit(step_test(p, 0.0f, 40), m));
+
+    // The log ends 0.1 s after the step
+    std::vector<TelemetrySample> cut;
+    for (const auto& s : step_test(p, 40.0f, 41)) {
+        if (s.t_ms < TUNE_HOLD_MS + 100) cut.push_back(s);
+    }
+    CHECK(!fit(cut, m));
+
+    // The gate opened, no grain came (empty hopper): noise only, whatever
+    // it fits
+    Truth empty = p;
+    empty.k = 0.0f;
+    for (uint32_t seed = 42; seed < 52; seed++) CHECK(!fit(step_test(empty, 40.0f, seed), m));
+    empty.noise_g = 0.8f;
+    CHECK(!fit(step_test(empty, 40.0f, 52), m));
+
+    // Nothing logged
+    CHECK(!fit({}, m));
+}
+
+int main()
+{
+    test_noise_free();
+    test_plants();
+    test_heavy_noise();
+    test_proposal();
+    test_refused();
+    return check_exit("autotune_test");
+}
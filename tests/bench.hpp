@@ -0,0 +1,21 @@
+#pragma once
+#include <chrono>
+
+// Host benchmark support: wall-clock seconds since construction
+class BenchTimer {
+public:
+    BenchTimer() : t0_(std::chrono::steady_clock::now()) {}
+    double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point t0_;
+};
+
+// Keeps a result alive past the optimizer
+template <typename T>
+inline void bench_keep(const T& v)
+{
+    asm volatile("" : : "g"(&v) : "memory");
+}
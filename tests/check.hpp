@@ -0,0 +1,41 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+
+// Host test support: no framework. One executable per module, CHECKs count
+// failures and carry on, check_exit() turns them into the exit code ctest
+// reads.
+
+inline int& check_failures()
+{
+    static int n = 0;
+    return n;
+}
+
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__,        \
+                         __LINE__, #cond);                                     \
+            check_failures()++;                                                \
+        }                                                                      \
+    } while (0)
+
+#define CHECK_NEAR(a, b, tol)                                                  \
+    do {                                                                       \
+        double a_ = (double)(a), b_ = (double)(b);                             \
+        if (!(std::fabs(a_ - b_) <= (double)(tol))) {                          \
+            std::fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s, %s) failed: "      \
+                         "%g vs %g\n", __FILE__, __LINE__, #a, #b, #tol,       \
+                         a_, b_);                                              \
+            check_failures()++;                                                \
+        }                                                                      \
+    } while (0)
+
+inline int check_exit(const char* name)
+{
+    int n = check_failures();
+    if (n) std::fprintf(stderr, "%s: %d check(s) failed\n", name, n);
+    else   std::printf("%s: ok\n", name);
+    return n ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+// ConfigLog (drivers/hx711/config_log.cpp) on an emulated NOR flash
+// (flash_sim.hpp), with the firmware's geometry: power cut at every erase and
+// page program of a workload that wraps the area several times, torn both as
+// a page prefix and as random bits, and again during the remount that
+// recovers from it. After every cut the log must mount, return each key's
+// last completed save (or the one cut short, if it landed), and carry on.
+
+#include <cstdio>
+#include <cstring>
+
+#include "check.hpp"
+#include "config_log.hpp"
+#include "flash_sim.hpp"
+
+static constexpr uint32_t SECTOR = 4096, PAGE = 256, SECTORS = 4;   // config_store.cpp
+
+// Keys with config_store-like struct sizes, the last one a whole page
+static constexpr int KEYS = 4;
+static const uint16_t KEY[KEYS] = {1, 2, 3, 7};
+static const uint16_t LEN[KEYS] = {48, 96, 20, PAGE - 16};
+
+// Payload of save `step` for key k: the step, then a pattern that depends on
+// both, so a record from another save can't pass for it
+static void payload(int k, int step, uint8_t* out)
+{
+    std::memcpy(out, &step, 4);
+    for (int i = 4; i < LEN[k]; i++) out[i] = (uint8_t)(step * 31 + i * 7 + k);
+}
+
+// Key of the step-th save of a workload: uneven, like the firmware's (the
+// scale config is saved far more often than the rest)
+static int key_of(int step) { return (step % 7 < 4) ? 0 : (step % 7 < 6) ? 1 : (step % 11 == 0) ? 3 : 2; }
+
+struct Model {
+    int committed[KEYS] = {-1, -1, -1, -1};   // step of the last completed save
+    int inflight = -1;                        // save cut short, if any
+};
+
+// Saves [from, to); false when a power cut ended it
+static bool run(ConfigLog& log, Model& m, int from, int to)
+{
+    uint8_t buf[PAGE];
+    for (int step = from; step < to; step++) {
+        int k = key_of(step);
+        payload(k, step, buf);
+        m.inflight = step;
+        try {
+            bool ok = log.write(KEY[k], buf, LEN[k]);
+            CHECK(ok);
+        } catch (const PowerCut&) {
+            return false;
+        }
+        m.committed[k] = step;
+        m.inflight = -1;
+    }
+    return true;
+}
+
+// Every key reads back its last completed save, or the save that was cut
+// short; the model then takes what the log says
+static bool verify(const ConfigLog& log, Model& m)
+{
+    bool ok = true;
+    uint8_t got[PAGE], want[PAGE];
+    for (int k = 0; k < KEYS; k++) {
+        int cut = (m.inflight >= 0 && key_of(m.inflight) == k) ? m.inflight : -1;
+        if (!log.read(KEY[k], got, LEN[k])) {
+            ok &= m.committed[k] < 0;
+            continue;
+        }
+        int step;
+        std::memcpy(&step, got, 4);
+        ok &= step == m.committed[k] || step == cut;
+        payload(k, step, want);
+        ok &= std::memcmp(got, want, LEN[k]) == 0;
+        m.committed[k] = step;
+    }
+    m.inflight = -1;
+    return ok;
+}
+
+static bool mount(ConfigLog& log, FlashSim& f)
+{
+    try {
+        return log.mount(f.flash());
+    } catch (const PowerCut&) {
+        return false;
+    }
+}
+
+static void test_basic()
+{
+    FlashSim f(SECTOR, PAGE, SECTORS);
+    ConfigLog log;
+    CHECK(log.mount(f.flash()));
+    CHECK(f.ops == 0);   // a blank area needs nothing
+    uint8_t buf[PAGE];
+    CHECK(!log.read(KEY[0], buf, LEN[0]));
+
+    Model m;
+    CHECK(run(log, m, 0, 20));
+    CHECK(verify(log, m));
+    CHECK(!log.read(KEY[0], buf, LEN[0] - 1));   // length must match
+    CHECK(!log.write(9, buf, PAGE - 15));        // bigger than a page
+
+    // Saving what is already stored costs no program
+    long ops = f.ops;
+    payload(key_of(19), 19, buf);
+    CHECK(log.write(KEY[key_of(19)], buf, LEN[key_of(19)]));
+    CHECK(f.ops == ops);
+
+    ConfigLog again;
+    CHECK(again.mount(f.flash()));
+    CHECK(verify(again, m));
+
+    // Geometry the log can't work with
+    FlashSim two(SECTOR, PAGE, 2);
+    CHECK(!again.mount(two.flash()));
+    FlashSim tiny(256, 32, 4);   // 8 pages a sector: not more than the keys
+    CHECK(!again.mount(tiny.flash()));
+}
+
+// A page that never verifies is skipped, the save lands on the next one
+static void test_bad_page()
+{
+    FlashSim f(SECTOR, PAGE, SECTORS);
+    ConfigLog log;
+    CHECK(log.mount(f.flash()));
+    Model m;
+    CHECK(run(log, m, 0, 5));
+    f.bad_page = 5 * PAGE;
+    CHECK(run(log, m, 5, 60));
+    ConfigLog again;
+    CHECK(again.mount(f.flash()));
+    CHECK(verify(again, m));
+    CHECK(f.overprograms == 0);
+}
+
+// Erases rotate evenly over the sectors, one per sector's worth of saves
+static void test_wear()
+{
+    FlashSim f(SECTOR, PAGE, SECTORS);
+    ConfigLog log;
+    CHECK(log.mount(f.flash()));
+    Model m;
+    const int saves = 3000;
+    CHECK(run(log, m, 0, saves));
+    uint32_t lo = ~0u, hi = 0, total = 0;
+    for (uint32_t e : f.sector_erases()) {
+        lo = e < lo ? e : lo;
+        hi = e > hi ? e : hi;
+        total += e;
+    }
+    CHECK(hi - lo <= 1);
+    CHECK(total == log.erase_count());
+    // GC copies add a few pages per sector on top of the saves
+    CHECK(total >= saves / (SECTOR / PAGE) && total <= saves / (SECTOR / PAGE - KEYS) + 1);
+    CHECK(f.overprograms == 0);
+}
+
+// Power cut at every operation of a workload, in both tearing modes, and
+// again at every operation of the remount that recovers from it
+static void test_power_fail()
+{
+    const int SAVES = 150;   // ~10 sector moves: the area wraps twice
+    long total_ops;
+    {
+        FlashSim f(SECTOR, PAGE, SECTORS);
+        ConfigLog log;
+        log.mount(f.flash());
+        Model m;
+        run(log, m, 0, SAVES);
+        total_ops = f.ops;
+    }
+    CHECK(total_ops > SAVES);
+
+    int cuts = 0, recovery_cuts = 0, bad_mounts = 0, bad_reads = 0, bad_after = 0;
+    long overprograms = 0;
+    for (int bits = 0; bits < 2; bits++) {
+        for (long cut = 0; cut < total_ops; cut++) {
+            FlashSim f(SECTOR, PAGE, SECTORS);
+            f.bits_mode = bits;
+            f.rng.seed((uint32_t)(cut * 2 + bits));
+            ConfigLog log;
+            log.mount(f.flash());
+            Model m;
+            f.cut_at = cut;
+            if (run(log, m, 0, SAVES)) continue;   // cut in a no-op save
+            cuts++;
+            const int stopped = m.inflight;
+
+            // Cut again at each operation of the recovery mount
+            for (long j = 0;; j++) {
+                FlashSim g = f;
+                g.cut_at = j;
+                ConfigLog r;
+                if (mount(r, g)) break;   // the recovery needed fewer ops
+                recovery_cuts++;
+                g.cut_at = -1;
+                Model mg = m;
+                if (!mount(r, g)) { bad_mounts++; continue; }
+                if (!verify(r, mg)) bad_reads++;
+                overprograms += g.overprograms;
+            }
+
+            // Power back for good: mount, check, finish the workload, check
+            f.cut_at = -1;
+            if (!mount(log, f)) {
+                bad_mounts++;
+                continue;
+            }
+            if (!verify(log, m)) bad_reads++;
+            if (!run(log, m, stopped + 1, SAVES + 40)) bad_after++;
+            ConfigLog again;
+            if (!mount(again, f) || !verify(again, m)) bad_after++;
+            overprograms += f.overprograms;
+        }
+    }
+    std::printf("power fail: %d cuts over %ld ops, %d more during recovery\n",
+                cuts, total_ops, recovery_cuts);
+    CHECK(cuts > 2 * SAVES);
+    CHECK(recovery_cuts > 0);
+    CHECK(bad_mounts == 0);
+    CHECK(bad_reads == 0);
+    CHECK(bad_after == 0);
+    CHECK(overprograms == 0);
+}
+
+int main()
+{
+    test_basic();
+    test_bad_page();
+    test_wear();
+    test_power_fail();
+    return check_exit("config_log_test");
+}
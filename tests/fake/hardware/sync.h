@@ -0,0 +1,5 @@
+#pragma once
+#include <atomic>
+
+// Host stand-in for the Cortex-M data memory barrier
+inline void __dmb() { std::atomic_thread_fence(std::memory_order_seq_cst); }
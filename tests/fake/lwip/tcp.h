@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include "lwipopts.h"   // the firmware's TCP_SND_BUF / TCP_SND_QUEUELEN / TCP_WND
+
+// Host stand-in for the raw lwIP TCP API the web server uses, backed by the
+// in-memory stack in tests/fake_tcp.cpp (driven through fake_tcp.hpp).
+
+typedef int8_t   err_t;
+typedef uint8_t  u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+
+#define ERR_OK    0
+#define ERR_MEM  -1
+#define ERR_VAL  -6
+#define ERR_ABRT -13
+#define ERR_RST  -14
+#define ERR_CLSD -15
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+#define TCP_PRIO_MIN    1
+#define IPADDR_TYPE_V4  0
+
+struct pbuf {
+    struct pbuf* next;
+    void*        payload;
+    u16_t        tot_len;
+    u16_t        len;
+};
+
+struct ip_addr_t { uint32_t addr; };
+extern const ip_addr_t fake_ip_addr_any;
+#define IP_ADDR_ANY (&fake_ip_addr_any)
+
+struct tcp_pcb;
+typedef err_t (*tcp_recv_fn)(void* arg, struct tcp_pcb* pcb, struct pbuf* p, err_t err);
+typedef err_t (*tcp_sent_fn)(void* arg, struct tcp_pcb* pcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void* arg, struct tcp_pcb* pcb);
+typedef void  (*tcp_err_fn)(void* arg, err_t err);
+typedef err_t (*tcp_accept_fn)(void* arg, struct tcp_pcb* newpcb, err_t err);
+
+struct tcp_pcb* tcp_new_ip_type(u8_t type);
+err_t tcp_bind(struct tcp_pcb* pcb, const ip_addr_t* ip, u16_t port);
+struct tcp_pcb* tcp_listen_with_backlog(struct tcp_pcb* pcb, u8_t backlog);
+void  tcp_accept(struct tcp_pcb* pcb, tcp_accept_fn accept);
+void  tcp_arg(struct tcp_pcb* pcb, void* arg);
+void  tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv);
+void  tcp_sent(struct tcp_pcb* pcb, tcp_sent_fn sent);
+void  tcp_err(struct tcp_pcb* pcb, tcp_err_fn err);
+void  tcp_poll(struct tcp_pcb* pcb, tcp_poll_fn poll, u8_t interval);
+void  tcp_setprio(struct tcp_pcb* pcb, u8_t prio);
+void  tcp_nagle_disable(struct tcp_pcb* pcb);
+err_t tcp_write(struct tcp_pcb* pcb, const void* data, u16_t len, u8_t flags);
+err_t tcp_output(struct tcp_pcb* pcb);
+u16_t tcp_sndbuf(struct tcp_pcb* pcb);
+u16_t tcp_sndqueuelen(struct tcp_pcb* pcb);
+void  tcp_recved(struct tcp_pcb* pcb, u16_t len);
+err_t tcp_close(struct tcp_pcb* pcb);
+void  tcp_abort(struct tcp_pcb* pcb);
+
+u16_t pbuf_copy_partial(const struct pbuf* p, void* dataptr, u16_t len, u16_t offset);
+u8_t  pbuf_free(struct pbuf* p);
+struct pbuf* pbuf_free_header(struct pbuf* q, u16_t size);
+void  pbuf_cat(struct pbuf* head, struct pbuf* tail);
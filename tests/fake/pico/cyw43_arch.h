@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+// Host stand-in: the web server only reads the RSSI for /api/status
+
+struct cyw43_t { int itf_state; };
+extern cyw43_t cyw43_state;
+
+inline int cyw43_wifi_get_rssi(cyw43_t*, int32_t* rssi)
+{
+    *rssi = -50;
+    return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+
+// Host stand-in for the few Pico SDK time calls the SDK-free-ish drivers
+// make. The clock only moves when a test moves it (fake_time_us).
+
+extern uint64_t fake_time_us;
+
+typedef uint64_t absolute_time_t;
+
+inline absolute_time_t get_absolute_time() { return fake_time_us; }
+inline uint32_t to_ms_since_boot(absolute_time_t t) { return (uint32_t)(t / 1000); }
+inline uint32_t time_us_32() { return (uint32_t)fake_time_us; }
@@ -0,0 +1,321 @@
+#include "fake_tcp.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "pico/cyw43_arch.h"
+#include "pico/stdlib.h"
+
+uint64_t fake_time_us = 1000000;
+cyw43_t cyw43_state = {};
+const ip_addr_t fake_ip_addr_any = {0};
+
+struct tcp_pcb {
+    bool listening = false;
+    bool dead = false;         // closed or aborted: the stack's again
+    void* arg = nullptr;
+    tcp_recv_fn   recv = nullptr;
+    tcp_sent_fn   sent = nullptr;
+    tcp_err_fn    err = nullptr;
+    tcp_poll_fn   poll = nullptr;
+    tcp_accept_fn accept = nullptr;
+
+    FakeConn* client = nullptr;
+    std::string unsent;        // written, not yet output
+    std::deque<size_t> segs;   // queued segment sizes, oldest first (in flight)
+    size_t in_flight = 0;      // output, not ACKed
+    size_t wnd = TCP_WND;      // receive window left
+};
+
+static std::vector<std::unique_ptr<tcp_pcb>> s_pcbs;
+static tcp_pcb* s_listen = nullptr;
+static int s_live_pbufs = 0;
+static int s_violations = 0;
+static int s_fail_writes = 0;
+
+static bool alive(tcp_pcb* pcb)
+{
+    if (!pcb || pcb->dead) {
+        s_violations++;
+        return false;
+    }
+    return true;
+}
+
+static size_t queued_bytes(const tcp_pcb* pcb) { return pcb->unsent.size() + pcb->in_flight; }
+
+static void flush(tcp_pcb* pcb)
+{
+    if (pcb->dead || pcb->unsent.empty()) return;
+    if (pcb->client) pcb->client->rx += pcb->unsent;
+    pcb->in_flight += pcb->unsent.size();
+    pcb->unsent.clear();
+}
+
+// ---------------------------------------------------------------- lwIP API --
+
+tcp_pcb* tcp_new_ip_type(u8_t)
+{
+    s_pcbs.push_back(std::make_unique<tcp_pcb>());
+    return s_pcbs.back().get();
+}
+
+err_t tcp_bind(tcp_pcb*, const ip_addr_t*, u16_t) { return ERR_OK; }
+
+tcp_pcb* tcp_listen_with_backlog(tcp_pcb* pcb, u8_t)
+{
+    pcb->listening = true;
+    s_listen = pcb;
+    return pcb;
+}
+
+void tcp_accept(tcp_pcb* pcb, tcp_accept_fn accept) { pcb->accept = accept; }
+
+// The setters are legal right up to the close (cleanup clears them first)
+void tcp_arg(tcp_pcb* pcb, void* arg)          { if (alive(pcb)) pcb->arg = arg; }
+void tcp_recv(tcp_pcb* pcb, tcp_recv_fn f)     { if (alive(pcb)) pcb->recv = f; }
+void tcp_sent(tcp_pcb* pcb, tcp_sent_fn f)     { if (alive(pcb)) pcb->sent = f; }
+void tcp_err(tcp_pcb* pcb, tcp_err_fn f)       { if (alive(pcb)) pcb->err = f; }
+void tcp_poll(tcp_pcb* pcb, tcp_poll_fn f, u8_t) { if (alive(pcb)) pcb->poll = f; }
+void tcp_setprio(tcp_pcb* pcb, u8_t)           { alive(pcb); }
+void tcp_nagle_disable(tcp_pcb* pcb)           { alive(pcb); }
+
+u16_t tcp_sndbuf(tcp_pcb* pcb)
+{
+    if (!alive(pcb)) return 0;
+    size_t used = queued_bytes(pcb);
+    return (u16_t)(used >= TCP_SND_BUF ? 0 : TCP_SND_BUF - used);
+}
+
+u16_t tcp_sndqueuelen(tcp_pcb* pcb)
+{
+    if (!alive(pcb)) return 0;
+    return (u16_t)pcb->segs.size();
+}
+
+err_t tcp_write(tcp_pcb* pcb, const void* data, u16_t len, u8_t)
+{
+    if (!alive(pcb)) return ERR_CLSD;
+    if (s_fail_writes > 0) {
+        s_fail_writes--;
+        return ERR_MEM;
+    }
+    if (len > tcp_sndbuf(pcb)) return ERR_MEM;
+    size_t nseg = (len + TCP_MSS - 1) / TCP_MSS;
+    if (pcb->segs.size() + nseg > TCP_SND_QUEUELEN) return ERR_MEM;
+    pcb->unsent.append((const char*)data, len);
+    // Segment sizes for the queue length: each write is its own segment(s)
+    for (size_t left = len; left > 0;) {
+        size_t s = left > TCP_MSS ? TCP_MSS : left;
+        pcb->segs.push_back(s);
+        left -= s;
+    }
+    return ERR_OK;
+}
+
+err_t tcp_output(tcp_pcb* pcb)
+{
+    if (!alive(pcb)) return ERR_CLSD;
+    flush(pcb);
+    return ERR_OK;
+}
+
+void tcp_recved(tcp_pcb* pcb, u16_t len)
+{
+    if (!alive(pcb)) return;
+    pcb->wnd += len;
+    if (pcb->wnd > TCP_WND) {
+        s_violations++;   // opened more than was ever received
+        pcb->wnd = TCP_WND;
+    }
+}
+
+err_t tcp_close(tcp_pcb* pcb)
+{
+    if (!alive(pcb)) return ERR_CLSD;
+    flush(pcb);
+    pcb->dead = true;
+    if (pcb->client) pcb->client->fin = true;
+    return ERR_OK;
+}
+
+void tcp_abort(tcp_pcb* pcb)
+{
+    if (!alive(pcb)) return;
+    pcb->dead = true;
+    pcb->unsent.clear();
+    if (pcb->client) pcb->client->reset = true;
+    if (pcb->err) pcb->err(pcb->arg, ERR_ABRT);
+}
+
+// ------------------------------------------------------------------- pbufs --
+
+static pbuf* pbuf_make(const char* data, size_t len)
+{
+    pbuf* p = (pbuf*)std::malloc(sizeof(pbuf) + len);
+    p->next = nullptr;
+    p->payload = (char*)(p + 1);
+    p->tot_len = (u16_t)len;
+    p->len = (u16_t)len;
+    std::memcpy(p->payload, data, len);
+    s_live_pbufs++;
+    return p;
+}
+
+u16_t pbuf_copy_partial(const pbuf* p, void* dataptr, u16_t len, u16_t offset)
+{
+    u16_t copied = 0;
+    for (; p && copied < len; p = p->next) {
+        if (offset >= p->len) {
+            offset = (u16_t)(offset - p->len);
+            continue;
+        }
+        u16_t n = (u16_t)(p->len - offset);
+        if (n > len - copied) n = (u16_t)(len - copied);
+        std::memcpy((char*)dataptr + copied, (const char*)p->payload + offset, n);
+        copied = (u16_t)(copied + n);
+        offset = 0;
+    }
+    return copied;
+}
+
+u8_t pbuf_free(pbuf* p)
+{
+    u8_t n = 0;
+    while (p) {
+        pbuf* next = p->next;
+        std::free(p);
+        s_live_pbufs--;
+        n++;
+        p = next;
+    }
+    return n;
+}
+
+pbuf* pbuf_free_header(pbuf* q, u16_t size)
+{
+    while (q && size > 0) {
+        if (size >= q->len) {
+            size = (u16_t)(size - q->len);
+            pbuf* next = q->next;
+            q->next = nullptr;
+            pbuf_free(q);
+            q = next;
+        } else {
+            q->payload = (char*)q->payload + size;
+            q->len = (u16_t)(q->len - size);
+            q->tot_len = (u16_t)(q->tot_len - size);
+            size = 0;
+        }
+    }
+    return q;
+}
+
+void pbuf_cat(pbuf* head, pbuf* tail)
+{
+    pbuf* p = head;
+    for (; p->next; p = p->next) p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+    p->tot_len = (u16_t)(p->tot_len + tail->tot_len);
+    p->next = tail;
+}
+
+// ------------------------------------------------------------- client side --
+
+bool fake_connect(FakeConn& c)
+{
+    c = FakeConn{};
+    if (!s_listen || !s_listen->accept) return false;
+    tcp_pcb* pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+    pcb->client = &c;
+    err_t err = s_listen->accept(s_listen->arg, pcb, ERR_OK);
+    if (err != ERR_OK) {
+        // lwIP drops a refused connection
+        if (!pcb->dead) {
+            pcb->dead = true;
+            c.reset = true;
+        }
+        return false;
+    }
+    c.pcb = pcb;
+    flush(pcb);
+    return true;
+}
+
+size_t fake_send(FakeConn& c, const std::string& data, size_t seg)
+{
+    tcp_pcb* pcb = c.pcb;
+    size_t off = 0;
+    while (pcb && !pcb->dead && off < data.size() && pcb->wnd > 0) {
+        size_t n = data.size() - off;
+        if (n > seg) n = seg;
+        if (n > pcb->wnd) n = pcb->wnd;
+        if (n > 0xFFFF) n = 0xFFFF;
+        pbuf* p = pbuf_make(data.data() + off, n);
+        pcb->wnd -= n;
+        off += n;
+        if (pcb->recv) {
+            pcb->recv(pcb->arg, pcb, p, ERR_OK);
+        } else {
+            pbuf_free(p);   // nobody listening: lwIP would refuse it
+        }
+        flush(pcb);
+    }
+    return off;
+}
+
+void fake_ack(FakeConn& c, size_t n)
+{
+    tcp_pcb* pcb = c.pcb;
+    if (!pcb || pcb->dead) return;
+    size_t pending = pcb->in_flight;
+    if (n > pending) n = pending;
+    if (n == 0) return;
+    c.acked += n;
+    pcb->in_flight -= n;
+    // Whole segments leave the queue as their last byte is ACKed
+    size_t left = n;
+    while (!pcb->segs.empty() && left >= pcb->segs.front()) {
+        left -= pcb->segs.front();
+        pcb->segs.pop_front();
+    }
+    if (left && !pcb->segs.empty()) pcb->segs.front() -= left;
+    if (pcb->sent) pcb->sent(pcb->arg, pcb, (u16_t)(n > 0xFFFF ? 0xFFFF : n));
+    flush(pcb);
+}
+
+void fake_fin(FakeConn& c)
+{
+    tcp_pcb* pcb = c.pcb;
+    if (!pcb || pcb->dead) return;
+    if (pcb->recv) pcb->recv(pcb->arg, pcb, nullptr, ERR_OK);
+    else tcp_close(pcb);
+    c.pcb = nullptr;
+}
+
+void fake_advance_ms(uint32_t ms)
+{
+    fake_time_us += (uint64_t)ms * 1000;
+    // Index loop: a poll callback may not create PCBs, but keep it safe
+    for (size_t i = 0; i < s_pcbs.size(); i++) {
+        tcp_pcb* pcb = s_pcbs[i].get();
+        if (pcb->dead || pcb->listening || !pcb->poll) continue;
+        pcb->poll(pcb->arg, pcb);
+        flush(pcb);
+    }
+}
+
+size_t fake_window(const FakeConn& c) { return c.pcb && !c.pcb->dead ? c.pcb->wnd : 0; }
+
+int fake_open_pcbs()
+{
+    int n = 0;
+    for (auto& p : s_pcbs) n += (!p->dead && !p->listening && p->client) ? 1 : 0;
+    return n;
+}
+
+int fake_live_pbufs() { return s_live_pbufs; }
+int fake_violations() { return s_violations; }
+void fake_fail_writes(int n) { s_fail_writes = n; }
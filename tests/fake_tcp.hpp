@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "lwip/tcp.h"
+
+// In-memory stand-in for lwIP's raw TCP API (tests/fake/lwip/tcp.h), with the
+// client side of every connection in the test's hands. Enough of lwIP's
+// behaviour to drive the web server as the firmware's stack does:
+//
+//   - tcp_write() takes at most tcp_sndbuf() bytes and TCP_SND_QUEUELEN
+//     segments (ERR_MEM past either); both come back when the client ACKs,
+//     followed by the sent callback
+//   - the client sends no more than the receive window, which opens again as
+//     the server calls tcp_recved()
+//   - a refused accept aborts the new connection; tcp_abort() calls the err
+//     callback with ERR_ABRT
+//   - after tcp_close()/tcp_abort() the PCB is the stack's again: any further
+//     call on it is counted in fake_violations()
+//
+// Written data reaches the client on tcp_output() and after every callback
+// returns (lwIP flushes at the end of its input processing).
+
+struct FakeConn {
+    tcp_pcb* pcb = nullptr;    // nullptr: the server refused it
+    std::string rx;            // bytes the server sent, all of them
+    size_t   acked = 0;        // of rx
+    bool     fin = false;      // the server closed
+    bool     reset = false;    // the server aborted
+};
+
+// Open a connection to the listening PCB (false: accept refused)
+bool fake_connect(FakeConn& c);
+// Send request bytes, as far as the window allows, in segments of at most
+// seg bytes; returns the bytes sent
+size_t fake_send(FakeConn& c, const std::string& data, size_t seg = 1460);
+// ACK up to n more of the bytes received (all by default)
+void fake_ack(FakeConn& c, size_t n = (size_t)-1);
+// The client closes its side
+void fake_fin(FakeConn& c);
+// Move the clock and run every PCB's poll callback
+void fake_advance_ms(uint32_t ms);
+
+// The server's receive window towards c (bytes the client may still send)
+size_t fake_window(const FakeConn& c);
+// Connections the server holds open (not closed or aborted)
+int  fake_open_pcbs();
+// pbufs alive (handed to the server and not freed)
+int  fake_live_pbufs();
+// Calls on a PCB after it was closed or aborted; tcp_recved() past what was
+// received
+int  fake_violations();
+// Make the next n tcp_write() calls fail with ERR_MEM
+void fake_fail_writes(int n);
@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "config_log.hpp"
+
+// RAM-backed NOR flash behind a ConfigFlash, for ConfigLog on the host.
+//
+// As on the chip: an erase sets a sector to 0xFF, a program can only clear
+// bits (new = old & data). Power can be cut at any operation: cut_at = n
+// tears the n-th erase/program from now (counting from 0) and throws
+// PowerCut out of the log, the way a brown-out stops the firmware mid-call.
+// A torn program lands a prefix of the page, or (bits mode) a random subset
+// of its cleared bits; a torn erase sets a random subset of the sector's
+// bits back to 1, whole pages first, as a partially completed erase does.
+// Anything that survives the cut stays in mem for the next mount().
+
+struct PowerCut {};
+
+class FlashSim {
+public:
+    FlashSim(uint32_t sector_size, uint32_t page_size, uint32_t sectors)
+        : sector_size_(sector_size), page_size_(page_size), sectors_(sectors),
+          mem_(sector_size * sectors / 4, 0xFFFFFFFFu), erases_(sectors, 0) {}
+
+    ConfigFlash flash() {
+        return ConfigFlash{bytes(), sector_size_, page_size_, sectors_, erase_cb, program_cb, this};
+    }
+
+    uint8_t* bytes() { return reinterpret_cast<uint8_t*>(mem_.data()); }
+    uint32_t size() const { return sector_size_ * sectors_; }
+
+    // Power-fail injection: -1 = never
+    long cut_at = -1;
+    bool bits_mode = false;
+    std::mt19937 rng{1};
+
+    // A worn page: programs at this offset come back unverified (nothing lands)
+    long bad_page = -1;
+
+    long ops = 0;                    // erases + programs so far
+    long overprograms = 0;           // programs asking for a 0 -> 1 transition
+    const std::vector<uint32_t>& sector_erases() const { return erases_; }
+
+private:
+    static bool erase_cb(uint32_t offset, void* ctx) {
+        return static_cast<FlashSim*>(ctx)->erase(offset);
+    }
+    static bool program_cb(uint32_t offset, const uint8_t* page, void* ctx) {
+        return static_cast<FlashSim*>(ctx)->program(offset, page);
+    }
+
+    bool tear() {
+        bool cut = cut_at == 0;
+        if (cut_at >= 0) cut_at--;
+        ops++;
+        return cut;
+    }
+
+    bool erase(uint32_t offset) {
+        uint8_t* s = bytes() + offset;
+        if (tear()) {
+            uint32_t pages = sector_size_ / page_size_;
+            uint32_t done = rng() % pages;
+            std::memset(s, 0xFF, done * page_size_);
+            for (uint32_t i = done * page_size_; i < sector_size_; i++) s[i] |= (uint8_t)rng();
+            throw PowerCut{};
+        }
+        std::memset(s, 0xFF, sector_size_);
+        erases_[offset / sector_size_]++;
+        return true;
+    }
+
+    bool program(uint32_t offset, const uint8_t* page) {
+        uint8_t* p = bytes() + offset;
+        for (uint32_t i = 0; i < page_size_; i++) {
+            if ((p[i] & page[i]) != page[i]) {
+                overprograms++;
+                break;
+            }
+        }
+        if (tear()) {
+            if (bits_mode) {
+                for (uint32_t i = 0; i < page_size_; i++) p[i] &= page[i] | (uint8_t)rng();
+            } else {
+                uint32_t n = rng() % page_size_;
+                for (uint32_t i = 0; i < n; i++) p[i] &= page[i];
+            }
+            throw PowerCut{};
+        }
+        if ((long)offset == bad_page) return false;
+        for (uint32_t i = 0; i < page_size_; i++) p[i] &= page[i];
+        return true;
+    }
+
+    uint32_t sector_size_, page_size_, sectors_;
+    std::vector<uint32_t> mem_;      // word-aligned, as the XIP view is
+    std::vector<uint32_t> erases_;
+};
@@ -0,0 +1,253 @@
+// FlowModel / FlowFeedforward (app/flow_model.cpp) against a simulated gate
+// with a known flow curve and in-flight behaviour: runs are logged as
+// /api/log.csv text, read back and fed to FlowFeedforward::replay, the way a
+// downloaded log teaches a model on the host. Checks the learned curve, the
+// in-flight fit and that the close decision it drives lands on target.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "flow_model.hpp"
+#include "telem_csv.hpp"
+
+static constexpr uint32_t TICK_MS = 20;
+static constexpr float SERVO_ZERO = 35.0f;   // flow-start angle of the simulated gate
+
+// The simulated gate and scale
+struct Plant {
+    float max_gps = 40.0f;     // flow curve: max_gps * (1 - exp(-open / 25 deg))
+    float chute_g = 3.0f;      // drops off the gate and chute after any close
+    float servo_lag_s = 0.25f; // servo travel + fall: full flow goes on this long
+    float meas_lag_s = 0.10f;  // the scale sees grain this late
+    float noise_g = 0.1f;      // reading noise
+
+    float gps(float open) const { return open <= 0.0f ? 0.0f : max_gps * (1.0f - std::exp(-open / 25.0f)); }
+    // The truth FlowModel should find: in-flight = chute_g + flow x lag
+    float lag_s() const { return servo_lag_s + meas_lag_s; }
+};
+
+// One dispense: the gate follows open_at(t, dispensed) until close_now(...)
+// says stop, then the in-flight grain lands. Samples run up to the close (as
+// replay() wants them); final_g is the settled reading.
+struct Run {
+    std::vector<TelemetrySample> samples;
+    float final_g = 0.0f;
+};
+
+template <class OpenFn, class CloseFn>
+static Run simulate(const Plant& p, uint32_t seed, float target, OpenFn open_at, CloseFn close_now)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, p.noise_g);
+    const float dt = TICK_MS / 1000.0f;
+    const int delay = (int)std::lround(p.meas_lag_s / dt);
+    std::vector<float> out_hist;   // grams leaving the gate per tick
+    float landed = 0.0f;
+    Run run;
+    bool closed = false;
+    float close_t = 0.0f;
+    for (int k = 0; k < 60000; k++) {
+        float t = k * dt;
+        float meas = landed + noise(rng);
+        float open = 0.0f;
+        if (!closed) {
+            open = open_at(t, meas);
+            TelemetrySample s{};
+            s.t_ms = k * TICK_MS;
+            s.setpoint = target;
+            s.dispensed = meas;
+            s.weight = 1800.0f - meas;
+            s.gross = 2210.0f - meas;
+            s.servo = SERVO_ZERO + open;
+            run.samples.push_back(s);
+            if (close_now(t, meas, target - meas)) {
+                closed = true;
+                close_t = t;
+            }
+        }
+        // The gate keeps flowing for the servo lag after the close decision
+        float gate_open = !closed ? open : (t - close_t < p.servo_lag_s ? run.samples.back().servo - SERVO_ZERO : 0.0f);
+        out_hist.push_back(p.gps(gate_open) * dt);
+        if ((int)out_hist.size() > delay) landed += out_hist[out_hist.size() - 1 - delay];
+        if (closed && t - close_t > 0.1f && t - close_t <= 0.5f) landed += p.chute_g * dt / 0.4f;
+        if (closed && t - close_t > 3.0f) break;
+    }
+    run.final_g = landed + noise(rng) * 0.3f;   // settled: averaged reading
+    return run;
+}
+
+// The run as /api/log.csv text: rows printed from what the codec stores
+static std::string to_csv(const Run& r)
+{
+    std::string csv = "# korndispenser-pid-log v2\n";
+    char line[200];
+    std::snprintf(line, sizeof(line), "# run_id=1,scale=1,name=Sim,target_g=%u,kp=1.000,ki=0.1000,kd=0.000,"
+                  "samples=%u,dropped=0,final_g=%.1f,sample_ms=%u\n",
+                  (unsigned)r.samples.front().setpoint, (unsigned)r.samples.size(),
+                  (double)r.final_g, (unsigned)TICK_MS);
+    csv += line;
+    csv += "t_ms,setpoint_g,dispensed_g,weight_g,gross_g,servo_deg,p_term,i_term,d_term,vib\n";
+    for (const auto& s : telem_as_logged(r.samples)) {
+        telem_csv_row(s, line, sizeof(line));
+        csv += line;
+    }
+    return csv;
+}
+
+// Replay a downloaded log: its rows, and final_g from the metadata line
+static void replay_csv(FlowFeedforward& ff, const std::string& csv)
+{
+    std::vector<TelemetrySample> rows;
+    float final_g = -1.0f;
+    size_t pos = 0;
+    while (pos < csv.size()) {
+        size_t end = csv.find('\n', pos);
+        std::string line = csv.substr(pos, end - pos);
+        pos = end == std::string::npos ? csv.size() : end + 1;
+        TelemetrySample s;
+        if (telem_csv_parse(line.c_str(), s)) rows.push_back(s);
+        else if (const char* f = std::strstr(line.c_str(), "final_g=")) final_g = (float)std::atof(f + 8);
+    }
+    ff.replay(rows.data(), (int)rows.size(), SERVO_ZERO, final_g);
+}
+
+// A teaching run: the gate steps through every opening up to top (1.5 s
+// each), holds top, closes there
+static Run staircase(const Plant& p, uint32_t seed, float top)
+{
+    return simulate(p, seed, 500.0f,
+        [&](float t, float) { float o = 10.0f * (1.0f + std::floor(t / 1.5f)); return o < top ? o : top; },
+        [&](float t, float, float) { return t >= 1.5f * (top / 10.0f) + 1.0f; });
+}
+
+static void test_learned_curve()
+{
+    Plant p;
+    FlowModel m;
+    FlowFeedforward ff;
+    ff.begin(&m);
+    for (uint32_t r = 0; r < 3; r++) replay_csv(ff, to_csv(staircase(p, r, 80.0f)));
+    CHECK(m.learned());
+    for (int k = 1; k < FLOW_NODES; k++) {
+        float o = k * FlowModel::NODE_DEG;
+        CHECK_NEAR(m.flow_at(o), p.gps(o), 0.06f * p.gps(o) + 0.3f);
+    }
+    // And the inverse the feedforward uses
+    CHECK_NEAR(m.opening_for(p.gps(45.0f)), 45.0f, 3.0f);
+    CHECK_NEAR(m.max_flow(), p.gps(80.0f), 0.06f * p.gps(80.0f));
+}
+
+// Runs closing at different flows pin both in-flight parameters
+static void test_in_flight_fit()
+{
+    Plant p;
+    FlowModel m;
+    FlowFeedforward ff;
+    ff.begin(&m);
+    CHECK(!m.in_flight_learned());
+    const float tops[] = {10, 80, 30, 60, 20, 70, 40, 50, 10, 80, 30, 60};
+    uint32_t seed = 100;
+    for (float top : tops) replay_csv(ff, to_csv(staircase(p, seed++, top)));
+    CHECK(m.in_flight_learned());
+    std::printf("in-flight fit: %.2f g + flow x %.3f s (truth %.2f g + flow x %.3f s)\n",
+                (double)m.in_flight_g(), (double)m.close_lag_s(), (double)p.chute_g, (double)p.lag_s());
+    CHECK_NEAR(m.in_flight_g(), p.chute_g, 0.6f);
+    CHECK_NEAR(m.close_lag_s(), p.lag_s(), 0.04f);
+
+    // The bag changes (more drops off the chute): the fit follows in a few runs
+    p.chute_g = 5.0f;
+    for (int r = 0; r < 8; r++) replay_csv(ff, to_csv(staircase(p, seed++, tops[r])));
+    CHECK_NEAR(m.in_flight_g(), p.chute_g, 0.6f);
+    CHECK_NEAR(m.close_lag_s(), p.lag_s(), 0.04f);
+}
+
+// The close decision on a live run: the learned model closes early by what is
+// still in flight; closing on the target overshoots by all of it
+static void test_close_decision()
+{
+    Plant p;
+    FlowModel m;
+    FlowFeedforward teach;
+    teach.begin(&m);
+    const float tops[] = {10, 80, 30, 60, 20, 70, 40, 50};
+    uint32_t seed = 200;
+    for (float top : tops) replay_csv(teach, to_csv(staircase(p, seed++, top)));
+
+    for (float target : {120.0f, 250.0f, 400.0f}) {
+        // Full opening until the taper, as the feedforward commands it
+        FlowFeedforward ff;
+        ff.begin(&m);
+        uint32_t t_ms = 0;
+        Run r = simulate(p, seed++, target,
+            [&](float t, float meas) {
+                t_ms = (uint32_t)std::lround(t * 1000.0f);
+                return ff.opening_for(target - meas);
+            },
+            [&](float, float meas, float remaining) {
+                ff.update(t_ms, meas, ff.opening_for(remaining));
+                return ff.should_close(remaining);
+            });
+        float close_g = r.samples.back().dispensed;
+        float predicted = ff.on_close(t_ms, close_g);
+        CHECK(predicted > 0.0f);
+        std::printf("target %.0f g: closed at %.1f g predicting %.1f g more, settled %.1f g\n",
+                    (double)target, (double)close_g, (double)predicted, (double)r.final_g);
+        CHECK_NEAR(r.final_g, target, 1.5f);
+        CHECK_NEAR(close_g + predicted, r.final_g, 1.5f);
+
+        // The same taper (down to a trickle) closed on the target itself
+        Run late = simulate(p, seed++, target,
+            [&](float, float meas) {
+                float gps = (target - meas) / FlowFeedforward::TAPER_S;
+                return m.opening_for(gps > 3.0f ? gps : 3.0f);
+            },
+            [&](float, float, float remaining) { return remaining <= 0.0f; });
+        CHECK(late.final_g - target > p.chute_g);
+    }
+}
+
+// Nothing learned or no flow measured: never close early. A dropped settle
+// teaches nothing.
+static void test_guards()
+{
+    FlowModel m;
+    FlowFeedforward ff;
+    ff.begin(&m);
+    CHECK(ff.in_flight() == 0.0f);
+    CHECK(!ff.should_close(0.5f));
+    m.observe_in_flight(4.0f, 0.0f);
+    CHECK(m.in_flight_learned());
+    CHECK(!ff.should_close(0.5f));   // no flow yet this run
+
+    float g = m.in_flight_g();
+    ff.on_close(1000, 100.0f);
+    CHECK(!ff.settle(2000, 130.0f));
+    ff.drop_settle();
+    CHECK(ff.settle(2600, 130.0f));
+    CHECK(m.in_flight_g() == g);
+
+    // A log without a settled weight teaches the curve only
+    Plant p;
+    Run r = staircase(p, 7, 50.0f);
+    FlowModel m2;
+    FlowFeedforward ff2;
+    ff2.begin(&m2);
+    ff2.replay(r.samples.data(), (int)r.samples.size(), SERVO_ZERO, -1.0f);
+    CHECK(!m2.in_flight_learned());
+    CHECK(m2.flow_at(30.0f) > 0.0f);
+}
+
+int main()
+{
+    test_learned_curve();
+    test_in_flight_fit();
+    test_close_decision();
+    test_guards();
+    return check_exit("flow_model_test");
+}
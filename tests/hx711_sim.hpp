@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include "sample_ring.hpp"
+
+// Host stand-in for hx711::start_capture's producer: the PIO state machine
+// pushing conversions into its 4-deep RX FIFO, and the two-channel DMA chain
+// draining it into a SampleRing - channel A moves the FIFO word to raw_[],
+// channel B the timer's low word to t_[]. Both write pointers wrap; the
+// ring head the firmware reads is channel B's (hx711::ring_head).
+//
+// The steps are separate so a test can stop the chain anywhere, e.g. between
+// A and B with a raw word landed and its stamp not yet.
+
+template <uint32_t N>
+class Hx711DmaSim {
+public:
+    explicit Hx711DmaSim(SampleRing<N>& ring) : ring_(ring) {}
+
+    // The state machine finished a conversion (24-bit, two's complement).
+    // False: the FIFO was full and the PIO stalls - the DMA fell behind.
+    bool convert(int32_t value) {
+        if (fifo_n_ == 4) return false;
+        fifo_[(fifo_head_ + fifo_n_) % 4] = (uint32_t)value & 0x00FFFFFFu;
+        fifo_n_++;
+        return true;
+    }
+
+    // Channel A: one FIFO word -> raw_[]; false while the FIFO is empty
+    bool dma_raw() {
+        if (fifo_n_ == 0 || raw_done_) return false;
+        ring_.raw_words()[wa_ & (N - 1)] = fifo_[fifo_head_];
+        fifo_head_ = (fifo_head_ + 1) % 4;
+        fifo_n_--;
+        wa_++;
+        raw_done_ = true;
+        return true;
+    }
+
+    // Channel B: the timer -> t_[], completing the entry
+    bool dma_stamp(uint32_t now_us) {
+        if (!raw_done_) return false;
+        ring_.stamps()[wb_ & (N - 1)] = now_us;
+        wb_++;
+        raw_done_ = false;
+        return true;
+    }
+
+    // Both channels for everything in the FIFO
+    void drain(uint32_t now_us) {
+        while (dma_raw()) dma_stamp(now_us);
+    }
+
+    // Channel B's write pointer as a slot index
+    uint32_t head() const { return wb_ & (N - 1); }
+    uint32_t fifo_level() const { return fifo_n_; }
+
+private:
+    SampleRing<N>& ring_;
+    uint32_t fifo_[4] = {};
+    uint32_t fifo_head_ = 0, fifo_n_ = 0;
+    uint32_t wa_ = 0, wb_ = 0;
+    bool     raw_done_ = false;   // A ran, B not yet
+};
@@ -0,0 +1,219 @@
+// Cost of one PID step, PidCore<float> against PidCore<Q16> (and double, the
+// old Compute's number type), plus the Q16 and float operations it is made
+// of. The same source runs on the host and on the board:
+//
+//   host:   pid_cycles_bench                 (tests/, ns and TSC ticks)
+//   board:  cmake -DKORN_PID_CYCLES=ON ...   (top-level project; flash
+//           pid_cycles_bench.uf2, read the USB serial port)
+//
+// On the RP2350 the counts are core clock cycles from the M33's DWT cycle
+// counter. The host's TSC ticks at a fixed rate, not the core clock, so only
+// the ratios carry over. Every step also checks how far the Q16 output is
+// from the float one over the same inputs.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include "bench.hpp"
+#include "pid_core.hpp"
+#include "q16.hpp"
+
+#if defined(PID_CYCLES_TARGET)
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+
+// Cortex-M33 debug registers: DEMCR.TRCENA powers the DWT, CYCCNTENA runs it
+static volatile uint32_t* const DEMCR = (volatile uint32_t*)0xE000EDFCu;
+static volatile uint32_t* const DWT_CTRL = (volatile uint32_t*)0xE0001000u;
+static volatile uint32_t* const DWT_CYCCNT = (volatile uint32_t*)0xE0001004u;
+
+static void cycles_init()
+{
+    *DEMCR |= 1u << 24;
+    *DWT_CYCCNT = 0;
+    *DWT_CTRL |= 1u;
+}
+static inline uint32_t cycles() { return *DWT_CYCCNT; }
+static const char* const UNIT = "cycles";
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+static void cycles_init() {}
+static inline uint32_t cycles() { return (uint32_t)__rdtsc(); }
+static const char* const UNIT = "TSC ticks";
+#else
+#include <chrono>
+
+static void cycles_init() {}
+static inline uint32_t cycles()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+static const char* const UNIT = "ns";
+#endif
+
+// Inputs: a 250 g dispense at 80 SPS with reading noise, the way the loop
+// sees it. Deterministic, so host and board step through the same values.
+static const int STEPS = 1024;
+static const float TARGET_G = 250.0f;
+static float s_input[STEPS];
+
+static void make_inputs()
+{
+    uint32_t r = 12345;
+    for (int k = 0; k < STEPS; k++) {
+        r = r * 1664525u + 1013904223u;
+        float noise = ((int32_t)(r >> 8) - (1 << 23)) / (float)(1 << 23) * 0.3f;
+        float t = k / 80.0f;
+        s_input[k] = TARGET_G * (1.0f - std::exp(-t / 4.0f)) + noise;
+    }
+}
+
+// control.cpp's configuration (default tuning, 12.5 ms, zero at 35 deg);
+// full = gain schedule, back-calculation and D filter as in the firmware
+template <typename T>
+static void configure(PidCore<T>& c, bool full)
+{
+    using Core = PidCore<T>;
+    const double ts = 0.0125, kp = 1.5, ki = 0.08, kd = 0.8;
+    auto g = [&](double p, double i, double d) { return typename Core::Gains{ T(p), T(i * ts), T(d / ts) }; };
+    c.set_gains(g(kp, ki, kd));
+    c.set_limits(T(35.0), T(115.0));
+    if (full) {
+        typename Core::Point pts[3] = {
+            { T(10.0),  g(kp * 0.6, ki * 0.5, kd * 1.0) },
+            { T(40.0),  g(kp * 1.0, ki * 1.0, kd * 1.0) },
+            { T(200.0), g(kp * 1.5, ki * 1.0, kd * 0.8) },
+        };
+        c.set_schedule(pts, 3);
+        c.set_back_calc(true, T(ts / 3.0));
+        c.set_d_alpha(T(1.0 / 3.0));
+    }
+    c.reset(T(35.0), T(0.0));
+}
+
+// Cycles per step over every input, the loop's own cost subtracted. The
+// counter is read around blocks short enough that 32 bits never wrap.
+template <typename T>
+static float step_cost(bool full, int reps)
+{
+    static T in[STEPS];   // static: the board's stack is 2 KB
+    for (int k = 0; k < STEPS; k++) in[k] = T(s_input[k]);
+    const T sp = T(TARGET_G);
+    uint64_t total = 0, empty = 0;
+    for (int r = 0; r < reps; r++) {
+        PidCore<T> c;
+        configure(c, full);
+        T out = T(0);
+        uint32_t t0 = cycles();
+        for (int k = 0; k < STEPS; k++) {
+            out = c.step(in[k], sp, true);
+            if (full) c.track(out);
+        }
+        uint32_t t1 = cycles();
+        bench_keep(out);
+        T sum = T(0);
+        uint32_t t2 = cycles();
+        for (int k = 0; k < STEPS; k++) {
+            sum += in[k];
+            bench_keep(sum);
+        }
+        uint32_t t3 = cycles();
+        total += (uint32_t)(t1 - t0);
+        empty += (uint32_t)(t3 - t2);
+    }
+    return (float)((double)(total > empty ? total - empty : 0) / ((double)reps * STEPS));
+}
+
+// Largest |Q16 output - float output| over the run, in degrees
+static float q16_error(bool full)
+{
+    PidCore<float> f;
+    PidCore<Q16> q;
+    configure(f, full);
+    configure(q, full);
+    float worst = 0.0f;
+    for (int k = 0; k < STEPS; k++) {
+        float of = f.step(s_input[k], TARGET_G, true);
+        Q16 oq = q.step(Q16(s_input[k]), Q16(TARGET_G), true);
+        if (full) {
+            f.track(of);
+            q.track(oq);
+        }
+        float e = std::fabs(of - (float)oq);
+        if (e > worst) worst = e;
+    }
+    return worst;
+}
+
+// One binary operation over the inputs, per operation
+template <typename T, typename Op>
+static float op_cost(Op op, int reps)
+{
+    static T a[STEPS], b[STEPS];
+    for (int k = 0; k < STEPS; k++) {
+        a[k] = T(s_input[k] + 1.0f);
+        b[k] = T(1.0f + s_input[(k * 7) % STEPS] / 64.0f);
+    }
+    uint64_t total = 0;
+    for (int r = 0; r < reps; r++) {
+        T acc = T(0);
+        uint32_t t0 = cycles();
+        for (int k = 0; k < STEPS; k++) {
+            acc = op(a[k], b[k]);
+            bench_keep(acc);
+        }
+        total += (uint32_t)(cycles() - t0);
+    }
+    return (float)((double)total / ((double)reps * STEPS));
+}
+
+static void report(int reps)
+{
+    make_inputs();
+    std::printf("PID step, %s per step (%d steps x %d):\n", UNIT, STEPS, reps);
+    for (int full = 0; full < 2; full++) {
+        std::printf("  %-32s float %7.1f   Q16 %7.1f   double %7.1f   Q16 vs float max %.4f deg\n",
+                    full ? "schedule + back-calc + D filter" : "plain (fixed gains)",
+                    (double)step_cost<float>(full, reps), (double)step_cost<Q16>(full, reps),
+                    (double)step_cost<double>(full, reps), (double)q16_error(full));
+    }
+    std::printf("operations, %s per op incl. loop:\n", UNIT);
+    std::printf("  add  float %6.1f   Q16 %6.1f\n",
+                (double)op_cost<float>([](float a, float b) { return a + b; }, reps),
+                (double)op_cost<Q16>([](Q16 a, Q16 b) { return a + b; }, reps));
+    std::printf("  mul  float %6.1f   Q16 %6.1f\n",
+                (double)op_cost<float>([](float a, float b) { return a * b; }, reps),
+                (double)op_cost<Q16>([](Q16 a, Q16 b) { return a * b; }, reps));
+    std::printf("  div  float %6.1f   Q16 %6.1f\n",
+                (double)op_cost<float>([](float a, float b) { return a / b; }, reps),
+                (double)op_cost<Q16>([](Q16 a, Q16 b) { return a / b; }, reps));
+}
+
+#if defined(PID_CYCLES_TARGET)
+int main()
+{
+    stdio_init_all();
+    cycles_init();
+    while (!stdio_usb_connected()) sleep_ms(100);
+    while (true) {
+        std::printf("\nclk_sys %lu Hz\n", (unsigned long)clock_get_hz(clk_sys));
+        report(20);
+        sleep_ms(5000);
+    }
+}
+#else
+int main()
+{
+    cycles_init();
+    BenchTimer t;
+    uint32_t c0 = cycles();
+    while (t.seconds() < 0.05) {}
+    std::printf("1 %s = %.3f ns\n", UNIT, t.seconds() * 1e9 / (uint32_t)(cycles() - c0));
+    report(2000);
+    std::printf("%.2f s\n", t.seconds());
+    return 0;
+}
+#endif
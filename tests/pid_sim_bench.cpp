@@ -0,0 +1,259 @@
+// The dispense loop closed around a simulated gate and scale, run with the
+// Arduino PID the firmware used before gain scheduling, back-calculation and
+// the derivative filter (pre-aa80dcd PID::Compute, double, whole-ms sample
+// time) and with PidCore<float> (drivers/pid/pid_core.hpp) as PID.cpp drives
+// it, each feature on its own and all three as control.cpp configures them:
+//
+//   pid_sim_bench
+//
+// The loop is control.cpp's PID-only path (no feedforward): output limits
+// zero..zero+80 deg, servo slew SERVO_SLEW_DEG_PER_S, TrackOutput with the
+// slewed angle, vibrator from 80 g remaining, done after DONE_CONFIRM_MS of
+// samples at target, then the gate closes and what is in flight lands.
+// Reported per target over plants and seeds: time to done and until the
+// weight has settled, overshoot of the settled weight, and servo travel (the
+// chatter the D filter is there for).
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.hpp"
+#include "pid_core.hpp"
+
+// control.cpp's tuning and loop constants
+static const double KP = 1.5, KI = 0.08, KD = 0.8;
+struct GainScale { double remaining_g, kp, ki, kd; };
+static const GainScale GAIN_SCHEDULE[] = {
+    {  10.0, 0.6, 0.5, 1.0 },
+    {  40.0, 1.0, 1.0, 1.0 },
+    { 200.0, 1.5, 1.0, 0.8 },
+};
+static const double PID_TRACKING_S = 3.0;
+static const float SERVO_SLEW_DEG_PER_S = 100.0f;
+static const float VIB_ASSIST_REMAINING_G = 80.0f;
+static const uint32_t DONE_CONFIRM_MS = 300;
+
+static const uint32_t PERIOD_US = 12500;            // HX711 at 80 SPS
+static const uint32_t SAMPLE_MS = PERIOD_US / 1000;  // as control.cpp rounds it
+static const float SERVO_ZERO = 35.0f;               // flow-start angle
+static const float SERVO_SPAN = 80.0f;               // zero .. zero + 80 deg
+static const float SERVO_CLOSE = SERVO_ZERO - 10.0f;
+
+// The simulated gate and scale
+struct Plant {
+    float max_gps = 40.0f;       // flow: max_gps * (1 - exp(-open / 25 deg))
+    float servo_dps = 400.0f;    // arm speed under load
+    float fall_s = 0.25f;        // gate to bag
+    float scale_tau_s = 0.08f;   // load cell + weight filter
+    float noise_g = 0.2f;        // reading noise after the filter, vibrator off
+    float vib_noise_g = 0.6f;    // and with the vibrator shaking the scale
+
+    float gps(float angle) const {
+        float open = angle - SERVO_ZERO;
+        return open <= 0.0f ? 0.0f : max_gps * (1.0f - std::exp(-open / 25.0f));
+    }
+};
+
+// The controller before the rework: Arduino PID::Compute as it was
+class OldPid {
+public:
+    explicit OldPid(double lo, double hi) : lo_(lo), hi_(hi) {
+        double ts = SAMPLE_MS / 1000.0;   // SetSampleTime took whole ms
+        kp_ = KP;
+        ki_ = KI * ts;
+        kd_ = KD / ts;
+    }
+    void reset(double output, double input) { sum_ = clamp(output); last_ = input; }
+    void track(double) {}
+    double step(double input, double setpoint) {
+        double error = setpoint - input;
+        double d_input = input - last_;
+        sum_ = clamp(sum_ + ki_ * error);
+        last_ = input;
+        return clamp(kp_ * error + sum_ - kd_ * d_input);
+    }
+
+private:
+    double clamp(double v) const { return v > hi_ ? hi_ : (v < lo_ ? lo_ : v); }
+    double lo_, hi_, kp_, ki_, kd_, sum_ = 0, last_ = 0;
+};
+
+// PidCore<float> configured the way PID.cpp does it (UpdateCore)
+struct Features { bool schedule, back_calc, d_filter; };
+
+class NewPid {
+public:
+    NewPid(double lo, double hi, Features f) {
+        using Core = PidCore<float>;
+        const double ts = PERIOD_US / 1e6;
+        auto per_sample = [&](double kp, double ki, double kd) {
+            return Core::Gains{ (float)kp, (float)(ki * ts), (float)(kd / ts) };
+        };
+        core_.set_gains(per_sample(KP, KI, KD));
+        if (f.schedule) {
+            Core::Point pts[3];
+            for (int k = 0; k < 3; k++) {
+                const GainScale& g = GAIN_SCHEDULE[k];
+                pts[k] = { (float)g.remaining_g, per_sample(KP * g.kp, KI * g.ki, KD * g.kd) };
+            }
+            core_.set_schedule(pts, 3);
+        }
+        core_.set_limits((float)lo, (float)hi);
+        core_.set_back_calc(f.back_calc, (float)(ts / PID_TRACKING_S));
+        double t_ms = ts * 1000.0, filter_ms = 2.0 * t_ms;
+        core_.set_d_alpha(f.d_filter ? (float)(t_ms / (filter_ms + t_ms)) : 1.0f);
+    }
+    void reset(double output, double input) { core_.reset((float)output, (float)input); }
+    void track(double applied) { core_.track((float)applied); }
+    double step(double input, double setpoint) { return core_.step((float)input, (float)setpoint, true); }
+
+private:
+    PidCore<float> core_;
+};
+
+struct Result {
+    float done_s = 0.0f;     // start to the close decision
+    float settled_s = 0.0f;  // start to the weight within 0.5 g of its final value
+    float over_g = 0.0f;     // settled weight - target
+    float travel_deg = 0.0f; // sum of commanded servo steps
+    bool done = false;
+};
+
+// One dispense, control.cpp's loop around the plant; the plant is stepped
+// five times per scale sample
+template <class Pid>
+static Result dispense(Pid& pid, const Plant& p, float target, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> white(0.0f, 1.0f);
+    const int sub = 5;
+    const float dt = PERIOD_US / 1e6f / sub;
+    const int fall = (int)std::lround(p.fall_s / dt);
+    const float zero = SERVO_ZERO, top = SERVO_ZERO + SERVO_SPAN;
+    const float max_step = SERVO_SLEW_DEG_PER_S * SAMPLE_MS / 1000.0f;
+    const int confirm = (int)((DONE_CONFIRM_MS + SAMPLE_MS - 1) / SAMPLE_MS);
+
+    pid.reset(zero, 0.0);
+    float servo_cmd = zero, arm = SERVO_CLOSE, landed = 0.0f, seen = 0.0f;
+    std::vector<float> column(fall + 1, 0.0f);   // grams falling, per sub-step
+    size_t head = 0;
+    float noise = 0.0f;   // unit noise through the filter's IIR smoother
+    const float iir = 0.3f, unit = std::sqrt((2.0f - iir) / iir);
+    int streak = 0;
+    bool closed = false;
+    Result res;
+    std::vector<float> at_sample;
+    for (int k = 0; k < 120 * 80; k++) {
+        // The scale delivers a sample: the loop runs
+        noise += iir * (unit * white(rng) - noise);
+        float dispensed = seen + (seen > 0.0f && target - seen <= VIB_ASSIST_REMAINING_G ?
+                                  p.vib_noise_g : p.noise_g) * noise;
+        if (!closed) {
+            float want = (float)pid.step(dispensed, target);
+            float step = want - servo_cmd;
+            if (step >  max_step) step =  max_step;
+            if (step < -max_step) step = -max_step;
+            servo_cmd += step;
+            res.travel_deg += std::fabs(step);
+            pid.track(servo_cmd);
+            streak = dispensed >= target ? streak + 1 : 0;
+            if (streak >= confirm) {
+                closed = true;
+                res.done = true;
+                res.done_s = k * PERIOD_US / 1e6f;
+                servo_cmd = SERVO_CLOSE;
+            }
+        }
+        if (closed && k * PERIOD_US / 1e6f > res.done_s + 3.0f) break;
+        if (!closed && servo_cmd > top) servo_cmd = top;
+
+        for (int s = 0; s < sub; s++) {
+            float d = servo_cmd - arm, lim = p.servo_dps * dt;
+            arm += d > lim ? lim : (d < -lim ? -lim : d);
+            column[head] = p.gps(arm) * dt;
+            head = (head + 1) % column.size();
+            landed += column[head];   // the oldest: it left fall_s ago
+            column[head] = 0.0f;
+            seen += (landed - seen) * dt / p.scale_tau_s;
+        }
+        at_sample.push_back(landed);
+    }
+    res.over_g = landed - target;
+    size_t k = at_sample.size();
+    while (k > 0 && std::fabs(at_sample[k - 1] - landed) < 0.5f) k--;
+    res.settled_s = k * PERIOD_US / 1e6f;
+    return res;
+}
+
+struct Variant {
+    const char* name;
+    bool old;
+    Features f;
+};
+
+static const Variant VARIANTS[] = {
+    { "old Arduino PID (double)", true,  { false, false, false } },
+    { "PidCore<float>, none",     false, { false, false, false } },
+    { "+ gain schedule",          false, { true,  false, false } },
+    { "+ back-calculation",       false, { false, true,  false } },
+    { "+ D filter",               false, { false, false, true  } },
+    { "all three (firmware)",     false, { true,  true,  true  } },
+};
+
+int main()
+{
+    const float targets[] = { 50.0f, 250.0f, 1000.0f };
+    const float flows[] = { 20.0f, 40.0f, 70.0f };   // fine grain .. coarse, g/s wide open
+    const uint32_t seeds = 8;
+
+    BenchTimer timer;
+    long runs = 0;
+    for (float target : targets) {
+        std::printf("target %.0f g (%u seeds x gates of %.0f/%.0f/%.0f g/s):\n", (double)target,
+                    (unsigned)seeds, (double)flows[0], (double)flows[1], (double)flows[2]);
+        std::printf("  %-26s %7s %9s %12s %11s %8s %11s\n", "", "done s", "settled s",
+                    "over g mean", "over g max", "|err| g", "travel deg");
+        for (const Variant& v : VARIANTS) {
+            double done = 0, settled = 0, over = 0, over_max = -1e9, err = 0, travel = 0;
+            int n = 0, stuck = 0;
+            for (float gps : flows) {
+                Plant p;
+                p.max_gps = gps;
+                for (uint32_t s = 0; s < seeds; s++) {
+                    Result r;
+                    if (v.old) {
+                        OldPid pid(SERVO_ZERO, SERVO_ZERO + SERVO_SPAN);
+                        r = dispense(pid, p, target, 1000 * s + (uint32_t)gps);
+                    } else {
+                        NewPid pid(SERVO_ZERO, SERVO_ZERO + SERVO_SPAN, v.f);
+                        r = dispense(pid, p, target, 1000 * s + (uint32_t)gps);
+                    }
+                    runs++;
+                    if (!r.done) {
+                        stuck++;
+                        continue;
+                    }
+                    n++;
+                    done += r.done_s;
+                    settled += r.settled_s;
+                    over += r.over_g;
+                    err += std::fabs(r.over_g);
+                    travel += r.travel_deg;
+                    if (r.over_g > over_max) over_max = r.over_g;
+                }
+            }
+            if (n == 0) {
+                std::printf("  %-26s never done\n", v.name);
+                continue;
+            }
+            std::printf("  %-26s %7.2f %9.2f %12.2f %11.2f %8.2f %11.0f", v.name, done / n,
+                        settled / n, over / n, over_max, err / n, travel / n);
+            if (stuck) std::printf("  (%d runs not done in 120 s)", stuck);
+            std::printf("\n");
+        }
+    }
+    std::printf("%ld dispenses simulated in %.2f s\n", runs, timer.seconds());
+    return 0;
+}
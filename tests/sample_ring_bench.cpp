@@ -0,0 +1,83 @@
+// SampleRing throughput on the host: the simulated DMA chain and the software
+// producer against a consumer reading in the firmware's batch sizes. Shows
+// the per-sample cost of the ring itself - the firmware's budget is one
+// conversion per 12.5 ms per scale.
+
+#include <cstdio>
+#include <initializer_list>
+
+#include "bench.hpp"
+#include "hx711_sim.hpp"
+#include "sample_ring.hpp"
+
+static constexpr uint32_t N = 128;
+static constexpr uint32_t SAMPLES = 20000000;
+
+static void bench_dma(uint32_t batch)
+{
+    static SampleRing<N> ring;
+    ring.reset();
+    Hx711DmaSim<N> dma(ring);
+    HxSample out[N];
+    int64_t sum = 0;
+    BenchTimer t;
+    for (uint32_t k = 0; k < SAMPLES; k += batch) {
+        for (uint32_t j = 0; j < batch; j++) {
+            dma.convert((int32_t)(k + j));
+            dma.drain(k + j);
+        }
+        uint32_t n = ring.read(dma.head(), out, N);
+        for (uint32_t i = 0; i < n; i++) sum += out[i].raw;
+    }
+    double s = t.seconds();
+    bench_keep(sum);
+    std::printf("dma sim   batch %3u: %6.2f ns/sample (producer + consumer), overruns %u\n",
+                (unsigned)batch, s * 1e9 / SAMPLES, (unsigned)ring.overruns());
+}
+
+static void bench_soft(uint32_t batch)
+{
+    static SampleRing<N> ring;
+    ring.reset();
+    HxSample out[N];
+    int64_t sum = 0;
+    BenchTimer t;
+    for (uint32_t k = 0; k < SAMPLES; k += batch) {
+        for (uint32_t j = 0; j < batch; j++) ring.push(k + j, k + j);
+        uint32_t n = ring.read(ring.soft_head(), out, N);
+        for (uint32_t i = 0; i < n; i++) sum += out[i].raw;
+    }
+    double s = t.seconds();
+    bench_keep(sum);
+    std::printf("soft push batch %3u: %6.2f ns/sample (producer + consumer), overruns %u\n",
+                (unsigned)batch, s * 1e9 / SAMPLES, (unsigned)ring.overruns());
+}
+
+static void bench_lapped()
+{
+    static SampleRing<N> ring;
+    ring.reset();
+    Hx711DmaSim<N> dma(ring);
+    HxSample out[N];
+    const uint32_t rounds = 200000;
+    BenchTimer t;
+    for (uint32_t r = 0; r < rounds; r++) {
+        for (uint32_t j = 0; j < N + 3; j++) {
+            dma.convert((int32_t)j);
+            dma.drain(r * (N + 3) + j);
+        }
+        ring.read(dma.head(), out, N);
+    }
+    double s = t.seconds();
+    std::printf("lapped read: %6.1f ns per recovery, overruns %u/%u\n",
+                s * 1e9 / rounds, (unsigned)ring.overruns(), (unsigned)rounds);
+}
+
+int main()
+{
+    // 1: a read per conversion; 8: 10 ms loop at 80 SPS x a few; 64: half a ring
+    for (uint32_t b : {1u, 8u, 64u}) bench_dma(b);
+    for (uint32_t b : {1u, 8u, 64u}) bench_soft(b);
+    bench_lapped();
+    return 0;
+}
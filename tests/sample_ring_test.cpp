@@ -0,0 +1,209 @@
+// SampleRing (drivers/hx711/sample_ring.hpp) against the simulated DMA chain
+// and the software producer: order, timestamps, sign extension, torn
+// entries, partial reads, lap detection and a threaded SPSC run.
+
+#include <atomic>
+#include <thread>
+
+#include "check.hpp"
+#include "hx711_sim.hpp"
+#include "sample_ring.hpp"
+
+static constexpr uint32_t N = 16;
+static constexpr uint32_t PERIOD_US = 12500;   // 80 SPS
+
+// Conversion k of a test stream: alternating sign, distinct values
+static int32_t value_of(uint32_t k) { return (k & 1) ? -(int32_t)(k * 37 + 1) : (int32_t)(k * 37); }
+static uint32_t stamp_of(uint32_t k) { return 1000 + k * PERIOD_US; }
+
+static void test_order_and_sign()
+{
+    SampleRing<N> ring;
+    Hx711DmaSim<N> dma(ring);
+    for (uint32_t k = 0; k < 5; k++) {
+        CHECK(dma.convert(value_of(k)));
+        dma.drain(stamp_of(k));
+    }
+    // Extremes of the 24-bit range
+    dma.convert(-8388608);
+    dma.drain(stamp_of(5));
+    dma.convert(8388607);
+    dma.drain(stamp_of(6));
+
+    HxSample s[N];
+    uint32_t n = ring.read(dma.head(), s, N);
+    CHECK(n == 7);
+    for (uint32_t k = 0; k < 5; k++) {
+        CHECK(s[k].raw == value_of(k));
+        CHECK(s[k].t_us == stamp_of(k));
+    }
+    CHECK(s[5].raw == -8388608);
+    CHECK(s[6].raw == 8388607);
+    CHECK(ring.read(dma.head(), s, N) == 0);
+    CHECK(ring.overruns() == 0);
+}
+
+static void test_torn_entry()
+{
+    SampleRing<N> ring;
+    Hx711DmaSim<N> dma(ring);
+    dma.convert(11);
+    dma.drain(stamp_of(0));
+    dma.convert(22);
+    CHECK(dma.dma_raw());   // raw landed, stamp not yet
+
+    HxSample s[N];
+    CHECK(ring.pending(dma.head()) == 1);
+    CHECK(ring.read(dma.head(), s, N) == 1);
+    CHECK(s[0].raw == 11);
+
+    CHECK(dma.dma_stamp(stamp_of(1)));
+    CHECK(ring.read(dma.head(), s, N) == 1);
+    CHECK(s[0].raw == 22 && s[0].t_us == stamp_of(1));
+}
+
+static void test_partial_reads_across_wrap()
+{
+    SampleRing<N> ring;
+    Hx711DmaSim<N> dma(ring);
+    HxSample s[N];
+    uint32_t next = 0;   // next conversion the consumer expects
+    uint32_t k = 0;
+    for (int round = 0; round < 20; round++) {
+        for (int j = 0; j < 9; j++, k++) {
+            dma.convert(value_of(k));
+            dma.drain(stamp_of(k));
+        }
+        // Two reads of at most 5: the second leaves the rest queued
+        for (int part = 0; part < 2; part++) {
+            uint32_t n = ring.read(dma.head(), s, 5);
+            for (uint32_t i = 0; i < n; i++, next++) {
+                CHECK(s[i].raw == value_of(next));
+                CHECK(s[i].t_us == stamp_of(next));
+            }
+        }
+    }
+    CHECK(next == k);
+    CHECK(ring.overruns() == 0);
+}
+
+static void test_lap()
+{
+    SampleRing<N> ring;
+    Hx711DmaSim<N> dma(ring);
+    HxSample s[N];
+    dma.convert(value_of(0));
+    dma.drain(stamp_of(0));
+    CHECK(ring.read(dma.head(), s, N) == 1);
+
+    // N - 1 behind is the most the ring holds without a lap
+    uint32_t k = 1;
+    for (; k < N; k++) {
+        dma.convert(value_of(k));
+        dma.drain(stamp_of(k));
+    }
+    CHECK(ring.read(dma.head(), s, N) == N - 1);
+    CHECK(ring.overruns() == 0);
+    CHECK(s[N - 2].raw == value_of(N - 1));
+
+    // A lap and a bit: the backlog drops to the newest complete entries
+    uint32_t end = k + N + 5;
+    for (; k < end; k++) {
+        dma.convert(value_of(k));
+        dma.drain(stamp_of(k));
+    }
+    uint32_t n = ring.read(dma.head(), s, N);
+    CHECK(ring.overruns() == 1);
+    CHECK(n == N - 1);
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t want = end - n + i;
+        CHECK(s[i].raw == value_of(want));
+        CHECK(s[i].t_us == stamp_of(want));
+    }
+
+    // And it carries on normally
+    dma.convert(value_of(k));
+    dma.drain(stamp_of(k));
+    CHECK(ring.read(dma.head(), s, N) == 1);
+    CHECK(s[0].t_us == stamp_of(k));
+    CHECK(ring.overruns() == 1);
+}
+
+static void test_skip_and_reset()
+{
+    SampleRing<N> ring;
+    Hx711DmaSim<N> dma(ring);
+    HxSample s[N];
+    uint32_t k = 0;
+    for (; k < 6; k++) {
+        dma.convert(value_of(k));
+        dma.drain(stamp_of(k));
+    }
+    ring.skip_to(dma.head());
+    CHECK(ring.pending(dma.head()) == 0);
+    CHECK(ring.read(dma.head(), s, N) == 0);
+    dma.convert(value_of(k));
+    dma.drain(stamp_of(k));
+    CHECK(ring.read(dma.head(), s, N) == 1);
+    CHECK(s[0].raw == value_of(k));
+    CHECK(ring.overruns() == 0);
+
+    // Software producer after a reset reads the same as the DMA chain
+    ring.reset();
+    for (uint32_t j = 0; j < 3; j++) ring.push((uint32_t)value_of(j) & 0x00FFFFFFu, stamp_of(j));
+    CHECK(ring.read(ring.soft_head(), s, N) == 3);
+    for (uint32_t j = 0; j < 3; j++) CHECK(s[j].raw == value_of(j) && s[j].t_us == stamp_of(j));
+}
+
+static void test_fifo_backpressure()
+{
+    SampleRing<N> ring;
+    Hx711DmaSim<N> dma(ring);
+    for (int j = 0; j < 4; j++) CHECK(dma.convert(j));
+    CHECK(!dma.convert(4));    // a stalled DMA stalls the state machine
+    dma.drain(stamp_of(0));
+    CHECK(dma.fifo_level() == 0);
+    CHECK(ring.pending(dma.head()) == 4);
+}
+
+// Software producer on its own thread, consumer here: every entry arrives
+// once, in order, while the consumer keeps up
+static void test_threaded()
+{
+    static SampleRing<128> ring;
+    ring.reset();
+    const uint32_t total = 50000;
+    std::atomic<uint32_t> consumed{0};
+    std::thread producer([&] {
+        for (uint32_t k = 0; k < total; k++) {
+            // Stay under a lap behind (the firmware reads every 10 ms)
+            while (k - consumed.load(std::memory_order_acquire) >= 100) std::this_thread::yield();
+            ring.push(k & 0x007FFFFFu, k);
+        }
+    });
+    HxSample s[32];
+    uint32_t next = 0;
+    bool in_order = true;
+    while (next < total) {
+        uint32_t n = ring.read(ring.soft_head(), s, 32);
+        for (uint32_t i = 0; i < n; i++, next++) {
+            if (s[i].t_us != next || s[i].raw != (int32_t)(next & 0x007FFFFFu)) in_order = false;
+        }
+        consumed.store(next, std::memory_order_release);
+    }
+    producer.join();
+    CHECK(in_order);
+    CHECK(ring.overruns() == 0);
+}
+
+int main()
+{
+    test_order_and_sign();
+    test_torn_entry();
+    test_partial_reads_across_wrap();
+    test_lap();
+    test_skip_and_reset();
+    test_fifo_backpressure();
+    test_threaded();
+    return check_exit("sample_ring_test");
+}
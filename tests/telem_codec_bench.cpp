@@ -0,0 +1,122 @@
+// Telemetry codec size and speed on the host, over downloaded /api/log.csv
+// files (or a synthetic dispense when none are given):
+//
+//   telem_codec_bench [LOG.csv ...]
+//
+// Size is measured the way the ring stores it: a keyframe at the start of
+// every TELEM_BLOCK_BYTES block. Also checks that every row decodes back to
+// the row it came from.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "telem_codec.hpp"
+#include "telem_csv.hpp"
+#include "telemetry.hpp"
+
+static void report(const char* name, const std::vector<TelemetrySample>& run)
+{
+    if (run.empty()) {
+        std::printf("%s: no samples\n", name);
+        return;
+    }
+
+    // Size in blocks, as telemetry.cpp fills them
+    TelemEncoder enc;
+    std::vector<uint8_t> bytes;
+    uint32_t hist[TELEM_CODEC_MAX_BYTES + 1] = {};
+    uint32_t used = TELEM_BLOCK_BYTES, blocks = 0;
+    for (const auto& s : run) {
+        uint8_t b[TELEM_CODEC_MAX_BYTES];
+        int n = enc.encode(s, b);
+        if (used + n > TELEM_BLOCK_BYTES) {
+            enc.reset();
+            n = enc.encode(s, b);
+            used = 0;
+            blocks++;
+        }
+        used += n;
+        hist[n]++;
+    }
+
+    // Round trip as one stream, and the CSV it prints
+    enc.reset();
+    for (const auto& s : run) {
+        uint8_t b[TELEM_CODEC_MAX_BYTES];
+        int n = enc.encode(s, b);
+        bytes.insert(bytes.end(), b, b + n);
+    }
+    TelemDecoder dec;
+    size_t off = 0, k = 0, mismatched = 0, csv_bytes = 0;
+    char want[160], got[160];
+    while (off < bytes.size() && k < run.size()) {
+        TelemetrySample s;
+        int n = dec.decode(bytes.data() + off, (int)(bytes.size() - off), s);
+        if (n <= 0) break;
+        off += n;
+        csv_bytes += telem_csv_row(run[k], want, sizeof(want));
+        telem_csv_row(s, got, sizeof(got));
+        mismatched += std::string(want) != got;
+        k++;
+    }
+
+    // Speed: the whole run many times over
+    const int reps = (int)(2000000 / run.size()) + 1;
+    std::vector<uint8_t> out(run.size() * TELEM_CODEC_MAX_BYTES);
+    size_t total = 0;
+    BenchTimer te;
+    for (int r = 0; r < reps; r++) {
+        enc.reset();
+        size_t o = 0;
+        for (const auto& s : run) o += enc.encode(s, out.data() + o);
+        total = o;
+        bench_keep(out[o / 2]);
+    }
+    double se = te.seconds();
+    float sum = 0;
+    BenchTimer td;
+    for (int r = 0; r < reps; r++) {
+        dec.reset();
+        size_t o = 0;
+        TelemetrySample s;
+        while (o < total) o += dec.decode(out.data() + o, (int)(total - o), s);
+        sum += s.weight;
+    }
+    double sd = td.seconds();
+    bench_keep(sum);
+
+    double samples = (double)run.size() * reps;
+    std::printf("%s: %zu samples, %u blocks of %u B: %.2f B/sample in blocks, "
+                "%.2f B/sample as one stream (raw 40, CSV %.1f)\n",
+                name, run.size(), (unsigned)blocks, (unsigned)TELEM_BLOCK_BYTES,
+                (blocks * (double)TELEM_BLOCK_BYTES - (TELEM_BLOCK_BYTES - used)) / run.size(),
+                (double)bytes.size() / run.size(), (double)csv_bytes / run.size());
+    std::printf("  size histogram:");
+    for (int n = 0; n <= TELEM_CODEC_MAX_BYTES; n++) {
+        if (hist[n]) std::printf(" %dB:%.1f%%", n, 100.0 * hist[n] / run.size());
+    }
+    std::printf("\n  encode %.1f ns/sample, decode %.1f ns/sample (host); "
+                "rows differing after the round trip: %zu of %zu\n",
+                se * 1e9 / samples, sd * 1e9 / samples, mismatched, k);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        report("synthetic 250 g dispense", telem_as_logged(telem_synth_run(1, 6000)));
+        return 0;
+    }
+    int rc = 0;
+    for (int a = 1; a < argc; a++) {
+        std::vector<TelemetrySample> run;
+        if (!telem_csv_load(argv[a], run)) {
+            std::fprintf(stderr, "cannot read %s\n", argv[a]);
+            rc = 1;
+            continue;
+        }
+        report(argv[a], run);
+    }
+    return rc;
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "telem_codec.hpp"
+
+// Telemetry samples for the codec's host test and benchmark: rows of the
+// /api/log.csv download (the format send_more_csv prints), and a synthetic
+// dispense run for when no recorded log is at hand.
+
+// One CSV row, exactly as send_more_csv (web_server.cpp) prints it
+inline int telem_csv_row(const TelemetrySample& s, char* buf, size_t len)
+{
+    return std::snprintf(buf, len, "%lu,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,%.2f,%.2f,%.2f\n",
+                         (unsigned long)s.t_ms, (double)s.setpoint, (double)s.dispensed,
+                         (double)s.weight, (double)s.gross, (double)s.servo, (double)s.p,
+                         (double)s.i, (double)s.d, (double)s.vib);
+}
+
+// One sample back from a CSV row; false for anything else
+inline bool telem_csv_parse(const char* line, TelemetrySample& s)
+{
+    if (line[0] < '0' || line[0] > '9') return false;
+    s = TelemetrySample{};
+    unsigned long t = 0;
+    int n = std::sscanf(line, "%lu,%f,%f,%f,%f,%f,%f,%f,%f,%f", &t, &s.setpoint, &s.dispensed,
+                        &s.weight, &s.gross, &s.servo, &s.p, &s.i, &s.d, &s.vib);
+    s.t_ms = (uint32_t)t;
+    return n == 10;
+}
+
+// Samples of a downloaded log: '#' metadata lines and the column header are
+// skipped. False if the file can't be read.
+inline bool telem_csv_load(const char* path, std::vector<TelemetrySample>& out)
+{
+    FILE* f = std::fopen(path, "r");
+    if (!f) return false;
+    char line[512];
+    TelemetrySample s;
+    while (std::fgets(line, sizeof(line), f)) {
+        if (telem_csv_parse(line, s)) out.push_back(s);
+    }
+    std::fclose(f);
+    return true;
+}
+
+// What the ring hands back for a run: every sample once through the codec.
+// A downloaded log is printed from these, never from the originals.
+inline std::vector<TelemetrySample> telem_as_logged(const std::vector<TelemetrySample>& run)
+{
+    TelemEncoder enc;
+    TelemDecoder dec;
+    std::vector<TelemetrySample> out;
+    for (const auto& s : run) {
+        uint8_t b[TELEM_CODEC_MAX_BYTES];
+        int n = enc.encode(s, b);
+        TelemetrySample d;
+        if (dec.decode(b, n, d) == n) out.push_back(d);
+    }
+    return out;
+}
+
+// A dispense as the PID loop logs it: 50 Hz with the odd late tick, grain
+// leaving the hopper on the scale (weight and gross fall, dispensed = start -
+// weight rises, as control.cpp logs them), the servo closing in on
+// the target, the vibrator pulsing, load-cell noise on every reading
+inline std::vector<TelemetrySample> telem_synth_run(uint32_t seed, int n, float target = 250.0f)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+    std::uniform_real_distribution<float> uni(0.0f, 1.0f);
+    const float kp = 1.2f, ki = 0.3f, kd = 0.05f, hopper = 1830.0f, container = 412.3f;
+    std::vector<TelemetrySample> out;
+    float flow = 0.0f, poured = 0.0f, integ = 0.0f, prev_err = target;
+    uint32_t t = 0;
+    for (int k = 0; k < n; k++) {
+        TelemetrySample s{};
+        s.t_ms = t;
+        t += 20 + (uni(rng) < 0.05f ? 1 + (uint32_t)(uni(rng) * 4) : 0);
+
+        float meas = poured + noise(rng);
+        s.setpoint = target;
+        s.weight = hopper - meas;
+        s.dispensed = meas;
+        s.gross = container + hopper - meas;   // same load cell, calibrated zero
+
+        float err = target - meas;
+        integ += err * 0.02f;
+        if (integ > 60.0f) integ = 60.0f;
+        s.p = kp * err;
+        s.i = ki * integ;
+        s.d = -kd * (err - prev_err) / 0.02f;
+        prev_err = err;
+        float u = s.p + s.i + s.d;
+        s.servo = u < 0.0f ? 0.0f : u > 90.0f ? 90.0f : u;
+        if (err <= 0.5f) s.servo = 0.0f;   // closed
+        s.vib = (s.servo > 0.0f && (k / 25) % 4 == 0) ? 0.65f : 0.0f;
+
+        // Grain flow follows the opening with a lag
+        flow += (s.servo * 0.004f - flow) * 0.1f;
+        poured += flow;
+        out.push_back(s);
+    }
+    return out;
+}
@@ -0,0 +1,532 @@
+// The web server (drivers/webserver/web_server.cpp) built for the host over
+// the in-memory TCP stack in fake_tcp.cpp: keep-alive, pipelined requests
+// answered in order under send-buffer and window pressure
+// (process_requests / consume_request), the connection pool (conn_alloc
+// evicting the longest-idle connection, refusing when none is evictable),
+// the timeouts, and a randomized multi-client load run that checks for
+// leaked pbufs, PCBs and calls on dead PCBs.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "check.hpp"
+#include "fake_tcp.hpp"
+#include "web_page.h"
+#include "web_page_gz.h"
+#include "web_server.h"
+
+static DispenserState s_state;
+
+// ---------------------------------------------------------------- requests --
+
+static std::string get(const char* path, const char* headers = "")
+{
+    return std::string("GET ") + path + " HTTP/1.1\r\nHost: korn\r\n" + headers + "\r\n";
+}
+
+// Three requests with three different answers, to check the order of a
+// pipelined batch by status code alone
+static const char* const ROTA[] = {"/api/status", "/missing", "/api/queue"};
+static const int ROTA_STATUS[] = {200, 404, 200};
+static std::string rota(int k) { return get(ROTA[k % 3]); }
+
+// --------------------------------------------------------------- responses --
+
+struct Resp {
+    int status = 0;
+    std::string head;
+    std::string body;
+    bool has(const char* line) const { return head.find(line) != std::string::npos; }
+};
+
+// Client: the connection plus how far its received bytes have been parsed.
+// Lives at a fixed address (the fake PCB points at the FakeConn).
+struct Client {
+    FakeConn c;
+    size_t pos = 0;
+
+    bool connect()
+    {
+        pos = 0;
+        return fake_connect(c);
+    }
+    bool open() const { return c.pcb && !c.fin && !c.reset; }
+
+    // Next complete response, if it has all arrived
+    bool next(Resp& r)
+    {
+        size_t end = c.rx.find("\r\n\r\n", pos);
+        if (end == std::string::npos) return false;
+        r = Resp{};
+        r.head = c.rx.substr(pos, end + 4 - pos);
+        r.status = std::atoi(r.head.c_str() + 9);
+        size_t body = end + 4;
+        size_t cl = r.head.find("Content-Length: ");
+        size_t len;
+        if (cl != std::string::npos) {
+            len = (size_t)std::atol(r.head.c_str() + cl + 16);
+        } else if (r.status == 204 || r.status == 304) {
+            len = 0;
+        } else {
+            // Delimited by the close
+            if (!c.fin) return false;
+            len = c.rx.size() - body;
+        }
+        if (c.rx.size() - body < len) return false;
+        r.body = c.rx.substr(body, len);
+        pos = body + len;
+        return true;
+    }
+
+    // Every response that is complete now
+    std::vector<Resp> drain()
+    {
+        std::vector<Resp> out;
+        Resp r;
+        while (next(r)) out.push_back(r);
+        return out;
+    }
+
+    void close()
+    {
+        if (open()) fake_fin(c);
+    }
+};
+
+// ACK everything until the server has nothing left to send
+static void ack_all(Client& cl)
+{
+    for (int i = 0; i < 1000 && cl.c.acked < cl.c.rx.size(); i++) fake_ack(cl.c);
+}
+
+static int s_violations0 = 0;
+
+// Every test leaves no connection, pbuf or PCB misuse behind it
+static void clean_end()
+{
+    fake_advance_ms(20000);   // time out anything a test left half-done
+    CHECK(fake_open_pcbs() == 0);
+    CHECK(fake_live_pbufs() == 0);
+    CHECK(fake_violations() == s_violations0);
+    s_violations0 = fake_violations();
+}
+
+// ------------------------------------------------------------------- tests --
+
+static void test_keep_alive()
+{
+    Client a;
+    CHECK(a.connect());
+    for (int k = 0; k < 3; k++) {
+        fake_send(a.c, rota(k));
+        ack_all(a);
+        auto rs = a.drain();
+        CHECK(rs.size() == 1);
+        if (rs.size() != 1) continue;
+        CHECK(rs[0].status == ROTA_STATUS[k]);
+        CHECK(rs[0].has("Connection: keep-alive"));
+    }
+    CHECK(a.open());
+    CHECK(fake_open_pcbs() == 1);
+
+    // Asked to close: the answer, then the FIN
+    fake_send(a.c, get("/api/status", "Connection: close\r\n"));
+    auto rs = a.drain();
+    CHECK(rs.size() == 1 && rs[0].status == 200 && rs[0].has("Connection: close"));
+    CHECK(a.c.fin);
+    CHECK(fake_window(a.c) == 0);
+
+    // HTTP/1.0 closes unless it asks otherwise
+    Client b;
+    CHECK(b.connect());
+    fake_send(b.c, "GET /api/status HTTP/1.0\r\n\r\n");
+    CHECK(b.drain().size() == 1 && b.c.fin);
+    clean_end();
+}
+
+static void test_pipelined_in_order()
+{
+    Client a;
+    CHECK(a.connect());
+    std::string batch;
+    for (int k = 0; k < 6; k++) batch += rota(k);
+    batch += "OPTIONS /api/status HTTP/1.1\r\n\r\n";
+    CHECK(fake_send(a.c, batch) == batch.size());
+    ack_all(a);
+    auto rs = a.drain();
+    CHECK(rs.size() == 7);
+    for (size_t k = 0; k < rs.size() && k < 6; k++) CHECK(rs[k].status == ROTA_STATUS[k % 3]);
+    if (rs.size() == 7) CHECK(rs[6].status == 204 && rs[6].has("Access-Control-Allow-Methods"));
+    CHECK(a.open());
+    CHECK(fake_window(a.c) == TCP_WND);   // every byte consumed and reopened
+    a.close();
+    clean_end();
+}
+
+// A batch bigger than the send buffer: answered until it runs low, the rest
+// on the ACKs, never out of order
+static void test_pipelining_throttled()
+{
+    Client a;
+    CHECK(a.connect());
+    std::string batch;
+    for (int k = 0; k < 18; k++) batch += rota(3 * k);   // /api/status, ~1 KB each
+    CHECK(batch.size() < 1024 - 1);
+    fake_send(a.c, batch);
+    size_t first = a.drain().size();
+    CHECK(first > 0 && first < 18);   // stopped on the send buffer, not done
+    CHECK(fake_window(a.c) == TCP_WND);   // the batch fit req_buf: all reopened
+    a.pos = 0;
+
+    // ACK in small steps: the rest follows
+    for (int i = 0; i < 200 && a.c.acked < a.c.rx.size(); i++) fake_ack(a.c, 700);
+    auto rs = a.drain();
+    CHECK(rs.size() == 18);
+    for (auto& r : rs) CHECK(r.status == 200 && r.body.front() == '{' && r.body.back() == '}');
+    CHECK(a.open());
+    a.close();
+    clean_end();
+}
+
+// A client that sends far more than req_buf holds is throttled by its window:
+// nothing is dropped, nothing is answered twice
+static void test_window_backpressure()
+{
+    Client a;
+    CHECK(a.connect());
+    const int total = 600;   // ~24 KB of requests, two windows and then some
+    std::string all;
+    for (int k = 0; k < total; k++) all += rota(k);
+    size_t sent = 0;
+    bool closed_window = false;
+    for (int i = 0; i < 100000 && sent < all.size(); i++) {
+        sent += fake_send(a.c, all.substr(sent, 4000));
+        if (fake_window(a.c) == 0) closed_window = true;
+        fake_ack(a.c, 1500);
+    }
+    CHECK(sent == all.size());
+    CHECK(closed_window);
+    ack_all(a);
+    auto rs = a.drain();
+    CHECK((int)rs.size() == total);
+    bool in_order = true;
+    for (size_t k = 0; k < rs.size(); k++) in_order &= rs[k].status == ROTA_STATUS[k % 3];
+    CHECK(in_order);
+    CHECK(fake_window(a.c) == TCP_WND);
+    a.close();
+    clean_end();
+}
+
+// GET / is streamed over several ACKs; a request pipelined behind it waits
+static void test_page_then_pipelined()
+{
+    Client a;
+    CHECK(a.connect());
+    fake_send(a.c, get("/", "Accept-Encoding: gzip, deflate\r\n") + get("/api/status"));
+    CHECK(a.drain().empty());   // the page doesn't fit one send buffer
+    a.pos = 0;
+    ack_all(a);
+    auto rs = a.drain();
+    CHECK(rs.size() == 2);
+    if (rs.size() == 2) {
+        CHECK(rs[0].status == 200 && rs[0].has("Content-Encoding: gzip"));
+        CHECK(rs[0].body.size() == WEB_PAGE_GZ_LEN &&
+              std::memcmp(rs[0].body.data(), WEB_PAGE_GZ, WEB_PAGE_GZ_LEN) == 0);
+        CHECK(rs[1].status == 200 && rs[1].body.front() == '{');
+    }
+
+    // The plain page, then a revalidation that costs a 304
+    fake_send(a.c, get("/?r=1720000000"));
+    ack_all(a);
+    rs = a.drain();
+    CHECK(rs.size() == 1 && rs[0].body == WEB_PAGE && !rs[0].has("Content-Encoding"));
+    fake_send(a.c, get("/", "If-None-Match: " WEB_PAGE_ETAG "\r\n"));
+    rs = a.drain();
+    CHECK(rs.size() == 1 && rs[0].status == 304 && rs[0].body.empty());
+    CHECK(a.open());
+    a.close();
+    clean_end();
+}
+
+// A full pool closes the longest-idle keep-alive connection for a new one,
+// skipping any connection with a request in progress
+static void test_pool_eviction()
+{
+    Client c[7];
+    for (int i = 0; i < 5; i++) {
+        CHECK(c[i].connect());
+        fake_send(c[i].c, get("/api/status"));
+        ack_all(c[i]);
+        fake_advance_ms(100);
+    }
+    CHECK(fake_open_pcbs() == 5);
+
+    CHECK(c[5].connect());
+    CHECK(c[0].c.fin);   // the oldest
+    for (int i = 1; i < 5; i++) CHECK(c[i].open());
+
+    // c[1] is next by age but mid-request: c[2] goes instead
+    fake_send(c[1].c, "GET /api/status HTTP/1.1\r\n");
+    CHECK(c[6].connect());
+    CHECK(c[1].open());
+    CHECK(c[2].c.fin);
+
+    // ... and c[1] finishes its request normally
+    fake_send(c[1].c, "\r\n");
+    auto rs = c[1].drain();
+    CHECK(rs.size() == 2 && rs[1].status == 200);
+    CHECK(fake_open_pcbs() == 5);
+    for (auto& x : c) x.close();
+    clean_end();
+}
+
+// Nothing evictable: the new connection is refused, the others are untouched
+static void test_pool_full()
+{
+    Client c[6];
+    for (int i = 0; i < 5; i++) {
+        CHECK(c[i].connect());
+        fake_send(c[i].c, "GET /api/status HTTP/1.1\r\n");
+    }
+    CHECK(!c[5].connect());
+    CHECK(c[5].c.reset);
+    CHECK(fake_open_pcbs() == 5);
+    for (int i = 0; i < 5; i++) {
+        fake_send(c[i].c, "\r\n");
+        auto rs = c[i].drain();
+        CHECK(rs.size() == 1 && rs[0].status == 200);
+    }
+    // Idle again: evictable
+    CHECK(c[5].connect());
+    for (auto& x : c) x.close();
+    clean_end();
+}
+
+static void test_too_large()
+{
+    // Headers that never end within req_buf
+    Client a;
+    CHECK(a.connect());
+    std::string big = "GET /api/status HTTP/1.1\r\nX-Pad: " + std::string(1100, 'x');
+    fake_send(a.c, big);
+    auto rs = a.drain();
+    CHECK(rs.size() == 1 && rs[0].status == 413 && rs[0].body == "too large");
+    CHECK(a.c.fin);
+
+    // A body announced bigger than req_buf: refused before it arrives
+    Client b;
+    CHECK(b.connect());
+    fake_send(b.c, "POST /api/recipe HTTP/1.1\r\nContent-Length: 5000\r\n\r\n{");
+    rs = b.drain();
+    CHECK(rs.size() == 1 && rs[0].status == 413);
+    CHECK(b.c.fin);
+    clean_end();
+}
+
+// Requests in arbitrary pieces, down to one byte per segment
+static void test_split_segments()
+{
+    Client a;
+    CHECK(a.connect());
+    std::string two = rota(0) + rota(1);
+    for (size_t seg : {1, 7, 50}) {
+        fake_send(a.c, two, seg);
+        ack_all(a);
+        auto rs = a.drain();
+        CHECK(rs.size() == 2);
+        if (rs.size() == 2) CHECK(rs[0].status == 200 && rs[1].status == 404);
+    }
+    // A POST body split from its headers
+    fake_send(a.c, "POST /api/target HTTP/1.1\r\nContent-Length: 14\r\n\r\n");
+    CHECK(a.drain().empty());
+    fake_send(a.c, "{\"target\":250}");
+    auto rs = a.drain();
+    CHECK(rs.size() == 1 && rs[0].status / 100 == 2);
+    a.close();
+    clean_end();
+}
+
+static void test_timeouts()
+{
+    // Idle keep-alive: closed after 5 s
+    Client a;
+    CHECK(a.connect());
+    fake_send(a.c, get("/api/status"));
+    ack_all(a);
+    for (int t = 0; t < 4; t++) fake_advance_ms(1000);
+    CHECK(a.open());
+    for (int t = 0; t < 2; t++) fake_advance_ms(1000);
+    CHECK(a.c.fin && !a.c.reset);
+
+    // Half a request: kept past the idle limit, reset after 10 s
+    Client b;
+    CHECK(b.connect());
+    fake_send(b.c, "GET /api/sta");
+    for (int t = 0; t < 8; t++) fake_advance_ms(1000);
+    CHECK(b.open());
+    for (int t = 0; t < 3; t++) fake_advance_ms(1000);
+    CHECK(b.c.reset);
+
+    // A client that never ACKs the page: the stalled response is reset too
+    Client c;
+    CHECK(c.connect());
+    fake_send(c.c, get("/"));
+    for (int t = 0; t < 11; t++) fake_advance_ms(1000);
+    CHECK(c.c.reset);
+    clean_end();
+}
+
+// The stack out of memory mid-response: the connection is torn down, its pool
+// slot comes back
+static void test_write_failure()
+{
+    Client a;
+    CHECK(a.connect());
+    fake_fail_writes(1);
+    fake_send(a.c, get("/api/status"));
+    CHECK(!a.open());
+    Client c[5];
+    for (auto& x : c) CHECK(x.connect());
+    CHECK(fake_open_pcbs() == 5);
+    for (auto& x : c) x.close();
+    clean_end();
+}
+
+// Live-status streams: three at most, the next one gets a 503
+static void test_events_limit()
+{
+    Client c[4];
+    for (int i = 0; i < 4; i++) {
+        CHECK(c[i].connect());
+        fake_send(c[i].c, get("/api/events"));
+    }
+    for (int i = 0; i < 3; i++) CHECK(c[i].open() && c[i].c.rx.find("text/event-stream") != std::string::npos);
+    auto rs = c[3].drain();
+    CHECK(rs.size() == 1 && rs[0].status == 503 && c[3].c.fin);
+
+    fake_advance_ms(300);
+    web_server_tick();
+    for (int i = 0; i < 3; i++) CHECK(c[i].c.rx.find("data: {") != std::string::npos);
+    for (auto& x : c) x.close();
+    web_server_tick();
+    clean_end();
+}
+
+// Clients at random: pipelined batches, partial ACKs, idle spells, FINs, more
+// clients than pool slots. Every answer arrives once and in order; a
+// connection only ever goes away with nothing outstanding.
+static void test_load()
+{
+    const int CLIENTS = 12, STEPS = 40000;
+    std::mt19937 rng(12345);
+    auto pct = [&](int p) { return (int)(rng() % 100) < p; };
+    std::vector<std::unique_ptr<Client>> cl;
+    std::vector<std::deque<int>> want(CLIENTS);
+    for (int i = 0; i < CLIENTS; i++) cl.push_back(std::make_unique<Client>());
+
+    long requests = 0, answered = 0, refused = 0, pages = 0;
+    bool in_order = true, lost = false;
+    auto collect = [&](int i) {
+        Resp r;
+        while (cl[i]->next(r)) {
+            if (want[i].empty() || r.status != want[i].front()) in_order = false;
+            if (!want[i].empty()) want[i].pop_front();
+            answered++;
+        }
+        if (!cl[i]->open() && cl[i]->c.pcb) {
+            if (!want[i].empty()) lost = true;
+            want[i].clear();
+            cl[i]->c.pcb = nullptr;
+        }
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int step = 0; step < STEPS; step++) {
+        int i = (int)(rng() % CLIENTS);
+        Client& c = *cl[i];
+        if (!c.open()) {
+            if (c.connect()) {
+                want[i].clear();
+            } else {
+                refused++;
+                c.c.pcb = nullptr;
+            }
+        } else if (pct(45)) {
+            // A pipelined batch of 1..4, now and then the page
+            std::string batch;
+            int n = 1 + (int)(rng() % 4);
+            for (int k = 0; k < n; k++) {
+                if (pct(3)) {
+                    batch += get("/", "Accept-Encoding: gzip\r\n");
+                    want[i].push_back(200);
+                    pages++;
+                } else {
+                    int r = (int)(rng() % 3);
+                    batch += rota(r);
+                    want[i].push_back(ROTA_STATUS[r]);
+                }
+            }
+            requests += n;
+            size_t sent = fake_send(c.c, batch, 1 + rng() % 1460);
+            if (sent < batch.size()) {
+                // Window shut: the rest goes after the ACKs have opened it
+                ack_all(c);
+                sent += fake_send(c.c, batch.substr(sent));
+            }
+            CHECK(sent == batch.size());
+        } else if (pct(70)) {
+            fake_ack(c.c, rng() % 6000);
+        } else if (pct(5) && want[i].empty()) {
+            c.close();
+        } else {
+            fake_advance_ms(rng() % 400);
+        }
+        // Everyone with answers in flight keeps ACKing now and then, so
+        // nothing stalls into the request timeout
+        for (int j = 0; j < CLIENTS; j++) {
+            if (cl[j]->open() && !want[j].empty() && pct(30)) fake_ack(cl[j]->c);
+            collect(j);
+        }
+    }
+    for (int i = 0; i < CLIENTS; i++) {
+        ack_all(*cl[i]);
+        collect(i);
+        cl[i]->close();
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    CHECK(in_order);
+    CHECK(!lost);
+    CHECK(answered == requests);
+    CHECK(requests > 10000);
+    CHECK(refused < requests / 10);
+    std::printf("load: %ld requests (%ld pages) from %d clients, %ld refused connects, "
+                "%.0f requests/s host\n", requests, pages, CLIENTS, refused, requests / s);
+    clean_end();
+}
+
+int main()
+{
+    web_server_init(&s_state);
+    test_keep_alive();
+    test_pipelined_in_order();
+    test_pipelining_throttled();
+    test_window_backpressure();
+    test_page_then_pipelined();
+    test_pool_eviction();
+    test_pool_full();
+    test_too_large();
+    test_split_segments();
+    test_timeouts();
+    test_write_failure();
+    test_events_limit();
+    test_load();
+    return check_exit("web_server_load_test");
+}
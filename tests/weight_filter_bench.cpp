@@ -0,0 +1,311 @@
+// Offline replay of a raw HX711 stream through WeightFilter settings
+// (drivers/hx711/weight_filter.hpp): noise and latency after each stage of
+// the chain - median, then smoother, then decimator - for a list of
+// candidate settings.
+//
+//   weight_filter_bench                      synthetic 80 SPS dispense stream
+//   weight_filter_bench FILE [COLUMN [CPG [SPS]]]
+//
+// FILE holds one value per line, or CSV with a header naming COLUMN
+// (default "raw"). Values are raw counts; a gram column (e.g. gross_g of
+// /api/log.csv) is turned into counts with CPG counts per gram. SPS is the
+// stream's rate (default 80).
+//
+// Measured on any stream:
+//   lag    the delay (input samples, shown in ms) that best lines the output
+//          up with the raw input - least squares over the whole record
+//   noise  spread of the output around a local straight line (0.5 s window),
+//          so the dispense ramp doesn't count: the median absolute residual
+//          as a standard deviation, so load steps and the odd spike don't
+//          either (those show in err)
+// On the synthetic stream, which knows its true weight, also:
+//   err    RMS of output - truth, delayed by the measured lag, on still parts
+//   step   time for the output to cover half of a 100 g load step
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "weight_filter.hpp"
+
+struct Stream {
+    std::vector<int32_t> raw;
+    std::vector<double>  truth;   // counts; empty for a recorded stream
+    int    step_at = -1;          // synthetic load step (input index)
+    double step_counts = 0.0;
+    double cpg = 1.0;
+    double sps = 80.0;
+};
+
+// 60 s at 80 SPS: still, a 20 g/s dispense ramp, still, a 100 g step on and
+// off (a bump on the hanging bag). White noise of a loaded HX711 at 80 SPS
+// plus rare spikes (vibrator knocks, servo current steps).
+static Stream synthetic()
+{
+    Stream s;
+    s.cpg = 420.0;
+    s.sps = 80.0;
+    const double offset = 80000.0, bag_g = 5000.0;
+    const int n = 60 * 80;
+    std::mt19937 rng(12345);
+    std::normal_distribution<double> noise(0.0, 0.6 * s.cpg);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    s.step_at = 40 * 80;
+    s.step_counts = 100.0 * s.cpg;
+    for (int k = 0; k < n; k++) {
+        double t = k / s.sps;
+        double g = bag_g;
+        if (t >= 5.0) g -= 20.0 * (t < 15.0 ? t - 5.0 : 10.0);
+        if (k >= s.step_at && t < 45.0) g += 100.0;
+        double c = offset + g * s.cpg;
+        s.truth.push_back(c);
+        double x = c + noise(rng);
+        if (u(rng) < 0.01) x += (u(rng) < 0.5 ? -1.0 : 1.0) * 15.0 * s.cpg;
+        s.raw.push_back((int32_t)std::lround(x));
+    }
+    return s;
+}
+
+static bool load(const char* path, const char* column, double cpg, double sps, Stream& s)
+{
+    FILE* f = std::fopen(path, "r");
+    if (!f) {
+        std::fprintf(stderr, "can't open %s\n", path);
+        return false;
+    }
+    s.cpg = cpg;
+    s.sps = sps;
+    char line[512];
+    int col = 0;
+    bool first = true;
+    while (std::fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;   // run meta, blank
+        // Split on commas
+        std::vector<std::string> fields;
+        std::string cur;
+        for (const char* p = line; *p && *p != '\n' && *p != '\r'; p++) {
+            if (*p == ',') { fields.push_back(cur); cur.clear(); }
+            else cur += *p;
+        }
+        fields.push_back(cur);
+        if (first) {
+            first = false;
+            char* end = nullptr;
+            std::strtod(fields[0].c_str(), &end);
+            if (end == fields[0].c_str()) {   // a header
+                col = -1;
+                for (size_t i = 0; i < fields.size(); i++) {
+                    if (fields[i] == column) col = (int)i;
+                }
+                if (col < 0) {
+                    std::fprintf(stderr, "no column '%s' in %s\n", column, path);
+                    std::fclose(f);
+                    return false;
+                }
+                continue;
+            }
+        }
+        if (col >= (int)fields.size()) continue;
+        s.raw.push_back((int32_t)std::lround(std::strtod(fields[col].c_str(), nullptr) * cpg));
+    }
+    std::fclose(f);
+    if (s.raw.size() < 200) {
+        std::fprintf(stderr, "%s: only %zu values\n", path, s.raw.size());
+        return false;
+    }
+    return true;
+}
+
+struct Out {
+    std::vector<int>    at;   // input index the value was emitted on
+    std::vector<double> y;
+};
+
+static Out run(const Stream& s, const WeightFilterConfig& cfg)
+{
+    WeightFilter f;
+    f.configure(cfg);
+    Out o;
+    for (size_t k = 0; k < s.raw.size(); k++) {
+        int32_t y;
+        if (f.push(s.raw[k], y)) {
+            o.at.push_back((int)k);
+            o.y.push_back((double)y);
+        }
+    }
+    return o;
+}
+
+// Reference at a fractional input index (linear interpolation)
+static double at(const std::vector<double>& v, double idx)
+{
+    if (idx <= 0.0) return v.front();
+    size_t i = (size_t)idx;
+    if (i + 1 >= v.size()) return v.back();
+    double fr = idx - (double)i;
+    return v[i] + (v[i + 1] - v[i]) * fr;
+}
+
+// Best lag in input samples, 0..40 in quarter steps. The output is held
+// between emissions, so every input index is compared.
+static double measure_lag(const Stream& s, const Out& o, const std::vector<double>& ref)
+{
+    double best_l = 0.0, best_e = 1e300;
+    for (double l = 0.0; l <= 40.0; l += 0.25) {
+        double e = 0.0;
+        size_t j = 0;
+        for (size_t k = 100; k < s.raw.size(); k++) {
+            while (j + 1 < o.at.size() && o.at[j + 1] <= (int)k) j++;
+            double d = o.y[j] - at(ref, (double)k - l);
+            e += d * d;
+        }
+        if (e < best_e) { best_e = e; best_l = l; }
+    }
+    return best_l;
+}
+
+// Robust spread around a local line through the emitted values within
+// +-0.25 s (1.4826 x median absolute residual = sigma for Gaussian noise)
+static double measure_noise(const Stream& s, const Out& o)
+{
+    int half = (int)(0.25 * s.sps);
+    std::vector<double> res;
+    size_t lo = 0, hi = 0;
+    for (size_t i = 0; i < o.at.size(); i++) {
+        while (o.at[lo] < o.at[i] - half) lo++;
+        while (hi + 1 < o.at.size() && o.at[hi + 1] <= o.at[i] + half) hi++;
+        int m = (int)(hi - lo + 1);
+        if (m < 5) continue;
+        double sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (size_t j = lo; j <= hi; j++) {
+            double x = o.at[j] - o.at[i];
+            sx += x; sy += o.y[j]; sxx += x * x; sxy += x * o.y[j];
+        }
+        double den = m * sxx - sx * sx;
+        if (den <= 0.0) continue;
+        double b = (m * sxy - sx * sy) / den;
+        double a = (sy - b * sx) / m;   // line at x = 0
+        res.push_back(std::fabs(o.y[i] - a));
+    }
+    if (res.empty()) return 0.0;
+    std::nth_element(res.begin(), res.begin() + res.size() / 2, res.end());
+    return 1.4826 * res[res.size() / 2];
+}
+
+// Synthetic only: RMS vs the truth on still parts (no ramp or step within
+// half a second), after the lag
+static double measure_err(const Stream& s, const Out& o, double lag)
+{
+    double sum = 0.0;
+    int n = 0;
+    int guard = (int)(0.5 * s.sps);
+    for (size_t i = 0; i < o.at.size(); i++) {
+        int k = o.at[i];
+        double t = k / s.sps;
+        bool moving = (t > 4.5 && t < 15.5) || std::abs(k - s.step_at) < guard ||
+                      std::fabs(t - 45.0) < 0.5;
+        if (moving || k < guard) continue;
+        double d = o.y[i] - at(s.truth, (double)k - lag);
+        sum += d * d;
+        n++;
+    }
+    return n ? std::sqrt(sum / n) : 0.0;
+}
+
+static double measure_step_ms(const Stream& s, const Out& o)
+{
+    double before = s.truth[s.step_at - 1];
+    double half = before + 0.5 * s.step_counts;
+    for (size_t i = 0; i < o.at.size(); i++) {
+        if (o.at[i] >= s.step_at && o.y[i] >= half) return (o.at[i] - s.step_at) * 1000.0 / s.sps;
+    }
+    return -1.0;
+}
+
+struct Candidate {
+    const char* name;
+    WeightFilterConfig cfg;
+};
+
+static WeightFilterConfig make(uint8_t median, FilterStage smooth, uint8_t taps, float alpha, uint8_t dec)
+{
+    WeightFilterConfig c;
+    c.median = median;
+    c.smooth = smooth;
+    c.fir_taps = taps;
+    c.iir_alpha = alpha;
+    c.decimate = dec;
+    return c;
+}
+
+int main(int argc, char** argv)
+{
+    Stream s;
+    if (argc > 1) {
+        const char* column = argc > 2 ? argv[2] : "raw";
+        double cpg = argc > 3 ? std::atof(argv[3]) : 1.0;
+        double sps = argc > 4 ? std::atof(argv[4]) : 80.0;
+        if (!(cpg > 0.0) || !(sps > 0.0) || !load(argv[1], column, cpg, sps, s)) return 1;
+        std::printf("%s: %zu values at %.0f SPS\n", argv[1], s.raw.size(), s.sps);
+    } else {
+        s = synthetic();
+        std::printf("synthetic: %zu values at %.0f SPS, %.0f counts/g\n", s.raw.size(), s.sps, s.cpg);
+    }
+    const bool synth = !s.truth.empty();
+
+    // The raw input as the lag reference; for the recorded stream its noise
+    // only adds a constant to every lag's error
+    std::vector<double> ref(s.raw.begin(), s.raw.end());
+    if (synth) ref = s.truth;
+
+    const Candidate cands[] = {
+        {"raw",              make(1, FilterStage::None, 4, 0.5f, 1)},
+        {"med3",             make(3, FilterStage::None, 4, 0.5f, 1)},
+        {"med5",             make(5, FilterStage::None, 4, 0.5f, 1)},
+        {"med3 fir4 d2",     make(3, FilterStage::Fir, 4, 0.5f, 2)},
+        {"med3 fir8 d4",     make(3, FilterStage::Fir, 8, 0.5f, 4)},
+        {"med5 fir8 d2",     make(5, FilterStage::Fir, 8, 0.5f, 2)},
+        {"med3 iir0.3 d2",   make(3, FilterStage::Iir, 4, 0.3f, 2)},
+        {"med3 iir0.15 d2",  make(3, FilterStage::Iir, 4, 0.15f, 2)},
+        {"fir8 d8 (10 SPS)", make(1, FilterStage::Fir, 8, 0.5f, 8)},
+    };
+
+    std::printf("\n%-17s %-8s %7s %7s %9s %8s", "setting", "stage", "theory", "lag", "noise", "noise");
+    if (synth) std::printf(" %8s %8s", "err", "step");
+    std::printf("\n%-17s %-8s %7s %7s %9s %8s", "", "", "ms", "ms", "counts", "g");
+    if (synth) std::printf(" %8s %8s", "g", "ms");
+    std::printf("\n");
+
+    const double ms_per = 1000.0 / s.sps;
+    for (const Candidate& c : cands) {
+        // Each stage of the chain on its own: the prefix up to it
+        WeightFilterConfig stages[3] = {c.cfg, c.cfg, c.cfg};
+        stages[0].smooth = FilterStage::None;
+        stages[0].decimate = 1;
+        stages[1].decimate = 1;
+        const char* names[3] = {"median", "smooth", "decim"};
+        int first = 0, last = 2;
+        if (c.cfg.smooth == FilterStage::None && c.cfg.decimate == 1) last = 0;
+        for (int st = first; st <= last; st++) {
+            if (st == 1 && c.cfg.smooth == FilterStage::None) continue;
+            if (st == 2 && c.cfg.decimate == 1) continue;
+            WeightFilter probe;
+            probe.configure(stages[st]);
+            Out o = run(s, stages[st]);
+            double lag = measure_lag(s, o, ref);
+            double noise = measure_noise(s, o);
+            std::printf("%-17s %-8s %7.1f %7.1f %9.1f %8.3f", st == first ? c.name : "", names[st],
+                        probe.delay_samples() * ms_per, lag * ms_per, noise, noise / s.cpg);
+            if (synth) {
+                std::printf(" %8.3f %8.1f", measure_err(s, o, lag) / s.cpg, measure_step_ms(s, o));
+            }
+            std::printf("\n");
+        }
+    }
+    return 0;
+}